@@ -133,6 +133,7 @@ if (KickstartRT_SDK_WITH_DX12)
 
     target_link_libraries(${SDK_NAME}_core_DX12 PRIVATE
         "d3d12.lib"
+        "dxgi.lib"
         "dxguid.lib"
     )
 
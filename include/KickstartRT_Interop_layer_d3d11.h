@@ -105,10 +105,19 @@ namespace KickstartRT {
 			UsingCommandQueue usingCommandQueue = UsingCommandQueue::Direct;
 			uint32_t		supportedWorkingSet = 4u;
 			uint32_t		descHeapSize = 8192u;
+			// Number of CBV/SRV/UAV descriptors reserved in each task working set to cache descriptor tables across frames. Zero disables the cache.
+			// Application resources referenced by cached tables must not be released and recreated at the same address while the cache is enabled.
+			uint32_t		descTableCacheSize = 0u;
+			// Page size of the volatile constant buffer of each task working set. Pages are added when a task uses more than a page.
 			uint32_t		uploadHeapSizeForVolatileConstantBuffers = 64u * 1024u;
+			SharedBufferSettings	sharedBufferSettings = {};
 
 			uint32_t*		coldLoadShaderList = nullptr;
 			uint32_t		coldLoadShaderListSize = 0u;
+
+			// Path of a file to load compiled PSOs from at init and to save them to at destruction. Null disables the pipeline cache.
+			// The file is discarded when it was written by a different SDK version, device or driver.
+			const wchar_t*	pipelineCacheFilePath = nullptr;
 		};
 
 #define KickstartRT_DECLSPEC_INL KickstartRT_Interop_D3D11_DECLSPEC
@@ -293,6 +293,138 @@ namespace KickstartRT {
 
 		size_t m_numResources[(size_t)ResourceKind::e_Num_Kinds];
 		size_t m_totalRequestedBytes[(size_t)ResourceKind::e_Num_Kinds];
+
+		/**
+		* Shared buffer pools that suballocate entries from large blocks.
+		*/
+		enum class SharedPool {
+			e_VertexTemporary = 0,
+			e_VertexPersistent,
+			e_DirectLightingCache,
+			e_DirectLightingCacheTemp,
+			e_Counter,
+			e_Readback,
+			e_BLASTemporary,
+			e_BLASPermanent,
+			e_BLASScratchTemp,
+			e_BLASScratchPerm,
+			e_Num_Pools,
+		};
+
+		/**
+		* Free runs are counted in bins of 4KB, 16KB, 64KB, 256KB, 1MB, 4MB, 16MB and larger. Bin i counts runs smaller than 4KB << (2 * i).
+		*/
+		static constexpr size_t kNumFreeRunHistogramBins = 8;
+
+		/**
+		* Utilization of the blocks in a shared pool. Blocks allocated exclusively for large entries are included in both committed and allocated bytes.
+		*/
+		struct SharedPoolUtilization {
+			size_t m_committedBlockBytes;	// total size of the buffer blocks.
+			size_t m_allocatedBytes;		// total size of live allocations.
+			size_t m_freeBytes;				// total size of free runs in shared blocks.
+			size_t m_largestFreeRunBytes;	// size of the largest free run, which limits the largest allocation without adding a block.
+			size_t m_freeRunHistogram[kNumFreeRunHistogramBins];
+			size_t m_numBlocksOverHardLimit;	// number of blocks added beyond the hard limit of the pool's memory budget category.
+		};
+
+		SharedPoolUtilization m_sharedPools[(size_t)SharedPool::e_Num_Pools];
+	};
+
+	/**
+	* Block settings of a shared buffer pool. Zero selects the default value of the pool.
+	*/
+	struct SharedBufferPoolSettings
+	{
+		uint64_t	blockSizeInBytes = 0ull;	// size of a shared block. Needs to be power of two. Allocations larger than the half of it get exclusive buffers.
+		uint64_t	pageSizeInBytes = 0ull;		// allocation granularity. Needs to be power of two and not smaller than the allocation alignment of the pool.
+		uint32_t	smallPageThreshold = 0u;	// allocations up to this number of pages take a whole free run if it is less than 3/2 of the size. Only used by the fixed page allocator.
+	};
+
+	/**
+	* Block settings of the shared buffer pools, which are passed with ExecuteContext_InitSettings.
+	* In auto grow mode, the block size of a pool is doubled when the ratio of exclusive allocations or the number of shared blocks exceeds the thresholds.
+	* A new block size takes effect once the pool has released all of its shared blocks.
+	*/
+	struct SharedBufferSettings
+	{
+		SharedBufferPoolSettings	pools[(size_t)ResourceAllocations::SharedPool::e_Num_Pools];
+
+		bool		autoGrowBlockSize = false;
+		float		autoGrowExclusiveAllocationRatio = 0.05f;
+		uint32_t	autoGrowBlockCountThreshold = 16u;
+		uint64_t	autoGrowMaxBlockSizeInBytes = 256ull * 1024ull * 1024ull;
+	};
+
+	/**
+	* Memory budget of the shared buffer pools, which is set with ExecuteContext::SetMemoryBudget().
+	* Pools are grouped into categories and the limits are applied to the total size of the committed blocks in each category. A limit of zero means unlimited.
+	*/
+	struct MemoryBudget
+	{
+		enum class PoolCategory {
+			e_Persistent = 0,		// VertexPersistent, DirectLightingCache, BLASPermanent and BLASScratchPerm pools.
+			e_Temporal,				// VertexTemporary, DirectLightingCacheTemp, BLASTemporary and BLASScratchTemp pools.
+			e_ReadbackAndCounter,	// Readback and Counter pools.
+			e_Num_Categories,
+		};
+
+		struct Limits {
+			size_t		m_softLimitInBytes = 0;		// while exceeding it, empty blocks are released immediately.
+			size_t		m_hardLimitInBytes = 0;		// adding a block beyond it is reported with a warning and counted in SharedPoolUtilization.
+			uint32_t	m_numWarmSpareBlocks = 0;	// number of empty blocks kept for reuse in each pool while under the soft limit.
+		};
+
+		Limits m_categories[(size_t)PoolCategory::e_Num_Categories];
+	};
+
+	/**
+	* Statistics of the descriptor table cache, which are summed over all task working sets. All values are zero if the cache is disabled or not supported by the graphics API.
+	*/
+	struct DescriptorTableCacheStatistics
+	{
+		uint64_t	m_numHits;				// tables that were reused without writing descriptors.
+		uint64_t	m_numMisses;			// tables that were written, including the ones that could not be cached.
+		uint64_t	m_numEvictions;			// least recently used tables evicted to make room for new ones.
+		uint32_t	m_numCachedTables;		// tables currently in the caches.
+		uint32_t	m_numCachedDescriptors;	// descriptors occupied by the cached tables.
+	};
+
+	/**
+	* Usage of the volatile constant buffers of all task working sets, which can be used to tune uploadHeapSizeForVolatileConstantBuffers in ExecuteContext_InitSettings.
+	*/
+	struct VolatileConstantBufferStatistics
+	{
+		uint64_t	m_highWaterMarkInBytes;	// the largest size of constant buffers used in a single task.
+		uint64_t	m_allocatedSizeInBytes;	// total size of the upload pages.
+		uint32_t	m_numPages;				// upload pages. A page is added when a task runs out of the current ones.
+	};
+
+	/**
+	* Counters of TLAS builds since the execute context was created. TLAS is refitted instead of rebuilt when it is enabled with maxTLASRefitCount in BVHBuildTask.
+	* Instances are split into a static and a dynamic TLAS by InstanceInput::isStatic, and each of them is counted separately.
+	*/
+	struct TLASBuildStatistics
+	{
+		enum class Partition : uint32_t {
+			e_Static = 0,
+			e_Dynamic,
+			e_Num_Partitions
+		};
+
+		struct PartitionStatistics {
+			uint64_t	m_numRebuilds;				// TLAS builds from scratch, including the forced ones.
+			uint64_t	m_numRefits;				// TLAS updates that refitted the previous TLAS.
+			uint64_t	m_numForcedRebuilds;		// rebuilds forced by maxTLASRefitCount while the instance set was unchanged.
+			uint32_t	m_numRefitsSinceRebuild;	// consecutive refits since the last rebuild.
+			uint32_t	m_numInstances;				// instances in the TLAS at the last build.
+			uint32_t	m_numUploadedInstanceDescs;	// instance descs uploaded by the last build.
+			uint64_t	m_TLASSizeInBytes;			// size of the TLAS buffer.
+			double		m_lastBuildCPUTimeInMs;		// CPU time spent to record the last build.
+			double		m_totalBuildCPUTimeInMs;	// CPU time spent to record all builds.
+		};
+
+		PartitionStatistics	m_partitions[(size_t)Partition::e_Num_Partitions];
 	};
 
 	/**
@@ -1066,6 +1066,7 @@ namespace BVHTask
 		GeometryHandle			geomHandle = GeometryHandle::Null;
 		InstanceInclusionMask	instanceInclusionMask = InstanceInclusionMask::Default;
 		bool					participatingInTLAS = true;
+		bool					isStatic = false; // Static instances are placed in a separate TLAS that is only rebuilt when its instance set changes.
 		float					initialTileColor[3] = { 0.f, 0.f, 0.f };
 	};
 
@@ -1135,6 +1136,14 @@ namespace BVHTask
 		*/
 		bool	 buildTLAS = true;
 
+		/**
+		* The max number of consecutive TLAS refits.
+		* When the instance set of TLAS is unchanged and only transforms or masks of instances are updated, TLAS is refitted instead of rebuilt,
+		* and it is rebuilt from scratch after this number of refits to bound the loss of trace performance.
+		* Set 0 to always rebuild TLAS. TLAS is built with the update flag only when this is not 0.
+		*/
+		uint32_t maxTLASRefitCount = 0u;
+
 		BVHBuildTask() : Task(Type::BVHBuild) {};
 	};
 
@@ -1331,6 +1340,24 @@ public:
 	 */
 	virtual Status GetLoadedShaderList(uint32_t* loadedListBuffer, size_t bufferSize, size_t* retListSize) = 0;
 
+	/**
+	 * Creates PSOs of the listed shaders on worker threads in advance of use, to avoid hitching when a shader permutation appears for the first time.
+	 * Only compute (inline raytracing) PSOs are warmed up. Shader tables are still created on first use.
+	 * Compile times of each PSO are reported through the log callback.
+	 * @param [in] shaderList Shader IDs in the same format as GetLoadedShaderList() returns.
+	 * @param [in] listSize The size of the shaderList.
+	 * @param [in] numThreads The number of worker threads when they are started. Zero uses the number of hardware threads minus one.
+	 * @param [in] skipPendingShaders If true, trace tasks whose shader permutation is not ready yet are skipped and their outputs are not written. Otherwise BuildGPUTask waits for the permutation.
+	 * @return Returns Status::OK if succeeded.
+	 */
+	virtual Status WarmUpShaders(const uint32_t* shaderList, size_t listSize, uint32_t numThreads, bool skipPendingShaders) = 0;
+
+	/**
+	 * Blocks until all shaders queued by WarmUpShaders() are created.
+	 * @return Returns Status::OK if succeeded.
+	 */
+	virtual Status WaitForShaderWarmUp() = 0;
+
 	/**
 	 * Returns the current VRAM resource allocation by the SDK.
 	 * @param [in, out] retStatus The storage to return the allocation information.
@@ -1338,6 +1365,42 @@ public:
 	 */
 	virtual Status GetCurrentResourceAllocations(KickstartRT::ResourceAllocations* retStatus) = 0;
 
+	/**
+	 * Sets the memory budget of the shared buffer pools. Empty blocks are released immediately while a category exceeds its soft limit,
+	 * and adding a block beyond the hard limit is reported instead of growing silently.
+	 * @param [in] budget The limits of each pool category. The soft limit must not be larger than the hard limit if both are set.
+	 * @return Returns Status::OK if succeeded.
+	 */
+	virtual Status SetMemoryBudget(const KickstartRT::MemoryBudget* budget) = 0;
+
+	/**
+	 * Returns the current memory budget of the shared buffer pools.
+	 * @param [in, out] retBudget The storage to return the memory budget.
+	 * @return Returns Status::OK if succeeded.
+	 */
+	virtual Status GetMemoryBudget(KickstartRT::MemoryBudget* retBudget) = 0;
+
+	/**
+	 * Returns hit and miss counters of the descriptor table cache, which is enabled with descTableCacheSize in ExecuteContext_InitSettings.
+	 * @param [in, out] retStatistics The storage to return the statistics.
+	 * @return Returns Status::OK if succeeded.
+	 */
+	virtual Status GetDescriptorTableCacheStatistics(KickstartRT::DescriptorTableCacheStatistics* retStatistics) = 0;
+
+	/**
+	 * Returns the high-water mark and the allocated size of the volatile constant buffers.
+	 * @param [in, out] retStatistics The storage to return the statistics.
+	 * @return Returns Status::OK if succeeded.
+	 */
+	virtual Status GetVolatileConstantBufferStatistics(KickstartRT::VolatileConstantBufferStatistics* retStatistics) = 0;
+
+	/**
+	 * Returns the number of TLAS rebuilds and refits.
+	 * @param [in, out] retStatistics The storage to return the statistics.
+	 * @return Returns Status::OK if succeeded.
+	 */
+	virtual Status GetTLASBuildStatistics(KickstartRT::TLASBuildStatistics* retStatistics) = 0;
+
 	/**
 	 * By calling this, A CSV file will be written to the provided path with the resouce allocation information.
 	 * This can be used to understand the current resource allocations.
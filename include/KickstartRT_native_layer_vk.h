@@ -158,10 +158,16 @@ namespace KickstartRT {
 
 			uint32_t		supportedWorkingsets = 2u;
 			uint32_t		descHeapSize = 8192u;
+			// Page size of the volatile constant buffer of each task working set. Pages are added when a task uses more than a page.
 			uint32_t		uploadHeapSizeForVolatileConstantBuffers = 64u * 1024u;
+			SharedBufferSettings	sharedBufferSettings = {};
 
 			uint32_t* coldLoadShaderList = nullptr;
 			uint32_t		coldLoadShaderListSize = 0u;
+
+			// Path of a file to load compiled PSOs from at init and to save them to at destruction. Null disables the pipeline cache.
+			// The file is discarded when it was written by a different SDK version, device or driver.
+			const wchar_t*	pipelineCacheFilePath = nullptr;
 		};
 #ifdef WIN32
 #define KickstartRT_DECLSPEC_INL KickstartRT_DECLSPEC
@@ -386,11 +386,46 @@ namespace KickstartRT_ExportLayer
 		return m_persistentWorkingSet->m_SDK_12->GetLoadedShaderList(loadedListBuffer, bufferSize, retListSize);
 	}
 
+	Status ExecuteContext_impl::WarmUpShaders(const uint32_t* shaderList, size_t listSize, uint32_t numThreads, bool skipPendingShaders)
+	{
+		return m_persistentWorkingSet->m_SDK_12->WarmUpShaders(shaderList, listSize, numThreads, skipPendingShaders);
+	}
+
+	Status ExecuteContext_impl::WaitForShaderWarmUp()
+	{
+		return m_persistentWorkingSet->m_SDK_12->WaitForShaderWarmUp();
+	}
+
 	Status ExecuteContext_impl::GetCurrentResourceAllocations(ResourceAllocations* retStatus)
 	{
 		return m_persistentWorkingSet->m_SDK_12->GetCurrentResourceAllocations(retStatus);
 	}
 
+	Status ExecuteContext_impl::SetMemoryBudget(const MemoryBudget* budget)
+	{
+		return m_persistentWorkingSet->m_SDK_12->SetMemoryBudget(budget);
+	}
+
+	Status ExecuteContext_impl::GetMemoryBudget(MemoryBudget* retBudget)
+	{
+		return m_persistentWorkingSet->m_SDK_12->GetMemoryBudget(retBudget);
+	}
+
+	Status ExecuteContext_impl::GetDescriptorTableCacheStatistics(DescriptorTableCacheStatistics* retStatistics)
+	{
+		return m_persistentWorkingSet->m_SDK_12->GetDescriptorTableCacheStatistics(retStatistics);
+	}
+
+	Status ExecuteContext_impl::GetVolatileConstantBufferStatistics(VolatileConstantBufferStatistics* retStatistics)
+	{
+		return m_persistentWorkingSet->m_SDK_12->GetVolatileConstantBufferStatistics(retStatistics);
+	}
+
+	Status ExecuteContext_impl::GetTLASBuildStatistics(TLASBuildStatistics* retStatistics)
+	{
+		return m_persistentWorkingSet->m_SDK_12->GetTLASBuildStatistics(retStatistics);
+	}
+
 	Status ExecuteContext_impl::BeginLoggingResourceAllocations(const wchar_t* filePath)
 	{
 		return m_persistentWorkingSet->m_SDK_12->BeginLoggingResourceAllocations(filePath);
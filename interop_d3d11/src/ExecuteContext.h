@@ -78,8 +78,15 @@ namespace KickstartRT_ExportLayer
 		Status ReleaseDeviceResourcesImmediately() override;
 
 		Status GetLoadedShaderList(uint32_t* loadedListBuffer, size_t bufferSize, size_t* retListSize) override;
+		Status WarmUpShaders(const uint32_t* shaderList, size_t listSize, uint32_t numThreads, bool skipPendingShaders) override;
+		Status WaitForShaderWarmUp() override;
 
 		Status GetCurrentResourceAllocations(ResourceAllocations* retStatus) override;
+		Status SetMemoryBudget(const MemoryBudget* budget) override;
+		Status GetMemoryBudget(MemoryBudget* retBudget) override;
+		Status GetDescriptorTableCacheStatistics(DescriptorTableCacheStatistics* retStatistics) override;
+		Status GetVolatileConstantBufferStatistics(VolatileConstantBufferStatistics* retStatistics) override;
+		Status GetTLASBuildStatistics(TLASBuildStatistics* retStatistics) override;
 		Status BeginLoggingResourceAllocations(const wchar_t * filePath) override;
 		Status EndLoggingResourceAllocations() override;
 	};
@@ -334,10 +334,13 @@ namespace KickstartRT_ExportLayer
 
 			initSettings_12.D3D12Device = m_device_12.Get();
 			initSettings_12.descHeapSize = initSettings->descHeapSize;
+			initSettings_12.descTableCacheSize = initSettings->descTableCacheSize;
 			initSettings_12.supportedWorkingsets = initSettings->supportedWorkingSet;
 			initSettings_12.uploadHeapSizeForVolatileConstantBuffers = initSettings->uploadHeapSizeForVolatileConstantBuffers;
+			initSettings_12.sharedBufferSettings = initSettings->sharedBufferSettings;
 			initSettings_12.coldLoadShaderList = initSettings->coldLoadShaderList;
 			initSettings_12.coldLoadShaderListSize = initSettings->coldLoadShaderListSize;
+			initSettings_12.pipelineCacheFilePath = initSettings->pipelineCacheFilePath;
 
 			auto sts = D3D12::ExecuteContext::Init(&initSettings_12, &m_SDK_12);
 			if (sts != Status::OK) {
@@ -104,6 +104,7 @@ namespace KickstartRT_ExportLayer
 		std::copy(std::begin(src.initialTileColor), std::end(src.initialTileColor), std::begin(dst.initialTileColor));
 		dst.transform = src.transform;
 		dst.participatingInTLAS = src.participatingInTLAS;
+		dst.isStatic = src.isStatic;
 		dst.instanceInclusionMask = (D3D12::BVHTask::InstanceInclusionMask)src.instanceInclusionMask;
 	}
 
@@ -125,6 +126,7 @@ namespace KickstartRT_ExportLayer
 	{
 		task_12->maxBlasBuildCount = task_12->maxBlasBuildCount;
 		task_12->buildTLAS = task_11->buildTLAS;
+		task_12->maxTLASRefitCount = task_11->maxTLASRefitCount;
 	};
 
 	Status TaskContainer_impl::ScheduleBVHTask(const BVHTask::Task* bvhTask)
@@ -34,15 +34,15 @@
 
 // Indirection Table 4 DWORD for a TLAS instance.
 // [BufferBlockUAV index for a TLC index buffer][offst for a TLC index buffer][BufferBlockUAV index for a TLC buffer][offst for a TLC buffer]....
-//[[vk::binding(1, 1)]]
-KS_VK_BINDING(1, 1)
+//[[vk::binding(2, 1)]]
+KS_VK_BINDING(2, 1)
 RWBuffer<uint4>   u_directLightingCacheIndirectionTable : register(u0, space1);
 
 // A entry consists of a pair of indexBuffer and Buffer [DirectLightingCache Index for TLASInstance:0][DirectLightingCache Buffer for TLAS Instance:0]....
 // If KICKSTARTRT_ENABLE_DIRECT_LIGHTING_CACHE_INDIRECTION_TABLE is enabled, the UAV array will be.. [UAV for zero View][UAV for null View][UAV for shared buffer block:0 for DirectLightingCache Buffer]...
 // unbounded size.
-//[[vk::binding(2, 1)]]
-KS_VK_BINDING(2, 1)
+//[[vk::binding(3, 1)]]
+KS_VK_BINDING(3, 1)
 DLCBufferType   u_directLightingCacheBuffer[]       : register(u1, space1);
 
 /* This didn't work well with VK. Seems "out RWBuffer<uint>" wasn't treated properly.
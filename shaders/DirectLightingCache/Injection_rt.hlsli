@@ -61,11 +61,26 @@ struct Payload
     float3 Col : COLOR;
 };
 
+#if !INLINE_RAY_TRACING
+// Ray payload of the LIB version, hit() is called after tracing both TLASs.
+struct HitRecord
+{
+    float RayT;
+    uint PrimitiveIndex;
+    float2 Barycentrics;
+    uint InstanceID;
+};
+#endif
+
 // ---[ Resources ]---
 //[[vk::binding(0, 1)]]
 KS_VK_BINDING(0, 1)
 RaytracingAccelerationStructure t_SceneBVH : register(t0, space1);
 
+//[[vk::binding(1, 1)]]
+KS_VK_BINDING(1, 1)
+RaytracingAccelerationStructure t_DynamicSceneBVH : register(t1, space1);
+
 //[[vk::binding(0, 0)]]
 KS_VK_BINDING(0, 0)
 ConstantBuffer<CB_Injection> CB : register(b0);
@@ -190,8 +205,30 @@ void rgs(uint2 LaunchThread)
 			ray);
 		rayQuery.Proceed();
 
-		// Process result
+		// Dynamic instances are in another TLAS. Trace it up to the closest hit in the static one.
+		RayDesc dynamicRay = ray;
 		if (rayQuery.CommittedStatus() == COMMITTED_TRIANGLE_HIT)
+			dynamicRay.TMax = rayQuery.CommittedRayT();
+		RayQuery<RAY_FLAG_FORCE_OPAQUE | RAY_FLAG_SKIP_PROCEDURAL_PRIMITIVES> dynamicRayQuery;
+		dynamicRayQuery.TraceRayInline(
+			t_DynamicSceneBVH,
+			RT_RayFlags, //ray flags
+			(uint)InstancePropertyMask::DirectLightInjectionTarget,
+			dynamicRay);
+		dynamicRayQuery.Proceed();
+
+		// Process result
+		if (dynamicRayQuery.CommittedStatus() == COMMITTED_TRIANGLE_HIT)
+		{
+			// Hit something, store lighting.
+			hit(
+				dynamicRayQuery.CommittedPrimitiveIndex(),
+				dynamicRayQuery.CommittedTriangleBarycentrics(),
+				dynamicRayQuery.CommittedInstanceID(),
+				dynamicRayQuery.CommittedRayT(),
+				payload);
+		}
+		else if (rayQuery.CommittedStatus() == COMMITTED_TRIANGLE_HIT)
 		{
 			// Hit something, store lighting.
 			hit(
@@ -202,6 +239,13 @@ void rgs(uint2 LaunchThread)
 				payload);
 		}
 #else
+		// Hit shaders only record the closest hit, since storing lighting for both TLASs would update an occluded surface.
+		HitRecord hitRecord;
+		hitRecord.RayT = -1.f;
+		hitRecord.PrimitiveIndex = 0;
+		hitRecord.Barycentrics = float2(0.f, 0.f);
+		hitRecord.InstanceID = 0;
+
 		TraceRay(
 			t_SceneBVH,
 			RT_RayFlags, // ray flags
@@ -210,7 +254,27 @@ void rgs(uint2 LaunchThread)
 			0, //MultiplierForGeometryContributionToHitGroupIndex
 			0, //MissShaderIndex
 			ray,
-			payload);
+			hitRecord);
+
+		// Dynamic instances are in another TLAS. Trace it up to the closest hit in the static one.
+		RayDesc dynamicRay = ray;
+		if (hitRecord.RayT >= 0.f)
+			dynamicRay.TMax = hitRecord.RayT;
+		TraceRay(
+			t_DynamicSceneBVH,
+			RT_RayFlags, // ray flags
+			(uint)InstancePropertyMask::DirectLightInjectionTarget,
+			0, //RayContributionToHitGroupIndex
+			0, //MultiplierForGeometryContributionToHitGroupIndex
+			0, //MissShaderIndex
+			dynamicRay,
+			hitRecord);
+
+		if (hitRecord.RayT >= 0.f)
+		{
+			// Hit something, store lighting.
+			hit(hitRecord.PrimitiveIndex, hitRecord.Barycentrics, hitRecord.InstanceID, hitRecord.RayT, payload);
+		}
 #endif
 	}
 }
@@ -240,13 +304,16 @@ void RayGen()
 }
 
 [shader("closesthit")]
-void ClosestHit(inout Payload payload, BuiltInTriangleIntersectionAttributes attrib)
+void ClosestHit(inout HitRecord hitRecord, BuiltInTriangleIntersectionAttributes attrib)
 {
-    hit(PrimitiveIndex(), attrib.barycentrics, InstanceIndex(), RayTCurrent(), payload);
+    hitRecord.RayT = RayTCurrent();
+    hitRecord.PrimitiveIndex = PrimitiveIndex();
+    hitRecord.Barycentrics = attrib.barycentrics;
+    hitRecord.InstanceID = InstanceID();
 }
 
 [shader("miss")]
-void Miss(inout Payload payload)
+void Miss(inout HitRecord hitRecord)
 {
 }
 #endif
@@ -132,6 +132,10 @@ SamplerState LinearClampSampler : register(s0);
 KS_VK_BINDING(0, 1)
 RaytracingAccelerationStructure t_SceneBVH : register(t0, space1);
 
+//[[vk::binding(1, 1)]]
+KS_VK_BINDING(1, 1)
+RaytracingAccelerationStructure t_DynamicSceneBVH : register(t1, space1);
+
 //[[vk::binding(2, 2)]]
 KS_VK_BINDING(2, 2)
 ConstantBuffer<CB_Reflection> CB : register(b0);
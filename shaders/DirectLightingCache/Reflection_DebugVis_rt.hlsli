@@ -132,8 +132,29 @@ void rgs(uint2 LaunchIndex)
 			ray);
 		rayQuery.Proceed();
 
-		// Process result
+		// Dynamic instances are in another TLAS. Trace it up to the closest hit in the static one.
+		RayDesc dynamicRay = ray;
 		if (rayQuery.CommittedStatus() == COMMITTED_TRIANGLE_HIT)
+			dynamicRay.TMax = rayQuery.CommittedRayT();
+		RayQuery<RAY_FLAG_CULL_NON_OPAQUE | RAY_FLAG_SKIP_PROCEDURAL_PRIMITIVES> dynamicRayQuery;
+		dynamicRayQuery.TraceRayInline(t_DynamicSceneBVH,
+			RAY_FLAG_NONE, // RAY_FLAG_CULL_BACK_FACING_TRIANGLES, // ray flags
+			(uint)InstancePropertyMask::Visible,
+			dynamicRay);
+		dynamicRayQuery.Proceed();
+
+		// Process result
+		if (dynamicRayQuery.CommittedStatus() == COMMITTED_TRIANGLE_HIT)
+		{
+			// Hit something
+			hit(
+				dynamicRayQuery.CommittedPrimitiveIndex(),
+				dynamicRayQuery.CommittedTriangleBarycentrics(),
+				dynamicRayQuery.CommittedInstanceID(),
+				dynamicRayQuery.CommittedRayT(),
+				payload);
+		}
+		else if (rayQuery.CommittedStatus() == COMMITTED_TRIANGLE_HIT)
 		{
 			// Hit something
 			hit(
@@ -146,6 +167,7 @@ void rgs(uint2 LaunchIndex)
 	}
 #else
 	{
+		Payload dynamicPayload = payload;
 		TraceRay(
 			t_SceneBVH,
 			RAY_FLAG_CULL_BACK_FACING_TRIANGLES, // ray flags
@@ -155,6 +177,22 @@ void rgs(uint2 LaunchIndex)
 			0, //MissShaderIndex
 			ray,
 			payload);
+
+		// Dynamic instances are in another TLAS. Trace it up to the closest hit in the static one.
+		RayDesc dynamicRay = ray;
+		if (payload.HitT >= 0.0)
+			dynamicRay.TMax = payload.HitT;
+		TraceRay(
+			t_DynamicSceneBVH,
+			RAY_FLAG_CULL_BACK_FACING_TRIANGLES, // ray flags
+			(uint)InstancePropertyMask::Visible,
+			0, //RayContributionToHitGroupIndex
+			0, //MultiplierForGeometryContributionToHitGroupIndex
+			0, //MissShaderIndex
+			dynamicRay,
+			dynamicPayload);
+		if (dynamicPayload.HitT >= 0.0)
+			payload = dynamicPayload;
 	}
 #endif
 
@@ -189,7 +227,7 @@ void RayGen()
 [shader("closesthit")]
 void ClosestHit(inout Payload payload, BuiltInTriangleIntersectionAttributes attrib)
 {
-	hit(PrimitiveIndex(), attrib.barycentrics, InstanceIndex(), RayTCurrent(), payload);
+	hit(PrimitiveIndex(), attrib.barycentrics, InstanceID(), RayTCurrent(), payload);
 }
 
 [shader("miss")]
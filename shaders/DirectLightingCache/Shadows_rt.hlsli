@@ -232,8 +232,29 @@ float TraceShadowRay(CB_Light light, float3 origin, float3 normal, inout RNGStat
 			ray);
 		rayQuery.Proceed();
 
-		// Process result
+		// Dynamic instances are in another TLAS. Trace it up to the closest hit in the static one.
+		RayDesc dynamicRay = ray;
 		if (rayQuery.CommittedStatus() == COMMITTED_TRIANGLE_HIT)
+			dynamicRay.TMax = rayQuery.CommittedRayT();
+		RayQuery<RAY_FLAGS> dynamicRayQuery;
+		dynamicRayQuery.TraceRayInline(t_DynamicSceneBVH,
+			RAY_FLAGS, // ray flags
+			(uint)InstancePropertyMask::Visible,
+			dynamicRay);
+		dynamicRayQuery.Proceed();
+
+		// Process result
+		if (dynamicRayQuery.CommittedStatus() == COMMITTED_TRIANGLE_HIT)
+		{
+			// Hit something
+			hit(
+				dynamicRayQuery.CommittedPrimitiveIndex(),
+				dynamicRayQuery.CommittedTriangleBarycentrics(),
+				dynamicRayQuery.CommittedInstanceID(),
+				dynamicRayQuery.CommittedRayT(),
+				payload);
+		}
+		else if (rayQuery.CommittedStatus() == COMMITTED_TRIANGLE_HIT)
 		{
 			// Hit something
 			hit(
@@ -246,6 +267,7 @@ float TraceShadowRay(CB_Light light, float3 origin, float3 normal, inout RNGStat
 	}
 #else
 	{
+		Payload dynamicPayload = payload;
 		TraceRay(
 			t_SceneBVH,
 			RAY_FLAGS, // ray flags
@@ -255,6 +277,22 @@ float TraceShadowRay(CB_Light light, float3 origin, float3 normal, inout RNGStat
 			0, //MissShaderIndex
 			ray,
 			payload);
+
+		// Dynamic instances are in another TLAS. Trace it up to the closest hit in the static one.
+		RayDesc dynamicRay = ray;
+		if (payload.HitT < kHitTForMiss)
+			dynamicRay.TMax = payload.HitT;
+		TraceRay(
+			t_DynamicSceneBVH,
+			RAY_FLAGS, // ray flags
+			(uint)InstancePropertyMask::Visible,
+			0, //RayContributionToHitGroupIndex
+			0, //MultiplierForGeometryContributionToHitGroupIndex
+			0, //MissShaderIndex
+			dynamicRay,
+			dynamicPayload);
+		if (dynamicPayload.HitT < kHitTForMiss)
+			payload = dynamicPayload;
 	}
 #endif
 
@@ -389,7 +427,7 @@ void RayGen()
 [shader("closesthit")]
 void ClosestHit(inout Payload payload, BuiltInTriangleIntersectionAttributes attrib)
 {
-	hit(PrimitiveIndex(), attrib.barycentrics, InstanceIndex(), RayTCurrent(), payload);
+	hit(PrimitiveIndex(), attrib.barycentrics, InstanceID(), RayTCurrent(), payload);
 }
 
 [shader("miss")]
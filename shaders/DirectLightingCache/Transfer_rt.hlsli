@@ -47,6 +47,10 @@ struct Payload
 KS_VK_BINDING(0, 1)
 RaytracingAccelerationStructure t_SceneBVH : register(t0, space1);
 
+//[[vk::binding(1, 1)]]
+KS_VK_BINDING(1, 1)
+RaytracingAccelerationStructure t_DynamicSceneBVH : register(t1, space1);
+
 //[[vk::binding(0, 0)]]
 KS_VK_BINDING(0, 0)
 ConstantBuffer<CB_Injection> CB : register(b0);
@@ -146,8 +150,30 @@ void rgs(uint LaunchThread)
 			ray);
 		rayQuery.Proceed();
 
-		// Process result
+		// Dynamic instances are in another TLAS. Trace it up to the closest hit in the static one.
+		RayDesc dynamicRay = ray;
 		if (rayQuery.CommittedStatus() == COMMITTED_TRIANGLE_HIT)
+			dynamicRay.TMax = rayQuery.CommittedRayT();
+		RayQuery<RAY_FLAG_FORCE_OPAQUE | RAY_FLAG_SKIP_PROCEDURAL_PRIMITIVES> dynamicRayQuery;
+		dynamicRayQuery.TraceRayInline(
+			t_DynamicSceneBVH,
+			RT_RayFlags, //ray flags
+			(uint)InstancePropertyMask::LightTransferSource,
+			dynamicRay);
+		dynamicRayQuery.Proceed();
+
+		// Process result
+		if (dynamicRayQuery.CommittedStatus() == COMMITTED_TRIANGLE_HIT)
+		{
+			// Hit something, store lighting.
+			hit(
+				dynamicRayQuery.CommittedPrimitiveIndex(),
+				dynamicRayQuery.CommittedTriangleBarycentrics(),
+				dynamicRayQuery.CommittedInstanceID(),
+				dynamicRayQuery.CommittedRayT(),
+				payload);
+		}
+		else if (rayQuery.CommittedStatus() == COMMITTED_TRIANGLE_HIT)
 		{
 			// Hit something, store lighting.
 			hit(
@@ -158,6 +184,7 @@ void rgs(uint LaunchThread)
 				payload);
 		}
 #else
+		Payload dynamicPayload = payload;
 		TraceRay(
 			t_SceneBVH,
 			RT_RayFlags, // ray flags
@@ -167,6 +194,22 @@ void rgs(uint LaunchThread)
 			0, //MissShaderIndex
 			ray,
 			payload);
+
+		// Dynamic instances are in another TLAS. Trace it up to the closest hit in the static one.
+		RayDesc dynamicRay = ray;
+		if (payload.HitT >= 0.0)
+			dynamicRay.TMax = payload.HitT;
+		TraceRay(
+			t_DynamicSceneBVH,
+			RT_RayFlags, // ray flags
+			(uint)InstancePropertyMask::LightTransferSource,
+			0, //RayContributionToHitGroupIndex
+			0, //MultiplierForGeometryContributionToHitGroupIndex
+			0, //MissShaderIndex
+			dynamicRay,
+			dynamicPayload);
+		if (dynamicPayload.HitT >= 0.0)
+			payload = dynamicPayload;
 #endif
 
 		if (payload.HitT >= 0 && (hitT < 0 || hitT > payload.HitT))
@@ -215,7 +258,7 @@ void RayGen()
 [shader("closesthit")]
 void ClosestHit(inout Payload payload, BuiltInTriangleIntersectionAttributes attrib)
 {
-    hit(PrimitiveIndex(), attrib.barycentrics, InstanceIndex(), RayTCurrent(), payload);
+    hit(PrimitiveIndex(), attrib.barycentrics, InstanceID(), RayTCurrent(), payload);
 }
 
 [shader("miss")]
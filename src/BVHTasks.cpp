@@ -27,6 +27,7 @@
 #include <RenderPass_DirectLightingCacheAllocation.h>
 
 #include <cstring>
+#include <inttypes.h>
 
 namespace KickstartRT_NativeLayer
 {
@@ -34,12 +35,15 @@ namespace KickstartRT_NativeLayer
 
 	Status BVHTasks::RegisterGeometry(GeometryHandle gHandle, const GeometryInput* input)
 	{
-		auto* gh = BVHTask::Geometry::ToPtr(gHandle);
-
 		if (gHandle == GeometryHandle::Null) {
 			Log::Fatal(L"Geometry handle was null.");
 			return Status::ERROR_INVALID_PARAM;
 		}
+		auto* gh = BVHTask::Geometry::ToPtr(gHandle);
+		if (gh == nullptr) {
+			Log::Fatal(L"Invalid geometry handle detected. %" PRIu64, (uint64_t)gHandle);
+			return Status::ERROR_INVALID_PARAM;
+		}
 		if (input == nullptr) {
 			Log::Fatal(L"GeometryInput was null.");
 			return Status::ERROR_INVALID_PARAM;
@@ -72,12 +76,15 @@ namespace KickstartRT_NativeLayer
 
 	Status BVHTasks::UpdateGeometry(GeometryHandle gHandle, const GeometryInput* newInput)
 	{
-		auto* gh = Geometry::ToPtr(gHandle);
-
 		if (gHandle == GeometryHandle::Null) {
 			Log::Fatal(L"Geometry handle was null.");
 			return Status::ERROR_INVALID_PARAM;
 		}
+		auto* gh = Geometry::ToPtr(gHandle);
+		if (gh == nullptr) {
+			Log::Fatal(L"Invalid geometry handle detected. %" PRIu64, (uint64_t)gHandle);
+			return Status::ERROR_INVALID_PARAM;
+		}
 		if (newInput == nullptr) {
 			Log::Fatal(L"New GeometryInput was null.");
 			return Status::ERROR_INVALID_PARAM;
@@ -112,12 +119,15 @@ namespace KickstartRT_NativeLayer
 
 	Status BVHTasks::RegisterInstance(InstanceHandle iHandle, const InstanceInput* input)
 	{
-		auto* ih = Instance::ToPtr(iHandle);
-
 		if (iHandle == InstanceHandle::Null) {
 			Log::Fatal(L"Instance handle was null.");
 			return Status::ERROR_INVALID_PARAM;
 		}
+		auto* ih = Instance::ToPtr(iHandle);
+		if (ih == nullptr) {
+			Log::Fatal(L"Invalid instance handle detected. %" PRIu64, (uint64_t)iHandle);
+			return Status::ERROR_INVALID_PARAM;
+		}
 		if (input == nullptr) {
 			Log::Fatal(L"InstanceInput was null.");
 			return Status::ERROR_INVALID_PARAM;
@@ -143,12 +153,15 @@ namespace KickstartRT_NativeLayer
 
 	Status BVHTasks::UpdateInstance(InstanceHandle iHandle, const InstanceInput* newInput)
 	{
-		auto* ih = Instance::ToPtr(iHandle);
-
 		if (iHandle == InstanceHandle::Null) {
 			Log::Fatal(L"Instance handle was null.");
 			return Status::ERROR_INVALID_PARAM;
 		}
+		auto* ih = Instance::ToPtr(iHandle);
+		if (ih == nullptr) {
+			Log::Fatal(L"Invalid instance handle detected. %" PRIu64, (uint64_t)iHandle);
+			return Status::ERROR_INVALID_PARAM;
+		}
 		if (newInput == nullptr) {
 			Log::Fatal(L"New InstanceInput was null.");
 			return Status::ERROR_INVALID_PARAM;
@@ -170,6 +183,7 @@ namespace KickstartRT_NativeLayer
 	{
 		m_maxBLASbuildCount = task->maxBlasBuildCount;
 		m_buildTLAS = task->buildTLAS;
+		m_maxTLASRefitCount = task->maxTLASRefitCount;
 
 		m_hasUpdate |= (task->maxBlasBuildCount > 0 || m_buildTLAS);
 
@@ -0,0 +1,112 @@
+/*
+* Copyright (c) 2022 NVIDIA CORPORATION. All rights reserved
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace KickstartRT_NativeLayer
+{
+	// Descriptor writes recorded between DescriptorTable::BeginBatchedWrite() and EndBatchedWrite() and applied with a single update call.
+	// Templated on the API structs, so that tools can benchmark it without a graphics API.
+	// Infos are copied since views can be released before the flush. They are referred by indices until the flush, so the vectors keep their capacity across flushes.
+	// An acceleration structure info is the only extension chained to writes.
+	template<typename WriteT, typename ImageInfoT, typename BufferInfoT, typename TexelBufferViewT, typename ASInfoT, typename ASHandleT>
+	struct DescriptorBatchedWrites {
+		static constexpr uint32_t m_noInfo = 0xFFFF'FFFF;
+		struct InfoIndices {
+			uint32_t	m_imageInfo = m_noInfo;
+			uint32_t	m_bufferInfo = m_noInfo;
+			uint32_t	m_texelBufferView = m_noInfo;
+			uint32_t	m_accelerationStructureInfo = m_noInfo;
+		};
+
+		std::vector<WriteT>				m_writes;
+		std::vector<InfoIndices>		m_infoIndices; // for each write.
+		std::vector<ImageInfoT>			m_imageInfos;
+		std::vector<BufferInfoT>		m_bufferInfos;
+		std::vector<TexelBufferViewT>	m_texelBufferViews;
+		std::vector<ASInfoT>			m_accelerationStructureInfos;
+		std::vector<ASHandleT>			m_accelerationStructures; // same index as the info.
+
+		// infos are on the caller's stack.
+		void Record(const WriteT& write)
+		{
+			InfoIndices idx;
+			if (write.pImageInfo != nullptr) {
+				idx.m_imageInfo = (uint32_t)m_imageInfos.size();
+				m_imageInfos.push_back(*write.pImageInfo);
+			}
+			if (write.pBufferInfo != nullptr) {
+				idx.m_bufferInfo = (uint32_t)m_bufferInfos.size();
+				m_bufferInfos.push_back(*write.pBufferInfo);
+			}
+			if (write.pTexelBufferView != nullptr) {
+				idx.m_texelBufferView = (uint32_t)m_texelBufferViews.size();
+				m_texelBufferViews.push_back(*write.pTexelBufferView);
+			}
+			if (write.pNext != nullptr) {
+				const ASInfoT* asInfo = reinterpret_cast<const ASInfoT*>(write.pNext);
+				idx.m_accelerationStructureInfo = (uint32_t)m_accelerationStructureInfos.size();
+				m_accelerationStructureInfos.push_back(*asInfo);
+				m_accelerationStructures.push_back(asInfo->pAccelerationStructures != nullptr ? *asInfo->pAccelerationStructures : ASHandleT{});
+			}
+
+			m_writes.push_back(write);
+			m_infoIndices.push_back(idx);
+		}
+
+		// Resolves the pointers of the recorded writes, passes them to update(const WriteT* writes, uint32_t count) and clears them.
+		// update is not called if there is no write.
+		template<typename UpdateFunc>
+		void Flush(UpdateFunc&& update)
+		{
+			if (m_writes.size() > 0) {
+				for (size_t i = 0; i < m_writes.size(); ++i) {
+					auto& w(m_writes[i]);
+					auto& idx(m_infoIndices[i]);
+					if (idx.m_imageInfo != m_noInfo)
+						w.pImageInfo = &m_imageInfos[idx.m_imageInfo];
+					if (idx.m_bufferInfo != m_noInfo)
+						w.pBufferInfo = &m_bufferInfos[idx.m_bufferInfo];
+					if (idx.m_texelBufferView != m_noInfo)
+						w.pTexelBufferView = &m_texelBufferViews[idx.m_texelBufferView];
+					if (idx.m_accelerationStructureInfo != m_noInfo) {
+						auto& asInfo(m_accelerationStructureInfos[idx.m_accelerationStructureInfo]);
+						if (asInfo.pAccelerationStructures != nullptr)
+							asInfo.pAccelerationStructures = &m_accelerationStructures[idx.m_accelerationStructureInfo];
+						w.pNext = &asInfo;
+					}
+				}
+				update(m_writes.data(), (uint32_t)m_writes.size());
+			}
+
+			m_writes.clear();
+			m_infoIndices.clear();
+			m_imageInfos.clear();
+			m_bufferInfos.clear();
+			m_texelBufferViews.clear();
+			m_accelerationStructureInfos.clear();
+			m_accelerationStructures.clear();
+		}
+	};
+};
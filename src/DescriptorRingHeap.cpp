@@ -0,0 +1,150 @@
+/*
+* Copyright (c) 2022 NVIDIA CORPORATION. All rights reserved
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <DescriptorRingHeap.h>
+#include <PersistentWorkingSet.h>
+#include <Utils.h>
+
+#include <algorithm>
+
+namespace KickstartRT_NativeLayer
+{
+#if defined(GRAPHICS_API_D3D12)
+	Status DescriptorRingHeap::Init(PersistentWorkingSet* pws, const GraphicsAPI::DescriptorHeap::Desc& reservedDesc, const GraphicsAPI::DescriptorHeap::Desc& ringDesc)
+	{
+		using dh = GraphicsAPI::DescriptorHeap;
+
+		std::array<uint32_t, m_numHeapTypes> ringSizes = {};
+		for (size_t i = 0; i < m_numHeapTypes; ++i) {
+			m_reservedSizes[i] = dh::NativeDescCount(reservedDesc, m_heapTypes[i]);
+			ringSizes[i] = dh::NativeDescCount(ringDesc, m_heapTypes[i]);
+		}
+
+		return CreateHeap(pws, ringSizes);
+	}
+
+	Status DescriptorRingHeap::CreateHeap(PersistentWorkingSet* pws, const std::array<uint32_t, m_numHeapTypes>& ringSizes)
+	{
+		using dh = GraphicsAPI::DescriptorHeap;
+
+		// only the number of descriptors of each native heap type matters.
+		dh::Desc	desc = {};
+		desc.setDescCount(dh::Type::TextureSrv, m_reservedSizes[0] + ringSizes[0]);
+		desc.setDescCount(dh::Type::Sampler, m_reservedSizes[1] + ringSizes[1]);
+
+		std::unique_ptr<dh>	heap = std::make_unique<dh>();
+		if (!heap->Create(&pws->m_device, desc, true)) {
+			Log::Fatal(L"Failed to create descriptor heap");
+			return Status::ERROR_INTERNAL;
+		}
+		heap->SetName(DebugName(L"TaskWorkingSet"));
+
+		std::array<std::unique_ptr<VirtualAllocator::RingAllocator>, m_numHeapTypes> allocators;
+		for (size_t i = 0; i < m_numHeapTypes; ++i) {
+			if (ringSizes[i] == 0)
+				continue;
+			allocators[i] = std::make_unique<VirtualAllocator::RingAllocator>();
+			if (!allocators[i]->Init(false, ringSizes[i], 1)) {
+				Log::Fatal(L"Failed to initialize descriptor ring allocator");
+				return Status::ERROR_INTERNAL;
+			}
+		}
+
+		// tables of in-flight tasks still refer the previous heap.
+		if (m_heap)
+			pws->DeferredRelease(std::move(m_heap));
+
+		m_heap = std::move(heap);
+		m_allocators = std::move(allocators);
+		m_ringSizes = ringSizes;
+		++m_generation;
+
+		return Status::OK;
+	}
+
+	Status DescriptorRingHeap::AllocateTaskSegment(PersistentWorkingSet* pws, uint64_t taskIndex, const GraphicsAPI::DescriptorHeap::Desc& desc, GraphicsAPI::DescriptorSubHeap* retSubHeap)
+	{
+		using dh = GraphicsAPI::DescriptorHeap;
+
+		std::array<uint32_t, m_numHeapTypes> sizes = {};
+		for (size_t i = 0; i < m_numHeapTypes; ++i)
+			sizes[i] = dh::NativeDescCount(desc, m_heapTypes[i]);
+
+		std::array<uint32_t, D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES> offsets = {};
+		auto AllocateSegments = [&]() {
+			for (size_t i = 0; i < m_numHeapTypes; ++i) {
+				if (sizes[i] == 0)
+					continue;
+				if (sizes[i] > m_ringSizes[i])
+					return false;
+
+				// freed right away, the range is reused after the task is reclaimed.
+				size_t offset;
+				m_allocators[i]->SetCurrentTag(taskIndex);
+				if (!m_allocators[i]->Alloc(sizes[i], &offset))
+					return false;
+				m_allocators[i]->Free(offset);
+
+				offsets[m_heapTypes[i]] = m_reservedSizes[i] + (uint32_t)offset;
+			}
+			return true;
+		};
+
+		if (!AllocateSegments()) {
+			// segments of in-flight tasks stay in the current heap, so the new ring is empty.
+			constexpr uint32_t maxHeapSizes[m_numHeapTypes] = { D3D12_MAX_SHADER_VISIBLE_DESCRIPTOR_HEAP_SIZE_TIER_1, D3D12_MAX_SHADER_VISIBLE_SAMPLER_HEAP_SIZE };
+
+			std::array<uint32_t, m_numHeapTypes> ringSizes = {};
+			for (size_t i = 0; i < m_numHeapTypes; ++i) {
+				uint32_t maxRingSize = maxHeapSizes[i] - m_reservedSizes[i];
+				if (sizes[i] > maxRingSize) {
+					Log::Fatal(L"Too many descriptors are requested for a task. HeapType:%d MaxRingSize:%d TriedToAllocate:%d", m_heapTypes[i], maxRingSize, sizes[i]);
+					return Status::ERROR_INTERNAL;
+				}
+				ringSizes[i] = std::min(std::max(m_ringSizes[i] * 2, sizes[i]), maxRingSize);
+			}
+
+			RETURN_IF_STATUS_FAILED(CreateHeap(pws, ringSizes));
+			Log::Info(L"Descriptor ring heap has been reallocated. CBV/SRV/UAV:%d Sampler:%d", ringSizes[0], ringSizes[1]);
+
+			if (!AllocateSegments()) {
+				Log::Fatal(L"Failed to allocate descriptor heap segment for a task");
+				return Status::ERROR_INTERNAL;
+			}
+		}
+
+		if (!retSubHeap->InitRange(m_heap.get(), desc, offsets)) {
+			Log::Fatal(L"Failed to suballocate descriptor heap");
+			return Status::ERROR_INTERNAL;
+		}
+
+		return Status::OK;
+	}
+
+	void DescriptorRingHeap::Reclaim(uint64_t finishedTaskIndex)
+	{
+		for (auto&& a : m_allocators) {
+			if (a)
+				a->Reclaim(finishedTaskIndex);
+		}
+	}
+#endif
+};
@@ -0,0 +1,65 @@
+/*
+* Copyright (c) 2022 NVIDIA CORPORATION. All rights reserved
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+#include <Platform.h>
+#include <GraphicsAPI/GraphicsAPI.h>
+#include <VirtualAllocator.h>
+#include <Log.h>
+
+#include <array>
+#include <memory>
+
+namespace KickstartRT_NativeLayer
+{
+	class PersistentWorkingSet;
+
+#if defined(GRAPHICS_API_D3D12)
+	// Shader visible descriptor heap shared by all task working sets. Each task allocates a segment from the ring, which is reclaimed after the task has been finished.
+	// All tables bound in a task have to be in a single heap, so the heap is only reallocated with a larger ring at the beginning of a task.
+	class DescriptorRingHeap
+	{
+		static constexpr size_t	m_numHeapTypes = 2; // CBV/SRV/UAV and sampler.
+		static constexpr D3D12_DESCRIPTOR_HEAP_TYPE	m_heapTypes[m_numHeapTypes] = { D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER };
+
+		std::unique_ptr<GraphicsAPI::DescriptorHeap>	m_heap;
+		std::array<uint32_t, m_numHeapTypes>			m_reservedSizes = {}; // at the beginning of the heap, suballocated with DescriptorSubHeap::Init().
+		std::array<uint32_t, m_numHeapTypes>			m_ringSizes = {};
+		std::array<std::unique_ptr<VirtualAllocator::RingAllocator>, m_numHeapTypes>	m_allocators; // one descriptor per page.
+		uint64_t										m_generation = 0;
+
+		Status CreateHeap(PersistentWorkingSet* pws, const std::array<uint32_t, m_numHeapTypes>& ringSizes);
+
+	public:
+		Status Init(PersistentWorkingSet* pws, const GraphicsAPI::DescriptorHeap::Desc& reservedDesc, const GraphicsAPI::DescriptorHeap::Desc& ringDesc);
+
+		// Initialize retSubHeap to a segment of the ring for the task. This may reallocate the heap, so it has to be done before any table of the task is allocated.
+		Status AllocateTaskSegment(PersistentWorkingSet* pws, uint64_t taskIndex, const GraphicsAPI::DescriptorHeap::Desc& desc, GraphicsAPI::DescriptorSubHeap* retSubHeap);
+
+		// Segments of finished tasks are reused.
+		void Reclaim(uint64_t finishedTaskIndex);
+
+		GraphicsAPI::DescriptorHeap* GetHeap() { return m_heap.get(); };
+		// Increased every time the heap is reallocated.
+		uint64_t GetGeneration() const { return m_generation; };
+	};
+#endif
+};
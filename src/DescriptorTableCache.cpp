@@ -0,0 +1,443 @@
+/*
+* Copyright (c) 2022 NVIDIA CORPORATION. All rights reserved
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <DescriptorTableCache.h>
+
+#include <string_view>
+
+namespace KickstartRT_NativeLayer
+{
+	DescriptorTableCache::TableContents::TableContents(const GraphicsAPI::DescriptorTableLayout* layout) :
+		m_layout(layout)
+	{
+		// tables of layouts with different ranges can't be shared even if the layout object is reallocated at the same address.
+		AddKeyField(m_layout);
+		AddKeyField(m_layout->m_lastUnbound);
+		for (auto&& range : m_layout->m_ranges) {
+			AddKeyField(range.m_type);
+			AddKeyField(range.m_baseRegIndex);
+			AddKeyField(range.m_descCount);
+			AddKeyField(range.m_regSpace);
+			AddKeyField(range.m_offsetFromTableStart);
+		}
+	}
+
+	void DescriptorTableCache::TableContents::AddKey(const void* data, size_t size)
+	{
+		const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+		m_key.insert(m_key.end(), p, p + size);
+	}
+
+	void DescriptorTableCache::TableContents::Add(DescType type, uint32_t rangeIndex, uint32_t indexInRange, const void* view, uint64_t resourceSerial)
+	{
+		m_descs.push_back({ type, rangeIndex, indexInRange, view });
+
+		// the descriptor is determined by the API data of the view, which is added by the caller.
+		// the serial tells a resource recreated by the SDK at the same address, like NRD pool textures after resizing.
+		AddKeyField(type);
+		AddKeyField(rangeIndex);
+		AddKeyField(indexInRange);
+		AddKeyField(resourceSerial);
+	}
+
+#if defined(GRAPHICS_API_D3D12)
+	// descs are often copied from the application, so only the union member selected by the view dimension is valid.
+	void DescriptorTableCache::TableContents::AddApiDataKey(const GraphicsAPI::ShaderResourceView::ApiData& apiData)
+	{
+		const D3D12_SHADER_RESOURCE_VIEW_DESC& d(apiData.m_desc);
+
+		AddKeyField(apiData.m_resource);
+		AddKeyField(d.Format);
+		AddKeyField(d.ViewDimension);
+		AddKeyField(d.Shader4ComponentMapping);
+		switch (d.ViewDimension) {
+		case D3D12_SRV_DIMENSION_BUFFER:
+			AddKeyField(d.Buffer.FirstElement);
+			AddKeyField(d.Buffer.NumElements);
+			AddKeyField(d.Buffer.StructureByteStride);
+			AddKeyField(d.Buffer.Flags);
+			break;
+		case D3D12_SRV_DIMENSION_TEXTURE1D:
+			AddKeyField(d.Texture1D.MostDetailedMip);
+			AddKeyField(d.Texture1D.MipLevels);
+			AddKeyField(d.Texture1D.ResourceMinLODClamp);
+			break;
+		case D3D12_SRV_DIMENSION_TEXTURE1DARRAY:
+			AddKeyField(d.Texture1DArray.MostDetailedMip);
+			AddKeyField(d.Texture1DArray.MipLevels);
+			AddKeyField(d.Texture1DArray.FirstArraySlice);
+			AddKeyField(d.Texture1DArray.ArraySize);
+			AddKeyField(d.Texture1DArray.ResourceMinLODClamp);
+			break;
+		case D3D12_SRV_DIMENSION_TEXTURE2D:
+			AddKeyField(d.Texture2D.MostDetailedMip);
+			AddKeyField(d.Texture2D.MipLevels);
+			AddKeyField(d.Texture2D.PlaneSlice);
+			AddKeyField(d.Texture2D.ResourceMinLODClamp);
+			break;
+		case D3D12_SRV_DIMENSION_TEXTURE2DARRAY:
+			AddKeyField(d.Texture2DArray.MostDetailedMip);
+			AddKeyField(d.Texture2DArray.MipLevels);
+			AddKeyField(d.Texture2DArray.FirstArraySlice);
+			AddKeyField(d.Texture2DArray.ArraySize);
+			AddKeyField(d.Texture2DArray.PlaneSlice);
+			AddKeyField(d.Texture2DArray.ResourceMinLODClamp);
+			break;
+		case D3D12_SRV_DIMENSION_TEXTURE2DMSARRAY:
+			AddKeyField(d.Texture2DMSArray.FirstArraySlice);
+			AddKeyField(d.Texture2DMSArray.ArraySize);
+			break;
+		case D3D12_SRV_DIMENSION_TEXTURE3D:
+			AddKeyField(d.Texture3D.MostDetailedMip);
+			AddKeyField(d.Texture3D.MipLevels);
+			AddKeyField(d.Texture3D.ResourceMinLODClamp);
+			break;
+		case D3D12_SRV_DIMENSION_TEXTURECUBE:
+			AddKeyField(d.TextureCube.MostDetailedMip);
+			AddKeyField(d.TextureCube.MipLevels);
+			AddKeyField(d.TextureCube.ResourceMinLODClamp);
+			break;
+		case D3D12_SRV_DIMENSION_TEXTURECUBEARRAY:
+			AddKeyField(d.TextureCubeArray.MostDetailedMip);
+			AddKeyField(d.TextureCubeArray.MipLevels);
+			AddKeyField(d.TextureCubeArray.First2DArrayFace);
+			AddKeyField(d.TextureCubeArray.NumCubes);
+			AddKeyField(d.TextureCubeArray.ResourceMinLODClamp);
+			break;
+		case D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE:
+			AddKeyField(d.RaytracingAccelerationStructure.Location);
+			break;
+		default:
+			// no fields, like TEXTURE2DMS.
+			break;
+		}
+	}
+
+	void DescriptorTableCache::TableContents::AddApiDataKey(const GraphicsAPI::UnorderedAccessView::ApiData& apiData)
+	{
+		const D3D12_UNORDERED_ACCESS_VIEW_DESC& d(apiData.m_desc);
+
+		AddKeyField(apiData.m_resource);
+		AddKeyField(d.Format);
+		AddKeyField(d.ViewDimension);
+		switch (d.ViewDimension) {
+		case D3D12_UAV_DIMENSION_BUFFER:
+			AddKeyField(d.Buffer.FirstElement);
+			AddKeyField(d.Buffer.NumElements);
+			AddKeyField(d.Buffer.StructureByteStride);
+			AddKeyField(d.Buffer.CounterOffsetInBytes);
+			AddKeyField(d.Buffer.Flags);
+			break;
+		case D3D12_UAV_DIMENSION_TEXTURE1D:
+			AddKeyField(d.Texture1D.MipSlice);
+			break;
+		case D3D12_UAV_DIMENSION_TEXTURE1DARRAY:
+			AddKeyField(d.Texture1DArray.MipSlice);
+			AddKeyField(d.Texture1DArray.FirstArraySlice);
+			AddKeyField(d.Texture1DArray.ArraySize);
+			break;
+		case D3D12_UAV_DIMENSION_TEXTURE2D:
+			AddKeyField(d.Texture2D.MipSlice);
+			AddKeyField(d.Texture2D.PlaneSlice);
+			break;
+		case D3D12_UAV_DIMENSION_TEXTURE2DARRAY:
+			AddKeyField(d.Texture2DArray.MipSlice);
+			AddKeyField(d.Texture2DArray.FirstArraySlice);
+			AddKeyField(d.Texture2DArray.ArraySize);
+			AddKeyField(d.Texture2DArray.PlaneSlice);
+			break;
+		case D3D12_UAV_DIMENSION_TEXTURE3D:
+			AddKeyField(d.Texture3D.MipSlice);
+			AddKeyField(d.Texture3D.FirstWSlice);
+			AddKeyField(d.Texture3D.WSize);
+			break;
+		default:
+			break;
+		}
+	}
+
+	void DescriptorTableCache::TableContents::AddApiDataKey(const GraphicsAPI::ConstantBufferView::ApiData& apiData)
+	{
+		AddKeyField(apiData.m_resource);
+		AddKeyField(apiData.m_desc.BufferLocation);
+		AddKeyField(apiData.m_desc.SizeInBytes);
+	}
+
+	void DescriptorTableCache::TableContents::AddApiDataKey(const GraphicsAPI::Sampler::ApiData& apiData)
+	{
+		const D3D12_SAMPLER_DESC& d(apiData.m_desc);
+
+		AddKeyField(d.Filter);
+		AddKeyField(d.AddressU);
+		AddKeyField(d.AddressV);
+		AddKeyField(d.AddressW);
+		AddKeyField(d.MipLODBias);
+		AddKeyField(d.MaxAnisotropy);
+		AddKeyField(d.ComparisonFunc);
+		for (auto&& c : d.BorderColor)
+			AddKeyField(c);
+		AddKeyField(d.MinLOD);
+		AddKeyField(d.MaxLOD);
+	}
+#endif
+
+	// VK tables aren't cached, so API data isn't added to their keys.
+	void DescriptorTableCache::TableContents::SetSrv(uint32_t rangeIndex, uint32_t indexInRange, const GraphicsAPI::ShaderResourceView* srv)
+	{
+		Add(DescType::Srv, rangeIndex, indexInRange, srv, srv->m_resourceSerial);
+#if defined(GRAPHICS_API_D3D12)
+		AddApiDataKey(srv->m_apiData);
+#endif
+	}
+
+	void DescriptorTableCache::TableContents::SetUav(uint32_t rangeIndex, uint32_t indexInRange, const GraphicsAPI::UnorderedAccessView* uav)
+	{
+		Add(DescType::Uav, rangeIndex, indexInRange, uav, uav->m_resourceSerial);
+#if defined(GRAPHICS_API_D3D12)
+		AddApiDataKey(uav->m_apiData);
+#endif
+	}
+
+	void DescriptorTableCache::TableContents::SetCbv(uint32_t rangeIndex, uint32_t indexInRange, const GraphicsAPI::ConstantBufferView* cbv)
+	{
+		Add(DescType::Cbv, rangeIndex, indexInRange, cbv, cbv->m_resourceSerial);
+#if defined(GRAPHICS_API_D3D12)
+		AddApiDataKey(cbv->m_apiData);
+#endif
+	}
+
+	void DescriptorTableCache::TableContents::SetSampler(uint32_t rangeIndex, uint32_t indexInRange, const GraphicsAPI::Sampler* smp)
+	{
+		Add(DescType::Sampler, rangeIndex, indexInRange, smp, 0);
+#if defined(GRAPHICS_API_D3D12)
+		AddApiDataKey(smp->m_apiData);
+#endif
+	}
+
+	DescriptorTableCache::~DescriptorTableCache()
+	{
+		m_entryMap.clear();
+		m_entries.clear();
+	}
+
+#if defined(GRAPHICS_API_D3D12)
+	Status DescriptorTableCache::Init(GraphicsAPI::DescriptorHeap* heap, const GraphicsAPI::DescriptorHeap::Desc& desc)
+	{
+		// tables in the previous heap are dropped when moving to a reallocated heap.
+		while (m_entries.size() > 0)
+			ReleaseEntry(m_entries.begin());
+
+		if (desc.m_totalDescCount == 0)
+			return Status::OK;
+
+		auto h = std::make_unique<GraphicsAPI::DescriptorSubHeap>();
+		if (!h->Init(heap, desc)) {
+			Log::Fatal(L"Failed to suballocate descriptor heap for descriptor table cache");
+			return Status::ERROR_INTERNAL;
+		}
+
+		// one descriptor per page, and a single block covers the whole region of each heap type.
+		constexpr D3D12_DESCRIPTOR_HEAP_TYPE heapTypes[2] = { D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER };
+		for (size_t i = 0; i < m_allocators.size(); ++i) {
+			if (m_heap) {
+				// allocators are empty and keep the same size.
+				if (m_allocatorSizes[i] != h->m_apiData.m_subHeaps[heapTypes[i]].m_subAllocationSize) {
+					Log::Fatal(L"Descriptor table cache cannot be resized");
+					return Status::ERROR_INTERNAL;
+				}
+				continue;
+			}
+			m_allocatorSizes[i] = h->m_apiData.m_subHeaps[heapTypes[i]].m_subAllocationSize;
+			if (m_allocatorSizes[i] == 0)
+				continue;
+			if (!m_allocators[i].Init(false, m_allocatorSizes[i], 1)) {
+				Log::Fatal(L"Failed to initialize descriptor table cache allocator");
+				return Status::ERROR_INTERNAL;
+			}
+		}
+
+		m_heap = std::move(h);
+
+		return Status::OK;
+	}
+#endif
+
+	void DescriptorTableCache::BeginTask()
+	{
+		++m_currentTaskIndex;
+	}
+
+	Status DescriptorTableCache::WriteDescriptors(GraphicsAPI::Device* dev, const TableContents& contents, GraphicsAPI::DescriptorTable* table)
+	{
+		using DescType = TableContents::DescType;
+
+		table->BeginBatchedWrite();
+		for (auto&& d : contents.m_descs) {
+			bool sts = false;
+			switch (d.m_type) {
+			case DescType::Srv:
+				sts = table->SetSrv(dev, d.m_rangeIndex, d.m_indexInRange, reinterpret_cast<const GraphicsAPI::ShaderResourceView*>(d.m_view));
+				break;
+			case DescType::Uav:
+				sts = table->SetUav(dev, d.m_rangeIndex, d.m_indexInRange, reinterpret_cast<const GraphicsAPI::UnorderedAccessView*>(d.m_view));
+				break;
+			case DescType::Cbv:
+				sts = table->SetCbv(dev, d.m_rangeIndex, d.m_indexInRange, reinterpret_cast<const GraphicsAPI::ConstantBufferView*>(d.m_view));
+				break;
+			case DescType::Sampler:
+				sts = table->SetSampler(dev, d.m_rangeIndex, d.m_indexInRange, reinterpret_cast<const GraphicsAPI::Sampler*>(d.m_view));
+				break;
+			}
+			if (!sts) {
+				Log::Fatal(L"Failed to set a descriptor");
+				return Status::ERROR_INTERNAL;
+			}
+		}
+		if (!table->EndBatchedWrite(dev)) {
+			Log::Fatal(L"Failed to write descriptors");
+			return Status::ERROR_INTERNAL;
+		}
+
+		return Status::OK;
+	}
+
+	Status DescriptorTableCache::WriteVolatileTable(GraphicsAPI::Device* dev, GraphicsAPI::IDescriptorHeap* volatileHeap, const TableContents& contents, GraphicsAPI::DescriptorTable* retTable)
+	{
+		if (!retTable->Allocate(volatileHeap, contents.m_layout)) {
+			Log::Fatal(L"Faild to allocate a portion of desc heap.");
+			return Status::ERROR_INTERNAL;
+		}
+
+		return WriteDescriptors(dev, contents, retTable);
+	}
+
+	void DescriptorTableCache::ReleaseEntry(decltype(m_entries)::iterator itr)
+	{
+#if defined(GRAPHICS_API_D3D12)
+		m_allocators[itr->m_allocatorIndex].Free(itr->m_offset);
+#endif
+		--m_numCachedTables;
+		m_numCachedDescriptors -= itr->m_numDescriptors;
+
+		m_entryMap.erase(itr->m_hash);
+		m_entries.erase(itr);
+	}
+
+	Status DescriptorTableCache::GetTable(GraphicsAPI::Device* dev, GraphicsAPI::IDescriptorHeap* volatileHeap, const TableContents& contents, GraphicsAPI::DescriptorTable* retTable)
+	{
+#if defined(GRAPHICS_API_D3D12)
+		if (m_heap) {
+			size_t hash = std::hash<std::string_view>()(std::string_view(reinterpret_cast<const char*>(contents.m_key.data()), contents.m_key.size()));
+
+			auto mItr = m_entryMap.find(hash);
+			if (mItr != m_entryMap.end()) {
+				auto eItr = mItr->second;
+				if (eItr->m_key == contents.m_key) {
+					eItr->m_lastUsedTaskIndex = m_currentTaskIndex;
+					m_entries.splice(m_entries.begin(), m_entries, eItr);
+
+					retTable->m_apiData = eItr->m_table.m_apiData;
+					retTable->m_descTableLayout = eItr->m_table.m_descTableLayout;
+					++m_numHits;
+
+					return Status::OK;
+				}
+
+				// hash collision. the older table can't be replaced while it is referenced by the current task.
+				if (eItr->m_lastUsedTaskIndex == m_currentTaskIndex) {
+					++m_numMisses;
+					return WriteVolatileTable(dev, volatileHeap, contents, retTable);
+				}
+				ReleaseEntry(eItr);
+			}
+			++m_numMisses;
+
+			D3D12_DESCRIPTOR_HEAP_TYPE heapType;
+			uint32_t numDescriptors = 0;
+			if (!GraphicsAPI::DescriptorSubHeap::GetTableAllocationSize(contents.m_layout, &heapType, &numDescriptors))
+				return WriteVolatileTable(dev, volatileHeap, contents, retTable);
+
+			uint32_t allocatorIndex = heapType == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ? 1 : 0;
+			if (numDescriptors == 0 || numDescriptors > m_allocatorSizes[allocatorIndex])
+				return WriteVolatileTable(dev, volatileHeap, contents, retTable);
+
+			size_t offset = 0;
+			while (!m_allocators[allocatorIndex].Alloc(numDescriptors, &offset)) {
+				// evict the least recently used table of the heap type. tables used by the current task are at the front.
+				auto victim = m_entries.end();
+				for (auto itr = m_entries.rbegin(); itr != m_entries.rend(); ++itr) {
+					if (itr->m_lastUsedTaskIndex == m_currentTaskIndex)
+						break;
+					if (itr->m_allocatorIndex == allocatorIndex) {
+						victim = std::prev(itr.base());
+						break;
+					}
+				}
+				if (victim == m_entries.end())
+					return WriteVolatileTable(dev, volatileHeap, contents, retTable);
+
+				ReleaseEntry(victim);
+				++m_numEvictions;
+			}
+
+			m_entries.emplace_front();
+			auto eItr = m_entries.begin();
+			eItr->m_key = contents.m_key;
+			eItr->m_hash = hash;
+			eItr->m_allocatorIndex = allocatorIndex;
+			eItr->m_offset = offset;
+			eItr->m_numDescriptors = numDescriptors;
+			eItr->m_lastUsedTaskIndex = m_currentTaskIndex;
+			m_entryMap.insert({ hash, eItr });
+			++m_numCachedTables;
+			m_numCachedDescriptors += numDescriptors;
+
+			if (!eItr->m_heap.InitRange(m_heap.get(), heapType, (uint32_t)offset, numDescriptors) ||
+				!eItr->m_table.Allocate(&eItr->m_heap, contents.m_layout)) {
+				Log::Fatal(L"Failed to allocate a descriptor table in the cache.");
+				ReleaseEntry(eItr);
+				return Status::ERROR_INTERNAL;
+			}
+			if (WriteDescriptors(dev, contents, &eItr->m_table) != Status::OK) {
+				ReleaseEntry(eItr);
+				return Status::ERROR_INTERNAL;
+			}
+
+			retTable->m_apiData = eItr->m_table.m_apiData;
+			retTable->m_descTableLayout = eItr->m_table.m_descTableLayout;
+
+			return Status::OK;
+		}
+#endif
+
+		++m_numMisses;
+		return WriteVolatileTable(dev, volatileHeap, contents, retTable);
+	}
+
+	void DescriptorTableCache::AddStatistics(KickstartRT::DescriptorTableCacheStatistics* retStatistics) const
+	{
+		retStatistics->m_numHits += m_numHits;
+		retStatistics->m_numMisses += m_numMisses;
+		retStatistics->m_numEvictions += m_numEvictions;
+		retStatistics->m_numCachedTables += m_numCachedTables;
+		retStatistics->m_numCachedDescriptors += m_numCachedDescriptors;
+	}
+};
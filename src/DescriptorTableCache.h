@@ -0,0 +1,140 @@
+/*
+* Copyright (c) 2022 NVIDIA CORPORATION. All rights reserved
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+#include <Platform.h>
+#include <GraphicsAPI/GraphicsAPI.h>
+#include <VirtualAllocator.h>
+#include <Log.h>
+
+#include <array>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace KickstartRT_NativeLayer
+{
+	// Keeps descriptor tables of a task working set alive across tasks. Tables are looked up by the layout and the contents of the views, and the least recently used ones are evicted.
+	// Only D3D12 caches tables, since VK descriptor sets refer to view objects that are released after each task. Otherwise tables are always written to the volatile heap.
+	class DescriptorTableCache
+	{
+	public:
+		// Descriptors to write into a table. Views are only referenced until GetTable() returns, so temporary views can be used.
+		class TableContents
+		{
+			friend class DescriptorTableCache;
+
+			enum class DescType : uint32_t {
+				Srv,
+				Uav,
+				Cbv,
+				Sampler,
+			};
+			struct Descriptor {
+				DescType		m_type;
+				uint32_t		m_rangeIndex;
+				uint32_t		m_indexInRange;
+				const void*		m_view;
+			};
+
+			const GraphicsAPI::DescriptorTableLayout*	m_layout;
+			std::vector<Descriptor>						m_descs;
+			std::vector<uint8_t>						m_key;
+
+			void AddKey(const void* data, size_t size);
+			// keys are built field by field, so padding and unused union members of API structs never get into them.
+			template<typename T>
+			void AddKeyField(const T& v)
+			{
+				static_assert(std::is_scalar_v<T>, "Only scalar fields can be added to a key.");
+				AddKey(&v, sizeof(v));
+			}
+			void Add(DescType type, uint32_t rangeIndex, uint32_t indexInRange, const void* view, uint64_t resourceSerial);
+#if defined(GRAPHICS_API_D3D12)
+			void AddApiDataKey(const GraphicsAPI::ShaderResourceView::ApiData& apiData);
+			void AddApiDataKey(const GraphicsAPI::UnorderedAccessView::ApiData& apiData);
+			void AddApiDataKey(const GraphicsAPI::ConstantBufferView::ApiData& apiData);
+			void AddApiDataKey(const GraphicsAPI::Sampler::ApiData& apiData);
+#endif
+
+		public:
+			TableContents(const GraphicsAPI::DescriptorTableLayout* layout);
+
+			void SetSrv(uint32_t rangeIndex, uint32_t indexInRange, const GraphicsAPI::ShaderResourceView* srv);
+			void SetUav(uint32_t rangeIndex, uint32_t indexInRange, const GraphicsAPI::UnorderedAccessView* uav);
+			void SetCbv(uint32_t rangeIndex, uint32_t indexInRange, const GraphicsAPI::ConstantBufferView* cbv);
+			void SetSampler(uint32_t rangeIndex, uint32_t indexInRange, const GraphicsAPI::Sampler* smp);
+		};
+
+	protected:
+		struct Entry {
+			std::vector<uint8_t>			m_key;
+			size_t							m_hash = 0;
+			uint32_t						m_allocatorIndex = 0;
+			size_t							m_offset = 0;
+			uint32_t						m_numDescriptors = 0;
+			uint64_t						m_lastUsedTaskIndex = 0;
+#if defined(GRAPHICS_API_D3D12)
+			GraphicsAPI::DescriptorSubHeap	m_heap;
+#endif
+			GraphicsAPI::DescriptorTable	m_table;
+		};
+
+#if defined(GRAPHICS_API_D3D12)
+		std::unique_ptr<GraphicsAPI::DescriptorSubHeap>		m_heap;
+		std::array<VirtualAllocator::TLSFAllocator, 2>		m_allocators; // CBV/SRV/UAV and sampler descriptors in m_heap.
+		std::array<uint32_t, 2>								m_allocatorSizes = {};
+#endif
+		std::list<Entry>												m_entries; // most recently used first.
+		std::unordered_map<size_t, decltype(m_entries)::iterator>		m_entryMap;
+		uint64_t												m_currentTaskIndex = 0;
+
+		std::atomic<uint64_t>	m_numHits = 0;
+		std::atomic<uint64_t>	m_numMisses = 0;
+		std::atomic<uint64_t>	m_numEvictions = 0;
+		std::atomic<uint32_t>	m_numCachedTables = 0;
+		std::atomic<uint32_t>	m_numCachedDescriptors = 0;
+
+		static Status WriteDescriptors(GraphicsAPI::Device* dev, const TableContents& contents, GraphicsAPI::DescriptorTable* table);
+		static Status WriteVolatileTable(GraphicsAPI::Device* dev, GraphicsAPI::IDescriptorHeap* volatileHeap, const TableContents& contents, GraphicsAPI::DescriptorTable* retTable);
+		void ReleaseEntry(decltype(m_entries)::iterator itr);
+
+	public:
+		~DescriptorTableCache();
+
+#if defined(GRAPHICS_API_D3D12)
+		// Suballocate the cache region from the heap that is shared with the volatile heap of the task working set, so both are visible to shaders at the same time.
+		// It can be called again with the same desc to move to a reallocated heap.
+		Status Init(GraphicsAPI::DescriptorHeap* heap, const GraphicsAPI::DescriptorHeap::Desc& desc);
+#endif
+		// Tables used after this call are not evicted until the next call.
+		void BeginTask();
+
+		// Return a cached table with the same contents, or write a new one. Tables that cannot be cached are written to volatileHeap.
+		Status GetTable(GraphicsAPI::Device* dev, GraphicsAPI::IDescriptorHeap* volatileHeap, const TableContents& contents, GraphicsAPI::DescriptorTable* retTable);
+
+		// Counters are added to retStatistics.
+		void AddStatistics(KickstartRT::DescriptorTableCacheStatistics* retStatistics) const;
+	};
+};
@@ -31,9 +31,7 @@
 
 namespace KickstartRT_NativeLayer
 {
-	// Counter for creating unique handles.
-	static std::atomic<uint32_t>		s_geometryCounter(0ul);
-	static std::atomic<uint32_t>		s_instanceCounter(0ul);
+	// Counter for creating unique handles. Geometry and instance handles are issued by their slot maps.
 	static std::atomic<uint32_t>		s_denoisingContextCounter(0ul);
 
 	static inline uint64_t IncrementHandleCounter(std::atomic<uint32_t>& c)
@@ -400,10 +398,15 @@ namespace KickstartRT_NativeLayer
 	{
 		GeometryHandle ret;
 		{
+			BVHTask::GeometryPtr gp = BVHTask::Geometry::Create();
+			if (!gp) {
+				Log::Fatal(L"Failed to allocate a geometry handle.");
+				return GeometryHandle::Null;
+			}
+			ret = gp->ToHandle();
+
 			std::scoped_lock mtx(m_updateFromExecuteContextMutex);
-			m_updateFromExecuteContext.m_createdGeometries.emplace_back(
-				std::make_unique<BVHTask::Geometry>(IncrementHandleCounter(s_geometryCounter)));
-			ret = m_updateFromExecuteContext.m_createdGeometries.back()->ToHandle();
+			m_updateFromExecuteContext.m_createdGeometries.emplace_back(std::move(gp));
 		}
 
 		return ret;
@@ -420,8 +423,15 @@ namespace KickstartRT_NativeLayer
 
 			auto& d(m_updateFromExecuteContext.m_createdGeometries);
 			for (size_t i = 0; i < nbHandles; ++i) {
-				d.emplace_back(std::make_unique<BVHTask::Geometry>(IncrementHandleCounter(s_geometryCounter)));
-				handles[i] = d.back()->ToHandle();
+				BVHTask::GeometryPtr gp = BVHTask::Geometry::Create();
+				if (!gp) {
+					Log::Fatal(L"Failed to allocate a geometry handle.");
+					for (size_t j = i; j < nbHandles; ++j)
+						handles[j] = GeometryHandle::Null;
+					return Status::ERROR_INTERNAL;
+				}
+				handles[i] = gp->ToHandle();
+				d.emplace_back(std::move(gp));
 			}
 		}
 
@@ -475,10 +485,15 @@ namespace KickstartRT_NativeLayer
 	{
 		InstanceHandle ret;
 		{
+			BVHTask::InstancePtr ip = BVHTask::Instance::Create();
+			if (!ip) {
+				Log::Fatal(L"Failed to allocate an instance handle.");
+				return InstanceHandle::Null;
+			}
+			ret = ip->ToHandle();
+
 			std::scoped_lock mtx(m_updateFromExecuteContextMutex);
-			m_updateFromExecuteContext.m_createdInstances.emplace_back(
-				std::make_unique<BVHTask::Instance>(IncrementHandleCounter(s_instanceCounter)));
-			ret = m_updateFromExecuteContext.m_createdInstances.back()->ToHandle();
+			m_updateFromExecuteContext.m_createdInstances.emplace_back(std::move(ip));
 		}
 
 		return ret;
@@ -495,8 +510,15 @@ namespace KickstartRT_NativeLayer
 
 			auto& d(m_updateFromExecuteContext.m_createdInstances);
 			for (size_t i = 0; i < nbHandles; ++i) {
-				d.emplace_back(std::make_unique<BVHTask::Instance>(IncrementHandleCounter(s_instanceCounter)));
-				handles[i] = d.back()->ToHandle();
+				BVHTask::InstancePtr ip = BVHTask::Instance::Create();
+				if (!ip) {
+					Log::Fatal(L"Failed to allocate an instance handle.");
+					for (size_t j = i; j < nbHandles; ++j)
+						handles[j] = InstanceHandle::Null;
+					return Status::ERROR_INTERNAL;
+				}
+				handles[i] = ip->ToHandle();
+				d.emplace_back(std::move(ip));
 			}
 		}
 
@@ -669,11 +691,54 @@ namespace KickstartRT_NativeLayer
 		}
 	};
 
+	Status ExecuteContext_impl::WarmUpShaders(const uint32_t* shaderList, size_t listSize, uint32_t numThreads, bool skipPendingShaders)
+	{
+		if (shaderList == nullptr && listSize > 0) {
+			Log::Fatal(L"Null pointer detected in WarmUpShaders().");
+			return Status::ERROR_INVALID_PARAM;
+		}
+
+		// Hold pws's mutex while queueing shaders.
+		std::scoped_lock pwsMutex(m_persistentWorkingSet->m_mutex);
+
+		return m_persistentWorkingSet->m_shaderFactory->WarmUpShaders(m_persistentWorkingSet.get(), shaderList, listSize, numThreads, skipPendingShaders);
+	}
+
+	Status ExecuteContext_impl::WaitForShaderWarmUp()
+	{
+		return m_persistentWorkingSet->m_shaderFactory->WaitForWarmUp();
+	}
+
 	Status ExecuteContext_impl::GetCurrentResourceAllocations(ResourceAllocations* retStatus)
 	{
 		return m_persistentWorkingSet->GetResourceAllocations(retStatus);
 	}
 
+	Status ExecuteContext_impl::SetMemoryBudget(const MemoryBudget* budget)
+	{
+		return m_persistentWorkingSet->SetMemoryBudget(budget);
+	}
+
+	Status ExecuteContext_impl::GetMemoryBudget(MemoryBudget* retBudget)
+	{
+		return m_persistentWorkingSet->GetMemoryBudget(retBudget);
+	}
+
+	Status ExecuteContext_impl::GetDescriptorTableCacheStatistics(DescriptorTableCacheStatistics* retStatistics)
+	{
+		return m_taskTracker->GetDescriptorTableCacheStatistics(retStatistics);
+	}
+
+	Status ExecuteContext_impl::GetVolatileConstantBufferStatistics(VolatileConstantBufferStatistics* retStatistics)
+	{
+		return m_taskTracker->GetVolatileConstantBufferStatistics(retStatistics);
+	}
+
+	Status ExecuteContext_impl::GetTLASBuildStatistics(TLASBuildStatistics* retStatistics)
+	{
+		return m_scene->GetTLASBuildStatistics(retStatistics);
+	}
+
 	Status ExecuteContext_impl::BeginLoggingResourceAllocations(const wchar_t* filePath)
 	{
 		return m_persistentWorkingSet->BeginLoggingResourceAllocations(filePath);
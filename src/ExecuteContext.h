@@ -51,8 +51,8 @@ namespace KickstartRT
 namespace KickstartRT_NativeLayer
 {
 	struct UpdateFromExecuteContext {
-		std::deque<std::unique_ptr<BVHTask::Geometry>>	m_createdGeometries;
-		std::deque<std::unique_ptr<BVHTask::Instance>>	m_createdInstances;
+		std::deque<BVHTask::GeometryPtr>	m_createdGeometries;
+		std::deque<BVHTask::InstancePtr>	m_createdInstances;
 		std::deque<std::unique_ptr<DenoisingContext>>			m_createdDenoisingContexts;
 		std::deque<GeometryHandle>								m_destroyedGeometries;
 		std::deque<InstanceHandle>								m_destroyedInstances;
@@ -103,8 +103,15 @@ namespace KickstartRT_NativeLayer
 		Status ReleaseDeviceResourcesImmediately() override;
 
 		Status GetLoadedShaderList(uint32_t* loadedListBuffer, size_t bufferSize, size_t* retListSize) override;
+		Status WarmUpShaders(const uint32_t* shaderList, size_t listSize, uint32_t numThreads, bool skipPendingShaders) override;
+		Status WaitForShaderWarmUp() override;
 
 		Status GetCurrentResourceAllocations(ResourceAllocations* retStatus) override;
+		Status SetMemoryBudget(const MemoryBudget* budget) override;
+		Status GetMemoryBudget(MemoryBudget* retBudget) override;
+		Status GetDescriptorTableCacheStatistics(DescriptorTableCacheStatistics* retStatistics) override;
+		Status GetVolatileConstantBufferStatistics(VolatileConstantBufferStatistics* retStatistics) override;
+		Status GetTLASBuildStatistics(TLASBuildStatistics* retStatistics) override;
 		Status BeginLoggingResourceAllocations(const wchar_t * filePath) override;
 		Status EndLoggingResourceAllocations() override;
 	};
@@ -28,6 +28,18 @@
 namespace KickstartRT_NativeLayer
 {
 	namespace BVHTask {
+		SlotMap<Geometry, GeometryHandle>& Geometry::GetSlotMap()
+		{
+			static SlotMap<Geometry, GeometryHandle> s_slotMap;
+			return s_slotMap;
+		}
+
+		// Returns an empty pointer when the slot map is exhausted.
+		GeometryPtr Geometry::Create()
+		{
+			return GeometryPtr(GetSlotMap().Allocate());
+		}
+
 		Geometry::~Geometry()
 		{
 			if (m_instances.size() > 0) {
@@ -57,6 +69,18 @@ namespace KickstartRT_NativeLayer
 			pws->DeferredRelease(std::move(m_edgeTableBuffer));
 		}
 
+		SlotMap<Instance, InstanceHandle>& Instance::GetSlotMap()
+		{
+			static SlotMap<Instance, InstanceHandle> s_slotMap;
+			return s_slotMap;
+		}
+
+		// Returns an empty pointer when the slot map is exhausted.
+		InstancePtr Instance::Create()
+		{
+			return InstancePtr(GetSlotMap().Allocate());
+		}
+
 		// calling dtor with valid geometry handle is prohibited.
 		Instance::~Instance()
 		{
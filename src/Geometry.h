@@ -22,7 +22,7 @@
 #pragma once
 #include <Platform.h>
 #include <OS.h>
-#include <Handle.h>
+#include <SlotMap.h>
 
 #include <SharedBuffer.h>
 
@@ -38,6 +38,9 @@ namespace KickstartRT_NativeLayer
 	class PersistentWorkingSet;
 
 	static constexpr uint32_t kInvalidNumTiles = 0xFFFF'FFFF;
+	static constexpr uint32_t kInvalidTLASInstanceIndex = 0xFFFF'FFFF;
+	using TLASPartition = KickstartRT::TLASBuildStatistics::Partition;
+	static constexpr size_t kNumTLASPartitions = (size_t)TLASPartition::e_Num_Partitions;
 
 	namespace BVHTask {
 		enum class RegisterStatus {
@@ -46,7 +49,10 @@ namespace KickstartRT_NativeLayer
 			Registered
 		};
 
+		struct Geometry;
 		struct Instance;
+		using GeometryPtr = std::unique_ptr<Geometry, SlotMapDeleter<Geometry>>;
+		using InstancePtr = std::unique_ptr<Instance, SlotMapDeleter<Instance>>;
 
 		struct Geometry {
 			const uint64_t					m_id;
@@ -87,15 +93,19 @@ namespace KickstartRT_NativeLayer
 			bool							m_directTileMapping = false;
 			std::wstring					m_name;
 			std::list<Instance*>		m_instances;	// weak reference of instances.
+			uint32_t						m_containerIndex = 0xFFFF'FFFF;	// position in the owning scene container.
+
+			static SlotMap<Geometry, GeometryHandle>& GetSlotMap();
+			static GeometryPtr Create();
 
 			static Geometry* ToPtr(GeometryHandle handle)
 			{
-				return ToPtr_s<Geometry, GeometryHandle>(handle);
+				return GetSlotMap().ToPtr(handle);
 			}
 
 			GeometryHandle ToHandle()
 			{
-				return ToHandle_s<Geometry, GeometryHandle>(this);
+				return static_cast<GeometryHandle>(m_id);
 			};
 
 		public:
@@ -139,15 +149,23 @@ namespace KickstartRT_NativeLayer
 			bool														m_needToUpdateUAV = false;
 #endif
 
-			std::optional<std::list<InstanceHandle>::iterator>	m_TLASInstanceListItr;
+			// Position in the TLAS instance list of the partition. InstanceID is offset by the number of static instances for dynamic ones.
+			uint32_t											m_TLASInstanceIndex = kInvalidTLASInstanceIndex;
+			TLASPartition										m_TLASPartition = TLASPartition::e_Dynamic;
+			// Waiting in the pending list to be added to the TLAS instance list.
+			bool												m_isTLASPending = false;
+			uint32_t											m_containerIndex = 0xFFFF'FFFF;	// position in the owning scene container.
+
+			static SlotMap<Instance, InstanceHandle>& GetSlotMap();
+			static InstancePtr Create();
 
 			static Instance* ToPtr(InstanceHandle handle)
 			{
-				return ToPtr_s<Instance, InstanceHandle>(handle);
+				return GetSlotMap().ToPtr(handle);
 			}
 			InstanceHandle ToHandle()
 			{
-				return ToHandle_s<Instance, InstanceHandle>(this);
+				return static_cast<InstanceHandle>(m_id);
 			};
 
 		public:
@@ -20,9 +20,15 @@
 * SOFTWARE.
 */
 #include "GraphicsAPI/GraphicsAPI.h"
+#include "common/CRC.h"
 
 #include <assert.h>
 #include <cstring>
+#include <cwchar>
+
+#if defined(GRAPHICS_API_D3D12)
+#include <dxgi1_4.h>
+#endif
 
 namespace KickstartRT_NativeLayer::GraphicsAPI {
 
@@ -231,14 +237,41 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
                 }
                 m_deviceMemoryTypeIndex[i] = idx;
 #endif
+                m_deviceMemoryTypeIsCoherent[i] = (memProperties.memoryTypes[m_deviceMemoryTypeIndex[i]].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+            }
+
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(m_apiData.m_physicalDevice, &properties);
+            m_nonCoherentAtomSize = properties.limits.nonCoherentAtomSize;
+        }
+
+        for (uint32_t i = 0; i < (uint32_t)VulkanDeviceMemoryType::Count; ++i) {
+            VulkanDeviceMemoryType t = (VulkanDeviceMemoryType)i;
+            bool isDefault = t == VulkanDeviceMemoryType::Default;
+
+            // buffer blocks always enable the device address bit, since upload buffers can be inputs of AS builds as well.
+            m_bufferMemoryAllocators[i] = std::make_unique<DeviceMemoryAllocator>();
+            if (!m_bufferMemoryAllocators[i]->Init(m_apiData.m_device, m_deviceMemoryTypeIndex[i], true, !isDefault, isDefault ? 64ull * 1024 * 1024 : 16ull * 1024 * 1024)) {
+                Log::Fatal(L"Failed to initialize device memory allocator.");
+                return false;
             }
         }
+        m_imageMemoryAllocator = std::make_unique<DeviceMemoryAllocator>();
+        if (!m_imageMemoryAllocator->Init(m_apiData.m_device, m_deviceMemoryTypeIndex[(size_t)VulkanDeviceMemoryType::Default], false, false, 64ull * 1024 * 1024)) {
+            Log::Fatal(L"Failed to initialize device memory allocator.");
+            return false;
+        }
 
         return true;
     }
 
     Device::~Device()
     {
+        // all suballocated resources have to be destructed before the device.
+        for (auto&& a : m_bufferMemoryAllocators)
+            a.reset();
+        m_imageMemoryAllocator.reset();
+
         // do not destruct vkDevice here since it is owned by application side.
         m_apiData = {};
     }
@@ -447,6 +480,18 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         }
     }
 
+    uint32_t DescriptorHeap::NativeDescCount(const Desc& desc, D3D12_DESCRIPTOR_HEAP_TYPE heapType)
+    {
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < value(Type::Count); ++i) {
+            Type t = static_cast<Type>(i);
+            if (nativeType(t) == heapType)
+                count += desc.m_descCount[value(t)];
+        }
+
+        return count;
+    }
+
     bool DescriptorHeap::ResetAllocation()
     {
         for (auto& h : m_apiData.m_heaps)
@@ -620,6 +665,80 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         return true;
     };
 
+    bool DescriptorSubHeap::InitRange(const DescriptorSubHeap* parent, D3D12_DESCRIPTOR_HEAP_TYPE heapType, uint32_t offset, uint32_t numDescriptors)
+    {
+        auto& parentEntry(parent->m_apiData.m_subHeaps[(uint32_t)heapType]);
+
+        if (offset + numDescriptors > parentEntry.m_subAllocationSize) {
+            Log::Fatal(L"Failed to suballocate descriptor sub heap. NumSubAllocatedDesc:%d Offset:%d TriedToAllocate:%d", parentEntry.m_subAllocationSize, offset, numDescriptors);
+            return false;
+        }
+
+        m_heap = parent->m_heap;
+        m_apiData = {};
+
+        auto& subHeap(m_apiData.m_subHeaps[(uint32_t)heapType]);
+        subHeap = parentEntry;
+        subHeap.m_currentOffset = 0;
+        subHeap.m_subAllocationOffset = parentEntry.m_subAllocationOffset + offset;
+        subHeap.m_subAllocationSize = numDescriptors;
+
+        return true;
+    }
+
+    bool DescriptorSubHeap::InitRange(DescriptorHeap* descHeap, const DescriptorHeap::Desc& desc, const std::array<uint32_t, D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES>& offsets)
+    {
+        uint32_t nativeDescCount[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES] = { 0 };
+        for (uint32_t i = 0; i < (uint32_t)D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i) {
+            nativeDescCount[i] = DescriptorHeap::NativeDescCount(desc, (D3D12_DESCRIPTOR_HEAP_TYPE)i);
+            if (nativeDescCount[i] == 0)
+                continue;
+
+            if (offsets[i] + nativeDescCount[i] > descHeap->m_apiData.m_heaps[i].m_numDescriptors) {
+                Log::Fatal(L"Failed to suballocate descriptor heap. NumDesc:%d Offset:%d TriedToAllocate:%d",
+                    descHeap->m_apiData.m_heaps[i].m_numDescriptors, offsets[i], nativeDescCount[i]);
+                return false;
+            }
+        }
+
+        m_heap = descHeap;
+        m_apiData = {};
+        for (uint32_t i = 0; i < (uint32_t)D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i) {
+            if (nativeDescCount[i] == 0)
+                continue;
+
+            auto& heap(m_heap->m_apiData.m_heaps[i]);
+            auto& subHeap(m_apiData.m_subHeaps[i]);
+
+            subHeap.m_descHeap = heap.m_descHeap;
+            subHeap.m_incrementSize = heap.m_incrementSize;
+            subHeap.m_numDescriptors = heap.m_numDescriptors;
+            subHeap.m_subAllocationOffset = offsets[i];
+            subHeap.m_subAllocationSize = nativeDescCount[i];
+        }
+
+        return true;
+    }
+
+    bool DescriptorSubHeap::GetTableAllocationSize(const DescriptorTableLayout* descTable, D3D12_DESCRIPTOR_HEAP_TYPE* retHeapType, uint32_t* retNumDescriptors)
+    {
+        if (descTable->m_lastUnbound || descTable->m_ranges.size() == 0)
+            return false;
+
+        D3D12_DESCRIPTOR_HEAP_TYPE heapType = nativeType(descTable->m_ranges[0].m_type);
+        uint32_t nbEntry = 0;
+        for (auto&& range : descTable->m_ranges) {
+            if (heapType != IDescriptorHeap::nativeType(range.m_type))
+                return false;
+            nbEntry += range.m_descCount;
+        }
+
+        *retHeapType = heapType;
+        *retNumDescriptors = nbEntry;
+
+        return true;
+    }
+
 
 #elif defined(GRAPHICS_API_VK)
 // non class enum warnings.
@@ -956,6 +1075,17 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         // nothing to do.
     }
 
+    void DescriptorTable::BeginBatchedWrite()
+    {
+        // nothing to do.
+    }
+
+    bool DescriptorTable::EndBatchedWrite(Device* dev)
+    {
+        (void)dev;
+        return true;
+    }
+
     bool DescriptorTable::Allocate(IDescriptorHeap* descHeap, const DescriptorTableLayout* descTableLayout, uint32_t unboundDescTableCount)
     {
         m_descTableLayout = {};
@@ -1145,6 +1275,48 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         // it doesn't destroy allocated VkDescriptorSet from pool, since the pool will be reset at the beggining of a frame.
     }
 
+    void DescriptorTable::BeginBatchedWrite()
+    {
+        // writes are applied immediately if the table has not been allocated yet.
+        m_isBatching = m_batchedWrites != nullptr;
+    }
+
+    bool DescriptorTable::EndBatchedWrite(Device* dev)
+    {
+        if (!m_isBatching) {
+            if (m_batchedWrites == nullptr)
+                return true;
+            Log::Fatal(L"EndBatchedWrite() was called without BeginBatchedWrite().");
+            return false;
+        }
+
+        FlushBatchedWrites(dev);
+        m_isBatching = false;
+
+        return true;
+    }
+
+    void DescriptorTable::FlushBatchedWrites(Device* dev)
+    {
+        if (m_batchedWrites == nullptr)
+            return;
+
+        // pending writes of other tables of the heap are flushed together, each write has its own destination set.
+        m_batchedWrites->Flush([dev](const VkWriteDescriptorSet* writes, uint32_t count) {
+            vkUpdateDescriptorSets(dev->m_apiData.m_device, count, writes, 0, nullptr);
+            });
+    }
+
+    void DescriptorTable::WriteDescriptor(Device* dev, const VkWriteDescriptorSet& write)
+    {
+        if (!m_isBatching) {
+            vkUpdateDescriptorSets(dev->m_apiData.m_device, 1, &write, 0, nullptr);
+            return;
+        }
+
+        m_batchedWrites->Record(write);
+    }
+
     bool DescriptorTable::Allocate(IDescriptorHeap* descHeap, const DescriptorTableLayout* descTableLayout, uint32_t unboundDescTableCount)
     {
         if (!descHeap->Allocate(descTableLayout, &m_apiData.m_heapAllocationInfo, unboundDescTableCount)) {
@@ -1153,6 +1325,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         }
 
         m_descTableLayout = descTableLayout;
+        m_batchedWrites = &descHeap->m_batchedWrites;
 
         return true;
     }
@@ -1247,7 +1420,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         write.dstArrayElement = indexInRange;
         write.descriptorCount = 1;
 
-        vkUpdateDescriptorSets(dev->m_apiData.m_device, 1, &write, 0, nullptr);
+        WriteDescriptor(dev, write);
 
         return true;
     }
@@ -1345,7 +1518,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         write.dstArrayElement = indexInRange;
         write.descriptorCount = 1;
 
-        vkUpdateDescriptorSets(dev->m_apiData.m_device, 1, &write, 0, nullptr);
+        WriteDescriptor(dev, write);
 
         return true;
     }
@@ -1366,7 +1539,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         write.descriptorCount = 1;
         write.pBufferInfo = &info;
 
-        vkUpdateDescriptorSets(dev->m_apiData.m_device, 1, &write, 0, nullptr);
+        WriteDescriptor(dev, write);
 
         return true;
     }
@@ -1387,7 +1560,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         write.descriptorCount = 1;
         write.pImageInfo = &info;
 
-        vkUpdateDescriptorSets(dev->m_apiData.m_device, 1, &write, 0, nullptr);
+        WriteDescriptor(dev, write);
 
         return true;
     }
@@ -1421,6 +1594,9 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
             return false;
         }
 
+        // keep the order with the batched writes.
+        FlushBatchedWrites(dev);
+
         VkCopyDescriptorSet copy = {};
         copy.sType = VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET;
         copy.srcSet = descTable->m_apiData.m_heapAllocationInfo.m_descSet;
@@ -1497,6 +1673,11 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
             }
 
             hr = dev->m_apiData.m_device->CreateRootSignature(0, serializedRS->GetBufferPointer(), serializedRS->GetBufferSize(), IID_PPV_ARGS(&m_apiData.m_rootSignature));
+            {
+                KickstartRT::CRC::CrcHash hasher;
+                hasher.AddBytes((const char*)serializedRS->GetBufferPointer(), serializedRS->GetBufferSize());
+                m_apiData.m_serializedCRC = hasher.Get();
+            }
             if (serializedRS)
                 serializedRS->Release();
             if (error)
@@ -1575,6 +1756,152 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         return true;
     }
 
+#endif
+
+    /***************************************************************
+     * ID3D12PipelineLibrary in D3D12
+     * VkPipelineCache in VK
+     ***************************************************************/
+#if defined(GRAPHICS_API_D3D12)
+    PipelineCache::~PipelineCache()
+    {
+        if (m_apiData.m_library)
+            m_apiData.m_library->Release();
+        m_apiData = {};
+    }
+
+    bool PipelineCache::GetDeviceIdentifier(Device* dev, DeviceIdentifier* retIdentifier)
+    {
+        *retIdentifier = {};
+
+        Microsoft::WRL::ComPtr<IDXGIFactory4>   factory;
+        Microsoft::WRL::ComPtr<IDXGIAdapter1>   adapter;
+        if (FAILED(CreateDXGIFactory1(IID_PPV_ARGS(&factory))) ||
+            FAILED(factory->EnumAdapterByLuid(dev->m_apiData.m_device->GetAdapterLuid(), IID_PPV_ARGS(&adapter)))) {
+            Log::Warning(L"Failed to find the adapter of the device.");
+            return false;
+        }
+
+        DXGI_ADAPTER_DESC1 desc = {};
+        LARGE_INTEGER umdVersion = {};
+        if (FAILED(adapter->GetDesc1(&desc)) ||
+            FAILED(adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &umdVersion))) {
+            Log::Warning(L"Failed to get the adapter description.");
+            return false;
+        }
+
+        retIdentifier->m_vendorID = desc.VendorId;
+        retIdentifier->m_deviceID = desc.DeviceId;
+        retIdentifier->m_driverVersion = (uint64_t)umdVersion.QuadPart;
+        static_assert(sizeof(desc.SubSysId) + sizeof(desc.Revision) <= sizeof(retIdentifier->m_uuid));
+        memcpy(retIdentifier->m_uuid.data(), &desc.SubSysId, sizeof(desc.SubSysId));
+        memcpy(retIdentifier->m_uuid.data() + sizeof(desc.SubSysId), &desc.Revision, sizeof(desc.Revision));
+
+        return true;
+    }
+
+    bool PipelineCache::Init(Device* dev, const void* initialData, size_t initialDataSize)
+    {
+        HRESULT hr = E_FAIL;
+
+        if (initialData != nullptr && initialDataSize > 0) {
+            m_apiData.m_initialData.assign((const uint8_t*)initialData, (const uint8_t*)initialData + initialDataSize);
+            hr = dev->m_apiData.m_device->CreatePipelineLibrary(m_apiData.m_initialData.data(), m_apiData.m_initialData.size(), IID_PPV_ARGS(&m_apiData.m_library));
+            if (FAILED(hr)) {
+                // e.g. D3D12_ERROR_DRIVER_VERSION_MISMATCH or D3D12_ERROR_ADAPTER_NOT_FOUND.
+                Log::Info(L"Serialized pipeline library was rejected. Creating an empty one.");
+                m_apiData.m_initialData.clear();
+            }
+        }
+
+        m_isWarm = SUCCEEDED(hr);
+        if (!m_isWarm) {
+            hr = dev->m_apiData.m_device->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&m_apiData.m_library));
+            if (FAILED(hr)) {
+                Log::Warning(L"Failed to create a pipeline library.");
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool PipelineCache::GetData(std::vector<uint8_t>* retData)
+    {
+        retData->resize(m_apiData.m_library->GetSerializedSize());
+        if (FAILED(m_apiData.m_library->Serialize(retData->data(), retData->size()))) {
+            Log::Warning(L"Failed to serialize a pipeline library.");
+            retData->clear();
+            return false;
+        }
+
+        return true;
+    }
+#elif defined(GRAPHICS_API_VK)
+    PipelineCache::~PipelineCache()
+    {
+        if (m_apiData.m_device && m_apiData.m_pipelineCache)
+            vkDestroyPipelineCache(m_apiData.m_device, m_apiData.m_pipelineCache, nullptr);
+        m_apiData = {};
+    }
+
+    bool PipelineCache::GetDeviceIdentifier(Device* dev, DeviceIdentifier* retIdentifier)
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(dev->m_apiData.m_physicalDevice, &properties);
+
+        retIdentifier->m_vendorID = properties.vendorID;
+        retIdentifier->m_deviceID = properties.deviceID;
+        retIdentifier->m_driverVersion = properties.driverVersion;
+        static_assert(sizeof(properties.pipelineCacheUUID) == sizeof(retIdentifier->m_uuid));
+        memcpy(retIdentifier->m_uuid.data(), properties.pipelineCacheUUID, sizeof(properties.pipelineCacheUUID));
+
+        return true;
+    }
+
+    bool PipelineCache::Init(Device* dev, const void* initialData, size_t initialDataSize)
+    {
+        VkPipelineCacheCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        info.initialDataSize = initialData != nullptr ? initialDataSize : 0;
+        info.pInitialData = initialData;
+
+        // drivers ignore initial data with an incompatible header.
+        VkResult res = vkCreatePipelineCache(dev->m_apiData.m_device, &info, nullptr, &m_apiData.m_pipelineCache);
+        m_isWarm = res == VK_SUCCESS && info.initialDataSize > 0;
+        if (res != VK_SUCCESS && info.initialDataSize > 0) {
+            Log::Info(L"Serialized pipeline cache was rejected. Creating an empty one.");
+            info.initialDataSize = 0;
+            info.pInitialData = nullptr;
+            res = vkCreatePipelineCache(dev->m_apiData.m_device, &info, nullptr, &m_apiData.m_pipelineCache);
+        }
+        if (res != VK_SUCCESS) {
+            Log::Warning(L"Failed to create a pipeline cache.");
+            m_apiData.m_pipelineCache = {};
+            return false;
+        }
+        m_apiData.m_device = dev->m_apiData.m_device;
+
+        return true;
+    }
+
+    bool PipelineCache::GetData(std::vector<uint8_t>* retData)
+    {
+        size_t size = 0;
+        if (vkGetPipelineCacheData(m_apiData.m_device, m_apiData.m_pipelineCache, &size, nullptr) != VK_SUCCESS) {
+            Log::Warning(L"Failed to get the pipeline cache size.");
+            return false;
+        }
+        retData->resize(size);
+        if (vkGetPipelineCacheData(m_apiData.m_device, m_apiData.m_pipelineCache, &size, retData->data()) != VK_SUCCESS) {
+            Log::Warning(L"Failed to get the pipeline cache data.");
+            retData->clear();
+            return false;
+        }
+        retData->resize(size);
+
+        return true;
+    }
 #endif
 
     /***************************************************************
@@ -1595,7 +1922,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         SetNameInternal(m_apiData.m_pipelineState, str.c_str());
     }
 
-    bool ComputePipelineState::Init(Device *dev, RootSignature* rootSig, ComputeShader* shader)
+    bool ComputePipelineState::Init(Device *dev, RootSignature* rootSig, ComputeShader* shader, PipelineCache* cache, std::optional<bool>* retCacheHit)
     {
         D3D12_COMPUTE_PIPELINE_STATE_DESC desc = {};
 
@@ -1604,12 +1931,48 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
             shader->m_apiData.m_shaderByteCode.data(),
             shader->m_apiData.m_shaderByteCode.size() };
 
+        if (retCacheHit != nullptr)
+            *retCacheHit = false;
+
+        ID3D12PipelineLibrary* library = cache != nullptr ? cache->m_apiData.m_library : nullptr;
+
+        // pipelines sharing a shader ID can have different bytecode or root signatures, so the key is made of their contents.
+        wchar_t cacheName[32];
+        if (library != nullptr) {
+            KickstartRT::CRC::CrcHash hasher;
+            hasher.AddBytes((const char*)shader->m_apiData.m_shaderByteCode.data(), shader->m_apiData.m_shaderByteCode.size());
+            swprintf(cacheName, 32, L"%08X_%08X_%08X", (uint32_t)shader->m_apiData.m_shaderByteCode.size(), hasher.Get(), rootSig->m_apiData.m_serializedCRC);
+
+            // E_INVALIDARG when the name is not found or the desc doesn't match.
+            if (SUCCEEDED(library->LoadComputePipeline(cacheName, &desc, IID_PPV_ARGS(&m_apiData.m_pipelineState)))) {
+                if (retCacheHit != nullptr)
+                    *retCacheHit = true;
+                return true;
+            }
+        }
+
         HRESULT hr = dev->m_apiData.m_device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&m_apiData.m_pipelineState));
         if (FAILED(hr)) {
             Log::Fatal(L"Failed to create PSO");
             return false;
         }
 
+        if (library != nullptr) {
+            hr = library->StorePipeline(cacheName, m_apiData.m_pipelineState);
+            if (hr == E_INVALIDARG) {
+                // the name exists. it's fine if another thread has just stored the same pipeline,
+                // otherwise the entry didn't match the desc and it cannot be replaced, so the library is rebuilt from the next run.
+                ID3D12PipelineState* stored = nullptr;
+                if (SUCCEEDED(library->LoadComputePipeline(cacheName, &desc, IID_PPV_ARGS(&stored))))
+                    stored->Release();
+                else if (!cache->m_needsRebuild.exchange(true))
+                    Log::Info(L"Pipeline library has a stale entry. It will be rebuilt.");
+            }
+            else if (FAILED(hr)) {
+                Log::Warning(L"Failed to store a PSO to the pipeline library.");
+            }
+        }
+
         return true;
     }
 #elif defined(GRAPHICS_API_VK)
@@ -1627,8 +1990,11 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         SetNameInternal(m_apiData.m_device, VkObjectType::VK_OBJECT_TYPE_PIPELINE, (uint64_t)m_apiData.m_pipeline, str.c_str());
     }
 
-    bool ComputePipelineState::Init(Device* dev, RootSignature* rootSig, ComputeShader* shader)
+    bool ComputePipelineState::Init(Device* dev, RootSignature* rootSig, ComputeShader* shader, PipelineCache* cache, std::optional<bool>* retCacheHit)
     {
+        // VkPipelineCache doesn't tell whether a pipeline was found in it.
+        if (retCacheHit != nullptr)
+            *retCacheHit = cache != nullptr ? std::nullopt : std::optional<bool>(false);
 
         {
             VkShaderModuleCreateInfo    info = {};
@@ -1651,7 +2017,8 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
             info.stage.module = m_apiData.m_module_CS;
             info.layout = rootSig->m_apiData.m_pipelineLayout;
 
-            if (vkCreateComputePipelines(dev->m_apiData.m_device, nullptr, 1, &info, nullptr, &m_apiData.m_pipeline) != VK_SUCCESS) {
+            VkPipelineCache pipelineCache = cache != nullptr ? cache->m_apiData.m_pipelineCache : VK_NULL_HANDLE;
+            if (vkCreateComputePipelines(dev->m_apiData.m_device, pipelineCache, 1, &info, nullptr, &m_apiData.m_pipeline) != VK_SUCCESS) {
                 Log::Fatal(L"Failed to create PSO (vkPipeline)");
                 return false;
             }
@@ -2630,6 +2997,127 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
 		return flags;
     }
 
+    DeviceMemoryAllocator::~DeviceMemoryAllocator()
+    {
+        // freeing a device memory unmaps it implicitly.
+        for (auto&& b : m_blocks)
+            vkFreeMemory(m_device, b.second, nullptr);
+        m_blocks.clear();
+        m_mappedPtrs.clear();
+    }
+
+    bool DeviceMemoryAllocator::Init(VkDevice device, uint32_t memoryTypeIndex, bool enableDeviceAddress, bool isHostVisible, uint64_t blockSizeInBytes)
+    {
+        m_device = device;
+        m_memoryTypeIndex = memoryTypeIndex;
+        m_enableDeviceAddress = enableDeviceAddress;
+        m_isHostVisible = isHostVisible;
+        m_blockSizeInBytes = blockSizeInBytes;
+
+        return m_allocator.Init(true, m_blockSizeInBytes, m_pageSizeInBytes);
+    }
+
+    bool DeviceMemoryAllocator::Alloc(const VkMemoryRequirements& reqs, bool enableDeviceAddress, VkDeviceMemory* retMemory, uint64_t* retOffset, uint64_t* retAllocation, uint8_t** retMappedPtr)
+    {
+        if ((reqs.memoryTypeBits & (1u << m_memoryTypeIndex)) == 0)
+            return false;
+        // blocks without the device address bit can't back a resource which queries its address.
+        if (enableDeviceAddress && !m_enableDeviceAddress)
+            return false;
+
+        // offsets are page aligned in a block, so pad the allocation only for larger alignments.
+        uint64_t alignment = std::max<uint64_t>(reqs.alignment, 1);
+        uint64_t paddedSize = reqs.size + (alignment > m_pageSizeInBytes ? alignment - m_pageSizeInBytes : 0);
+
+        // large resources get a dedicated allocation.
+        if (paddedSize > m_blockSizeInBytes / 4)
+            return false;
+
+        std::scoped_lock mtx(m_mutex);
+
+        size_t allocation;
+        if (!m_allocator.Alloc(paddedSize, &allocation))
+            return false;
+
+        uint32_t blockID = (uint32_t)(allocation / m_blockSizeInBytes);
+        auto itr = m_blocks.find(blockID);
+        if (itr == m_blocks.end()) {
+            VkMemoryAllocateInfo allocInfo = {};
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize = m_blockSizeInBytes;
+            allocInfo.memoryTypeIndex = m_memoryTypeIndex;
+
+            VkMemoryAllocateFlagsInfo flagInfo = {};
+            if (m_enableDeviceAddress) {
+                flagInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+                flagInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+                allocInfo.pNext = &flagInfo;
+            }
+
+            VkDeviceMemory mem = {};
+            void* mappedPtr = nullptr;
+            if (vkAllocateMemory(m_device, &allocInfo, nullptr, &mem) != VK_SUCCESS) {
+                Log::Warning(L"Failed to allocate a vk memory block for suballocation.");
+                mem = {};
+            }
+            else if (m_isHostVisible && vkMapMemory(m_device, mem, 0, VK_WHOLE_SIZE, 0, &mappedPtr) != VK_SUCCESS) {
+                Log::Warning(L"Failed to map a vk memory block for suballocation.");
+                vkFreeMemory(m_device, mem, nullptr);
+                mem = {};
+            }
+            if (!mem) {
+                // fall back to a dedicated allocation.
+                m_allocator.Free(allocation);
+                m_allocator.RemoveUnusedBlocks({ blockID });
+                return false;
+            }
+
+            itr = m_blocks.insert({ blockID, mem }).first;
+            m_mappedPtrs.insert({ blockID, reinterpret_cast<uint8_t*>(mappedPtr) });
+        }
+
+        uint64_t localOffset = allocation - (uint64_t)blockID * m_blockSizeInBytes;
+        localOffset = (localOffset + alignment - 1) / alignment * alignment;
+
+        *retMemory = itr->second;
+        *retOffset = localOffset;
+        *retAllocation = allocation;
+        *retMappedPtr = m_isHostVisible ? m_mappedPtrs[blockID] + localOffset : nullptr;
+
+        return true;
+    }
+
+    void DeviceMemoryAllocator::Free(uint64_t allocation)
+    {
+        std::scoped_lock mtx(m_mutex);
+
+        if (!m_allocator.Free(allocation)) {
+            Log::Fatal(L"Failed to free a suballocated vk memory.");
+            return;
+        }
+
+        // release an empty block, but keep the last one to avoid reallocating it repeatedly.
+        if (m_blocks.size() <= 1)
+            return;
+
+        uint32_t blockID = (uint32_t)(allocation / m_blockSizeInBytes);
+        size_t nbBlocks = m_allocator.NumberOfBlocks();
+        std::vector<uint32_t> ids(nbBlocks), occupancy(nbBlocks);
+        m_allocator.BlockStatus(ids.data(), occupancy.data());
+
+        for (size_t i = 0; i < nbBlocks; ++i) {
+            if (ids[i] != blockID)
+                continue;
+            if (occupancy[i] == 0) {
+                vkFreeMemory(m_device, m_blocks[blockID], nullptr);
+                m_blocks.erase(blockID);
+                m_mappedPtrs.erase(blockID);
+                m_allocator.RemoveUnusedBlocks({ blockID });
+            }
+            break;
+        }
+    }
+
     bool Resource::AllocateDeviceMemory(Device *dev, Device::VulkanDeviceMemoryType memType, uint32_t /*memoryTypeBits*/, bool enableDeviceAddress, size_t size, VkDeviceMemory *mem)
     {
         VkMemoryAllocateInfo allocInfo = {};
@@ -2794,6 +3282,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
     bool Texture::Create(Device* dev, Resource::Type type, Resource::Format format, Resource::BindFlags bindFlags,
         uint32_t width, uint32_t height, uint32_t depth, uint32_t arraySize, uint32_t mipLevels, uint32_t sampleCount)
     {
+        m_serial = NextSerial();
         m_type = type;
         m_format = format;
         m_bindFlags = bindFlags;
@@ -2937,10 +3426,13 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         if (m_destructWithDestructor) {
             if (m_apiData.m_device && m_apiData.m_image)
                 vkDestroyImage(m_apiData.m_device, m_apiData.m_image, nullptr);
-            if (m_apiData.m_deviceMemory && m_apiData.m_device)
+            if (m_apiData.m_memoryAllocator)
+                m_apiData.m_memoryAllocator->Free(m_apiData.m_memoryAllocation);
+            else if (m_apiData.m_deviceMemory && m_apiData.m_device)
                 vkFreeMemory(m_apiData.m_device, m_apiData.m_deviceMemory, nullptr);
             m_apiData.m_image = {};
             m_apiData.m_deviceMemory = {};
+            m_apiData.m_memoryAllocator = nullptr;
             m_apiData.m_device = {};
         }
     }
@@ -2974,6 +3466,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
     bool Texture::Create(Device* dev, Resource::Type type, Resource::Format format, Resource::BindFlags bindFlags,
                         uint32_t width, uint32_t height, uint32_t depth, uint32_t arraySize, uint32_t mipLevels, uint32_t sampleCount)
     {
+        m_serial = NextSerial();
         VkImageCreateInfo imageInfo = {};
 
         imageInfo.arrayLayers = arraySize;
@@ -3007,11 +3500,19 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         VkMemoryRequirements memRequirements;
         vkGetImageMemoryRequirements(dev->m_apiData.m_device, m_apiData.m_image, &memRequirements);
 
-        if (! Resource::AllocateDeviceMemory(dev, Device::VulkanDeviceMemoryType::Default, memRequirements.memoryTypeBits, false, memRequirements.size, &m_apiData.m_deviceMemory)) {
+        DeviceMemoryAllocator* memAllocator = imageInfo.tiling == VK_IMAGE_TILING_OPTIMAL ?
+            dev->m_imageMemoryAllocator.get() : dev->m_bufferMemoryAllocators[(size_t)Device::VulkanDeviceMemoryType::Default].get();
+        VkDeviceSize memOffset = 0;
+        if (!is_set(bindFlags, BindFlags::Shared) &&
+            memAllocator->Alloc(memRequirements, false, &m_apiData.m_deviceMemory, &memOffset, &m_apiData.m_memoryAllocation, &m_apiData.m_memoryMappedPtr)) {
+            m_apiData.m_memoryAllocator = memAllocator;
+            m_apiData.m_deviceMemoryOffset = memOffset;
+        }
+        else if (! Resource::AllocateDeviceMemory(dev, Device::VulkanDeviceMemoryType::Default, memRequirements.memoryTypeBits, false, memRequirements.size, &m_apiData.m_deviceMemory)) {
             Log::Fatal(L"Failed to allocate vk device memory");
             return false;
         }
-        if (vkBindImageMemory(dev->m_apiData.m_device, m_apiData.m_image, m_apiData.m_deviceMemory, 0) != VK_SUCCESS) {
+        if (vkBindImageMemory(dev->m_apiData.m_device, m_apiData.m_image, m_apiData.m_deviceMemory, memOffset) != VK_SUCCESS) {
             Log::Fatal(L"Failed to bind vk device memory to an image");
             return false;
         }
@@ -3095,6 +3596,11 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
 #if defined(GRAPHICS_API_D3D12)
     Buffer::~Buffer()
     {
+        if (m_apiData.m_resource && m_persistentMappedPtr != nullptr) {
+            D3D12_RANGE wroteRange = { 0, 0 };
+            m_apiData.m_resource->Unmap(0, &wroteRange);
+            m_persistentMappedPtr = nullptr;
+        }
         if (m_apiData.m_resource && m_destructWithDestructor)
             m_apiData.m_resource->Release();
 
@@ -3107,6 +3613,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         Resource::BindFlags bindFlags,
         Buffer::CpuAccess cpuAccess)
     {
+        m_serial = NextSerial();
         if (cpuAccess != CpuAccess::None && is_set(bindFlags, BindFlags::Shared))
         {
             Log::Fatal(L"Can't create shared resource with CPU access other than 'None'.");
@@ -3291,6 +3798,32 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         m_apiData.m_resource->Unmap(subResourceIndex, &wroteRange);
     }
 
+    void* Buffer::MapPersistently(Device* /*dev*/)
+    {
+        if (m_cpuAccess == CpuAccess::None || m_persistentMappedPtr != nullptr) {
+            Log::Fatal(L"Invalid persistent map operation detected.");
+            return nullptr;
+        }
+
+        // readback heaps tell the driver that the CPU may read the entire buffer.
+        D3D12_RANGE readRange = { 0, m_cpuAccess == CpuAccess::Read ? (SIZE_T)m_sizeInBytes : 0 };
+        if (FAILED(m_apiData.m_resource->Map(0, &readRange, &m_persistentMappedPtr))) {
+            Log::Fatal(L"Faild to map buffer, probably device has been removed for some reason.");
+            m_persistentMappedPtr = nullptr;
+        }
+        return m_persistentMappedPtr;
+    }
+
+    void Buffer::InvalidateMappedRange(Device* /*dev*/, uint64_t /*rangeBegin*/, uint64_t /*rangeEnd*/)
+    {
+        // upload and readback heaps are coherent with the GPU, so nothing to do.
+    }
+
+    void Buffer::FlushMappedRange(Device* /*dev*/, uint64_t /*rangeBegin*/, uint64_t /*rangeEnd*/)
+    {
+        // upload and readback heaps are coherent with the GPU, so nothing to do.
+    }
+
 #elif defined(GRAPHICS_API_VK)
     Buffer::~Buffer()
     {
@@ -3301,8 +3834,14 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
 #endif
             if (m_apiData.m_buffer && m_apiData.m_device)
                 vkDestroyBuffer(m_apiData.m_device, m_apiData.m_buffer, nullptr);
-            if (m_apiData.m_deviceMemory && m_apiData.m_device && m_apiData.m_deviceMemoryOffset == uint64_t(-1))
-                vkFreeMemory(m_apiData.m_device, m_apiData.m_deviceMemory, nullptr);
+            if (m_apiData.m_memoryAllocator)
+                m_apiData.m_memoryAllocator->Free(m_apiData.m_memoryAllocation);
+            else {
+                if (m_apiData.m_deviceMemory && m_apiData.m_device && m_persistentMappedPtr != nullptr)
+                    vkUnmapMemory(m_apiData.m_device, m_apiData.m_deviceMemory);
+                if (m_apiData.m_deviceMemory && m_apiData.m_device && m_apiData.m_deviceMemoryOffset == uint64_t(-1))
+                    vkFreeMemory(m_apiData.m_device, m_apiData.m_deviceMemory, nullptr);
+            }
 
 #if 0
             m_apiData.m_accelerationStructure = {};
@@ -3310,7 +3849,10 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
             m_apiData.m_buffer = {};
             m_apiData.m_deviceMemory = {};
             m_apiData.m_deviceAddress = {};
+            m_apiData.m_memoryAllocator = nullptr;
+            m_apiData.m_memoryMappedPtr = nullptr;
             m_apiData.m_device = {};
+            m_persistentMappedPtr = nullptr;
         }
     }
 
@@ -3320,6 +3862,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         Resource::BindFlags bindFlags,
         CpuAccess cpuAccess)
     {
+        m_serial = NextSerial();
         uint64_t sizeInBytes = sizeInBytesOrNumberOfElements;
         if (format != Resource::Format::Unknown) {
             sizeInBytes *= Resource::GetFormatBytesPerBlock(format);
@@ -3401,6 +3944,14 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
             m_apiData.m_deviceMemory = heap->m_apiData.m_deviceMemory;
             m_apiData.m_deviceMemoryOffset = heapOffsetInBytes;
         }
+        else if (!is_set(bindFlags, BindFlags::Shared) &&
+            dev->m_bufferMemoryAllocators[(size_t)memType]->Alloc(reqs, enableDeviceAddress, &m_apiData.m_deviceMemory, &m_apiData.m_deviceMemoryOffset, &m_apiData.m_memoryAllocation, &m_apiData.m_memoryMappedPtr)) {
+            m_apiData.m_memoryAllocator = dev->m_bufferMemoryAllocators[(size_t)memType].get();
+            if (vkBindBufferMemory(dev->m_apiData.m_device, m_apiData.m_buffer, m_apiData.m_deviceMemory, m_apiData.m_deviceMemoryOffset) != VK_SUCCESS) {
+                Log::Fatal(L"Faild to bind buffer memory.");
+                return false;
+            }
+        }
         else {
             if (!Resource::AllocateDeviceMemory(dev, memType, reqs.memoryTypeBits, enableDeviceAddress, reqs.size, &m_apiData.m_deviceMemory)) {
                 Log::Fatal(L"Faild to allocate device memory.");
@@ -3417,6 +3968,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         m_sizeInBytes = sizeInBytes;
         m_bindFlags = bindFlags;
         m_cpuAccess = cpuAccess;
+        m_isHostCoherent = dev->m_deviceMemoryTypeIsCoherent[(size_t)memType];
         m_format = format;
         m_type = Type::Buffer;
 
@@ -3498,6 +4050,11 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
             break;
         };
 
+        if (m_apiData.m_memoryMappedPtr != nullptr) {
+            // suballocated memory is mapped persistently per block.
+            return m_apiData.m_memoryMappedPtr + offset;
+        }
+
         if (m_apiData.m_deviceMemoryOffset != uint64_t(-1)) {
             offset += m_apiData.m_deviceMemoryOffset;
             if (type == MapType::WriteDiscard) {
@@ -3519,10 +4076,78 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         if (subResourceIndex > 0) {
             Log::Fatal(L"Mapping subresourceIndex != 0 isn't supported.");
         }
+        if (m_apiData.m_memoryMappedPtr != nullptr)
+            return;
 
         vkUnmapMemory(dev->m_apiData.m_device, m_apiData.m_deviceMemory);
     }
 
+    void* Buffer::MapPersistently(Device* dev)
+    {
+        if (m_cpuAccess == CpuAccess::None || m_persistentMappedPtr != nullptr) {
+            Log::Fatal(L"Invalid persistent map operation detected.");
+            return nullptr;
+        }
+        if (m_apiData.m_memoryMappedPtr != nullptr) {
+            m_persistentMappedPtr = m_apiData.m_memoryMappedPtr;
+            return m_persistentMappedPtr;
+        }
+        if (m_apiData.m_deviceMemoryOffset != uint64_t(-1)) {
+            // a device memory can be mapped only once, so it cannot be shared with other placed resources.
+            Log::Fatal(L"Placed resource doesn't support persistent map().");
+            return nullptr;
+        }
+
+        if (vkMapMemory(dev->m_apiData.m_device, m_apiData.m_deviceMemory, 0, VK_WHOLE_SIZE, 0, &m_persistentMappedPtr) != VK_SUCCESS) {
+            Log::Fatal(L"Faild to map buffer.");
+            m_persistentMappedPtr = nullptr;
+        }
+        return m_persistentMappedPtr;
+    }
+
+    // Ranges of non-coherent memory need to be aligned to nonCoherentAtomSize, or reach the end of the mapping.
+    // Suballocation blocks are multiples of the atom size, so an aligned end never exceeds the block.
+    static VkMappedMemoryRange MappedMemoryRange(Device* dev, VkDeviceMemory memory, uint64_t memoryOffset, uint64_t mappingSizeInBytes, uint64_t rangeBegin, uint64_t rangeEnd)
+    {
+        uint64_t atom = dev->m_nonCoherentAtomSize;
+        uint64_t begin = (memoryOffset + rangeBegin) / atom * atom;
+        uint64_t end = (memoryOffset + rangeEnd + atom - 1) / atom * atom;
+
+        VkMappedMemoryRange range = {};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = memory;
+        range.offset = begin;
+        range.size = end >= mappingSizeInBytes ? VK_WHOLE_SIZE : end - begin;
+
+        return range;
+    }
+
+    void Buffer::InvalidateMappedRange(Device* dev, uint64_t rangeBegin, uint64_t rangeEnd)
+    {
+        if (m_isHostCoherent || m_persistentMappedPtr == nullptr || rangeBegin >= rangeEnd)
+            return;
+
+        bool isSuballocated = m_apiData.m_memoryAllocator != nullptr;
+        VkMappedMemoryRange range = MappedMemoryRange(dev, m_apiData.m_deviceMemory,
+            isSuballocated ? m_apiData.m_deviceMemoryOffset : 0, isSuballocated ? uint64_t(-1) : m_sizeInBytes, rangeBegin, rangeEnd);
+        if (vkInvalidateMappedMemoryRanges(dev->m_apiData.m_device, 1, &range) != VK_SUCCESS) {
+            Log::Fatal(L"Faild to invalidate mapped memory range.");
+        }
+    }
+
+    void Buffer::FlushMappedRange(Device* dev, uint64_t rangeBegin, uint64_t rangeEnd)
+    {
+        if (m_isHostCoherent || m_persistentMappedPtr == nullptr || rangeBegin >= rangeEnd)
+            return;
+
+        bool isSuballocated = m_apiData.m_memoryAllocator != nullptr;
+        VkMappedMemoryRange range = MappedMemoryRange(dev, m_apiData.m_deviceMemory,
+            isSuballocated ? m_apiData.m_deviceMemoryOffset : 0, isSuballocated ? uint64_t(-1) : m_sizeInBytes, rangeBegin, rangeEnd);
+        if (vkFlushMappedMemoryRanges(dev->m_apiData.m_device, 1, &range) != VK_SUCCESS) {
+            Log::Fatal(L"Faild to flush mapped memory range.");
+        }
+    }
+
 
 #endif
 
@@ -3595,6 +4220,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
 
     bool ShaderResourceView::Init(Device* /*dev*/, Texture *tex, uint32_t mostDetailedMip, uint32_t mipCount, uint32_t firstArraySlice, uint32_t arraySize)
     {
+        m_resourceSerial = tex->m_serial;
         auto GetSRVResourceDimension = [&]() -> D3D12_SRV_DIMENSION
         {
             using Type = Resource::Type;
@@ -3709,6 +4335,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
 
     bool ShaderResourceView::Init(Device* /*dev*/, Buffer *buf, uint32_t firstElement, uint32_t elementCount)
     {
+        m_resourceSerial = buf->m_serial;
 		D3D12_SHADER_RESOURCE_VIEW_DESC desc = {};
 
 		uint32_t bufferElementSize = 0;
@@ -3877,6 +4504,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
 
     bool ShaderResourceView::Init(Device* dev, Texture* tex, uint32_t mostDetailedMip, uint32_t mipCount, uint32_t firstArraySlice, uint32_t arraySize)
     {
+        m_resourceSerial = tex->m_serial;
         VkImageViewCreateInfo info = {};
 
         auto getViewType = [](Resource::Type type, bool isArray) -> VkImageViewType {
@@ -3933,6 +4561,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
 
     bool ShaderResourceView::Init(Device* dev, Buffer* buf, uint32_t firstElement, uint32_t elementCount)
     {
+        m_resourceSerial = buf->m_serial;
         uint32_t bufferElementSize = buf->m_format == Resource::Format::Unknown ? 1 : Resource::GetFormatBytesPerBlock(buf->m_format);
         m_apiData.m_rawOffsetInBytes = (uint64_t)firstElement * bufferElementSize;
         m_apiData.m_rawSizeInBytes = elementCount == 0xFFFFFFFF ? buf->m_sizeInBytes : (uint64_t)elementCount * bufferElementSize;
@@ -4063,6 +4692,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
 
     bool UnorderedAccessView::Init(Device* /*dev*/, Texture *tex, uint32_t mipLevel, uint32_t firstArraySlice, uint32_t arraySize)
     {
+        m_resourceSerial = tex->m_serial;
         auto GetUAVResourceDimension = [&]() -> D3D12_UAV_DIMENSION
         {
             using Type = Resource::Type;
@@ -4145,6 +4775,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
 
     bool UnorderedAccessView::Init(Device* /*dev*/, Buffer *buf, uint32_t firstElement, uint32_t elementCount)
     {
+        m_resourceSerial = buf->m_serial;
 		D3D12_UNORDERED_ACCESS_VIEW_DESC desc = {};
 
 		uint32_t bufferElementSize = 0;
@@ -4263,6 +4894,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
 
     bool UnorderedAccessView::Init(Device* dev, Texture* tex, uint32_t mipLevel, uint32_t firstArraySlice, uint32_t arraySize)
     {
+        m_resourceSerial = tex->m_serial;
         VkImageViewCreateInfo info = {};
 
         auto getViewType = [](Resource::Type type, bool isArray) -> VkImageViewType {
@@ -4319,6 +4951,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
 
     bool UnorderedAccessView::Init(Device* dev, Buffer* buf, uint32_t firstElement, uint32_t elementCount)
     {
+        m_resourceSerial = buf->m_serial;
 #if 0
         if (buf->GetGlobalState() == ResourceState::State::AccelerationStructure) {
             Log::Fatal(L"AccelerationStructure detected. nee to check SDK source code to support it.");
@@ -4398,6 +5031,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
 #if defined(GRAPHICS_API_D3D12)
     bool ConstantBufferView::Init(Buffer* buf, uint64_t offsetInBytes, uint32_t sizeInBytes)
     {
+        m_resourceSerial = buf->m_serial;
         D3D12_CONSTANT_BUFFER_VIEW_DESC desc = {};
         desc.BufferLocation = buf->m_apiData.m_resource->GetGPUVirtualAddress();
 
@@ -4427,6 +5061,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
 #elif defined(GRAPHICS_API_VK)
     bool ConstantBufferView::Init(Buffer* buf, uint64_t offsetInBytes, uint32_t sizeInBytes)
     {
+        m_resourceSerial = buf->m_serial;
         if (Resource::ConstantBufferPlacementAlignment(offsetInBytes) != offsetInBytes ||
             Resource::ConstantBufferPlacementAlignment(sizeInBytes) != sizeInBytes) {
             Log::Fatal(L"Faild to init CBV. Alignment violation detected.");
@@ -4861,9 +5496,15 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
                     else if (buf->GetGlobalState() == ResourceState::State::UnorderedAccess && newState == ResourceState::State::CopyDest) {
                         bufSHADER2CPYBarrier.push_back(barrier);
                     }
+                    else if (buf->GetGlobalState() == ResourceState::State::NonPixelShader && newState == ResourceState::State::CopyDest) {
+                        bufSHADER2CPYBarrier.push_back(barrier);
+                    }
                     else if (buf->GetGlobalState() == ResourceState::State::GenericRead && newState == ResourceState::State::CopySource) {
                         bufTop2CPYBarrier.push_back(barrier);
                     }
+                    else if (buf->GetGlobalState() == ResourceState::State::Common && newState == ResourceState::State::CopyDest) {
+                        bufTop2CPYBarrier.push_back(barrier);
+                    }
                     else if (buf->GetGlobalState() == ResourceState::State::CopyDest && newState == ResourceState::State::UnorderedAccess) {
                         bufCPY2SHADERBarrier.push_back(barrier);
                     }
@@ -5032,7 +5673,8 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
                     0, nullptr);
             }
             if (bufSHADER2CPYBarrier.size() > 0) {
-                vkCmdPipelineBarrier(m_apiData.m_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                // TLAS instance descs are read by AS builds.
+                vkCmdPipelineBarrier(m_apiData.m_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
                     0, nullptr,
                     (uint32_t)bufSHADER2CPYBarrier.size(), bufSHADER2CPYBarrier.data(),
                     0, nullptr);
@@ -5044,7 +5686,8 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
                     0, nullptr);
             }
             if (bufCPY2SHADERBarrier.size() > 0) {
-                vkCmdPipelineBarrier(m_apiData.m_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                // TLAS instance descs are read by AS builds.
+                vkCmdPipelineBarrier(m_apiData.m_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0,
                     0, nullptr,
                     (uint32_t)bufCPY2SHADERBarrier.size(), bufCPY2SHADERBarrier.data(),
                     0, nullptr);
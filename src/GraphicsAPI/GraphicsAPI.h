@@ -26,6 +26,14 @@
 #include <memory>
 #include <array>
 #include <vector>
+#if defined(GRAPHICS_API_VK)
+#include <mutex>
+#include <atomic>
+#include <optional>
+#include <unordered_map>
+#include <VirtualAllocator.h>
+#include <DescriptorBatchedWrites.h>
+#endif
 
 // This is to enable RT shader stage bindings of descriptor layouts in Vulkan. 
 #define USE_SHADER_TABLE_RT_SHADERS 1
@@ -92,6 +100,35 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
 #endif
     };
 
+#if defined(GRAPHICS_API_VK)
+    /***************************************************************
+     * Suballocator of VkDeviceMemory blocks of a memory type. (VK only)
+     * Host visible blocks are mapped persistently since a VkDeviceMemory can be mapped only once.
+     ***************************************************************/
+    struct DeviceMemoryAllocator : public Noncopyable
+    {
+        static constexpr uint64_t   m_pageSizeInBytes = 4ull * 1024;
+
+        std::mutex                                      m_mutex;
+        VkDevice                                        m_device = {};
+        uint32_t                                        m_memoryTypeIndex = 0;
+        bool                                            m_enableDeviceAddress = false;
+        bool                                            m_isHostVisible = false;
+        uint64_t                                        m_blockSizeInBytes = 0;
+        VirtualAllocator::TLSFAllocator                 m_allocator;
+        std::unordered_map<uint32_t, VkDeviceMemory>    m_blocks;
+        std::unordered_map<uint32_t, uint8_t*>          m_mappedPtrs;
+
+        ~DeviceMemoryAllocator();
+
+        bool Init(VkDevice device, uint32_t memoryTypeIndex, bool enableDeviceAddress, bool isHostVisible, uint64_t blockSizeInBytes);
+
+        // Returns false when the resource should get a dedicated allocation instead.
+        bool Alloc(const VkMemoryRequirements& reqs, bool enableDeviceAddress, VkDeviceMemory* retMemory, uint64_t* retOffset, uint64_t* retAllocation, uint8_t** retMappedPtr);
+        void Free(uint64_t allocation);
+    };
+#endif
+
     /***************************************************************
      * Device in D3D12
      * Device in VK
@@ -120,6 +157,13 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
             Count
         };
         std::array<uint32_t, (size_t)VulkanDeviceMemoryType::Count>     m_deviceMemoryTypeIndex;
+        std::array<bool, (size_t)VulkanDeviceMemoryType::Count>         m_deviceMemoryTypeIsCoherent;
+        uint64_t                                                        m_nonCoherentAtomSize = 1;
+
+        // Suballocators of VkDeviceMemory blocks for standalone resources, per memory type.
+        // Optimally tiled images use their own so they never share a block with linear resources.
+        std::array<std::unique_ptr<DeviceMemoryAllocator>, (size_t)VulkanDeviceMemoryType::Count>   m_bufferMemoryAllocators;
+        std::unique_ptr<DeviceMemoryAllocator>                                                      m_imageMemoryAllocator;
 #endif
 
         ApiData   m_apiData = {};
@@ -170,6 +214,13 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
      ***************************************************************/
     struct DescriptorTableLayout;
 
+#if defined(GRAPHICS_API_VK)
+    // Owned by a heap and shared by the tables allocated from it, so that tables don't allocate their own containers.
+    using DescriptorBatchedWrites = KickstartRT_NativeLayer::DescriptorBatchedWrites<
+        VkWriteDescriptorSet, VkDescriptorImageInfo, VkDescriptorBufferInfo, VkBufferView,
+        VkWriteDescriptorSetAccelerationStructureKHR, VkAccelerationStructureKHR>;
+#endif
+
     struct IDescriptorHeap : public DeviceObject
     {
 #if defined(GRAPHICS_API_D3D12)
@@ -210,6 +261,8 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         virtual void GetHeaps(std::vector<ID3D12DescriptorHeap*>& retHeaps) = 0;
 #elif defined(GRAPHICS_API_VK)
         static constexpr VkDescriptorType nativeType(const Type& type);
+
+        DescriptorBatchedWrites     m_batchedWrites;
 #endif
 
         virtual ~IDescriptorHeap() = default;
@@ -259,6 +312,8 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         bool Create(Device* dev, const Desc& desc, bool isShaderVisible);
 #if defined(GRAPHICS_API_D3D12)
         virtual void GetHeaps(std::vector<ID3D12DescriptorHeap*>& retHeaps);
+        // Number of descriptors of the desc that are placed in the native heap type.
+        static uint32_t NativeDescCount(const Desc& desc, D3D12_DESCRIPTOR_HEAP_TYPE heapType);
 #endif
 
         virtual bool ResetAllocation() override;
@@ -286,6 +341,12 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
 
         virtual ~DescriptorSubHeap();
         bool Init(DescriptorHeap* heap, const DescriptorHeap::Desc& desc);
+        // Initialize as a range of another sub heap to place tables at an explicit offset in it.
+        bool InitRange(const DescriptorSubHeap* parent, D3D12_DESCRIPTOR_HEAP_TYPE heapType, uint32_t offset, uint32_t numDescriptors);
+        // Initialize at explicit offsets of each native heap type instead of the current offsets of the heap.
+        bool InitRange(DescriptorHeap* heap, const DescriptorHeap::Desc& desc, const std::array<uint32_t, D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES>& offsets);
+        // Heap type and number of descriptors that a table of the layout occupies. Unbound layouts are not supported.
+        static bool GetTableAllocationSize(const DescriptorTableLayout* descTable, D3D12_DESCRIPTOR_HEAP_TYPE* retHeapType, uint32_t* retNumDescriptors);
         virtual void GetHeaps(std::vector<ID3D12DescriptorHeap*>& retHeaps);
 
         virtual bool ResetAllocation() override;
@@ -354,6 +415,12 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         struct ApiData {
             IDescriptorHeap::AllocationInfo          m_heapAllocationInfo;
         };
+
+        DescriptorBatchedWrites*    m_batchedWrites = nullptr; // of the heap that the table is allocated from.
+        bool                        m_isBatching = false;
+
+        void WriteDescriptor(Device* dev, const VkWriteDescriptorSet& write);
+        void FlushBatchedWrites(Device* dev);
 #endif
 
         ApiData     m_apiData = {};
@@ -363,6 +430,10 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
 
         bool Allocate(IDescriptorHeap* descHeap, const DescriptorTableLayout* descTableLayout, uint32_t unboundDescTableCount = 0);
 
+        // Set*() calls in between are flushed with a single update in VK. D3D12 copies descriptors immediately.
+        void BeginBatchedWrite();
+        bool EndBatchedWrite(Device* dev);
+
         bool SetSrv(Device* dev, uint32_t rangeIndex, uint32_t indexInRange, const ShaderResourceView* srv);
         bool SetUav(Device* dev, uint32_t rangeIndex, uint32_t indexInRange, const UnorderedAccessView* uav);
         bool SetCbv(Device* dev, uint32_t rangeIndex, uint32_t indexInRange, const ConstantBufferView* cbv);
@@ -380,6 +451,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
 #if defined(GRAPHICS_API_D3D12)
         struct ApiData {
             ID3D12RootSignature* m_rootSignature = {};
+            uint32_t             m_serializedCRC = 0; // a part of the key of pipelines in a pipeline library.
         };
 #elif defined(GRAPHICS_API_VK)
         struct ApiData {
@@ -418,6 +490,45 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         bool Init(const void* shaderByteCode, size_t size);
     };
 
+    /***************************************************************
+     * ID3D12PipelineLibrary in D3D12
+     * VkPipelineCache in VK
+     ***************************************************************/
+    struct PipelineCache : public DeviceObject
+    {
+#if defined(GRAPHICS_API_D3D12)
+        struct ApiData {
+            ID3D12PipelineLibrary*  m_library = {};
+            // A pipeline library refers the initial data during its lifetime.
+            std::vector<uint8_t>    m_initialData;
+        };
+#elif defined(GRAPHICS_API_VK)
+        struct ApiData {
+            VkPipelineCache m_pipelineCache = {};
+            VkDevice        m_device = {};
+        };
+#endif
+        // Identifies the adapter and the driver that a serialized cache is valid for.
+        struct DeviceIdentifier {
+            uint32_t                    m_vendorID = 0;
+            uint32_t                    m_deviceID = 0;
+            uint64_t                    m_driverVersion = 0;
+            std::array<uint8_t, 16>     m_uuid = {};
+        };
+
+        ApiData     m_apiData = {};
+        bool        m_isWarm = false; // initialized with valid serialized data.
+        std::atomic<bool>   m_needsRebuild = false; // a stored pipeline didn't match its desc. the data is discarded instead of being saved. (D3D12 only)
+
+        virtual ~PipelineCache();
+
+        static bool GetDeviceIdentifier(Device* dev, DeviceIdentifier* retIdentifier);
+
+        // Falls back to an empty cache if the initial data is rejected.
+        bool Init(Device* dev, const void* initialData, size_t initialDataSize);
+        bool GetData(std::vector<uint8_t>* retData);
+    };
+
     /***************************************************************
      * ID3D12PipelineState in D3D12
      * VkPipeline in VK
@@ -441,7 +552,9 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         virtual ~ComputePipelineState();
         void SetName(const std::wstring& str);
 
-        bool Init(Device* dev, RootSignature* rootSig, ComputeShader* shader);
+        // D3D12 pipelines are keyed by the hashes of the bytecode and the root signature in a pipeline library.
+        // retCacheHit is nullopt when the API doesn't tell whether the pipeline was found in the cache.
+        bool Init(Device* dev, RootSignature* rootSig, ComputeShader* shader, PipelineCache* cache = nullptr, std::optional<bool>* retCacheHit = nullptr);
     };
 
     /***************************************************************
@@ -593,6 +706,11 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
             VkDeviceMemory  m_deviceMemory = {};
             VkDeviceAddress m_deviceAddress = {};
             uint64_t        m_deviceMemoryOffset = uint64_t(-1);
+
+            // Valid when the memory was suballocated from a DeviceMemoryAllocator.
+            DeviceMemoryAllocator*  m_memoryAllocator = nullptr;
+            uint64_t                m_memoryAllocation = 0;
+            uint8_t*                m_memoryMappedPtr = nullptr;
         };
 #endif
         /** Resource types. Notice there are no array types. Array are controlled using the array size parameter on texture creation.
@@ -864,6 +982,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
 
         bool        m_destructWithDestructor = true;
         ApiData     m_apiData = {};
+        uint64_t    m_serial = 0; // unique for each API object created by Create(). zero if wrapped from API data of the application.
         Type        m_type = Type::Buffer;
         BindFlags   m_bindFlags = BindFlags::None;
         uint32_t    m_subresourceCount = 1;
@@ -872,6 +991,12 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
 
         ApiResourceID GetApiResourceID() const;
 
+        static uint64_t NextSerial()
+        {
+            static std::atomic<uint64_t> serial{ 0 };
+            return ++serial;
+        }
+
         void SetGlobalState(ResourceState::State state, ResourceState::Subresource subresource = ResourceState::SubresourceAll);
         ResourceState::State GetGlobalState(ResourceState::Subresource subresource = ResourceState::SubresourceAll);
 
@@ -937,6 +1062,10 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         uint32_t            m_elementCount = 0;
         uint32_t            m_structSizeInBytes = 0;
         uint64_t            m_sizeInBytes = 0;
+        void*               m_persistentMappedPtr = nullptr; ///< Valid after MapPersistently() until the buffer is destructed.
+#if defined(GRAPHICS_API_VK)
+        bool                m_isHostCoherent = true;
+#endif
 
         bool Create(Device* dev,
             uint64_t sizeInBytesOrNumberOfElements, Resource::Format format,
@@ -965,6 +1094,16 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         void* Map(Device *dev, Buffer::MapType type, uint32_t subResourceIndex, uint64_t readRangeBegin, uint64_t readRangeEnd);
         void Unmap(Device *dev, uint32_t subResourceIndex, uint64_t writeRangeBegin, uint64_t writeRangeEnd);
 
+        /** Map the entire buffer once and keep it mapped until the buffer is destructed. Map() and Unmap() must not be used for the buffer after that.
+        */
+        void* MapPersistently(Device* dev);
+        /** Make GPU writes in the range visible through the persistently mapped pointer. Only needed for non-coherent memory.
+        */
+        void InvalidateMappedRange(Device* dev, uint64_t rangeBegin, uint64_t rangeEnd);
+        /** Make CPU writes in the range through the persistently mapped pointer visible to the GPU. Only needed for non-coherent memory.
+        */
+        void FlushMappedRange(Device* dev, uint64_t rangeBegin, uint64_t rangeEnd);
+
         virtual ~Buffer();
     };
 
@@ -1019,6 +1158,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         };
 #endif
         ApiData                     m_apiData = {};
+        uint64_t                    m_resourceSerial = 0; // Resource::m_serial of the viewed resource.
         bool                        m_isNullView = true;
         Resource::Type              m_nullViewType = Resource::Type::Buffer;
         bool                        m_nullIsArray = false;
@@ -1065,6 +1205,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         };
 #endif
         ApiData         m_apiData = {};
+        uint64_t        m_resourceSerial = 0; // Resource::m_serial of the viewed resource.
         bool            m_isNullView = true;
         Resource::Type  m_nullViewType = Resource::Type::Buffer;
         bool            m_nullIsArray = false;
@@ -1102,6 +1243,7 @@ namespace KickstartRT_NativeLayer::GraphicsAPI {
         };
 #endif
         ApiData      m_apiData = {};
+        uint64_t     m_resourceSerial = 0; // Resource::m_serial of the viewed buffer.
 
         bool Init(Buffer *buf, uint64_t offsetInBytes, uint32_t sizeInBytes);
         bool Init(Buffer *buf);
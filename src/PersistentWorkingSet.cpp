@@ -52,6 +52,10 @@ namespace KickstartRT_NativeLayer
 	{
 		std::scoped_lock mtx(m_mutex);
 
+		// warm-up workers refer root signatures owned by render passes.
+		if (m_shaderFactory)
+			m_shaderFactory->StopWarmUp();
+
 		m_winResFileSystem.reset();
 
 		// release all device objects anyway.
@@ -61,6 +65,8 @@ namespace KickstartRT_NativeLayer
 		m_RP_DirectLightingCacheInjection.reset();
 		m_RP_DirectLightingCacheReflection.reset();
 
+		if (m_shaderFactory)
+			m_shaderFactory->SavePipelineCache(&m_device);
 		m_shaderFactory.reset();
 
 		m_bufferForZeroClear.reset();
@@ -105,6 +111,9 @@ namespace KickstartRT_NativeLayer
 		m_winResFileSystem = std::make_shared<VirtualFS::WinResFileSystem>();
 		std::filesystem::path		basePath;
 		m_shaderFactory = std::make_unique<ShaderFactory::Factory>(m_winResFileSystem, basePath, initSettings->coldLoadShaderList, initSettings->coldLoadShaderListSize);
+		if (initSettings->pipelineCacheFilePath != nullptr) {
+			RETURN_IF_STATUS_FAILED(m_shaderFactory->InitPipelineCache(&m_device, std::make_shared<VirtualFS::NativeFileSystem>(), initSettings->pipelineCacheFilePath));
+		}
 
 		std::unique_ptr<RenderPass_DirectLightingCacheAllocation> directLightingCacheAllocation = std::make_unique<RenderPass_DirectLightingCacheAllocation>();
 		std::unique_ptr<RenderPass_DirectLightingCacheInjection> directLightingCacheInjection = std::make_unique<RenderPass_DirectLightingCacheInjection>();
@@ -124,114 +133,149 @@ namespace KickstartRT_NativeLayer
 		m_UAVCPUDescHeap2 = std::make_unique<SharedCPUDescriptorHeap>();
 		RETURN_IF_STATUS_FAILED(m_UAVCPUDescHeap2->Init(&m_device, GraphicsAPI::DescriptorHeap::Type::TypedBufferUav, 2, initSettings->descHeapSize / 4)); // a set of [tileIdx, tile]
 
+		using SP = KickstartRT::ResourceAllocations::SharedPool;
+		const auto& sharedBufferSettings = initSettings->sharedBufferSettings;
+		auto BlockSize = [&sharedBufferSettings](SP pool, uint64_t defaultSizeInBytes) {
+			uint64_t blockSize = sharedBufferSettings.pools[(size_t)pool].blockSizeInBytes;
+			return blockSize > 0 ? blockSize : defaultSizeInBytes;
+		};
+
 		m_sharedBufferForDirectLightingCache = std::make_unique<decltype(m_sharedBufferForDirectLightingCache)::element_type>();
-		m_sharedBufferForDirectLightingCache->Init(
+		RETURN_IF_STATUS_FAILED(m_sharedBufferForDirectLightingCache->Init(
 			&m_device,
 			256, // 256 Bytes
 			true, // useUAV
 			true, // useGpuPtr
-			16 * 1024 * 1024, // blockSize 16MB
+			BlockSize(SP::e_DirectLightingCache, 16 * 1024 * 1024), // default blockSize 16MB
 			GraphicsAPI::Buffer::Format::R32Uint, GraphicsAPI::Resource::BindFlags::UnorderedAccess | GraphicsAPI::Resource::BindFlags::ShaderDeviceAddress | GraphicsAPI::Resource::BindFlags::AllowShaderAtomics, GraphicsAPI::Buffer::CpuAccess::None,
 			ResourceLogger::ResourceKind::e_DirectLightingCache_SharedBlock, ResourceLogger::ResourceKind::e_DirectLightingCache_SharedEntry,
-			L"SharedBufferForDirectLightingCache");
+			L"SharedBufferForDirectLightingCache"));
 
 		m_sharedBufferForDirectLightingCacheTemp = std::make_unique<decltype(m_sharedBufferForDirectLightingCacheTemp)::element_type>();
-		m_sharedBufferForDirectLightingCacheTemp->Init(
+		RETURN_IF_STATUS_FAILED(m_sharedBufferForDirectLightingCacheTemp->Init(
 			&m_device,
 			256, // 256 Bytes
 			true, // useUAV
 			true, // useGpuPtr
-			16 * 1024 * 1024, // blockSize 16MB
+			BlockSize(SP::e_DirectLightingCacheTemp, 16 * 1024 * 1024), // default blockSize 16MB
 			GraphicsAPI::Buffer::Format::R32Uint, GraphicsAPI::Resource::BindFlags::UnorderedAccess | GraphicsAPI::Resource::BindFlags::ShaderDeviceAddress | GraphicsAPI::Resource::BindFlags::AllowShaderAtomics, GraphicsAPI::Buffer::CpuAccess::None,
 			ResourceLogger::ResourceKind::e_DirectLightingCacheTemp_SharedBlock, ResourceLogger::ResourceKind::e_DirectLightingCacheTemp_SharedEntry,
-			L"m_sharedBufferForDirectLightingCacheTemp");
+			L"m_sharedBufferForDirectLightingCacheTemp"));
 
 		m_sharedBufferForVertexTemporal = std::make_unique<decltype(m_sharedBufferForVertexTemporal)::element_type>();
-		m_sharedBufferForVertexTemporal->Init(
+		RETURN_IF_STATUS_FAILED(m_sharedBufferForVertexTemporal->Init(
 			&m_device,
 			256, // 256 Bytes
 			true, // useUAV
 			true, // useGpuPtr
-			8 * 1024 * 1024, // blockSize 8MB
+			BlockSize(SP::e_VertexTemporary, 8 * 1024 * 1024), // default blockSize 8MB
 			GraphicsAPI::Buffer::Format::R32Uint, GraphicsAPI::Resource::BindFlags::UnorderedAccess | GraphicsAPI::Resource::BindFlags::ShaderDeviceAddress, GraphicsAPI::Buffer::CpuAccess::None,
 			ResourceLogger::ResourceKind::e_VertexTemporay_SharedBlock, ResourceLogger::ResourceKind::e_VertexTemporay_SharedEntry,
-			L"SharedBufferForVertexTemp");
+			L"SharedBufferForVertexTemp"));
 
-		m_sharedBufferForVertexPersistent = std::make_unique<decltype(m_sharedBufferForVertexTemporal)::element_type>();
-		m_sharedBufferForVertexPersistent->Init(
+		m_sharedBufferForVertexPersistent = std::make_unique<decltype(m_sharedBufferForVertexPersistent)::element_type>();
+		RETURN_IF_STATUS_FAILED(m_sharedBufferForVertexPersistent->Init(
 			&m_device,
 			256, // 256 Bytes
 			true, // useUAV
 			true, // useGpuPtr
-			4 * 1024 * 1024, // blockSize 4MB
+			BlockSize(SP::e_VertexPersistent, 4 * 1024 * 1024), // default blockSize 4MB
 			GraphicsAPI::Buffer::Format::R32Uint, GraphicsAPI::Resource::BindFlags::UnorderedAccess | GraphicsAPI::Resource::BindFlags::ShaderDeviceAddress, GraphicsAPI::Buffer::CpuAccess::None,
 			ResourceLogger::ResourceKind::e_VertexPersistent_SharedBlock, ResourceLogger::ResourceKind::e_VertexPersistent_SharedEntry,
-			L"SharedBufferForVertexPers");
+			L"SharedBufferForVertexPers"));
 
 		m_sharedBufferForReadback = std::make_unique<decltype(m_sharedBufferForReadback)::element_type>();
-		m_sharedBufferForReadback->Init(
+		RETURN_IF_STATUS_FAILED(m_sharedBufferForReadback->Init(
 			&m_device,
 			sizeof(uint32_t) * 4, //allocation alignment size
 			false, // useUAV
 			false, // useGpuPtr
-			256 * 1024, // blockSize 256KB
+			BlockSize(SP::e_Readback, 256 * 1024), // default blockSize 256KB
 			GraphicsAPI::Buffer::Format::R32Uint, GraphicsAPI::Resource::BindFlags::None, GraphicsAPI::Buffer::CpuAccess::Read,
 			ResourceLogger::ResourceKind::e_Readback_SharedBlock, ResourceLogger::ResourceKind::e_Readback_SharedEntry,
-			L"SharedBufferForReadbacks");
+			L"SharedBufferForReadbacks"));
+		// readback blocks stay mapped for their lifetime to avoid Map()/Unmap() per frame.
+		RETURN_IF_STATUS_FAILED(m_sharedBufferForReadback->EnablePersistentMapping());
 
 		m_sharedBufferForCounter = std::make_unique<decltype(m_sharedBufferForCounter)::element_type>();
-		m_sharedBufferForCounter->Init(
+		RETURN_IF_STATUS_FAILED(m_sharedBufferForCounter->Init(
 			&m_device,
 			sizeof(uint32_t) * 4, //allocation alignment size
 			true, // useClear
 			true, // useGpuPtr
-			256 * 1024, // blockSize 256KB
+			BlockSize(SP::e_Counter, 256 * 1024), // default blockSize 256KB
 			GraphicsAPI::Buffer::Format::R32Uint, GraphicsAPI::Resource::BindFlags::UnorderedAccess | GraphicsAPI::Resource::BindFlags::ShaderDeviceAddress, GraphicsAPI::Buffer::CpuAccess::None,
 			ResourceLogger::ResourceKind::e_Counter_SharedBlock, ResourceLogger::ResourceKind::e_Counter_SharedEntry,
-			L"SharedBufferForCounter");
+			L"SharedBufferForCounter"));
+
+		// counters and their readbacks are tiny and allocated per geometry, so they are served from slabs.
+		RETURN_IF_STATUS_FAILED(m_sharedBufferForReadback->EnableSlabAllocation(sizeof(uint32_t) * 4, 256));
+		RETURN_IF_STATUS_FAILED(m_sharedBufferForCounter->EnableSlabAllocation(sizeof(uint32_t) * 4, 256));
 
 		{
-			std::array<std::add_pointer<decltype(m_sharedBufferForBLASTemporal)>::type, 2> bArr =
-			{ &m_sharedBufferForBLASTemporal , &m_sharedBufferForBLASPermanent };
-			std::array<std::wstring, 2> nArr =
-			{ L"BLASTemporal", L"BLASPermanent" };
-			std::array<std::pair<ResourceLogger::ResourceKind, ResourceLogger::ResourceKind>, 2> kArr =
-			{ std::make_pair(ResourceLogger::ResourceKind::e_BLASSTemporary_SharedBlock, ResourceLogger::ResourceKind::e_BLASSTemporary_SharedEntry),
-			  std::make_pair(ResourceLogger::ResourceKind::e_BLASSPermanent_SharedBlock, ResourceLogger::ResourceKind::e_BLASSPermanent_SharedEntry)};
-			for (size_t i = 0; i < bArr.size(); ++i){
-				(*bArr[i]) = std::make_unique<decltype(m_sharedBufferForBLASTemporal)::element_type>();
-				(*bArr[i])->Init(
+			// temporal and permanent buffers may use different allocator types.
+			auto InitBLASBuffer = [&](auto& sharedBuffer, SP pool, ResourceLogger::ResourceKind blockKind, ResourceLogger::ResourceKind entryKind, const std::wstring& name) {
+				sharedBuffer = std::make_unique<typename std::remove_reference_t<decltype(sharedBuffer)>::element_type>();
+				return sharedBuffer->Init(
 					&m_device,
 					256,	// AS allocation alignment
 					false,	// useClear
 					true,	// useGpuPtr
-					32 * 1024 * 1024, // blockSize 32M Bytes.
+					BlockSize(pool, 32 * 1024 * 1024), // default blockSize 32M Bytes.
 					GraphicsAPI::Buffer::Format::R32Uint, GraphicsAPI::Resource::BindFlags::UnorderedAccess | GraphicsAPI::Resource::BindFlags::ShaderDeviceAddress | GraphicsAPI::Resource::BindFlags::AccelerationStructure, GraphicsAPI::Buffer::CpuAccess::None,
-					kArr[i].first, kArr[i].second,
-					nArr[i]);
-			}
+					blockKind, entryKind,
+					name);
+			};
+			RETURN_IF_STATUS_FAILED(InitBLASBuffer(m_sharedBufferForBLASTemporal, SP::e_BLASTemporary, ResourceLogger::ResourceKind::e_BLASSTemporary_SharedBlock, ResourceLogger::ResourceKind::e_BLASSTemporary_SharedEntry, L"BLASTemporal"));
+			RETURN_IF_STATUS_FAILED(InitBLASBuffer(m_sharedBufferForBLASPermanent, SP::e_BLASPermanent, ResourceLogger::ResourceKind::e_BLASSPermanent_SharedBlock, ResourceLogger::ResourceKind::e_BLASSPermanent_SharedEntry, L"BLASPermanent"));
 		}
 		{
-			std::array<std::add_pointer<decltype(m_sharedBufferForBLASScratchTemporal)>::type, 2> bArr =
-			{ &m_sharedBufferForBLASScratchTemporal, &m_sharedBufferForBLASScratchPermanent };
-			std::array<std::wstring, 2> nArr =
-			{ L"BLASScratchTemporal", L"BLASScratchPermanent" };
-			std::array<std::pair<ResourceLogger::ResourceKind, ResourceLogger::ResourceKind>, 2> kArr =
-			{ std::make_pair(ResourceLogger::ResourceKind::e_BLASScratchTemp_SharedBlock, ResourceLogger::ResourceKind::e_BLASScratchTemp_SharedEntry),
-			  std::make_pair(ResourceLogger::ResourceKind::e_BLASScratchPerm_SharedBlock, ResourceLogger::ResourceKind::e_BLASScratchPerm_SharedEntry)};
-			for (size_t i = 0; i < bArr.size(); ++i) {
-				(*bArr[i]) = std::make_unique<decltype(m_sharedBufferForBLASTemporal)::element_type>();
-				(*bArr[i])->Init(
+			auto InitBLASScratchBuffer = [&](auto& sharedBuffer, SP pool, ResourceLogger::ResourceKind blockKind, ResourceLogger::ResourceKind entryKind, const std::wstring& name) {
+				sharedBuffer = std::make_unique<typename std::remove_reference_t<decltype(sharedBuffer)>::element_type>();
+				return sharedBuffer->Init(
 					&m_device,
 					256,	// AS allocation alignment
 					false,	// useClear
 					true,	// useGpuPtr
-					8 * 1024 * 1024, // blockSize 8M Bytes.
+					BlockSize(pool, 8 * 1024 * 1024), // default blockSize 8M Bytes.
 					GraphicsAPI::Buffer::Format::R32Uint, GraphicsAPI::Resource::BindFlags::UnorderedAccess | GraphicsAPI::Resource::BindFlags::ShaderDeviceAddress, GraphicsAPI::Buffer::CpuAccess::None,
-					kArr[i].first, kArr[i].second,
-					nArr[i]);
+					blockKind, entryKind,
+					name);
+			};
+			RETURN_IF_STATUS_FAILED(InitBLASScratchBuffer(m_sharedBufferForBLASScratchTemporal, SP::e_BLASScratchTemp, ResourceLogger::ResourceKind::e_BLASScratchTemp_SharedBlock, ResourceLogger::ResourceKind::e_BLASScratchTemp_SharedEntry, L"BLASScratchTemporal"));
+			RETURN_IF_STATUS_FAILED(InitBLASScratchBuffer(m_sharedBufferForBLASScratchPermanent, SP::e_BLASScratchPerm, ResourceLogger::ResourceKind::e_BLASScratchPerm_SharedBlock, ResourceLogger::ResourceKind::e_BLASScratchPerm_SharedEntry, L"BLASScratchPermanent"));
+		}
+		for (auto&& [pool, sharedBuffer] : SharedBuffersByPool()) {
+			// zero page size keeps the allocation alignment of the pool.
+			const auto& poolSettings = sharedBufferSettings.pools[(size_t)pool];
+			if (poolSettings.pageSizeInBytes > 0 || poolSettings.smallPageThreshold > 0)
+				RETURN_IF_STATUS_FAILED(sharedBuffer->ConfigureAllocator(poolSettings.pageSizeInBytes, poolSettings.smallPageThreshold));
+
+			if (sharedBufferSettings.autoGrowBlockSize) {
+				RETURN_IF_STATUS_FAILED(sharedBuffer->EnableAutoGrowBlockSize(
+					sharedBufferSettings.autoGrowMaxBlockSizeInBytes, sharedBufferSettings.autoGrowExclusiveAllocationRatio, sharedBufferSettings.autoGrowBlockCountThreshold));
 			}
 		}
+		{
+			// pools share the limits of their memory budget category. no limit until SetMemoryBudget() is called.
+			using PC = KickstartRT::MemoryBudget::PoolCategory;
+			SharedBufferBudget* persistent = &m_sharedBufferBudgets[(size_t)PC::e_Persistent];
+			SharedBufferBudget* temporal = &m_sharedBufferBudgets[(size_t)PC::e_Temporal];
+			SharedBufferBudget* readbackAndCounter = &m_sharedBufferBudgets[(size_t)PC::e_ReadbackAndCounter];
+
+			m_sharedBufferForDirectLightingCache->SetBudget(persistent);
+			m_sharedBufferForVertexPersistent->SetBudget(persistent);
+			m_sharedBufferForBLASPermanent->SetBudget(persistent);
+			m_sharedBufferForBLASScratchPermanent->SetBudget(persistent);
+
+			m_sharedBufferForDirectLightingCacheTemp->SetBudget(temporal);
+			m_sharedBufferForVertexTemporal->SetBudget(temporal);
+			m_sharedBufferForBLASTemporal->SetBudget(temporal);
+			m_sharedBufferForBLASScratchTemporal->SetBudget(temporal);
+
+			m_sharedBufferForReadback->SetBudget(readbackAndCounter);
+			m_sharedBufferForCounter->SetBudget(readbackAndCounter);
+		}
 
 		m_upBufferForZeroView = std::make_unique<GraphicsAPI::Buffer>();
 		m_upBufferForZeroView->Create(&m_device, 32, GraphicsAPI::Resource::Format::R32Uint, GraphicsAPI::Resource::BindFlags::None, GraphicsAPI::Buffer::CpuAccess::Write);
@@ -437,8 +481,18 @@ namespace KickstartRT_NativeLayer
 		static uint64_t	logIndex;
 
 		m_resourceLogger.ReleaseDeferredReleasedDeviceObjects(finishedTaskIndex);
+		if (m_resourceLogger.m_isLogging)
+			UpdateSharedPoolUtilizations(&m_resourceLogger.m_allocationInfo);
 		m_resourceLogger.LogResource(logIndex++);
 
+		// entries of temporal resources have been released above, so they can be reclaimed before checking unused blocks.
+		m_sharedBufferForDirectLightingCacheTemp->ReclaimFinishedAllocations(finishedTaskIndex);
+		m_sharedBufferForBLASScratchTemporal->ReclaimFinishedAllocations(finishedTaskIndex);
+#if defined(GRAPHICS_API_D3D12)
+		if (m_descRingHeap)
+			m_descRingHeap->Reclaim(finishedTaskIndex);
+#endif
+
 		uint64_t framesToRemove = 30;
 		m_sharedBufferForDirectLightingCache->CheckUnusedBufferBlocks(framesToRemove);
 		m_sharedBufferForDirectLightingCacheTemp->CheckUnusedBufferBlocks(framesToRemove);
@@ -568,18 +622,128 @@ namespace KickstartRT_NativeLayer
 	Status PersistentWorkingSet::GetResourceAllocations(KickstartRT::ResourceAllocations* retAllocation)
 	{
 		std::scoped_lock mtx(m_mutex);
-		return m_resourceLogger.GetResourceAllocations(retAllocation);
+		RETURN_IF_STATUS_FAILED(m_resourceLogger.GetResourceAllocations(retAllocation));
+		UpdateSharedPoolUtilizations(retAllocation);
+
+		return Status::OK;
+	}
+
+	Status PersistentWorkingSet::SetMemoryBudget(const KickstartRT::MemoryBudget* budget)
+	{
+		std::scoped_lock mtx(m_mutex);
+
+		if (budget == nullptr) {
+			Log::Fatal(L"Invalid memory budget was passed.");
+			return Status::ERROR_INVALID_PARAM;
+		}
+		for (auto&& l : budget->m_categories) {
+			if (l.m_softLimitInBytes > 0 && l.m_hardLimitInBytes > 0 && l.m_softLimitInBytes > l.m_hardLimitInBytes) {
+				Log::Fatal(L"Soft limit of a memory budget was larger than its hard limit.");
+				return Status::ERROR_INVALID_PARAM;
+			}
+		}
+
+		// committed bytes are kept since they are tracked by the shared buffers.
+		for (size_t i = 0; i < m_sharedBufferBudgets.size(); ++i) {
+			auto& l = budget->m_categories[i];
+			m_sharedBufferBudgets[i].m_softLimitInBytes = l.m_softLimitInBytes;
+			m_sharedBufferBudgets[i].m_hardLimitInBytes = l.m_hardLimitInBytes;
+			m_sharedBufferBudgets[i].m_numWarmSpareBlocks = l.m_numWarmSpareBlocks;
+		}
+
+		return Status::OK;
+	}
+
+	Status PersistentWorkingSet::GetMemoryBudget(KickstartRT::MemoryBudget* retBudget)
+	{
+		std::scoped_lock mtx(m_mutex);
+
+		if (retBudget == nullptr) {
+			Log::Fatal(L"Invalid memory budget was passed.");
+			return Status::ERROR_INVALID_PARAM;
+		}
+		for (size_t i = 0; i < m_sharedBufferBudgets.size(); ++i) {
+			auto& l = retBudget->m_categories[i];
+			l.m_softLimitInBytes = m_sharedBufferBudgets[i].m_softLimitInBytes;
+			l.m_hardLimitInBytes = m_sharedBufferBudgets[i].m_hardLimitInBytes;
+			l.m_numWarmSpareBlocks = m_sharedBufferBudgets[i].m_numWarmSpareBlocks;
+		}
+
+		return Status::OK;
+	}
+
+	std::array<std::pair<KickstartRT::ResourceAllocations::SharedPool, SharedBuffer*>, (size_t)KickstartRT::ResourceAllocations::SharedPool::e_Num_Pools> PersistentWorkingSet::SharedBuffersByPool()
+	{
+		using SP = KickstartRT::ResourceAllocations::SharedPool;
+
+		return { {
+			{ SP::e_VertexTemporary, m_sharedBufferForVertexTemporal.get() },
+			{ SP::e_VertexPersistent, m_sharedBufferForVertexPersistent.get() },
+			{ SP::e_DirectLightingCache, m_sharedBufferForDirectLightingCache.get() },
+			{ SP::e_DirectLightingCacheTemp, m_sharedBufferForDirectLightingCacheTemp.get() },
+			{ SP::e_Counter, m_sharedBufferForCounter.get() },
+			{ SP::e_Readback, m_sharedBufferForReadback.get() },
+			{ SP::e_BLASTemporary, m_sharedBufferForBLASTemporal.get() },
+			{ SP::e_BLASPermanent, m_sharedBufferForBLASPermanent.get() },
+			{ SP::e_BLASScratchTemp, m_sharedBufferForBLASScratchTemporal.get() },
+			{ SP::e_BLASScratchPerm, m_sharedBufferForBLASScratchPermanent.get() },
+		} };
+	}
+
+	void PersistentWorkingSet::UpdateSharedPoolUtilizations(KickstartRT::ResourceAllocations* retAllocation)
+	{
+		for (auto&& p : SharedBuffersByPool()) {
+			auto* u = &retAllocation->m_sharedPools[(size_t)p.first];
+			if (p.second != nullptr)
+				p.second->GetUtilization(u);
+			else
+				*u = {};
+		}
+	}
+
+	std::vector<std::pair<SharedBuffer*, const wchar_t*>> PersistentWorkingSet::SharedBuffersForAllocationTrace()
+	{
+		return {
+			{ m_sharedBufferForDirectLightingCache.get(), L"DirectLightingCache" },
+			{ m_sharedBufferForDirectLightingCacheTemp.get(), L"DirectLightingCacheTemp" },
+			{ m_sharedBufferForVertexPersistent.get(), L"VertexPersistent" },
+			{ m_sharedBufferForVertexTemporal.get(), L"VertexTemporal" },
+			{ m_sharedBufferForReadback.get(), L"Readback" },
+			{ m_sharedBufferForCounter.get(), L"Counter" },
+			{ m_sharedBufferForBLASScratchPermanent.get(), L"BLASScratchPermanent" },
+			{ m_sharedBufferForBLASScratchTemporal.get(), L"BLASScratchTemporal" },
+			{ m_sharedBufferForBLASPermanent.get(), L"BLASPermanent" },
+			{ m_sharedBufferForBLASTemporal.get(), L"BLASTemporal" },
+		};
 	}
 
 	Status PersistentWorkingSet::BeginLoggingResourceAllocations(const wchar_t* filePath)
 	{
 		std::scoped_lock mtx(m_mutex);
-		return m_resourceLogger.BeginLoggingResourceAllocations(filePath);
+		RETURN_IF_STATUS_FAILED(m_resourceLogger.BeginLoggingResourceAllocations(filePath));
+
+#if KICKSTARTRT_ENABLE_ALLOCATION_TRACE
+		// Traces are written as "[log file stem]_[shared buffer name].kstrace" in the same directory.
+		std::filesystem::path logPath(filePath);
+		for (auto&& sb : SharedBuffersForAllocationTrace()) {
+			std::filesystem::path tracePath = logPath.parent_path() / (logPath.stem().wstring() + L"_" + sb.second + L".kstrace");
+			RETURN_IF_STATUS_FAILED(sb.first->BeginAllocationTrace(tracePath.wstring()));
+		}
+#endif
+
+		return Status::OK;
 	}
 
 	Status PersistentWorkingSet::EndLoggingResourceAllocations()
 	{
 		std::scoped_lock mtx(m_mutex);
-		return m_resourceLogger.EndLoggingResourceAllocations();
+		RETURN_IF_STATUS_FAILED(m_resourceLogger.EndLoggingResourceAllocations());
+
+#if KICKSTARTRT_ENABLE_ALLOCATION_TRACE
+		for (auto&& sb : SharedBuffersForAllocationTrace())
+			sb.first->EndAllocationTrace();
+#endif
+
+		return Status::OK;
 	}
 };
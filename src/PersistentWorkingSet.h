@@ -25,6 +25,7 @@
 
 #include <VirtualAllocator.h>
 #include <SharedCPUDescriptorHeap.h>
+#include <DescriptorRingHeap.h>
 #include <SharedBuffer.h>
 #include <ResourceLogger.h>
 
@@ -35,6 +36,7 @@
 #include <functional>
 #include <set>
 #include <optional>
+#include <array>
 
 #if !defined(KICKSTARTRT_ENABLE_SHARED_BUFFERS_FOR_PERSISTENT_DEVICE_RESOURCES)
 #error "KICKSTARTRT_ENABLE_SHARED_BUFFERS_FOR_PERSISTENT_DEVICE_RESOURCES must be defined"
@@ -45,6 +47,15 @@
 #if !defined(KICKSTARTRT_ENABLE_SHARED_BUFFERS_FOR_READBACK_AND_COUNTER_RESOURCES)
 #error "KICKSTARTRT_ENABLE_SHARED_BUFFERS_FOR_READBACK_AND_COUNTER_RESOURCES must be defined"
 #endif
+#if !defined(KICKSTARTRT_USE_TLSF_ALLOCATOR_FOR_PERSISTENT_DEVICE_RESOURCES)
+#error "KICKSTARTRT_USE_TLSF_ALLOCATOR_FOR_PERSISTENT_DEVICE_RESOURCES must be defined"
+#endif
+#if !defined(KICKSTARTRT_USE_RING_ALLOCATOR_FOR_TEMPORAL_DEVICE_RESOURCES)
+#error "KICKSTARTRT_USE_RING_ALLOCATOR_FOR_TEMPORAL_DEVICE_RESOURCES must be defined"
+#endif
+#if !defined(KICKSTARTRT_ENABLE_ALLOCATION_TRACE)
+#error "KICKSTARTRT_ENABLE_ALLOCATION_TRACE must be defined"
+#endif
 
 namespace KickstartRT_NativeLayer
 {
@@ -81,6 +92,7 @@ namespace KickstartRT_NativeLayer
         std::mutex		m_mutex;
 
         static constexpr int32_t    m_unboundDescTableUpperbound = 40000;
+        static constexpr size_t     m_defragmentationBytesPerTask = 4 * 1024 * 1024; // upper limit of relocation size of each shared buffer per task.
 
         ResourceLogger          m_resourceLogger;
 
@@ -111,23 +123,39 @@ namespace KickstartRT_NativeLayer
         std::unique_ptr<SharedCPUDescriptorHeap>            m_UAVCPUDescHeap1;
         std::unique_ptr<SharedCPUDescriptorHeap>            m_UAVCPUDescHeap2;
 
-        std::vector<std::unique_ptr<GraphicsAPI::DescriptorHeap>>   m_descHeaps;
+#if defined(GRAPHICS_API_D3D12)
+        std::unique_ptr<DescriptorRingHeap>                 m_descRingHeap;
+#endif
 
     protected:
         std::optional<uint64_t>                             m_currentTaskIndex;
         std::optional<uint64_t>                             m_lastFinishedTaskIndex;
 
+        // limits of each memory budget category. declared before the shared buffers which refer them.
+        std::array<SharedBufferBudget, (size_t)KickstartRT::MemoryBudget::PoolCategory::e_Num_Categories>  m_sharedBufferBudgets;
+
     public:
 
 #if KICKSTARTRT_ENABLE_SHARED_BUFFERS_FOR_PERSISTENT_DEVICE_RESOURCES
+#if KICKSTARTRT_USE_TLSF_ALLOCATOR_FOR_PERSISTENT_DEVICE_RESOURCES
+        using AllocatorTypeForPersistentDeviceResources = VirtualAllocator::TLSFAllocator;
+#else
         using AllocatorTypeForPersistentDeviceResources = VirtualAllocator::FixedPageAllocator;
+#endif
 #else
         using AllocatorTypeForPersistentDeviceResources = void;
 #endif
 #if KICKSTARTRT_ENABLE_SHARED_BUFFERS_FOR_TEMPORAL_DEVICE_RESOURCES
         using AllocatorTypeForTemporalDeviceResources = VirtualAllocator::FixedPageAllocator;
+        // entries of these buffers are released when their tasks are finished, so none of them blocks the ring from being reclaimed.
+#if KICKSTARTRT_USE_RING_ALLOCATOR_FOR_TEMPORAL_DEVICE_RESOURCES
+        using AllocatorTypeForPerTaskDeviceResources = VirtualAllocator::RingAllocator;
+#else
+        using AllocatorTypeForPerTaskDeviceResources = VirtualAllocator::FixedPageAllocator;
+#endif
 #else
         using AllocatorTypeForTemporalDeviceResources = void;
+        using AllocatorTypeForPerTaskDeviceResources = void;
 #endif
 #if KICKSTARTRT_ENABLE_SHARED_BUFFERS_FOR_READBACK_AND_COUNTER_RESOURCES
         using AllocatorTypeForReadbackAndCounterResources = VirtualAllocator::BuddyAllocator;
@@ -136,7 +164,7 @@ namespace KickstartRT_NativeLayer
 #endif
 
         std::unique_ptr<SharedBuffer_Impl<AllocatorTypeForPersistentDeviceResources>>   m_sharedBufferForDirectLightingCache;
-        std::unique_ptr<SharedBuffer_Impl<AllocatorTypeForTemporalDeviceResources>>     m_sharedBufferForDirectLightingCacheTemp;
+        std::unique_ptr<SharedBuffer_Impl<AllocatorTypeForPerTaskDeviceResources>>      m_sharedBufferForDirectLightingCacheTemp;
 
         std::unique_ptr<SharedBuffer_Impl<AllocatorTypeForPersistentDeviceResources>>   m_sharedBufferForVertexPersistent;
         std::unique_ptr<SharedBuffer_Impl<AllocatorTypeForTemporalDeviceResources>>     m_sharedBufferForVertexTemporal;
@@ -145,7 +173,7 @@ namespace KickstartRT_NativeLayer
         std::unique_ptr<SharedBuffer_Impl<AllocatorTypeForReadbackAndCounterResources>> m_sharedBufferForCounter;
 
         std::unique_ptr<SharedBuffer_Impl<AllocatorTypeForPersistentDeviceResources>>   m_sharedBufferForBLASScratchPermanent;
-        std::unique_ptr<SharedBuffer_Impl<AllocatorTypeForTemporalDeviceResources>>     m_sharedBufferForBLASScratchTemporal;
+        std::unique_ptr<SharedBuffer_Impl<AllocatorTypeForPerTaskDeviceResources>>      m_sharedBufferForBLASScratchTemporal;
 
         std::unique_ptr<SharedBuffer_Impl<AllocatorTypeForPersistentDeviceResources>>   m_sharedBufferForBLASPermanent;
         std::unique_ptr<SharedBuffer_Impl<AllocatorTypeForTemporalDeviceResources>>     m_sharedBufferForBLASTemporal;
@@ -192,5 +220,13 @@ namespace KickstartRT_NativeLayer
         Status GetResourceAllocations(KickstartRT::ResourceAllocations* retAllocation);
         Status BeginLoggingResourceAllocations(const wchar_t* filePath);
         Status EndLoggingResourceAllocations();
+
+        Status SetMemoryBudget(const KickstartRT::MemoryBudget* budget);
+        Status GetMemoryBudget(KickstartRT::MemoryBudget* retBudget);
+
+    protected:
+        std::vector<std::pair<SharedBuffer*, const wchar_t*>> SharedBuffersForAllocationTrace();
+        std::array<std::pair<KickstartRT::ResourceAllocations::SharedPool, SharedBuffer*>, (size_t)KickstartRT::ResourceAllocations::SharedPool::e_Num_Pools> SharedBuffersByPool();
+        void UpdateSharedPoolUtilizations(KickstartRT::ResourceAllocations* retAllocation);
     };
 };
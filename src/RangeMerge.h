@@ -0,0 +1,102 @@
+/*
+* Copyright (c) 2022 NVIDIA CORPORATION. All rights reserved
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace KickstartRT_NativeLayer
+{
+	// Helpers to coalesce small updates into a few ranges. Header only so that tools can benchmark them.
+	namespace RangeMerge
+	{
+		// Sort [offset, offset + size) ranges by offset and merge adjacent or overlapping ones in place.
+		template<typename T>
+		inline void SortAndMerge(std::vector<std::pair<T, T>>& ranges)
+		{
+			if (ranges.empty())
+				return;
+
+			std::sort(ranges.begin(), ranges.end());
+
+			size_t dst = 0;
+			for (size_t i = 1; i < ranges.size(); ++i) {
+				auto& cur(ranges[dst]);
+				T curEnd = cur.first + cur.second;
+				if (ranges[i].first <= curEnd) {
+					// adjacent or overlapping.
+					cur.second = std::max(curEnd, ranges[i].first + ranges[i].second) - cur.first;
+					continue;
+				}
+				ranges[++dst] = ranges[i];
+			}
+			ranges.resize(dst + 1);
+		}
+
+		// Sort dirty indices, call visit(index) for each index below count whose flag is set, clear the flag, and append [begin, end) ranges of the visited indices.
+		// Indices whose distance is up to gap are merged into one range. The cost is proportional to the number of dirty indices, not to count.
+		template<typename T, typename F, typename Visit>
+		inline void GatherDirtyRanges(std::vector<T>& dirtyIndices, std::vector<F>& dirtyFlags, T count, T gap, std::vector<std::pair<T, T>>& retRanges, Visit&& visit)
+		{
+			std::sort(dirtyIndices.begin(), dirtyIndices.end());
+
+			for (auto&& index : dirtyIndices) {
+				// Removed entries and duplicated indices are skipped.
+				if (index >= count || !dirtyFlags[index])
+					continue;
+
+				visit(index);
+				dirtyFlags[index] = 0;
+
+				if (retRanges.size() > 0 && index <= retRanges.back().second + gap)
+					retRanges.back().second = index + 1;
+				else
+					retRanges.push_back({ index, index + 1 });
+			}
+		}
+
+		// Number of elements in [begin, end) ranges.
+		template<typename T>
+		inline size_t TotalLength(const std::vector<std::pair<T, T>>& ranges)
+		{
+			size_t length = 0;
+			for (auto&& r : ranges)
+				length += (size_t)(r.second - r.first);
+			return length;
+		}
+
+		// Copy elements of [begin, end) ranges of src to dst tightly. dst needs TotalLength(ranges) elements.
+		template<typename T, typename E>
+		inline void PackRanges(const std::vector<std::pair<T, T>>& ranges, const E* src, void* dst)
+		{
+			uint8_t* ptr = reinterpret_cast<uint8_t*>(dst);
+			for (auto&& r : ranges) {
+				size_t rangeSize = sizeof(E) * (size_t)(r.second - r.first);
+				memcpy(ptr, &src[r.first], rangeSize);
+				ptr += rangeSize;
+			}
+		}
+	};
+};
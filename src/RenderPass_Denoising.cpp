@@ -1425,13 +1425,12 @@ namespace KickstartRT_NativeLayer
 
 #if defined(GRAPHICS_API_D3D12)
 				GraphicsAPI::DescriptorTable samplerTable;
-				if (!samplerTable.Allocate(tws->m_CBVSRVUAVHeap.get(), m_samplerTableLayout.get())) {
-					Log::Fatal(L"Faild to allocate a portion of desc heap.");
-					return Status::ERROR_INTERNAL;
-				}
-
-				for (Sampler& sampler : m_samplers) {
-					samplerTable.SetSampler(&dev, 0, sampler.registerIndex, sampler.sampler.get());
+				{
+					DescriptorTableCache::TableContents samplerContents(m_samplerTableLayout.get());
+					for (Sampler& sampler : m_samplers) {
+						samplerContents.SetSampler(0, sampler.registerIndex, sampler.sampler.get());
+					}
+					RETURN_IF_STATUS_FAILED(tws->m_descTableCache.GetTable(&dev, tws->m_CBVSRVUAVHeap.get(), samplerContents, &samplerTable));
 				}
 #endif
 				// Convert inputs
@@ -1462,22 +1461,20 @@ namespace KickstartRT_NativeLayer
 					NRDStateTransitions stateTransitions;
 
 					{ // Desctriptor Table
-						if (!descTable.Allocate(tws->m_CBVSRVUAVHeap.get(), m_descTableLayout.get())) {
-							Log::Fatal(L"Faild to allocate a portion of desc heap.");
-							return Status::ERROR_INTERNAL;
-						}
+						// tables are reused from the cache as long as the views and the constant buffer location are unchanged.
+						DescriptorTableCache::TableContents contents(m_descTableLayout.get());
+						GraphicsAPI::ConstantBufferView cbv;
 
 						if (pipelineDesc.hasConstantData) {
 							assert(dispatch.constantBufferData && dispatch.constantBufferDataSize != 0);
-							GraphicsAPI::ConstantBufferView cbv;
 							void* cbPtrForWrite;
 							RETURN_IF_STATUS_FAILED(tws->m_volatileConstantBuffer.Allocate(dispatch.constantBufferDataSize, &cbv, &cbPtrForWrite));
 							memcpy(cbPtrForWrite, dispatch.constantBufferData, dispatch.constantBufferDataSize);
 
 #if defined(GRAPHICS_API_D3D12)
-							descTable.SetCbv(&dev, 0, 0, &cbv);
+							contents.SetCbv(0, 0, &cbv);
 #elif defined(GRAPHICS_API_VK)
-							descTable.SetCbv(&dev, constantBufferOffset, 0, &cbv);
+							contents.SetCbv(constantBufferOffset, 0, &cbv);
 #endif
 						}
 
@@ -1500,25 +1497,28 @@ namespace KickstartRT_NativeLayer
 
 								if (range.descriptorType == nrd::DescriptorType::TEXTURE) {
 #if defined(GRAPHICS_API_D3D12)
-									descTable.SetSrv(&dev, 1, range.baseRegisterIndex + descIt, srv.get());
+									contents.SetSrv(1, range.baseRegisterIndex + descIt, srv.get());
 #elif defined(GRAPHICS_API_VK)
-									descTable.SetSrv(&dev, textureOffset + range.baseRegisterIndex + descIt, 0, srv.get());
+									contents.SetSrv(textureOffset + range.baseRegisterIndex + descIt, 0, srv.get());
 #endif
 								}
 								else if (range.descriptorType == nrd::DescriptorType::STORAGE_TEXTURE) {
 									assert(nrdResource.mipNum == 1);
 #if defined(GRAPHICS_API_D3D12)
-									descTable.SetUav(&dev, 2, range.baseRegisterIndex + descIt, uav.get());
+									contents.SetUav(2, range.baseRegisterIndex + descIt, uav.get());
 #elif defined(GRAPHICS_API_VK)
-									descTable.SetUav(&dev, storageTextureAndBufferOffset + range.baseRegisterIndex + descIt, 0, uav.get());
+									contents.SetUav(storageTextureAndBufferOffset + range.baseRegisterIndex + descIt, 0, uav.get());
 #endif
 								}
 
+								// deferred released views stay alive until the task has finished, so the contents can still refer to them.
 								pws->DeferredRelease(std::move(srv));
 								pws->DeferredRelease(std::move(uav));
 							}
 						}
 						assert(resourceIdx == dispatch.resourceNum);
+
+						RETURN_IF_STATUS_FAILED(tws->m_descTableCache.GetTable(&dev, tws->m_CBVSRVUAVHeap.get(), contents, &descTable));
 					}
 
 					stateTransitions.Flush(cmdList);
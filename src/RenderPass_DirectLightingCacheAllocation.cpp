@@ -343,7 +343,7 @@ namespace KickstartRT_NativeLayer
 				const uint32_t maxEdgeCount = gp->m_totalNbIndices;
 
 				// use persistent allocator if allow update is enabled.
-				decltype(pws->m_sharedBufferForVertexTemporal)::element_type* allocator = nullptr;
+				SharedBuffer* allocator = nullptr; // persistent and temporal buffers may use different allocator types.
 				if (gp->m_input.allowUpdate) {
 					allocator = pws->m_sharedBufferForVertexPersistent.get();
 				}
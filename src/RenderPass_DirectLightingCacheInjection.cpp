@@ -59,7 +59,8 @@ namespace KickstartRT_NativeLayer
 
 			// set 2 [AS, UAV ...]
 			{
-				m_descTableLayout2.AddRange(GraphicsAPI::DescriptorHeap::Type::AccelerationStructureSrv, 0, 1, 1); // t0, space1 TLAS
+				m_descTableLayout2.AddRange(GraphicsAPI::DescriptorHeap::Type::AccelerationStructureSrv, 0, 1, 1); // t0, space1 static TLAS
+				m_descTableLayout2.AddRange(GraphicsAPI::DescriptorHeap::Type::AccelerationStructureSrv, 1, 1, 1); // t1, space1 dynamic TLAS
 				m_descTableLayout2.AddRange(GraphicsAPI::DescriptorHeap::Type::TypedBufferUav, 0, 1, 1); // u0, space1 TileTable
 				m_descTableLayout2.AddRange(GraphicsAPI::DescriptorHeap::Type::TypedBufferUav, 1, -pws->m_unboundDescTableUpperbound, 1); //u1 ~ space1, tileIndex, tileBuffer ... 40000 is the upper bound of the array in VK.
 				m_descTableLayout2.SetAPIData(dev);
@@ -84,7 +85,8 @@ namespace KickstartRT_NativeLayer
 
 			// set 2 [AS, UAV ...]
 			{
-				m_descTableLayoutTransfer2.AddRange(GraphicsAPI::DescriptorHeap::Type::AccelerationStructureSrv, 0, 1, 1); // t0, space1 TLAS
+				m_descTableLayoutTransfer2.AddRange(GraphicsAPI::DescriptorHeap::Type::AccelerationStructureSrv, 0, 1, 1); // t0, space1 static TLAS
+				m_descTableLayoutTransfer2.AddRange(GraphicsAPI::DescriptorHeap::Type::AccelerationStructureSrv, 1, 1, 1); // t1, space1 dynamic TLAS
 				m_descTableLayoutTransfer2.AddRange(GraphicsAPI::DescriptorHeap::Type::TypedBufferUav, 0, 1, 1); // u0, space1 TileTable
 				m_descTableLayoutTransfer2.AddRange(GraphicsAPI::DescriptorHeap::Type::TypedBufferUav, 1, -pws->m_unboundDescTableUpperbound, 1); //u1 ~ space1, tileIndex, tileBuffer ... 40000 is the upper bound of the array in VK.
 				m_descTableLayoutTransfer2.SetAPIData(dev);
@@ -93,7 +93,8 @@ namespace KickstartRT_NativeLayer
 				return Status::ERROR_FAILED_TO_INIT_RENDER_PASS;
 			}
 
-			m_descTableLayout1.AddRange(GraphicsAPI::DescriptorHeap::Type::AccelerationStructureSrv, 0, 1, 1); // t0, space1 TLAS
+			m_descTableLayout1.AddRange(GraphicsAPI::DescriptorHeap::Type::AccelerationStructureSrv, 0, 1, 1); // t0, space1 static TLAS
+			m_descTableLayout1.AddRange(GraphicsAPI::DescriptorHeap::Type::AccelerationStructureSrv, 1, 1, 1); // t1, space1 dynamic TLAS
 			m_descTableLayout1.AddRange(GraphicsAPI::DescriptorHeap::Type::TypedBufferUav, 0, 1, 1); // u0, space1, tile table
 			m_descTableLayout1.AddRange(GraphicsAPI::DescriptorHeap::Type::TypedBufferUav, 1, -pws->m_unboundDescTableUpperbound, 1); //u1 ~ space1, tileIndex, tileBuffer ...
 			if (!m_descTableLayout1.SetAPIData(dev)) {
@@ -533,29 +534,31 @@ namespace KickstartRT_NativeLayer
 			return Status::ERROR_INVALID_PARAM;
 		}
 
-		GraphicsAPI::ComputePipelineState* activeCSPSO = nullptr;
-		ShaderTableRT* activeShaderTable = nullptr;
+		ShaderFactory::ShaderDictEntry* activeEntry = nullptr;
 		if (isDebugShader) {
-			activeCSPSO = useInlineRT ? m_pso_DebugVis->GetCSPSO(pws) : nullptr;
-			activeShaderTable = useInlineRT ? nullptr : m_shaderTable_DebugVis->GetShaderTableRT(pws, cmdList);
+			activeEntry = useInlineRT ? m_pso_DebugVis : m_shaderTable_DebugVis;
 		}
 		else if (isEnableShadowsPass) {
-			activeCSPSO = useInlineRT ? m_pso_Shadows[ShadowsShaderPermutationIdx]->GetCSPSO(pws) : nullptr;
-			activeShaderTable = useInlineRT ? nullptr : m_shaderTable_Shadows[ShadowsShaderPermutationIdx]->GetShaderTableRT(pws, cmdList);
+			activeEntry = useInlineRT ? m_pso_Shadows[ShadowsShaderPermutationIdx] : m_shaderTable_Shadows[ShadowsShaderPermutationIdx];
 		}
 		else if (isEnableRTAOPass) {
-			activeCSPSO = useInlineRT ? m_pso_AO[AOShaderPermutationIdx]->GetCSPSO(pws) : nullptr;
-			activeShaderTable = useInlineRT ? nullptr : m_shaderTable_AO[AOShaderPermutationIdx]->GetShaderTableRT(pws, cmdList);
+			activeEntry = useInlineRT ? m_pso_AO[AOShaderPermutationIdx] : m_shaderTable_AO[AOShaderPermutationIdx];
 		}
 		else if (isEnableGIPass) {
-			activeCSPSO = useInlineRT ? m_pso_GI[GIShaderPermutationIdx]->GetCSPSO(pws) : nullptr;
-			activeShaderTable = useInlineRT ? nullptr : m_shaderTable_GI[GIShaderPermutationIdx]->GetShaderTableRT(pws, cmdList);
+			activeEntry = useInlineRT ? m_pso_GI[GIShaderPermutationIdx] : m_shaderTable_GI[GIShaderPermutationIdx];
 		}
 		else {
-			activeCSPSO = useInlineRT ? m_pso[reflectionShaderPermutationIdx]->GetCSPSO(pws) : nullptr;
-			activeShaderTable = useInlineRT ? nullptr : m_shaderTable[reflectionShaderPermutationIdx]->GetShaderTableRT(pws, cmdList);
+			activeEntry = useInlineRT ? m_pso[reflectionShaderPermutationIdx] : m_shaderTable[reflectionShaderPermutationIdx];
 		}
 
+		// A permutation still being warmed up is either waited for in GetCSPSO() or skipped for this task.
+		if (activeEntry->WarmUpPending() && pws->m_shaderFactory->SkipPendingShaders()) {
+			return Status::OK;
+		}
+
+		GraphicsAPI::ComputePipelineState* activeCSPSO = useInlineRT ? activeEntry->GetCSPSO(pws) : nullptr;
+		ShaderTableRT* activeShaderTable = useInlineRT ? nullptr : activeEntry->GetShaderTableRT(pws, cmdList);
+
 		if (useInlineRT) {
 			cmdList->SetComputePipelineState(activeCSPSO);
 		}
@@ -836,6 +839,7 @@ namespace KickstartRT_NativeLayer
 			memset(cbPtrForWrite, 0, 80);
 		}
 
+		descTable.BeginBatchedWrite();
 		{
 			descTable.SetSrv(&dev, 0, 0, &m_blueNoiseTexSRV); // Layout2 : 0, Range:0, RangeIdx:0 BNTex SRV
 			
@@ -911,6 +915,10 @@ namespace KickstartRT_NativeLayer
 			pws->DeferredRelease(std::move(outUAV));
 			pws->DeferredRelease(std::move(outAuxUAV));
 		}
+		if (!descTable.EndBatchedWrite(&dev)) {
+			Log::Fatal(L"Faild to write descriptors.");
+			return Status::ERROR_INTERNAL;
+		}
 
 		stateTransitions.Flush(cmdList);
 
@@ -36,6 +36,8 @@ namespace KickstartRT_NativeLayer
 			L"VertexPersistent_SharedEntry",
 			L"DirectLightingCache_SharedBlock",
 			L"DirectLightingCache_SharedEntry",
+			L"DirectLightingCacheTemp_SharedBlock",
+			L"DirectLightingCacheTemp_SharedEntry",
 			L"TLAS",
 			L"Other",
 			L"Counter_SharedBlock",
@@ -57,6 +59,25 @@ namespace KickstartRT_NativeLayer
 		return kindToStr[kind];
 	}
 
+	static const wchar_t* PoolToStr(size_t pool)
+	{
+		std::array<const wchar_t*, (size_t)KickstartRT::ResourceAllocations::SharedPool::e_Num_Pools> poolToStr =
+		{
+			L"VertexTemporary",
+			L"VertexPersistent",
+			L"DirectLightingCache",
+			L"DirectLightingCacheTemp",
+			L"Counter",
+			L"Readback",
+			L"BLASTemporary",
+			L"BLASPermanent",
+			L"BLASScratchTemp",
+			L"BLASScratchPerm",
+		};
+
+		return poolToStr[pool];
+	}
+
 	void ResourceLogger::CheckLeaks()
 	{
 		auto& a = m_allocationInfo;
@@ -139,6 +160,41 @@ namespace KickstartRT_NativeLayer
 				}
 				of << std::endl;
 			}
+
+			using RA = KickstartRT::ResourceAllocations;
+
+			// Committed, allocated, largest free run in MB, free run histogram and blocks added beyond the hard budget for each shared pool.
+			of << L"Shared Pool Utilization" << std::endl;
+			of << L"FrameIndex,";
+			for (size_t i = 0; i < (size_t)RA::SharedPool::e_Num_Pools; ++i) {
+				of << PoolToStr(i) << L"_CommittedMB," << PoolToStr(i) << L"_AllocatedMB," << PoolToStr(i) << L"_LargestFreeRunMB,";
+				for (size_t h = 0; h < RA::kNumFreeRunHistogramBins; ++h) {
+					if (h < RA::kNumFreeRunHistogramBins - 1)
+						of << PoolToStr(i) << L"_FreeRunsUnder" << (4 << (2 * h)) << L"KB,";
+					else
+						of << PoolToStr(i) << L"_FreeRunsOthers,";
+				}
+				of << PoolToStr(i) << L"_BlocksOverHardLimit,";
+			}
+			of << std::endl;
+
+			for (auto&& l : m_frameLogs) {
+				uint64_t fi = l.first;
+				auto& a = l.second;
+
+				of << fi << ",";
+				for (size_t i = 0; i < (size_t)RA::SharedPool::e_Num_Pools; ++i) {
+					auto& u = a.m_sharedPools[i];
+					of << (double)u.m_committedBlockBytes / (1024. * 1024) << ",";
+					of << (double)u.m_allocatedBytes / (1024. * 1024) << ",";
+					of << (double)u.m_largestFreeRunBytes / (1024. * 1024) << ",";
+					for (size_t h = 0; h < RA::kNumFreeRunHistogramBins; ++h) {
+						of << u.m_freeRunHistogram[h] << ",";
+					}
+					of << u.m_numBlocksOverHardLimit << ",";
+				}
+				of << std::endl;
+			}
 		}
 		of.close();
 
@@ -85,6 +85,9 @@ namespace KickstartRT_NativeLayer
                 m_allocationInfo.m_numResources[i] = 0;
                 m_allocationInfo.m_totalRequestedBytes[i] = 0;
             }
+            for (size_t i = 0; i < (size_t)RA::SharedPool::e_Num_Pools; ++i) {
+                m_allocationInfo.m_sharedPools[i] = {};
+            }
 
             m_isLogging = false;
             m_flushTimes = 0;
@@ -32,8 +32,11 @@
 #include <TaskContainer.h>
 #include <RenderTaskValidator.h>
 #include <RenderPass_Common.h>
+#include <RangeMerge.h>
 
 #include <cinttypes>
+#include <algorithm>
+#include <chrono>
 
 namespace KickstartRT_NativeLayer
 {
@@ -163,7 +166,7 @@ namespace KickstartRT_NativeLayer
 			// This maps volatile constant buffer, sets descriptor heap.
 			// Dtor automatically unmap buffer.
 			// Ctor and Dtor don't open / close the command list.
-			TaskWorkingSetCommandList cl(taskWorkingSet, userCmdList.get());
+			TaskWorkingSetCommandList cl(taskWorkingSet, userCmdList.get(), (uint32_t)taskContainer->m_renderTask->m_renderTasks.size());
 
 			// Do geometry taks is at the beginning or the end of entire process. 
 			auto DoGeometyTask = [&]() {
@@ -210,6 +213,17 @@ namespace KickstartRT_NativeLayer
 					}
 				}
 
+				// Relocated BLASs and DLC buffers are referenced from TLAS (and DLC indirection table), so it's done only when TLAS is going to be built.
+				if (taskContainer->m_bvhTask->m_buildTLAS) {
+					bool relocated = false;
+					sts = DefragmentSharedBuffers(pws, cl.m_commandList, relocated);
+					if (sts != Status::OK) {
+						Log::Fatal(L"Failed returned form DefragmentSharedBuffers() call");
+						return sts;
+					}
+					m_TLASisDrity |= relocated;
+				}
+
 				// BLAS build process can be skipped when maxBlasBuildCount == 0 and no update geometry.
 				if (taskContainer->m_bvhTask->m_maxBLASbuildCount > 0 || updatedGeometryPtrs.size() > 0) {
 					GraphicsAPI::Utils::ScopedEventObject sce(cl.m_commandList, { 0, 128, 0 }, DebugName("BLAS Tasks"));
@@ -233,7 +247,7 @@ namespace KickstartRT_NativeLayer
 				}
 
 				if (taskContainer->m_bvhTask->m_buildTLAS && m_TLASisDrity) {
-					sts = BuildTLASCommands(cl.m_set, cl.m_commandList);
+					sts = BuildTLASCommands(cl.m_set, cl.m_commandList, taskContainer->m_bvhTask->m_maxTLASRefitCount);
 					if (sts != Status::OK) {
 						Log::Fatal(L"Failed to build TLAS task");
 						return sts;
@@ -266,7 +280,7 @@ namespace KickstartRT_NativeLayer
 				{
 					GraphicsAPI::Utils::ScopedEventObject sce(cl.m_commandList, { 0, 128, 0 }, DebugName("Light Injection Task"));
 
-					if (m_TLASBufferSrv) {
+					if (TLASIsReady()) {
 						// build desc table for all lighting cache.
 						if (NeedToUpdateDescTable) {
 							lightingCache_descTable = std::make_unique<GraphicsAPI::DescriptorTable>();
@@ -340,15 +354,20 @@ namespace KickstartRT_NativeLayer
 							auto& taskTransfer(task.Get<RenderTask::DirectLightTransferTask>());
 							RETURN_IF_STATUS_FAILED(RenderTaskValidator::DirectLightTransferTask(&taskTransfer));
 
-							BVHTask::Instance* targetInstance = BVHTask::Instance::ToPtr(taskTransfer.target);
+							BVHTask::Instance* targetInstance = m_container.FindInstance(taskTransfer.target);
+							if (targetInstance == nullptr)
+							{
+								Log::Fatal(L"Instance is not registered to the scene.");
+								return Status::ERROR_INVALID_INSTANCE_HANDLE;
+							}
 
-							if (!targetInstance->m_TLASInstanceListItr.has_value())
+							if (targetInstance->m_TLASInstanceIndex == kInvalidTLASInstanceIndex)
 							{
 								Log::Fatal(L"Instance is not part of TLAS.");
 								return Status::ERROR_INVALID_INSTANCE_HANDLE;
 							}
 
-							const uint32_t targetInstanceIndex = (uint32_t)std::distance(m_container.m_TLASInstanceList.begin(), targetInstance->m_TLASInstanceListItr.value());
+							const uint32_t targetInstanceIndex = m_container.TLASInstanceID(targetInstance);
 
 							RenderPass_DirectLightingCacheInjection::TransferParams params;
 							params.targetInstanceIndex = targetInstanceIndex;
@@ -369,7 +388,7 @@ namespace KickstartRT_NativeLayer
 				case RenderTask::Task::Type::TraceShadow:
 				case RenderTask::Task::Type::TraceMultiShadow:
 				{
-					if (m_TLASBufferSrv) {
+					if (TLASIsReady()) {
 						RETURN_IF_STATUS_FAILED(RenderTaskValidator::TraceTask(&task.Get()));
 
 						{ // Lighting
@@ -505,15 +524,13 @@ namespace KickstartRT_NativeLayer
 
 	Status Scene::UpdateScenegraphFromExecuteContext(PersistentWorkingSet* /*pws*/, UpdateFromExecuteContext* updateFromExc, bool& isSceneChanged)
 	{
-		auto RemoveInstanceFromGraph = [&](SceneContainer::InsMapIterator& itr)
+		auto RemoveInstanceFromGraph = [&](Instance* ip)
 		{
-			//auto& ih(itr->first);
-			auto& iPtr(itr->second);
+			BVHTask::InstancePtr iPtr = m_container.DetachInstance(ip);
 
 			if (iPtr->m_registerStatus != BVHTask::RegisterStatus::Registered) {
 				// This instance is created but not being registered to the scene graph.
 				// Destrcut immediately.
-				itr = m_container.m_instances.erase(itr);
 				return;
 			}
 
@@ -524,58 +541,51 @@ namespace KickstartRT_NativeLayer
 			iPtr->m_geometry = nullptr;
 
 			// Erase from TLAS instance list.
-			if (iPtr->m_TLASInstanceListItr.has_value()) {
-				m_container.m_TLASInstanceList.erase(iPtr->m_TLASInstanceListItr.value());
-			}
+			m_container.RemoveFromTLASInstanceList(iPtr.get());
 
 			m_container.m_readyToDestructInstances.push_back(std::move(iPtr));
-			itr = m_container.m_instances.erase(itr);
 
 			isSceneChanged = true;
 		};
 
-		auto RemoveGeometryFromGraph = [&](SceneContainer::GeomMapIterator& itr)
+		auto RemoveGeometryFromGraph = [&](Geometry* gp)
 		{
-			auto& gh(itr->first);
-			auto& ghPtr(itr->second);
+			BVHTask::GeometryPtr ghPtr = m_container.DetachGeometry(gp);
 
 			if (ghPtr->m_registerStatus != BVHTask::RegisterStatus::Registered) {
 				// This geometry is created but not being registered to the scene graph.
 				// Destrcut immediately.
-				itr = m_container.m_geometries.erase(itr);
 				return;
 			}
 
 			if (ghPtr->m_instances.size() > 0) {
 				// the geometry is still being referenced by instances. Just hide from the scenegraph.
-				m_container.m_removedGeometries.insert({ gh, std::move(ghPtr) });
+				m_container.m_removedGeometries.push_back(std::move(ghPtr));
 			}
 			else {
 				// if it's not referenced from any instance, it's ready to destruct.
 				m_container.m_readyToDestructGeometries.push_back(std::move(ghPtr));
 			}
-			itr = m_container.m_geometries.erase(itr);
 
 			isSceneChanged = true;
 		};
 
 		// Destroy expired instances.
 		if (updateFromExc->m_destroyAllInstances) {
-			auto itr = m_container.m_instances.begin();
-			while (itr != m_container.m_instances.end()) {
-				RemoveInstanceFromGraph(itr);
+			while (!m_container.m_instances.empty()) {
+				RemoveInstanceFromGraph(m_container.m_instances.back().get());
 			}
 		}
 
 		for (auto&& destIh : updateFromExc->m_destroyedInstances) {
-			auto itr = m_container.m_instances.find(destIh);
-			if (itr != m_container.m_instances.end()) {
-				RemoveInstanceFromGraph(itr);
+			Instance* ip = m_container.FindInstance(destIh);
+			if (ip != nullptr) {
+				RemoveInstanceFromGraph(ip);
 			}
 			else {
 				// Search in created instance list.
 				Instance* destIhPtr = Instance::ToPtr(destIh);
-				auto createdDestItr = std::find_if(
+				auto createdDestItr = destIhPtr == nullptr ? updateFromExc->m_createdInstances.end() : std::find_if(
 					updateFromExc->m_createdInstances.begin(),
 					updateFromExc->m_createdInstances.end(),
 					[destIhPtr](auto&& createdItr) { return createdItr.get() == destIhPtr; });
@@ -591,20 +601,19 @@ namespace KickstartRT_NativeLayer
 
 		// Destroy expired geometries.
 		if (updateFromExc->m_destroyAllGeometries) {
-			auto itr = m_container.m_geometries.begin();
-			while (itr != m_container.m_geometries.end()) {
-				RemoveGeometryFromGraph(itr);
+			while (!m_container.m_geometries.empty()) {
+				RemoveGeometryFromGraph(m_container.m_geometries.back().get());
 			}
 		}
 		for (auto&& destGh : updateFromExc->m_destroyedGeometries) {
-			auto itr = m_container.m_geometries.find(destGh);
-			if (itr != m_container.m_geometries.end()) {
-				RemoveGeometryFromGraph(itr);
+			Geometry* gp = m_container.FindGeometry(destGh);
+			if (gp != nullptr) {
+				RemoveGeometryFromGraph(gp);
 			}
 			else {
 				// Search in created geom list.
 				Geometry* destGhPtr = Geometry::ToPtr(destGh);
-				auto createdDestItr = std::find_if(
+				auto createdDestItr = destGhPtr == nullptr ? updateFromExc->m_createdGeometries.end() : std::find_if(
 					updateFromExc->m_createdGeometries.begin(),
 					updateFromExc->m_createdGeometries.end(),
 					[destGhPtr](auto&& createdItr) { return createdItr.get() == destGhPtr; });
@@ -623,15 +632,13 @@ namespace KickstartRT_NativeLayer
 			if (!i)
 				continue; // destructed.
 
-			auto gh = i->ToHandle();
-			m_container.m_geometries.insert({ gh, std::move(i) });
+			m_container.AddGeometry(std::move(i));
 		}
 		for (auto&& i : updateFromExc->m_createdInstances) {
 			if (!i)
 				continue; // destructed.
 
-			auto ih = i->ToHandle();
-			m_container.m_instances.insert({ ih, std::move(i) });
+			m_container.AddInstance(std::move(i));
 		}
 
 		return Status::OK;
@@ -647,32 +654,30 @@ namespace KickstartRT_NativeLayer
 		isSceneChanged = false;
 
 		auto RegisterGeometry = [&](GeometryHandle &gh) {
-			auto ghItr = m_container.m_geometries.find(gh);
-			if (ghItr == m_container.m_geometries.end()) {
+			Geometry* gp = m_container.FindGeometry(gh);
+			if (gp == nullptr) {
 				Log::Fatal(L"Invalid geometry handle dtected while registering. %" PRIu64, gh);
 				return;
 			}
-			Geometry* gp = ghItr->second.get();
 			addedGeometryPtrs.push_back(gp);
 			gp->m_registerStatus = BVHTask::RegisterStatus::Registered;
 
 			isSceneChanged = true;
 		};
 		auto RegisterInstance = [&](InstanceHandle& ih) {
-			auto ihItr = m_container.m_instances.find(ih);
-			if (ihItr == m_container.m_instances.end()) {
+			Instance* ip = m_container.FindInstance(ih);
+			if (ip == nullptr) {
 				Log::Fatal(L"Invalid instance handle dtected while registering. %" PRIu64, ih);
 				return;
 			}
 
-			Instance* ip = ihItr->second.get();
-			auto gItr = m_container.m_geometries.find(ip->m_input.geomHandle);
-			if (gItr == m_container.m_geometries.end()) {
+			Geometry* gp = m_container.FindGeometry(ip->m_input.geomHandle);
+			if (gp == nullptr) {
 				Log::Fatal(L"Invalid geometry handle detected when registering an instance. %" PRIu64, (uint64_t)ip->m_input.geomHandle);
 				return;
 			}
 
-			ip->m_geometry = Geometry::ToPtr(ip->m_input.geomHandle);
+			ip->m_geometry = gp;
 			ip->m_input.geomHandle = GeometryHandle::Null;
 
 			// add reference from geometry.
@@ -681,17 +686,20 @@ namespace KickstartRT_NativeLayer
 			addedInstancePtrs.push_back(ip);
 			ip->m_registerStatus = BVHTask::RegisterStatus::Registered;
 
+			// It will be added to TLAS instance list once its BLAS is ready.
+			if (ip->m_input.participatingInTLAS)
+				m_container.AddToTLASPendingList(ip);
+
 			isSceneChanged = true;
 		};
 
 		// Update all geometries and instances.
 		for (auto&& upGeom : bvhTasks->m_updatedGeometries) {
-			auto gItr = m_container.m_geometries.find(upGeom.m_gh);
-			if (gItr == m_container.m_geometries.end()) {
+			Geometry* gp = m_container.FindGeometry(upGeom.m_gh);
+			if (gp == nullptr) {
 				Log::Fatal(L"Invalid geometry handle detected when updating a geometry. %" PRIu64, (uint64_t)upGeom.m_gh);
 				continue;
 			}
-			Geometry* gp = gItr->second.get();
 
 #if 0
 			if (RenderPass_DirectLightingCacheAllocation::CheckUpdateInputs(gp->m_input, upGeom.m_input) != Status::OK) {
@@ -718,28 +726,36 @@ namespace KickstartRT_NativeLayer
 			isSceneChanged = true;
 
 		for (auto&& upIns : bvhTasks->m_updatedInstances) {
-			auto iItr = m_container.m_instances.find(upIns.m_ih);
-			if (iItr == m_container.m_instances.end()) {
+			Instance* ip = m_container.FindInstance(upIns.m_ih);
+			if (ip == nullptr) {
 				Log::Fatal(L"Invalid instance handle detected when updating a instance. %" PRIu64, (uint64_t)upIns.m_ih);
 				continue;
 			}
-			Instance* ip = iItr->second.get();
 
 			// update transform and visiblity from input
 			ip->m_input.transform = upIns.m_input.transform;
 			ip->m_input.participatingInTLAS = upIns.m_input.participatingInTLAS;
 			ip->m_input.instanceInclusionMask = upIns.m_input.instanceInclusionMask;
+			ip->m_input.isStatic = upIns.m_input.isStatic;
 
 			// Do not add this to the update instance list when it's just registered.
-			if (ip->m_registerStatus == BVHTask::RegisterStatus::Registered)
+			if (ip->m_registerStatus == BVHTask::RegisterStatus::Registered) {
 				updatedInstancePtrs.push_back(ip);
 
-			// If its TLAS participating status is changed to disable and if it is participating in TLAS, remove it.
-			if (! ip->m_input.participatingInTLAS) {
-				if (ip->m_TLASInstanceListItr.has_value()) {
-					m_container.m_TLASInstanceList.erase(ip->m_TLASInstanceListItr.value());
-					ip->m_TLASInstanceListItr.reset();
+				// If its TLAS participating status is changed to disable and if it is participating in TLAS, remove it.
+				// An instance moved to the other TLAS partition is removed and appended again.
+				// Otherwise only its instance desc needs to be rewritten.
+				bool partitionChanged = ip->m_TLASInstanceIndex != kInvalidTLASInstanceIndex && (ip->m_TLASPartition == TLASPartition::e_Static) != ip->m_input.isStatic;
+				if (! ip->m_input.participatingInTLAS)
+					m_container.RemoveFromTLASInstanceList(ip);
+				else if (partitionChanged) {
+					m_container.RemoveFromTLASInstanceList(ip);
+					m_container.AddToTLASPendingList(ip);
 				}
+				else if (ip->m_TLASInstanceIndex != kInvalidTLASInstanceIndex)
+					m_container.UpdateTLASInstanceTransform(ip);
+				else
+					m_container.AddToTLASPendingList(ip);
 			}
 		}
 		if (updatedInstancePtrs.size() > 0)
@@ -760,8 +776,8 @@ namespace KickstartRT_NativeLayer
 		// Check if removed geometry is not referenced from any instance and move them to readyToDestructGeometries list.
 		if (isSceneChanged) {
 			for (auto itr = m_container.m_removedGeometries.begin(); itr != m_container.m_removedGeometries.end(); ) {
-				if (itr->second->m_instances.size() == 0) {
-					m_container.m_readyToDestructGeometries.push_back(std::move(itr->second));
+				if ((*itr)->m_instances.size() == 0) {
+					m_container.m_readyToDestructGeometries.push_back(std::move(*itr));
 					itr = m_container.m_removedGeometries.erase(itr);
 				}
 				else {
@@ -860,8 +876,8 @@ namespace KickstartRT_NativeLayer
 			m_container.m_waitingForTileAllocationGeometries.pop_front();
 
 			// Handes should be even safer than the raw pointer since it can find a different new -> delete -> new sctructures that have the same addresses.
-			auto gItr = m_container.m_geometries.find(gh);
-			if (gItr == m_container.m_geometries.end()) {
+			Geometry* gp = m_container.FindGeometry(gh);
+			if (gp == nullptr) {
 				// the geometry has been removed before doing redback.
 				if (!loggedMessage) {
 					Log::Warning(L"GeometryHandle was removed while calculating tile cache buffer size.");
@@ -871,7 +887,7 @@ namespace KickstartRT_NativeLayer
 			}
 
 			// the geometry is still alive.
-			readyToReadback.push_back(gItr->second.get());
+			readyToReadback.push_back(gp);
 		}
 
 		if (!readyToReadback.empty()) {
@@ -934,6 +950,7 @@ namespace KickstartRT_NativeLayer
 				for (auto&& ip : gp->m_instances) {
 					AllocationHappened = true;
 					RETURN_IF_STATUS_FAILED(AllocateTileForInstance(pws, ip, gp->m_numberOfTiles));
+					m_container.UpdateTLASInstanceTileBuffer(ip);
 				}
 			}
 
@@ -963,6 +980,7 @@ namespace KickstartRT_NativeLayer
 
 			AllocationHappened = true;
 			RETURN_IF_STATUS_FAILED(AllocateTileForInstance(pws, ip, gp->m_numberOfTiles));
+			m_container.UpdateTLASInstanceTileBuffer(ip);
 		}
 
 		return Status::OK;
@@ -1050,8 +1068,8 @@ namespace KickstartRT_NativeLayer
 			GeometryHandle gh = itr->second;
 			m_container.m_waitingForBVHCompactionGeometries.pop_front();
 
-			auto gItr = m_container.m_geometries.find(gh);
-			if (gItr == m_container.m_geometries.end()) {
+			Geometry* gp = m_container.FindGeometry(gh);
+			if (gp == nullptr) {
 				// The geometry has been removed before doing redback.
 				if (!loggedMessage) {
 					Log::Warning(L"GeometryHandle has been removed while calculating compacted BVH size.");
@@ -1060,7 +1078,7 @@ namespace KickstartRT_NativeLayer
 				continue;
 			}
 
-			readyToReadback.push_back(gItr->second.get());
+			readyToReadback.push_back(gp);
 		}
 
 		// nothing to do.
@@ -1167,6 +1185,7 @@ namespace KickstartRT_NativeLayer
 #endif
 
 			std::swap(gp->m_BLASBuffer, b);
+			m_container.MarkTLASInstanceDescsDirty(gp);
 
 			pws->DeferredRelease(std::move(b));
 		}
@@ -1182,6 +1201,38 @@ namespace KickstartRT_NativeLayer
 		return Status::OK;
 	}
 
+	Status Scene::DefragmentSharedBuffers(PersistentWorkingSet* pws, GraphicsAPI::CommandList* cmdList, bool& relocated)
+	{
+		relocated = false;
+
+		// Drain partially used blocks of the persistent pools a bit per task, so that they can be released with CheckUnusedBufferBlocks().
+		bool DLCRelocated = false;
+		RETURN_IF_STATUS_FAILED(pws->m_sharedBufferForDirectLightingCache->Defragment(pws, cmdList, PersistentWorkingSet::m_defragmentationBytesPerTask, DLCRelocated));
+		if (DLCRelocated) {
+			// UAVs of relocated entries have been re-created, so CPU desc tables of instances need to be updated.
+			for (auto&& ins : m_container.m_instances)
+				ins->m_needToUpdateUAV = true;
+		}
+
+		bool BLASRelocated = false;
+		RETURN_IF_STATUS_FAILED(pws->m_sharedBufferForBLASPermanent->Defragment(pws, cmdList, PersistentWorkingSet::m_defragmentationBytesPerTask, BLASRelocated));
+		if (BLASRelocated) {
+			// Relocated entries are not reported, so all instance descs need to be rewritten.
+			for (auto&& list : m_container.m_TLASInstanceLists) {
+				list.m_allDescsAreDirty = true;
+				list.m_topologyIsChanged = true;
+			}
+		}
+
+		if (m_enableInfoLog && (DLCRelocated || BLASRelocated)) {
+			Log::Info(L"DefragmentSharedBuffers() DLC relocated:%d BLAS relocated:%d", DLCRelocated, BLASRelocated);
+		}
+
+		relocated = DLCRelocated || BLASRelocated;
+
+		return Status::OK;
+	}
+
 	Status Scene::BuildBLASCommands(TaskWorkingSet* tws, GraphicsAPI::CommandList* cmdList,
 		std::deque<Geometry *>& updatedGeometryPtrs,
 		uint32_t maxBlasBuildTasks, bool& BLASChanged)
@@ -1217,8 +1268,8 @@ namespace KickstartRT_NativeLayer
 			m_container.m_buildBVHQueue.pop_front();
 
 			// Handle is even better than the raw pointer to detect new -> delete -> new senario.
-			auto gItr = m_container.m_geometries.find(gh);
-			if (gItr == m_container.m_geometries.end()) {
+			Geometry* gp = m_container.FindGeometry(gh);
+			if (gp == nullptr) {
 				if (!loggedMessage) {
 					Log::Info(L"A geometry has been removed before building BVH.");
 					loggedMessage = true;
@@ -1226,7 +1277,7 @@ namespace KickstartRT_NativeLayer
 				continue;
 			}
 
-			buildGeometries.push_back(gItr->second.get());
+			buildGeometries.push_back(gp);
 		}
 
 		size_t nbGeomsToProcesss = buildGeometries.size() + updatedGeometries.size();
@@ -1241,6 +1292,12 @@ namespace KickstartRT_NativeLayer
 
 		BLASChanged = true;
 
+		// BLASs rebuilt or updated in place change the bounds of their instances, so the TLASs need to be refitted at least.
+		for (auto&& gp : updatedGeometries)
+			m_container.MarkTLASNeedsRefit(gp);
+		for (auto&& gp : buildGeometries)
+			m_container.MarkTLASNeedsRefit(gp);
+
 #if defined(GRAPHICS_API_D3D12)
 		std::vector<D3D12_RAYTRACING_GEOMETRY_DESC> rtGeomDescs(nbGeomsToProcesss);
 		std::vector<D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS> asInputs(nbGeomsToProcesss);
@@ -1439,6 +1496,7 @@ namespace KickstartRT_NativeLayer
 				else {
 					gp->m_BLASBuffer = pws->m_sharedBufferForBLASPermanent->Allocate(pws, bufferSize, true);
 				}
+				m_container.MarkTLASInstanceDescsDirty(gp);
 			}
 
 #if defined(GRAPHICS_API_D3D12)
@@ -1689,54 +1747,54 @@ namespace KickstartRT_NativeLayer
 		return Status::OK;
 	}
 
-	Status Scene::BuildTLASCommands(TaskWorkingSet* tws, GraphicsAPI::CommandList* cmdList)
+	Status Scene::BuildTLASCommands(TaskWorkingSet* tws, GraphicsAPI::CommandList* cmdList, uint32_t maxTLASRefitCount)
 	{
-#if defined(GRAPHICS_API_VK)
-		namespace VK = KickstartRT_NativeLayer::GraphicsAPI::VK;
-#endif
-
 		PersistentWorkingSet* pws(tws->m_persistentWorkingSet);
 		GraphicsAPI::Utils::ScopedEventObject sce(cmdList, { 0, 128, 0 }, DebugName("Build TLAS"));
 
-		uint32_t nbInstanceParticipated = 0;
-#if defined(GRAPHICS_API_D3D12)
-		std::vector<D3D12_RAYTRACING_INSTANCE_DESC> iDescs(m_container.m_instances.size());
-#elif defined(GRAPHICS_API_VK)
-		std::vector<VkAccelerationStructureInstanceKHR> iDescs(m_container.m_instances.size());
-#endif
-
 		{
 			// Update tlas instance list with valid instances. SDK try to keep the order of the list as much as possible so that we can minimize the desc copy OP.
 			if (m_container.m_instances.size() > 0) {
-				// Fill instance desc and upload it to a GPU visible buffer 
+				// Only pending instances are checked here, the others are added or removed when they are registered, updated or destroyed.
+				std::deque<InstanceHandle> stillPendingInstances;
 
-				for (auto&& itr : m_container.m_instances) {
-					if (! itr.second->m_input.participatingInTLAS) {
+				for (auto&& ih : m_container.m_TLASPendingInstances) {
+					Instance* ip = m_container.FindInstance(ih);
+					if (ip == nullptr)
+						continue; // destructed.
+
+					if (!ip->m_isTLASPending)
+						continue;
+
+					if (! ip->m_input.participatingInTLAS) {
+						ip->m_isTLASPending = false;
 						continue;
 					}
 
-					auto gp = itr.second->m_geometry;
+					auto gp = ip->m_geometry;
 
-					if (gp == nullptr)
+					if (gp == nullptr) {
 						Log::Fatal(L"Invalid geometry reference held by an instance found.");
+						ip->m_isTLASPending = false;
+						continue;
+					}
 
 					if (!gp->m_BLASBuffer) {
 						//Log::Info(L"Null BLAS is detected.. will be created soon..");
+						stillPendingInstances.push_back(ih);
 						continue;
 					}
 
-					// A valid instance and visible, but not on the list.
-					if (!itr.second->m_TLASInstanceListItr.has_value()) {
-						// Put the instance at the last of instance list for TLAS so that long-living instances should be stay the same place of the list longer.
-						m_container.m_TLASInstanceList.push_back(itr.second->ToHandle());
-						itr.second->m_TLASInstanceListItr = --m_container.m_TLASInstanceList.end();
-					}
+					// Put the instance at the last of instance list for TLAS so that long-living instances should be stay the same place of the list longer.
+					ip->m_isTLASPending = false;
+					m_container.AppendToTLASInstanceList(ip);
 				}
+				std::swap(stillPendingInstances, m_container.m_TLASPendingInstances);
 
 #if KICKSTARTRT_ENABLE_DIRECT_LIGHTING_CACHE_INDIRECTION_TABLE
 				{
 					// Update indirection table here.
-					std::vector<uint32_t> indirectionTable(m_container.m_TLASInstanceList.size() * 4);
+					std::vector<uint32_t> indirectionTable((size_t)m_container.NumberOfTLASInstances() * 4);
 					std::map<SharedBuffer::BufferBlock*, uint32_t> sharedBlockEntriesMap;
 					m_directLightingCacheIndirectionTableSharedBlockEntries.clear();
 
@@ -1744,51 +1802,54 @@ namespace KickstartRT_NativeLayer
 					// [Zero UAV], [Null UAV], [BufferBlock UAVs...]
 					uint32_t indirectionTableEntryIdx = 2;
 					uint32_t insIdx = 0;
-					for (auto&& itr : m_container.m_TLASInstanceList) {
-						auto ip = Instance::ToPtr(itr);
-						auto& gp(ip->m_geometry);
-
-						// One instace occupies 4 DWORD. [UAVIndex for DLC index][Offset for DLC index], [UAVIndex for DLC][Offset for DLC]
-						size_t idx = (size_t)insIdx++ * 4;
-
-						auto WriteEntry = [&](std::unique_ptr<SharedBuffer::BufferEntry> &bufferEntry) {
-							auto* bPtr = bufferEntry->m_block;
-							auto tItr = sharedBlockEntriesMap.find(bPtr);
-							uint32_t	tableEntryIdx;
-							if (tItr == sharedBlockEntriesMap.end()) {
-								tableEntryIdx = indirectionTableEntryIdx++;
-								sharedBlockEntriesMap.insert({ bPtr, tableEntryIdx });
-								m_directLightingCacheIndirectionTableSharedBlockEntries.push_back(bPtr);
+					// Static instances come first, same as InstanceIDs.
+					for (auto&& list : m_container.m_TLASInstanceLists) {
+						for (size_t i = 0; i < list.m_instances.size(); ++i) {
+							auto gp = list.m_geometries[i];
+							auto dynamicTileBuffer = list.m_dynamicTileBuffers[i];
+
+							// One instace occupies 4 DWORD. [UAVIndex for DLC index][Offset for DLC index], [UAVIndex for DLC][Offset for DLC]
+							size_t idx = (size_t)insIdx++ * 4;
+
+							auto WriteEntry = [&](SharedBuffer::BufferEntry* bufferEntry) {
+								auto* bPtr = bufferEntry->m_block;
+								auto tItr = sharedBlockEntriesMap.find(bPtr);
+								uint32_t	tableEntryIdx;
+								if (tItr == sharedBlockEntriesMap.end()) {
+									tableEntryIdx = indirectionTableEntryIdx++;
+									sharedBlockEntriesMap.insert({ bPtr, tableEntryIdx });
+									m_directLightingCacheIndirectionTableSharedBlockEntries.push_back(bPtr);
+								}
+								else {
+									tableEntryIdx = tItr->second;
+								}
+
+								indirectionTable[idx++] = tableEntryIdx; // Buffer Block UAV index for direct lighting cache Buffer.
+								indirectionTable[idx++] = (uint32_t)(bufferEntry->m_offset / sizeof(uint32_t)); // Buffer Block offset (DWORD) for direct lighting cache Buffer.
+							};
+
+							if (gp->m_directTileMapping) {
+								// DirectTileMapping doesn't have an index buffer for DLC.
+								indirectionTable[idx++] = 0; // Buffer Block UAV index for direct lighting cache index Buffer. One is Zero UAV.
+								indirectionTable[idx++] = 0; // Buffer Block offset (DWORD) for direct lighting cache index Buffer.
 							}
 							else {
-								tableEntryIdx = tItr->second;
+								WriteEntry(gp->m_directLightingCacheIndices.get());
+							}
+							if (dynamicTileBuffer == nullptr) {
+								// Dynamic Tile buffer is not allocated yet.
+								indirectionTable[idx++] = 1; // Buffer Block UAV for direct lighting cache Buffer. Two is null UAV.
+								indirectionTable[idx++] = 0; // Buffer Block offset (DWORD) for direct lighting cache Buffer.
+							}
+							else {
+								WriteEntry(dynamicTileBuffer);
 							}
-
-							indirectionTable[idx++] = tableEntryIdx; // Buffer Block UAV index for direct lighting cache Buffer.
-							indirectionTable[idx++] = (uint32_t)(bufferEntry->m_offset / sizeof(uint32_t)); // Buffer Block offset (DWORD) for direct lighting cache Buffer.
-						};
-
-						if (gp->m_directTileMapping) {
-							// DirectTileMapping doesn't have an index buffer for DLC.
-							indirectionTable[idx++] = 0; // Buffer Block UAV index for direct lighting cache index Buffer. One is Zero UAV.
-							indirectionTable[idx++] = 0; // Buffer Block offset (DWORD) for direct lighting cache index Buffer.
-						}
-						else {
-							WriteEntry(gp->m_directLightingCacheIndices);
-						}
-						if (! ip->m_dynamicTileBuffer) {
-							// Dynamic Tile buffer is not allocated yet.
-							indirectionTable[idx++] = 1; // Buffer Block UAV for direct lighting cache Buffer. Two is null UAV.
-							indirectionTable[idx++] = 0; // Buffer Block offset (DWORD) for direct lighting cache Buffer.
-						}
-						else {
-							WriteEntry(ip->m_dynamicTileBuffer);
 						}
 					}
 
 					// Upload indirection table.
-					if (m_container.m_TLASInstanceList.size() > 0) {
-						size_t requiredSize = sizeof(uint32_t) * 4 * m_container.m_TLASInstanceList.size();
+					if (m_container.NumberOfTLASInstances() > 0) {
+						size_t requiredSize = sizeof(uint32_t) * 4 * m_container.NumberOfTLASInstances();
 						size_t allocationSize = requiredSize + sizeof(uint32_t) * 4 * 50;
 
 						if ((!tws->m_directLightingCacheIndirectionTableUploadBuffer) || tws->m_directLightingCacheIndirectionTableUploadBuffer->m_sizeInBytes < requiredSize) {
@@ -1858,74 +1919,188 @@ namespace KickstartRT_NativeLayer
 				}
 #endif
 			}
+		}
+
+		for (size_t i = 0; i < kNumTLASPartitions; ++i) {
+			auto& list(m_container.m_TLASInstanceLists[i]);
+
+			// A partition is built only when its instances or BLASs are changed. The empty one is also built once to have a valid SRV.
+			bool needsBuild = (!m_TLASPartitions[i].m_bufferSrv) || list.m_topologyIsChanged || list.m_allDescsAreDirty || list.m_needsRefit || list.m_dirtyIndices.size() > 0;
+			if (!needsBuild)
+				continue;
+
+			RETURN_IF_STATUS_FAILED(BuildTLASPartitionCommands(tws, cmdList, (TLASPartition)i, maxTLASRefitCount));
+		}
+
+		return Status::OK;
+	}
+
+	Status Scene::BuildTLASPartitionCommands(TaskWorkingSet* tws, GraphicsAPI::CommandList* cmdList, TLASPartition partition, uint32_t maxTLASRefitCount)
+	{
+#if defined(GRAPHICS_API_VK)
+		namespace VK = KickstartRT_NativeLayer::GraphicsAPI::VK;
+#endif
+
+		PersistentWorkingSet* pws(tws->m_persistentWorkingSet);
+		GraphicsAPI::Utils::ScopedEventObject sce(cmdList, { 0, 128, 0 }, DebugName("Build TLAS[%d]", (uint32_t)partition));
+		auto startTime = std::chrono::steady_clock::now();
+
+		auto& list(m_container.m_TLASInstanceLists[(size_t)partition]);
+		auto& res(m_TLASPartitions[(size_t)partition]);
+		auto& stats(m_TLASBuildStatistics.m_partitions[(size_t)partition]);
+		auto& uploadBuffer(tws->m_TLASUploadBuffers[(size_t)partition]);
+
+		const uint32_t nbInstanceParticipated = (uint32_t)list.m_instances.size();
+		// InstanceIDs of the dynamic instances follow the static ones.
+		const uint32_t instanceIDOffset = partition == TLASPartition::e_Static ? 0 : (uint32_t)m_container.m_TLASInstanceLists[(size_t)TLASPartition::e_Static].m_instances.size();
+
+		if (m_enableInfoLog) {
+			Log::Info(L"BuildTLASCommand() Partition: %d NbInstancesParticipated: %d NbDirtyInstances: %d", (uint32_t)partition, nbInstanceParticipated, (uint32_t)list.m_dirtyIndices.size());
+		}
+
+		// Allocate the device buffer for instance descs. All descs need to be uploaded to a new buffer.
+		{
+			size_t requiredSize = sizeof(TLASInstanceDesc) * nbInstanceParticipated;
+
+			if (requiredSize > 0 && ((!res.m_instanceDescBuffer) || res.m_instanceDescBuffer->m_sizeInBytes < requiredSize)) {
+				pws->DeferredRelease(std::move(res.m_instanceDescBuffer));
+
+				size_t allocationSize = requiredSize + requiredSize / 4 + sizeof(TLASInstanceDesc) * 50;
+
+				res.m_instanceDescBuffer = pws->CreateBufferResource(
+					(uint32_t)allocationSize, GraphicsAPI::Resource::Format::Unknown,
+					GraphicsAPI::Resource::BindFlags::ShaderDeviceAddress | GraphicsAPI::Resource::BindFlags::AccelerationStructureBuildInput,
+					GraphicsAPI::Buffer::CpuAccess::None,
+					ResourceLogger::ResourceKind::e_TLAS);
+				if (!res.m_instanceDescBuffer) {
+					Log::Fatal(L"Failed to allocate a TLAS instance desc buffer %" PRIu64, allocationSize);
+					return (Status::ERROR_INTERNAL);
+				}
+				res.m_instanceDescBuffer->SetName(DebugName(L"TLAS[%d] instance descs", (uint32_t)partition));
+
+				list.m_allDescsAreDirty = true;
+			}
+		}
+
+		// Refit TLAS when only transforms or masks of instances are updated since the last build, and rebuild it after maxTLASRefitCount refits.
+		bool doRefit = false;
+		{
+			bool topologyChanged = list.m_topologyIsChanged || list.m_allDescsAreDirty || nbInstanceParticipated != res.m_builtInstanceCount;
+			list.m_topologyIsChanged = false;
+			list.m_needsRefit = false;
+
+			if (maxTLASRefitCount > 0 && res.m_allowsUpdate && (!topologyChanged) && nbInstanceParticipated > 0) {
+				if (stats.m_numRefitsSinceRebuild < maxTLASRefitCount)
+					doRefit = true;
+				else
+					stats.m_numForcedRebuilds++;
+			}
+		}
+
+		// Rewrite dirty instance descs and gather ranges to upload.
+		std::vector<std::pair<uint32_t, uint32_t>> uploadRanges; // [begin, end) in the TLAS instance list.
+		{
+			res.m_instanceDescs.resize(nbInstanceParticipated);
+
+			// Only the packed hot fields of the list are read here, not the instances.
+			auto WriteDesc = [&](uint32_t index) {
+				auto gp = list.m_geometries[index];
 
-			// Fill instance desc and upload it to a GPU visible buffer 
-			for (auto&& itr : m_container.m_TLASInstanceList) {
-				auto ip = Instance::ToPtr(itr);
-				auto& gp(ip->m_geometry);
-				
 #if defined(GRAPHICS_API_D3D12)
-				D3D12_RAYTRACING_INSTANCE_DESC& iDesc(iDescs[nbInstanceParticipated]);
+				D3D12_RAYTRACING_INSTANCE_DESC& iDesc(res.m_instanceDescs[index]);
 				iDesc = {};
-				ip->m_input.transform.CopyTo(&iDesc.Transform[0][0]);
-				iDesc.InstanceID = nbInstanceParticipated;
+				list.m_transforms[index].CopyTo(&iDesc.Transform[0][0]);
+				iDesc.InstanceID = instanceIDOffset + index;
 				iDesc.InstanceContributionToHitGroupIndex = 0; // since we only use inline raytracing.
-				iDesc.InstanceMask = uint8_t(ip->m_input.instanceInclusionMask);
+				iDesc.InstanceMask = list.m_instanceMasks[index];
 				iDesc.Flags = D3D12_RAYTRACING_INSTANCE_FLAG_TRIANGLE_CULL_DISABLE | D3D12_RAYTRACING_INSTANCE_FLAG_FORCE_OPAQUE;
 				iDesc.AccelerationStructure = gp->m_BLASBuffer->GetGpuPtr();
 #elif defined(GRAPHICS_API_VK)
-				VkAccelerationStructureInstanceKHR& iDesc(iDescs[nbInstanceParticipated]);
+				VkAccelerationStructureInstanceKHR& iDesc(res.m_instanceDescs[index]);
 				iDesc = {};
-				ip->m_input.transform.CopyTo(&iDesc.transform);
-				iDesc.instanceCustomIndex = nbInstanceParticipated;
-				iDesc.mask = uint8_t(ip->m_input.instanceInclusionMask);
+				list.m_transforms[index].CopyTo(&iDesc.transform);
+				iDesc.instanceCustomIndex = instanceIDOffset + index;
+				iDesc.mask = list.m_instanceMasks[index];
 				iDesc.instanceShaderBindingTableRecordOffset = 0;
 				iDesc.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR | VK_GEOMETRY_INSTANCE_FORCE_OPAQUE_BIT_KHR;
 				iDesc.accelerationStructureReference = gp->m_BLASBuffer->GetGpuPtr();
 #endif
-				++nbInstanceParticipated;
+			};
+
+			auto& dirtyFlags(list.m_descIsDirty);
+			auto& dirtyIndices(list.m_dirtyIndices);
+
+			if (list.m_allDescsAreDirty) {
+				for (uint32_t i = 0; i < nbInstanceParticipated; ++i)
+					WriteDesc(i);
+				if (nbInstanceParticipated > 0)
+					uploadRanges.push_back({ 0, nbInstanceParticipated });
+
+				std::fill(dirtyFlags.begin(), dirtyFlags.end(), (uint8_t)0);
+			}
+			else {
+				RangeMerge::GatherDirtyRanges(dirtyIndices, dirtyFlags, nbInstanceParticipated, m_TLASInstanceDescMergeGap, uploadRanges, WriteDesc);
 			}
-		}
 
-		if (m_enableInfoLog) {
-			Log::Info(L"BuildTLASCommand() NbInstancesParticipated: %d", nbInstanceParticipated);
+			dirtyIndices.clear();
+			list.m_allDescsAreDirty = false;
 		}
 
-		// shrink the array to cut unused region.
-		iDescs.resize(nbInstanceParticipated);
+		// upload dirty TLAS descs.
+		if (uploadRanges.size() > 0) {
+			size_t requiredUploadSize = sizeof(TLASInstanceDesc) * RangeMerge::TotalLength(uploadRanges);
 
-		// upload TLAS desc.
-		{
-			size_t requiredUploadSize = sizeof(iDescs[0]) * iDescs.size();
-			size_t allocationSize = requiredUploadSize + sizeof(iDescs[0]) * 50;
+			size_t allocationSize = requiredUploadSize + sizeof(TLASInstanceDesc) * 50;
 
-			if (tws->m_TLASUploadBuffer->m_sizeInBytes < requiredUploadSize) {
-				if (tws->m_TLASUploadBuffer->m_sizeInBytes > 0)
-					pws->DeferredRelease(std::move(tws->m_TLASUploadBuffer));
+			if (uploadBuffer->m_sizeInBytes < requiredUploadSize) {
+				if (uploadBuffer->m_sizeInBytes > 0)
+					pws->DeferredRelease(std::move(uploadBuffer));
 
-				tws->m_TLASUploadBuffer = pws->CreateBufferResource(
+				uploadBuffer = pws->CreateBufferResource(
 					(uint32_t)allocationSize, GraphicsAPI::Resource::Format::Unknown,
-					GraphicsAPI::Resource::BindFlags::Constant | GraphicsAPI::Resource::BindFlags::ShaderDeviceAddress | GraphicsAPI::Resource::BindFlags::AccelerationStructureBuildInput,
+					GraphicsAPI::Resource::BindFlags::None,
 					GraphicsAPI::Buffer::CpuAccess::Write,
 					ResourceLogger::ResourceKind::e_TLAS);
-				if (!tws->m_TLASUploadBuffer) {
+				if (!uploadBuffer) {
 					Log::Fatal(L"Failed to allocate a TLAS upload buffer %" PRIu64, allocationSize);
 					return (Status::ERROR_INTERNAL);
 				}
-				tws->m_TLASUploadBuffer->SetName(DebugName(L"TLAS upload"));
+				uploadBuffer->SetName(DebugName(L"TLAS[%d] upload", (uint32_t)partition));
 			}
 
-			// copy instance info to the upload buffer.
-			if (requiredUploadSize > 0) {
-				void* ptr = tws->m_TLASUploadBuffer->Map(&pws->m_device, GraphicsAPI::Buffer::MapType::WriteDiscard, 0, 0, 0);
-				if (ptr != nullptr) {
-					memcpy(ptr, &iDescs[0], requiredUploadSize);
-					tws->m_TLASUploadBuffer->Unmap(&pws->m_device, 0, 0, requiredUploadSize);
-				}
-				else {
+			// copy dirty ranges to the upload buffer tightly.
+			{
+				uint8_t* ptr = reinterpret_cast<uint8_t*>(uploadBuffer->Map(&pws->m_device, GraphicsAPI::Buffer::MapType::WriteDiscard, 0, 0, 0));
+				if (ptr == nullptr) {
 					Log::Fatal(L"Failed to map TLAS upload buffer, device removal state is suspected.");
 					return (Status::ERROR_INTERNAL);
 				}
+				RangeMerge::PackRanges(uploadRanges, res.m_instanceDescs.data(), ptr);
+				uploadBuffer->Unmap(&pws->m_device, 0, 0, requiredUploadSize);
+			}
+
+			{
+				//set transition to copy dest
+				std::vector<GraphicsAPI::Resource*> rArr{ res.m_instanceDescBuffer.get() };
+				std::vector<GraphicsAPI::ResourceState::State> sArr{ GraphicsAPI::ResourceState::State::CopyDest };
+				cmdList->ResourceTransitionBarrier(rArr.data(), rArr.size(), sArr.data());
+			}
+			{
+				// copy each range to the device buffer.
+				uint64_t srcOffset = 0;
+				for (auto&& r : uploadRanges) {
+					uint64_t rangeSize = sizeof(TLASInstanceDesc) * (r.second - r.first);
+					cmdList->CopyBufferRegion(
+						res.m_instanceDescBuffer.get(), sizeof(TLASInstanceDesc) * r.first,
+						uploadBuffer.get(), srcOffset, rangeSize);
+					srcOffset += rangeSize;
+				}
+			}
+			{
+				//set transition from CopyDest to be read by AS build
+				std::vector<GraphicsAPI::Resource*> rArr{ res.m_instanceDescBuffer.get() };
+				std::vector<GraphicsAPI::ResourceState::State> sArr{ GraphicsAPI::ResourceState::State::NonPixelShader };
+				cmdList->ResourceTransitionBarrier(rArr.data(), rArr.size(), sArr.data());
 			}
 		}
 
@@ -1938,9 +2113,11 @@ namespace KickstartRT_NativeLayer
 			D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS ASInputs = {};
 			ASInputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
 			ASInputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-			ASInputs.InstanceDescs = instanceCount > 0 ? tws->m_TLASUploadBuffer->GetGpuAddress() : 0;
+			ASInputs.InstanceDescs = instanceCount > 0 ? res.m_instanceDescBuffer->GetGpuAddress() : 0;
 			ASInputs.NumDescs = instanceCount;
 			ASInputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
+			if (maxTLASRefitCount > 0)
+				ASInputs.Flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE;
 
 			// Get the size requirements for the TLAS buffers
 			{
@@ -1948,14 +2125,14 @@ namespace KickstartRT_NativeLayer
 				pws->m_device.m_apiData.m_device->GetRaytracingAccelerationStructurePrebuildInfo(&ASInputs, &ASPreBuildInfo);
 
 				TLASBufferSize = GraphicsAPI::ALIGN((UINT64)D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT, ASPreBuildInfo.ResultDataMaxSizeInBytes);
-				scratchBufferSize = GraphicsAPI::ALIGN((UINT64)D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT, ASPreBuildInfo.ScratchDataSizeInBytes);
+				scratchBufferSize = GraphicsAPI::ALIGN((UINT64)D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT, std::max(ASPreBuildInfo.ScratchDataSizeInBytes, ASPreBuildInfo.UpdateScratchDataSizeInBytes));
 			}
 
 #elif defined(GRAPHICS_API_VK)
 			VkAccelerationStructureGeometryInstancesDataKHR instances = {};
 			instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
 			instances.arrayOfPointers = false;
-			instances.data.deviceAddress = instanceCount > 0 ? tws->m_TLASUploadBuffer->GetGpuAddress() : 0;
+			instances.data.deviceAddress = instanceCount > 0 ? res.m_instanceDescBuffer->GetGpuAddress() : 0;
 
 			// Identify the above data as containing opaque triangles.
 			VkAccelerationStructureGeometryKHR asGeom = {};
@@ -1968,6 +2145,8 @@ namespace KickstartRT_NativeLayer
 			geomInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
 			geomInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
 			geomInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+			if (maxTLASRefitCount > 0)
+				geomInfo.flags |= VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
 			geomInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
 			geomInfo.srcAccelerationStructure = {};
 			geomInfo.dstAccelerationStructure = {};
@@ -1987,40 +2166,43 @@ namespace KickstartRT_NativeLayer
 #endif
 
 			// Allocate TLAS buffer and Scratch buffer
-			if ((!m_TLASScratchBuffer) || m_TLASScratchBuffer->m_sizeInBytes < scratchBufferSize) {
-				pws->DeferredRelease(std::move(m_TLASScratchBuffer));
+			if ((!res.m_scratchBuffer) || res.m_scratchBuffer->m_sizeInBytes < scratchBufferSize) {
+				pws->DeferredRelease(std::move(res.m_scratchBuffer));
 
 				uint64_t allocationSize = scratchBufferSize + 256 * 4 * 16; // + 16KB
-				m_TLASScratchBuffer = pws->CreateBufferResource(
+				res.m_scratchBuffer = pws->CreateBufferResource(
 					allocationSize, GraphicsAPI::Resource::Format::Unknown,
 					GraphicsAPI::Resource::BindFlags::UnorderedAccess | GraphicsAPI::Resource::BindFlags::ShaderDeviceAddress,
 					GraphicsAPI::Buffer::CpuAccess::None,
 					ResourceLogger::ResourceKind::e_TLAS);
-				if (!m_TLASScratchBuffer) {
+				if (!res.m_scratchBuffer) {
 					Log::Fatal(L"Failed to allocate a TLAS scratch buffer %" PRIu64, allocationSize);
 					return (Status::ERROR_INTERNAL);
 				}
-				m_TLASScratchBuffer->SetName(DebugName(L"TLAS scratch"));
+				res.m_scratchBuffer->SetName(DebugName(L"TLAS[%d] scratch", (uint32_t)partition));
 			}
-			if ((!m_TLASBuffer) || m_TLASBuffer->m_sizeInBytes < TLASBufferSize) {
-				pws->DeferredRelease(std::move(m_TLASBuffer));
-				pws->DeferredRelease(std::move(m_TLASBufferSrv));
+			if ((!res.m_buffer) || res.m_buffer->m_sizeInBytes < TLASBufferSize) {
+				pws->DeferredRelease(std::move(res.m_buffer));
+				pws->DeferredRelease(std::move(res.m_bufferSrv));
+
+				// A new buffer doesn't have a source TLAS to refit.
+				doRefit = false;
 
 				uint64_t allocationSize = TLASBufferSize + 256 * 4 * 16; // + 16KB
 
-				m_TLASBuffer = pws->CreateBufferResource(
+				res.m_buffer = pws->CreateBufferResource(
 					allocationSize, GraphicsAPI::Resource::Format::Unknown,
 					GraphicsAPI::Resource::BindFlags::UnorderedAccess | GraphicsAPI::Resource::BindFlags::AccelerationStructure,
 					GraphicsAPI::Buffer::CpuAccess::None,
 					ResourceLogger::ResourceKind::e_TLAS);
-				if (!m_TLASBuffer) {
+				if (!res.m_buffer) {
 					Log::Fatal(L"Failed to allocate a TLAS buffer %" PRIu64, allocationSize);
 					return (Status::ERROR_INTERNAL);
 				}
-				m_TLASBuffer->SetName(DebugName(L"TLAS"));
+				res.m_buffer->SetName(DebugName(L"TLAS[%d]", (uint32_t)partition));
 
-				m_TLASBufferSrv = std::make_unique<GraphicsAPI::ShaderResourceView>();
-				if (!m_TLASBufferSrv->Init(&pws->m_device, m_TLASBuffer.get())) {
+				res.m_bufferSrv = std::make_unique<GraphicsAPI::ShaderResourceView>();
+				if (!res.m_bufferSrv->Init(&pws->m_device, res.m_buffer.get())) {
 					Log::Fatal(L"Failed to create SRV for a TLAS buffer %" PRIu64, allocationSize);
 					return (Status::ERROR_INTERNAL);
 				}
@@ -2031,8 +2213,12 @@ namespace KickstartRT_NativeLayer
 			{
 				D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc = {};
 				buildDesc.Inputs = ASInputs;
-				buildDesc.ScratchAccelerationStructureData = m_TLASScratchBuffer->GetGpuAddress();
-				buildDesc.DestAccelerationStructureData = m_TLASBuffer->GetGpuAddress();
+				if (doRefit) {
+					buildDesc.Inputs.Flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
+					buildDesc.SourceAccelerationStructureData = res.m_buffer->GetGpuAddress();
+				}
+				buildDesc.ScratchAccelerationStructureData = res.m_scratchBuffer->GetGpuAddress();
+				buildDesc.DestAccelerationStructureData = res.m_buffer->GetGpuAddress();
 
 				cmdList->m_apiData.m_commandList->BuildRaytracingAccelerationStructure(&buildDesc, 0, nullptr);
 			}
@@ -2045,8 +2231,12 @@ namespace KickstartRT_NativeLayer
 				rangeInfo.primitiveOffset = 0;
 				rangeInfo.transformOffset = 0;
 
-				geomInfo.dstAccelerationStructure = m_TLASBufferSrv->m_apiData.m_accelerationStructure;
-				geomInfo.scratchData.deviceAddress = m_TLASScratchBuffer->GetGpuAddress();
+				geomInfo.dstAccelerationStructure = res.m_bufferSrv->m_apiData.m_accelerationStructure;
+				if (doRefit) {
+					geomInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR;
+					geomInfo.srcAccelerationStructure = res.m_bufferSrv->m_apiData.m_accelerationStructure;
+				}
+				geomInfo.scratchData.deviceAddress = res.m_scratchBuffer->GetGpuAddress();
 
 				VkAccelerationStructureBuildRangeInfoKHR* rangeArr[1] = { &rangeInfo };
 				VK::vkCmdBuildAccelerationStructuresKHR(
@@ -2059,11 +2249,35 @@ namespace KickstartRT_NativeLayer
 
 			// set uav barrier to use it
 			{
-				std::vector<GraphicsAPI::Resource*> rArr{ m_TLASBuffer.get() };
+				std::vector<GraphicsAPI::Resource*> rArr{ res.m_buffer.get() };
 				cmdList->ResourceUAVBarrier(rArr.data(), rArr.size());
 			}
+
+			res.m_allowsUpdate = maxTLASRefitCount > 0;
+			res.m_builtInstanceCount = instanceCount;
+			if (doRefit) {
+				stats.m_numRefits++;
+				stats.m_numRefitsSinceRebuild++;
+			}
+			else {
+				stats.m_numRebuilds++;
+				stats.m_numRefitsSinceRebuild = 0;
+			}
+			stats.m_numInstances = instanceCount;
+			stats.m_TLASSizeInBytes = res.m_buffer->m_sizeInBytes;
+
+			if (m_enableInfoLog) {
+				Log::Info(L"BuildTLASCommand() Partition: %d Refit: %d RefitsSinceRebuild: %d", (uint32_t)partition, doRefit, stats.m_numRefitsSinceRebuild);
+			}
 		}
 
+		// GPU time of the build can't be measured since the command list is executed by the application, so uploaded descs and the TLAS size are reported with the CPU time.
+		stats.m_numUploadedInstanceDescs = 0;
+		for (auto&& r : uploadRanges)
+			stats.m_numUploadedInstanceDescs += r.second - r.first;
+		stats.m_lastBuildCPUTimeInMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+		stats.m_totalBuildCPUTimeInMs += stats.m_lastBuildCPUTimeInMs;
+
 		return Status::OK;
 	}
 
@@ -2082,14 +2296,16 @@ namespace KickstartRT_NativeLayer
 			}
 
 			{
-				// First entry is for TLAS
-				if (!destDescTable->SetSrv(&pws->m_device, 0, 0, m_TLASBufferSrv.get())) {
-					Log::Fatal(L"Failed to set Srv");
-					return Status::ERROR_INTERNAL;
+				// First two entries are for the static and the dynamic TLAS
+				for (uint32_t i = 0; i < kNumTLASPartitions; ++i) {
+					if (!destDescTable->SetSrv(&pws->m_device, i, 0, m_TLASPartitions[i].m_bufferSrv.get())) {
+						Log::Fatal(L"Failed to set Srv");
+						return Status::ERROR_INTERNAL;
+					}
 				}
 
-				// Second one is for direct lighting cache indirection table.
-				if (!destDescTable->SetUav(&pws->m_device, 1, 0, m_directLightingCacheIndirectionTableBufferUAV.get())) {
+				// Third one is for direct lighting cache indirection table.
+				if (!destDescTable->SetUav(&pws->m_device, 2, 0, m_directLightingCacheIndirectionTableBufferUAV.get())) {
 					Log::Fatal(L"Failed to set Uav");
 					return Status::ERROR_INTERNAL;
 				}
@@ -2098,17 +2314,17 @@ namespace KickstartRT_NativeLayer
 				// Copy CPU -> GPU visible.
 				// 1st entry is reserved for zero view.
 				uint32_t tableIndex = 0;
-				if (!destDescTable->SetUav(&pws->m_device, 2, tableIndex++, pws->m_zeroBufferUAV.get())) {
+				if (!destDescTable->SetUav(&pws->m_device, 3, tableIndex++, pws->m_zeroBufferUAV.get())) {
 					Log::Fatal(L"Failed to set UAV");
 					return Status::ERROR_INTERNAL;
 				}
 				// 2nd entry is reserved for null view.
-				if (!destDescTable->SetUav(&pws->m_device, 2, tableIndex++, pws->m_nullBufferUAV.get())) {
+				if (!destDescTable->SetUav(&pws->m_device, 3, tableIndex++, pws->m_nullBufferUAV.get())) {
 					Log::Fatal(L"Failed to set UAV");
 					return Status::ERROR_INTERNAL;
 				}
 				for (auto&& itr : m_directLightingCacheIndirectionTableSharedBlockEntries) {
-					if (!destDescTable->SetUav(&pws->m_device, 2, tableIndex++, itr->m_uav.get())) {
+					if (!destDescTable->SetUav(&pws->m_device, 3, tableIndex++, itr->m_uav.get())) {
 						Log::Fatal(L"Failed to set UAV");
 						return Status::ERROR_INTERNAL;
 					}
@@ -2117,10 +2333,11 @@ namespace KickstartRT_NativeLayer
 
 			// return valid isntance list.
 			{
-				std::deque<Instance*>		validIp(m_container.m_TLASInstanceList.size(), nullptr);
+				std::deque<Instance*>		validIp(m_container.NumberOfTLASInstances(), nullptr);
 				uint32_t instanceIdx = 0;
-				for (auto&& itr : m_container.m_TLASInstanceList) {
-					validIp[instanceIdx++] = Instance::ToPtr(itr);
+				for (auto&& list : m_container.m_TLASInstanceLists) {
+					for (auto&& itr : list.m_instances)
+						validIp[instanceIdx++] = Instance::ToPtr(itr);
 				}
 				std::swap(validIp, retInstances);
 			}
@@ -2129,7 +2346,7 @@ namespace KickstartRT_NativeLayer
 #else
 		{
 			// Check if the CPU desc heap has sufficient buffer size, then allocate it. 
-			uint32_t requestedSize = (uint32_t)m_container.m_TLASInstanceList.size() * 2;
+			uint32_t requestedSize = m_container.NumberOfTLASInstances() * 2;
 
 			if (requestedSize > m_cpuLightCacheDescs.m_allocatedDescTableSize) {
 				uint32_t allocationSize = requestedSize + 128;
@@ -2219,27 +2436,30 @@ namespace KickstartRT_NativeLayer
 		};
 
 		// update CPU desc table array
-		std::deque<Instance*>		validIp(m_container.m_TLASInstanceList.size(), nullptr);
+		std::deque<Instance*>		validIp(m_container.NumberOfTLASInstances(), nullptr);
 		uint32_t instanceIdx = 0;
 
-		for (auto&& itr : m_container.m_TLASInstanceList) {
-			auto* ip = Instance::ToPtr(itr);
-			auto* gp = ip->m_geometry;
+		// Static instances come first, same as InstanceIDs.
+		for (auto&& list : m_container.m_TLASInstanceLists) {
+			for (auto&& itr : list.m_instances) {
+				auto* ip = Instance::ToPtr(itr);
+				auto* gp = ip->m_geometry;
 
-			bool isUpdated = false;
-			if (UpdateCPUDescs(ip, gp, isUpdated) != Status::OK) {
-				Log::Fatal(L"Failed to update CPU desc heap for a instance.");
-				return Status::ERROR_INTERNAL;
-			}
+				bool isUpdated = false;
+				if (UpdateCPUDescs(ip, gp, isUpdated) != Status::OK) {
+					Log::Fatal(L"Failed to update CPU desc heap for a instance.");
+					return Status::ERROR_INTERNAL;
+				}
 
-			if (isUpdated || m_cpuLightCacheDescs.m_instanceList[instanceIdx] != itr) {
-				// copy CPU -> CPU desc array
-				m_cpuLightCacheDescs.m_descTable->Copy(&pws->m_device, 0, instanceIdx * 2, ip->m_cpuDescTableAllocation->m_table);
-				m_cpuLightCacheDescs.m_instanceList[instanceIdx] = itr;
-			}
-			validIp[instanceIdx] = ip;
+				if (isUpdated || m_cpuLightCacheDescs.m_instanceList[instanceIdx] != itr) {
+					// copy CPU -> CPU desc array
+					m_cpuLightCacheDescs.m_descTable->Copy(&pws->m_device, 0, instanceIdx * 2, ip->m_cpuDescTableAllocation->m_table);
+					m_cpuLightCacheDescs.m_instanceList[instanceIdx] = itr;
+				}
+				validIp[instanceIdx] = ip;
 
-			++instanceIdx;
+				++instanceIdx;
+			}
 		}
 
 		uint32_t descTableSize = (uint32_t)validIp.size() * 2;
@@ -2255,14 +2475,16 @@ namespace KickstartRT_NativeLayer
 		}
 
 		{
-			// first entry is for TLAS
-			if (!destDescTable->SetSrv(&pws->m_device, 0, 0, m_TLASBufferSrv.get())) {
-				Log::Fatal(L"Failed to set Srv");
-				return Status::ERROR_INTERNAL;
+			// first two entries are for the static and the dynamic TLAS
+			for (uint32_t i = 0; i < kNumTLASPartitions; ++i) {
+				if (!destDescTable->SetSrv(&pws->m_device, i, 0, m_TLASPartitions[i].m_bufferSrv.get())) {
+					Log::Fatal(L"Failed to set Srv");
+					return Status::ERROR_INTERNAL;
+				}
 			}
 
-			// second one is for tile Table. (obsoleted.)
-			if (!destDescTable->SetUav(&pws->m_device, 1, 0, pws->m_zeroBufferUAV.get())) {
+			// third one is for tile Table. (obsoleted.)
+			if (!destDescTable->SetUav(&pws->m_device, 2, 0, pws->m_zeroBufferUAV.get())) {
 				Log::Fatal(L"Failed to set Uav");
 				return Status::ERROR_INTERNAL;
 			}
@@ -2270,7 +2492,7 @@ namespace KickstartRT_NativeLayer
 			// the rest is for direct lighting cache. it's an array of (directLightingCacheIndex, directLightingCacheBuffer)
 			// Copy CPU -> GPU visible.
 			if (descTableSize > 0) {
-				if (!destDescTable->Copy(&pws->m_device, 2, 0, m_cpuLightCacheDescs.m_descTable.get(), descTableSize)) {
+				if (!destDescTable->Copy(&pws->m_device, 3, 0, m_cpuLightCacheDescs.m_descTable.get(), descTableSize)) {
 					Log::Fatal(L"Failed to Copy descriptors");
 					return Status::ERROR_INTERNAL;
 				}
@@ -2321,5 +2543,26 @@ namespace KickstartRT_NativeLayer
 
 		return Status::OK;
 	};
+
+	bool Scene::TLASIsReady() const
+	{
+		for (auto&& res : m_TLASPartitions) {
+			if (!res.m_bufferSrv)
+				return false;
+		}
+		return true;
+	}
+
+	Status Scene::GetTLASBuildStatistics(TLASBuildStatistics* retStatistics)
+	{
+		if (retStatistics == nullptr)
+			return Status::ERROR_INVALID_PARAM;
+
+		std::scoped_lock containerMutex(m_container.m_mutex);
+
+		*retStatistics = m_TLASBuildStatistics;
+
+		return Status::OK;
+	}
 };
 
@@ -37,6 +37,7 @@
 #include <unordered_map>
 #include <atomic>
 #include <optional>
+#include <array>
 
 namespace KickstartRT_NativeLayer
 {
@@ -48,9 +49,33 @@ namespace KickstartRT_NativeLayer
 		SceneContainer	m_container;
 
 		bool														m_TLASisDrity = false;
-		std::unique_ptr<GraphicsAPI::Buffer>						m_TLASScratchBuffer;
-		std::unique_ptr<GraphicsAPI::Buffer>						m_TLASBuffer;
-		std::unique_ptr<GraphicsAPI::ShaderResourceView>			m_TLASBufferSrv;
+
+#if defined(GRAPHICS_API_D3D12)
+		using TLASInstanceDesc = D3D12_RAYTRACING_INSTANCE_DESC;
+#elif defined(GRAPHICS_API_VK)
+		using TLASInstanceDesc = VkAccelerationStructureInstanceKHR;
+#endif
+		// Clean descs in a gap up to this number are uploaded with the neighboring dirty ones to reduce copy commands.
+		static constexpr uint32_t									m_TLASInstanceDescMergeGap = 16;
+
+		// The static and the dynamic TLAS are built separately, and shaders trace both of them.
+		struct TLASPartitionResources {
+			std::unique_ptr<GraphicsAPI::Buffer>					m_scratchBuffer;
+			std::unique_ptr<GraphicsAPI::Buffer>					m_buffer;
+			std::unique_ptr<GraphicsAPI::ShaderResourceView>		m_bufferSrv;
+
+			// Instance descs indexed by the TLAS instance list. Only dirty entries are rewritten and copied to the device buffer.
+			std::vector<TLASInstanceDesc>							m_instanceDescs;
+			std::unique_ptr<GraphicsAPI::Buffer>					m_instanceDescBuffer;
+
+			// TLAS can be refitted only when the last build allowed update and the instance set is unchanged since then.
+			bool													m_allowsUpdate = false;
+			uint32_t												m_builtInstanceCount = 0;
+		};
+		std::array<TLASPartitionResources, kNumTLASPartitions>		m_TLASPartitions;
+		TLASBuildStatistics											m_TLASBuildStatistics = {};
+
+		bool TLASIsReady() const;
 
 #if KICKSTARTRT_ENABLE_DIRECT_LIGHTING_CACHE_INDIRECTION_TABLE
 		std::unique_ptr<GraphicsAPI::Buffer>						m_directLightingCacheIndirectionTableBuffer;
@@ -78,6 +103,7 @@ namespace KickstartRT_NativeLayer
 		Status DoAllocationForAddedInstances(PersistentWorkingSet* pws, std::deque<BVHTask::Instance*>& addedInstancePtrs, bool& AllocationHappened);
 
 		Status DoReadbackAndCompactBLASBuffers(PersistentWorkingSet* pws, GraphicsAPI::CommandList* cmdList, bool& BLASChanged);
+		Status DefragmentSharedBuffers(PersistentWorkingSet* pws, GraphicsAPI::CommandList* cmdList, bool& relocated);
 
 		Status BuildTransformAndTileAllocationCommands(TaskWorkingSet* tws, GraphicsAPI::CommandList* cmdList,
 			std::deque<BVHTask::Geometry*>& addedGeometries,
@@ -87,7 +113,8 @@ namespace KickstartRT_NativeLayer
 			std::deque<BVHTask::Geometry*>& updatedGeometryPtrs,
 			uint32_t maxBlasBuildTasks, bool& BLASChanged);
 
-		Status BuildTLASCommands(TaskWorkingSet* tws, GraphicsAPI::CommandList* cmdList);
+		Status BuildTLASCommands(TaskWorkingSet* tws, GraphicsAPI::CommandList* cmdList, uint32_t maxTLASRefitCount);
+		Status BuildTLASPartitionCommands(TaskWorkingSet* tws, GraphicsAPI::CommandList* cmdList, TLASPartition partition, uint32_t maxTLASRefitCount);
 
 		Status BuildDirectLightingCacheDescriptorTable(TaskWorkingSet* tws, GraphicsAPI::DescriptorTableLayout* srcLayout, GraphicsAPI::DescriptorTable* destDescTable, std::deque<BVHTask::Instance*>& retInstances);
 
@@ -97,6 +124,7 @@ namespace KickstartRT_NativeLayer
 	public:
 		Status BuildTask(GPUTaskHandle *retHandle, TaskTracker *taskTracker, PersistentWorkingSet* pws, TaskContainer_impl* arg_taskContainer, UpdateFromExecuteContext *updateFromExc, const BuildGPUTaskInput *input);
 		Status ReleaseDeviceResourcesImmediately(TaskTracker* taskTracker, PersistentWorkingSet* pws, UpdateFromExecuteContext* updateFromExc);
+		Status GetTLASBuildStatistics(TLASBuildStatistics* retStatistics);
 	};
 };
 
@@ -31,8 +31,8 @@ namespace KickstartRT_NativeLayer
 		std::scoped_lock mtx(m_mutex);
 
 		// delete relationship between instance and geometry.
-		for (auto&& itr : m_instances) {
-			auto* iPtr = itr.second.get();
+		for (auto&& ins : m_instances) {
+			auto* iPtr = ins.get();
 			assert(iPtr != nullptr);
 			if (iPtr != nullptr) {
 				assert(iPtr->m_geometry != nullptr);
@@ -49,4 +49,195 @@ namespace KickstartRT_NativeLayer
 			dc->DeferredRelease(nullptr);
 		}
 	}
+
+	BVHTask::Geometry* SceneContainer::FindGeometry(GeometryHandle gh) const
+	{
+		BVHTask::Geometry* gp = BVHTask::Geometry::ToPtr(gh);
+		if (gp == nullptr || gp->m_containerIndex >= m_geometries.size() || m_geometries[gp->m_containerIndex].get() != gp)
+			return nullptr;
+		return gp;
+	}
+
+	BVHTask::Instance* SceneContainer::FindInstance(InstanceHandle ih) const
+	{
+		BVHTask::Instance* ip = BVHTask::Instance::ToPtr(ih);
+		if (ip == nullptr || ip->m_containerIndex >= m_instances.size() || m_instances[ip->m_containerIndex].get() != ip)
+			return nullptr;
+		return ip;
+	}
+
+	void SceneContainer::AddGeometry(BVHTask::GeometryPtr gp)
+	{
+		gp->m_containerIndex = (uint32_t)m_geometries.size();
+		m_geometries.push_back(std::move(gp));
+	}
+
+	void SceneContainer::AddInstance(BVHTask::InstancePtr ip)
+	{
+		ip->m_containerIndex = (uint32_t)m_instances.size();
+		m_instances.push_back(std::move(ip));
+	}
+
+	BVHTask::GeometryPtr SceneContainer::DetachGeometry(BVHTask::Geometry* gp)
+	{
+		const uint32_t index = gp->m_containerIndex;
+		assert(m_geometries[index].get() == gp);
+
+		BVHTask::GeometryPtr ret = std::move(m_geometries[index]);
+		if (index != m_geometries.size() - 1) {
+			m_geometries[index] = std::move(m_geometries.back());
+			m_geometries[index]->m_containerIndex = index;
+		}
+		m_geometries.pop_back();
+		ret->m_containerIndex = 0xFFFF'FFFF;
+
+		return ret;
+	}
+
+	BVHTask::InstancePtr SceneContainer::DetachInstance(BVHTask::Instance* ip)
+	{
+		const uint32_t index = ip->m_containerIndex;
+		assert(m_instances[index].get() == ip);
+
+		BVHTask::InstancePtr ret = std::move(m_instances[index]);
+		if (index != m_instances.size() - 1) {
+			m_instances[index] = std::move(m_instances.back());
+			m_instances[index]->m_containerIndex = index;
+		}
+		m_instances.pop_back();
+		ret->m_containerIndex = 0xFFFF'FFFF;
+
+		return ret;
+	}
+
+	void SceneContainer::AddToTLASPendingList(BVHTask::Instance* ip)
+	{
+		if (ip->m_isTLASPending || ip->m_TLASInstanceIndex != kInvalidTLASInstanceIndex)
+			return;
+
+		ip->m_isTLASPending = true;
+		m_TLASPendingInstances.push_back(ip->ToHandle());
+	}
+
+	void SceneContainer::AppendToTLASInstanceList(BVHTask::Instance* ip)
+	{
+		assert(ip->m_TLASInstanceIndex == kInvalidTLASInstanceIndex);
+
+		ip->m_TLASPartition = ip->m_input.isStatic ? TLASPartition::e_Static : TLASPartition::e_Dynamic;
+		auto& list = m_TLASInstanceLists[(size_t)ip->m_TLASPartition];
+
+		ip->m_TLASInstanceIndex = (uint32_t)list.m_instances.size();
+		list.m_instances.push_back(ip->ToHandle());
+		list.m_transforms.push_back(ip->m_input.transform);
+		list.m_instanceMasks.push_back(uint8_t(ip->m_input.instanceInclusionMask));
+		list.m_geometries.push_back(ip->m_geometry);
+		list.m_dynamicTileBuffers.push_back(ip->m_dynamicTileBuffer.get());
+		list.m_descIsDirty.push_back(0);
+		MarkTLASInstanceDescDirty(ip->m_TLASPartition, ip->m_TLASInstanceIndex);
+		list.m_topologyIsChanged = true;
+
+		// InstanceIDs of the dynamic instances are shifted by the number of static instances.
+		if (ip->m_TLASPartition == TLASPartition::e_Static)
+			m_TLASInstanceLists[(size_t)TLASPartition::e_Dynamic].m_allDescsAreDirty = true;
+	}
+
+	void SceneContainer::RemoveFromTLASInstanceList(BVHTask::Instance* ip)
+	{
+		ip->m_isTLASPending = false;
+		if (ip->m_TLASInstanceIndex == kInvalidTLASInstanceIndex)
+			return;
+
+		auto& list = m_TLASInstanceLists[(size_t)ip->m_TLASPartition];
+
+		// Move the last entry to the removed position so that only one desc needs to be rewritten.
+		const uint32_t index = ip->m_TLASInstanceIndex;
+		const uint32_t lastIndex = (uint32_t)list.m_instances.size() - 1;
+		if (index != lastIndex) {
+			InstanceHandle lastIh = list.m_instances[lastIndex];
+			list.m_instances[index] = lastIh;
+			list.m_transforms[index] = list.m_transforms[lastIndex];
+			list.m_instanceMasks[index] = list.m_instanceMasks[lastIndex];
+			list.m_geometries[index] = list.m_geometries[lastIndex];
+			list.m_dynamicTileBuffers[index] = list.m_dynamicTileBuffers[lastIndex];
+			BVHTask::Instance::ToPtr(lastIh)->m_TLASInstanceIndex = index;
+			MarkTLASInstanceDescDirty(ip->m_TLASPartition, index);
+		}
+		list.m_instances.pop_back();
+		list.m_transforms.pop_back();
+		list.m_instanceMasks.pop_back();
+		list.m_geometries.pop_back();
+		list.m_dynamicTileBuffers.pop_back();
+		list.m_descIsDirty.pop_back();
+		list.m_topologyIsChanged = true;
+
+		if (ip->m_TLASPartition == TLASPartition::e_Static)
+			m_TLASInstanceLists[(size_t)TLASPartition::e_Dynamic].m_allDescsAreDirty = true;
+
+		ip->m_TLASInstanceIndex = kInvalidTLASInstanceIndex;
+	}
+
+	void SceneContainer::MarkTLASInstanceDescDirty(TLASPartition partition, uint32_t index)
+	{
+		auto& list = m_TLASInstanceLists[(size_t)partition];
+		if (list.m_descIsDirty[index])
+			return;
+
+		list.m_descIsDirty[index] = 1;
+		list.m_dirtyIndices.push_back(index);
+	}
+
+	void SceneContainer::UpdateTLASInstanceTransform(BVHTask::Instance* ip)
+	{
+		if (ip->m_TLASInstanceIndex == kInvalidTLASInstanceIndex)
+			return;
+
+		auto& list = m_TLASInstanceLists[(size_t)ip->m_TLASPartition];
+		list.m_transforms[ip->m_TLASInstanceIndex] = ip->m_input.transform;
+		list.m_instanceMasks[ip->m_TLASInstanceIndex] = uint8_t(ip->m_input.instanceInclusionMask);
+		MarkTLASInstanceDescDirty(ip->m_TLASPartition, ip->m_TLASInstanceIndex);
+	}
+
+	void SceneContainer::UpdateTLASInstanceTileBuffer(BVHTask::Instance* ip)
+	{
+		if (ip->m_TLASInstanceIndex == kInvalidTLASInstanceIndex)
+			return;
+
+		auto& list = m_TLASInstanceLists[(size_t)ip->m_TLASPartition];
+		list.m_dynamicTileBuffers[ip->m_TLASInstanceIndex] = ip->m_dynamicTileBuffer.get();
+	}
+
+	void SceneContainer::MarkTLASInstanceDescsDirty(BVHTask::Geometry* gp)
+	{
+		for (auto&& ip : gp->m_instances) {
+			if (ip->m_TLASInstanceIndex != kInvalidTLASInstanceIndex) {
+				MarkTLASInstanceDescDirty(ip->m_TLASPartition, ip->m_TLASInstanceIndex);
+				m_TLASInstanceLists[(size_t)ip->m_TLASPartition].m_topologyIsChanged = true;
+			}
+		}
+	}
+
+	void SceneContainer::MarkTLASNeedsRefit(BVHTask::Geometry* gp)
+	{
+		for (auto&& ip : gp->m_instances) {
+			if (ip->m_TLASInstanceIndex != kInvalidTLASInstanceIndex)
+				m_TLASInstanceLists[(size_t)ip->m_TLASPartition].m_needsRefit = true;
+		}
+	}
+
+	uint32_t SceneContainer::NumberOfTLASInstances() const
+	{
+		uint32_t num = 0;
+		for (auto&& list : m_TLASInstanceLists)
+			num += (uint32_t)list.m_instances.size();
+		return num;
+	}
+
+	uint32_t SceneContainer::TLASInstanceID(const BVHTask::Instance* ip) const
+	{
+		if (ip->m_TLASInstanceIndex == kInvalidTLASInstanceIndex)
+			return kInvalidTLASInstanceIndex;
+		if (ip->m_TLASPartition == TLASPartition::e_Static)
+			return ip->m_TLASInstanceIndex;
+		return (uint32_t)m_TLASInstanceLists[(size_t)TLASPartition::e_Static].m_instances.size() + ip->m_TLASInstanceIndex;
+	}
 };
\ No newline at end of file
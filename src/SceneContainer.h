@@ -26,8 +26,9 @@
 
 #include <memory>
 #include <deque>
-#include <unordered_map>
 #include <list>
+#include <vector>
+#include <array>
 #include <mutex>
 
 namespace KickstartRT_NativeLayer
@@ -38,12 +39,12 @@ namespace KickstartRT_NativeLayer
 		// mutex for all operations.
 		std::mutex		m_mutex;
 
-		// all registered geometry, not removed yet, should be in this map.
-		std::unordered_map<GeometryHandle, std::unique_ptr<BVHTask::Geometry>>		m_geometries;
+		// all registered geometry, not removed yet, should be in this list. Geometry::m_containerIndex is the position in it.
+		std::vector<BVHTask::GeometryPtr>				m_geometries;
 		// Removed geometries that are hidden from external APIs, but still alive. Once it's m_refCount become '0'. Geometry is moved to ready to destruct.
-		std::unordered_map<GeometryHandle, std::unique_ptr<BVHTask::Geometry>>		m_removedGeometries;
+		std::list<BVHTask::GeometryPtr>					m_removedGeometries;
 		// This list is cleared every frame after actual destruction process.
-		std::list<std::unique_ptr<BVHTask::Geometry>>						m_readyToDestructGeometries;
+		std::list<BVHTask::GeometryPtr>					m_readyToDestructGeometries;
 
 		// This list acts as a task queue for building BVH. Mostry comming from added geometries.
 		std::deque<GeometryHandle>							m_buildBVHQueue;
@@ -54,14 +55,39 @@ namespace KickstartRT_NativeLayer
 		// This lists geometries after building BVH and before compaction due to readback latency.
 		std::deque<std::pair<uint64_t, GeometryHandle>>		m_waitingForBVHCompactionGeometries;
 
-		// all registered instances, not removed yet, should be in this map.
-		std::unordered_map<InstanceHandle, std::unique_ptr<BVHTask::Instance>>		m_instances;
+		// all registered instances, not removed yet, should be in this list. Instance::m_containerIndex is the position in it.
+		std::vector<BVHTask::InstancePtr>				m_instances;
 
-		// Valid instance list for TLAS and desctable. Updated during TLAS build process, and referred during desc table update.
-		std::list<InstanceHandle>								m_TLASInstanceList;
+		struct TLASInstanceList {
+			// Valid instance list for TLAS and desctable. Updated during TLAS build process, and referred during desc table update.
+			// A removed entry is filled with the last one to keep the other positions.
+			std::vector<InstanceHandle>		m_instances;
+
+			// Hot fields of the listed instances read by TLAS build and DLC indirection table update, packed in the same order as m_instances.
+			// Being on the list means the instance is participating in TLAS. Instances hold the cold state.
+			std::vector<Math::Float_3x4>					m_transforms;
+			std::vector<uint8_t>							m_instanceMasks;
+			std::vector<BVHTask::Geometry*>				m_geometries;
+			std::vector<SharedBuffer::BufferEntry*>		m_dynamicTileBuffers;
+
+			// Dirty flags for each entry of the list, and the indices marked as dirty since the last TLAS build.
+			std::vector<uint8_t>			m_descIsDirty;
+			std::vector<uint32_t>			m_dirtyIndices;
+			bool							m_allDescsAreDirty = false;
+			// Set when an instance is added to or removed from the list, or a BLAS referenced from the list is replaced, which prevents TLAS refit.
+			bool							m_topologyIsChanged = false;
+			// Set when a BLAS referenced from the list is updated in place, which needs the TLAS to be refitted.
+			bool							m_needsRefit = false;
+		};
+
+		// Instances are split into the static and the dynamic TLAS. InstanceID is the position in the static list followed by the dynamic list.
+		std::array<TLASInstanceList, kNumTLASPartitions>			m_TLASInstanceLists;
+
+		// Registered instances participating in TLAS but not on the TLAS instance list yet, mostly waiting for their BLAS.
+		std::deque<InstanceHandle>								m_TLASPendingInstances;
 
 		// This list is cleared every frame after actual destruction process.
-		std::list<std::unique_ptr<BVHTask::Instance>>			m_readyToDestructInstances;
+		std::list<BVHTask::InstancePtr>					m_readyToDestructInstances;
 
 		// need to update direct lighting cache, requested from referencing geometry. This list is created/deleted every frame during BVH build process.
 		std::deque<InstanceHandle>						m_needToUpdateDirectLightingCache;
@@ -69,8 +95,26 @@ namespace KickstartRT_NativeLayer
 		// All the currently alive denoising contexts.
 		std::deque<std::unique_ptr<DenoisingContext> > m_denoisingContexts;
 
-		using GeomMapIterator = typename std::unordered_map<GeometryHandle, std::unique_ptr<BVHTask::Geometry>>::iterator;
-		using InsMapIterator = typename std::unordered_map<InstanceHandle, std::unique_ptr<BVHTask::Instance>>::iterator;
+		// Return nullptr if the handle is stale or not in this container.
+		BVHTask::Geometry* FindGeometry(GeometryHandle gh) const;
+		BVHTask::Instance* FindInstance(InstanceHandle ih) const;
+		void AddGeometry(BVHTask::GeometryPtr gp);
+		void AddInstance(BVHTask::InstancePtr ip);
+		// Remove from the list by moving the last entry to its position, and return the ownership.
+		BVHTask::GeometryPtr DetachGeometry(BVHTask::Geometry* gp);
+		BVHTask::InstancePtr DetachInstance(BVHTask::Instance* ip);
+
+		void AddToTLASPendingList(BVHTask::Instance* ip);
+		void AppendToTLASInstanceList(BVHTask::Instance* ip);
+		void RemoveFromTLASInstanceList(BVHTask::Instance* ip);
+		void MarkTLASInstanceDescDirty(TLASPartition partition, uint32_t index);
+		// Copy the hot fields of an instance on the TLAS instance list after they are changed.
+		void UpdateTLASInstanceTransform(BVHTask::Instance* ip);
+		void UpdateTLASInstanceTileBuffer(BVHTask::Instance* ip);
+		void MarkTLASInstanceDescsDirty(BVHTask::Geometry* gp);
+		void MarkTLASNeedsRefit(BVHTask::Geometry* gp);
+		uint32_t NumberOfTLASInstances() const;
+		uint32_t TLASInstanceID(const BVHTask::Instance* ip) const;
 
 		~SceneContainer();
 	};
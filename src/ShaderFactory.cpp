@@ -29,6 +29,8 @@
 #include "Utils.h"
 
 #include <iostream>
+#include <chrono>
+#include <cwchar>
 
 namespace KickstartRT::ShaderFactory {
     namespace FS = KickstartRT::VirtualFS;
@@ -36,6 +38,46 @@ namespace KickstartRT::ShaderFactory {
     namespace Log = KickstartRT_NativeLayer::Log;
     using namespace KickstartRT_NativeLayer::BVHTask;
 
+    namespace {
+        // Header of a pipeline cache file. The serialized cache data follows it.
+        struct PipelineCacheFileHeader {
+            static constexpr uint32_t   m_magicNumber = 0x4350524B; // "KRPC"
+
+            uint32_t    m_magic = m_magicNumber;
+            uint32_t    m_sdkVersion[3] = {};
+            KickstartRT_NativeLayer::GraphicsAPI::PipelineCache::DeviceIdentifier  m_deviceIdentifier;
+            uint64_t    m_dataSizeInBytes = 0;
+            uint32_t    m_dataCRC = 0;
+
+            bool Init(KickstartRT_NativeLayer::GraphicsAPI::Device* dev)
+            {
+                Version v;
+                m_sdkVersion[0] = v.Major;
+                m_sdkVersion[1] = v.Minor;
+                m_sdkVersion[2] = v.Patch;
+                return KickstartRT_NativeLayer::GraphicsAPI::PipelineCache::GetDeviceIdentifier(dev, &m_deviceIdentifier);
+            }
+
+            bool IsCompatible(const PipelineCacheFileHeader& h) const
+            {
+                return
+                    m_magic == h.m_magic &&
+                    memcmp(m_sdkVersion, h.m_sdkVersion, sizeof(m_sdkVersion)) == 0 &&
+                    m_deviceIdentifier.m_vendorID == h.m_deviceIdentifier.m_vendorID &&
+                    m_deviceIdentifier.m_deviceID == h.m_deviceIdentifier.m_deviceID &&
+                    m_deviceIdentifier.m_driverVersion == h.m_deviceIdentifier.m_driverVersion &&
+                    m_deviceIdentifier.m_uuid == h.m_deviceIdentifier.m_uuid;
+            }
+
+            static uint32_t CalcDataCRC(const void* data, size_t size)
+            {
+                CRC::CrcHash hasher;
+                hasher.AddBytes((const char*)data, size);
+                return hasher.Get();
+            }
+        };
+    };
+
     Factory::Factory(
         std::shared_ptr<FS::IFileSystem> fs,
         const std::filesystem::path& basePath,
@@ -59,13 +101,244 @@ namespace KickstartRT::ShaderFactory {
         }
     }
 
+    Factory::~Factory()
+    {
+        StopWarmUp();
+    }
+
     void Factory::ClearCache()
     {
+        std::scoped_lock lock(m_bytecodeCacheMutex);
         m_BytecodeCache.clear();
     }
 
+    Status Factory::InitPipelineCache(KickstartRT_NativeLayer::GraphicsAPI::Device* dev, std::shared_ptr<FS::IFileSystem> fs, const std::filesystem::path& path)
+    {
+        namespace GraphicsAPI = KickstartRT_NativeLayer::GraphicsAPI;
+
+        PipelineCacheFileHeader expected;
+        if (!expected.Init(dev)) {
+            Log::Warning(L"Pipeline cache is disabled since the device couldn't be identified.");
+            return Status::OK;
+        }
+
+        const void* data = nullptr;
+        size_t dataSize = 0;
+        std::shared_ptr<Blob::IBlob> blob;
+        if (fs->fileExists(path))
+            blob = fs->readFile(path);
+
+        if (blob && blob->size() >= sizeof(PipelineCacheFileHeader)) {
+            PipelineCacheFileHeader header;
+            memcpy(&header, blob->data(), sizeof(header));
+            const uint8_t* payload = reinterpret_cast<const uint8_t*>(blob->data()) + sizeof(header);
+
+            if (expected.IsCompatible(header) &&
+                header.m_dataSizeInBytes == blob->size() - sizeof(header) &&
+                header.m_dataCRC == PipelineCacheFileHeader::CalcDataCRC(payload, (size_t)header.m_dataSizeInBytes)) {
+                data = payload;
+                dataSize = (size_t)header.m_dataSizeInBytes;
+            }
+            else {
+                Log::Info(L"Pipeline cache file doesn't match the SDK, device or driver. It will be rebuilt: %s", path.generic_string<wchar_t>().c_str());
+            }
+        }
+
+        auto cache = std::make_unique<GraphicsAPI::PipelineCache>();
+        if (!cache->Init(dev, data, dataSize)) {
+            Log::Warning(L"Failed to create a pipeline cache. PSOs will be created without it.");
+            return Status::OK;
+        }
+
+        m_pipelineCache = std::move(cache);
+        m_pipelineCacheFS = fs;
+        m_pipelineCachePath = path;
+
+        return Status::OK;
+    }
+
+    Status Factory::SavePipelineCache(KickstartRT_NativeLayer::GraphicsAPI::Device* dev)
+    {
+        ReportPSOCreationTimes();
+
+        if (!m_pipelineCache)
+            return Status::OK;
+
+        std::vector<uint8_t> data;
+        if (m_pipelineCache->m_needsRebuild) {
+            // an empty payload makes the next run start with an empty cache.
+            Log::Info(L"Pipeline cache has stale entries. Discarding it: %s", m_pipelineCachePath.generic_string<wchar_t>().c_str());
+        }
+        else if (!m_pipelineCache->GetData(&data)) {
+            return Status::ERROR_INTERNAL;
+        }
+
+        PipelineCacheFileHeader header;
+        if (!header.Init(dev))
+            return Status::ERROR_INTERNAL;
+        header.m_dataSizeInBytes = data.size();
+        header.m_dataCRC = PipelineCacheFileHeader::CalcDataCRC(data.data(), data.size());
+
+        std::vector<uint8_t> file(sizeof(header) + data.size());
+        memcpy(file.data(), &header, sizeof(header));
+        memcpy(file.data() + sizeof(header), data.data(), data.size());
+
+        if (!m_pipelineCacheFS->writeFile(m_pipelineCachePath, file.data(), file.size())) {
+            Log::Warning(L"Failed to write the pipeline cache file: %s", m_pipelineCachePath.generic_string<wchar_t>().c_str());
+            return Status::ERROR_INTERNAL;
+        }
+
+        return Status::OK;
+    }
+
+    KickstartRT_NativeLayer::GraphicsAPI::PipelineCache* Factory::GetPipelineCache() const
+    {
+        return m_pipelineCache.get();
+    }
+
+    void Factory::AddPSOCreationTime(std::optional<bool> cacheHit, double timeInMs)
+    {
+        std::scoped_lock lock(m_psoCreationStatsMutex);
+        auto& stats(m_psoCreationStats[cacheHit.has_value() ? (*cacheHit ? 1 : 0) : 2]);
+        stats.m_count++;
+        stats.m_totalTimeInMs += timeInMs;
+    }
+
+    void Factory::ReportPSOCreationTimes()
+    {
+        std::unique_lock lock(m_psoCreationStatsMutex);
+        const auto cold(m_psoCreationStats[0]);
+        const auto warm(m_psoCreationStats[1]);
+        const auto unknown(m_psoCreationStats[2]);
+        lock.unlock();
+
+        if (unknown.m_count > 0) {
+            Log::Info(L"PSO creation: %u with the pipeline cache in %.2f ms (avg %.2f ms). Cache hits are not reported by the API.",
+                unknown.m_count, unknown.m_totalTimeInMs, unknown.m_totalTimeInMs / unknown.m_count);
+        }
+
+        if (cold.m_count + warm.m_count == 0)
+            return;
+
+        Log::Info(L"PSO creation: %u compiled in %.2f ms (avg %.2f ms), %u from the pipeline cache in %.2f ms (avg %.2f ms).",
+            cold.m_count, cold.m_totalTimeInMs, cold.m_count > 0 ? cold.m_totalTimeInMs / cold.m_count : 0.0,
+            warm.m_count, warm.m_totalTimeInMs, warm.m_count > 0 ? warm.m_totalTimeInMs / warm.m_count : 0.0);
+    }
+
+    Status Factory::WarmUpShaders(KickstartRT_NativeLayer::PersistentWorkingSet* pws, const uint32_t* shaderList, size_t listSize, uint32_t numThreads, bool skipPendingShaders)
+    {
+        // The first 3 entries hold the library version as same as the cold load list.
+        constexpr size_t headerSize = 3;
+
+        m_skipPendingShaders = skipPendingShaders;
+
+        std::unique_lock lock(m_warmUpMutex);
+
+        for (size_t i = headerSize; i < listSize; ++i) {
+            auto itr = m_shaderDict.find(shaderList[i]);
+            if (itr == m_shaderDict.end())
+                continue;
+
+            // Shader tables create device resources through the persistent working set, so they are created on first use.
+            ShaderDictEntry* ent = itr->second.get();
+            if (ent->m_type != ShaderType::Enum::SHADER_COMPUTE || ent->m_warmUpPending)
+                continue;
+            {
+                std::scoped_lock entLock(ent->m_createMutex);
+                if (ent->Loaded())
+                    continue;
+                ent->m_warmUpPending = true;
+            }
+            m_warmUpQueue.push_back(ent);
+        }
+
+        if (m_warmUpThreads.empty() && !m_warmUpQueue.empty()) {
+            if (numThreads == 0) {
+                uint32_t hwThreads = std::thread::hardware_concurrency();
+                numThreads = hwThreads > 1 ? hwThreads - 1 : 1;
+            }
+            m_warmUpExit = false;
+            for (uint32_t i = 0; i < numThreads; ++i)
+                m_warmUpThreads.emplace_back(&Factory::WarmUpThreadProc, this, pws);
+        }
+
+        lock.unlock();
+        m_warmUpCV.notify_all();
+
+        return Status::OK;
+    }
+
+    void Factory::WarmUpThreadProc(KickstartRT_NativeLayer::PersistentWorkingSet* pws)
+    {
+        for (;;) {
+            ShaderDictEntry* ent = nullptr;
+            {
+                std::unique_lock lock(m_warmUpMutex);
+                m_warmUpCV.wait(lock, [this]() { return m_warmUpExit || !m_warmUpQueue.empty(); });
+                if (m_warmUpQueue.empty())
+                    return;
+
+                ent = m_warmUpQueue.front();
+                m_warmUpQueue.pop_front();
+                ++m_warmUpInFlight;
+            }
+
+            {
+                std::scoped_lock entLock(ent->m_createMutex);
+                if (!ent->Loaded()) {
+                    auto startTime = std::chrono::steady_clock::now();
+                    if (ent->CreateShaderObject(pws) == Status::OK) {
+                        double timeInMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+                        Log::Info(L"Warmed up PSO %s (%08X) in %.2f ms.", ent->m_shaderName.c_str(), ent->m_id_CRC.value_or(0), timeInMs);
+                    }
+                    else {
+                        Log::Warning(L"Failed to warm up PSO: %s", ent->m_fileName.c_str());
+                    }
+                }
+                ent->m_warmUpPending = false;
+            }
+
+            {
+                std::scoped_lock lock(m_warmUpMutex);
+                --m_warmUpInFlight;
+            }
+            m_warmUpCV.notify_all();
+        }
+    }
+
+    Status Factory::WaitForWarmUp()
+    {
+        std::unique_lock lock(m_warmUpMutex);
+        m_warmUpCV.wait(lock, [this]() { return m_warmUpQueue.empty() && m_warmUpInFlight == 0; });
+
+        return Status::OK;
+    }
+
+    void Factory::StopWarmUp()
+    {
+        {
+            std::scoped_lock lock(m_warmUpMutex);
+            for (auto&& ent : m_warmUpQueue)
+                ent->m_warmUpPending = false;
+            m_warmUpQueue.clear();
+            m_warmUpExit = true;
+        }
+        m_warmUpCV.notify_all();
+
+        for (auto&& t : m_warmUpThreads)
+            t.join();
+        m_warmUpThreads.clear();
+    }
+
+    bool Factory::SkipPendingShaders() const
+    {
+        return m_skipPendingShaders;
+    }
+
     std::shared_ptr<Blob::IBlob> Factory::GetBytecode(const wchar_t* fileName, const wchar_t* entryName)
     {
+        std::scoped_lock lock(m_bytecodeCacheMutex);
+
         if (!entryName)
             entryName = L"main";
 
@@ -212,7 +485,7 @@ namespace KickstartRT::ShaderFactory {
         }
 
         for (auto&& itr : m_shaderDict) {
-            if (!itr.second->Loaded())
+            if (itr.second->WarmUpPending() || !itr.second->Loaded())
                 continue;
             loadedListBuffer[writtenElementCnt++] = itr.first;
             if (writtenElementCnt == bufferSize)
@@ -234,6 +507,7 @@ namespace KickstartRT::ShaderFactory {
 
             if (itr->second->m_type == ShaderFactory::ShaderType::Enum::SHADER_COMPUTE ||
                 itr->second->m_type == ShaderFactory::ShaderType::Enum::SHADER_RAY_GENERATION) {
+                std::scoped_lock entLock(itr->second->m_createMutex);
                 auto sts = itr->second->CreateShaderObject(pws);
                 if (sts != Status::OK) {
                     Log::Fatal(L"Failed to create shader object: %s", itr->second->m_fileName.c_str());
@@ -268,6 +542,11 @@ namespace KickstartRT::ShaderFactory {
         return false;
     };
 
+    bool ShaderDictEntry::WarmUpPending() const
+    {
+        return m_warmUpPending;
+    }
+
     Status ShaderDictEntry::CreateShaderObject(KickstartRT_NativeLayer::PersistentWorkingSet* pws)
     {
         namespace Native = KickstartRT_NativeLayer;
@@ -289,12 +568,15 @@ namespace KickstartRT::ShaderFactory {
             Native::GraphicsAPI::ComputeShader cs;
             cs.Init(((const char*)byteCode.get()->data()) + m_offset, m_size);
 
+            auto startTime = std::chrono::steady_clock::now();
+            std::optional<bool> cacheHit;
             m_cs_pso = std::make_unique<Native::GraphicsAPI::ComputePipelineState>();
-            if (! m_cs_pso->Init(&pws->m_device, m_rootSig, &cs)) {
+            if (! m_cs_pso->Init(&pws->m_device, m_rootSig, &cs, factory->GetPipelineCache(), &cacheHit)) {
                 m_cs_pso.reset();
                 Log::Fatal(L"Failed to create PSO: %s", m_fileName.c_str());
                 return Status::ERROR_INTERNAL;
             }
+            factory->AddPSOCreationTime(cacheHit, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
             if (m_shaderName.length() > 0)
                 m_cs_pso->SetName(Native::DebugName(m_shaderName.c_str()));
 
@@ -308,11 +590,20 @@ namespace KickstartRT::ShaderFactory {
             }
             std::shared_ptr<Blob::IBlob> libBlob = std::make_shared<Blob::SubBlob>(byteCode, m_offset, m_size);
 
+            // D3D12 pipeline libraries don't store state objects, so only VK rtPSOs use the pipeline cache.
+            auto startTime = std::chrono::steady_clock::now();
+#if defined(GRAPHICS_API_VK)
+            // VkPipelineCache doesn't tell whether a pipeline was found in it.
+            std::optional<bool> cacheHit = factory->GetPipelineCache() != nullptr ? std::nullopt : std::optional<bool>(false);
+#else
+            std::optional<bool> cacheHit = false;
+#endif
             m_shaderTableRT = Native::ShaderTableRT::Init(pws, m_rootSig, libBlob);
             if (! m_shaderTableRT) {
                 Log::Fatal(L"Failed to create rtPSO");
                 return Status::ERROR_INTERNAL;
             }
+            factory->AddPSOCreationTime(cacheHit, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
             if (m_shaderName.length() > 0)
                 m_shaderTableRT->m_rtPSO->SetName(m_shaderName);
 
@@ -324,6 +615,9 @@ namespace KickstartRT::ShaderFactory {
 
     KickstartRT_NativeLayer::GraphicsAPI::ComputePipelineState* ShaderDictEntry::GetCSPSO(KickstartRT_NativeLayer::PersistentWorkingSet* pws)
     {
+        // waits for a warm-up worker creating this entry.
+        std::scoped_lock lock(m_createMutex);
+
         if (!m_cs_pso) {
             auto sts = CreateShaderObject(pws);
             if (sts != Status::OK) {
@@ -336,6 +630,8 @@ namespace KickstartRT::ShaderFactory {
 
     KickstartRT_NativeLayer::ShaderTableRT* ShaderDictEntry::GetShaderTableRT(KickstartRT_NativeLayer::PersistentWorkingSet* pws, KickstartRT_NativeLayer::GraphicsAPI::CommandList *cmdList)
     {
+        std::scoped_lock lock(m_createMutex);
+
         if (!m_shaderTableRT) {
             auto sts = CreateShaderObject(pws);
             if (sts != Status::OK) {
@@ -28,12 +28,20 @@
 #include <memory>
 #include <filesystem>
 #include <optional>
+#include <array>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 namespace KickstartRT_NativeLayer
 {
     namespace GraphicsAPI {
+        struct Device;
         struct RootSignature;
         struct ComputePipelineState;
+        struct PipelineCache;
         struct CommandList;
     };
     class PersistentWorkingSet;
@@ -103,8 +111,16 @@ namespace KickstartRT::ShaderFactory
         std::unique_ptr<KickstartRT_NativeLayer::GraphicsAPI::ComputePipelineState> m_cs_pso;
         std::unique_ptr<KickstartRT_NativeLayer::ShaderTableRT> m_shaderTableRT;
 
+        // Held while the shader object is created, so users of the entry wait for a warm-up worker.
+        std::mutex          m_createMutex;
+        std::atomic<bool>   m_warmUpPending{ false };
+
+        friend class Factory;
+
     public:
         Status CreateShaderObject(KickstartRT_NativeLayer::PersistentWorkingSet* pws);
+        // True while the entry is queued or being created by a warm-up worker.
+        bool WarmUpPending() const;
         KickstartRT_NativeLayer::GraphicsAPI::ComputePipelineState *GetCSPSO(KickstartRT_NativeLayer::PersistentWorkingSet* pws);
         KickstartRT_NativeLayer::ShaderTableRT *GetShaderTableRT(KickstartRT_NativeLayer::PersistentWorkingSet* pws, KickstartRT_NativeLayer::GraphicsAPI::CommandList *cmdList);
         uint32_t CalcCRC();
@@ -124,6 +140,30 @@ namespace KickstartRT::ShaderFactory
         std::shared_ptr<VirtualFS::IFileSystem> m_fs;
         std::filesystem::path m_basePath;
 
+        std::unique_ptr<KickstartRT_NativeLayer::GraphicsAPI::PipelineCache>   m_pipelineCache;
+        std::shared_ptr<VirtualFS::IFileSystem> m_pipelineCacheFS;
+        std::filesystem::path m_pipelineCachePath;
+
+        // PSO creation timings, [0]: compiled (cold), [1]: found in the pipeline cache (warm), [2]: created with a cache which doesn't report hits (VK).
+        struct PSOCreationStats {
+            uint32_t    m_count = 0;
+            double      m_totalTimeInMs = 0.0;
+        };
+        std::array<PSOCreationStats, 3> m_psoCreationStats;
+        std::mutex                      m_psoCreationStatsMutex;
+        std::mutex                      m_bytecodeCacheMutex;
+
+        // Worker threads creating compute PSOs in advance of use.
+        std::vector<std::thread>        m_warmUpThreads;
+        std::deque<ShaderDictEntry*>    m_warmUpQueue;
+        std::mutex                      m_warmUpMutex;
+        std::condition_variable         m_warmUpCV;
+        uint32_t                        m_warmUpInFlight = 0;
+        bool                            m_warmUpExit = false;
+        std::atomic<bool>               m_skipPendingShaders{ false };
+
+        void WarmUpThreadProc(KickstartRT_NativeLayer::PersistentWorkingSet* pws);
+
         std::optional<std::pair<size_t, size_t>> FindShaderPermutationOffset(std::shared_ptr<ShaderBlob::IBlob>& blob, const ShaderDesc& d, std::optional<uint32_t> shaderMacroCRC, bool errorIfNotFound = true);
         std::shared_ptr<ShaderBlob::IBlob> FindShaderPermutation(std::shared_ptr<ShaderBlob::IBlob>& blob, const ShaderDesc& d, const ShaderBlob::ShaderConstant* constants, uint32_t numConstants, bool errorIfNotFound = true);
 
@@ -132,8 +172,23 @@ namespace KickstartRT::ShaderFactory
             std::shared_ptr<VirtualFS::IFileSystem> fs,
             const std::filesystem::path& basePath,
             const uint32_t * const coldLoadShaderList, uint32_t coldLoadShaderListSize);
+        ~Factory();
         void ClearCache();
 
+        // The pipeline cache file is validated with the SDK version and the device/driver identifiers.
+        Status InitPipelineCache(KickstartRT_NativeLayer::GraphicsAPI::Device* dev, std::shared_ptr<VirtualFS::IFileSystem> fs, const std::filesystem::path& path);
+        Status SavePipelineCache(KickstartRT_NativeLayer::GraphicsAPI::Device* dev);
+        KickstartRT_NativeLayer::GraphicsAPI::PipelineCache* GetPipelineCache() const;
+        void AddPSOCreationTime(std::optional<bool> cacheHit, double timeInMs);
+        void ReportPSOCreationTimes();
+
+        // Queues compute PSOs of the listed shader IDs (cold load list format) to worker threads.
+        Status WarmUpShaders(KickstartRT_NativeLayer::PersistentWorkingSet* pws, const uint32_t* shaderList, size_t listSize, uint32_t numThreads, bool skipPendingShaders);
+        Status WaitForWarmUp();
+        // Drops queued entries, waits for in-flight ones and stops the workers.
+        void StopWarmUp();
+        bool SkipPendingShaders() const;
+
         static std::optional<uint32_t> GetShaderMacroCRC(const std::vector<ShaderMacro>* pDefines);
         std::pair<Status, ShaderDictEntry *> RegisterShader(std::unique_ptr<ShaderDictEntry> ent);
         Status GetLoadedShaderList(uint32_t *loadedListBuffer, size_t bufferSize, size_t *retListSize);
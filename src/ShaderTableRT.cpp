@@ -77,7 +77,7 @@ namespace KickstartRT_NativeLayer
 
 			// shader config.
 			D3D12_RAYTRACING_SHADER_CONFIG shCnfDesc{};
-			shCnfDesc.MaxPayloadSizeInBytes = sizeof(float) * 4;		// float3: color, float: hitT
+			shCnfDesc.MaxPayloadSizeInBytes = sizeof(float) * 5;		// float3: color, float: hitT, or the hit record of light injection
 			shCnfDesc.MaxAttributeSizeInBytes = sizeof(float) * 2;	// float2 barycentrics
 			AddSubobject(D3D12_STATE_SUBOBJECT_TYPE_RAYTRACING_SHADER_CONFIG, &shCnfDesc);
 
@@ -284,8 +284,11 @@ namespace KickstartRT_NativeLayer
 
 				rayPipelineInfo.layout = globalRootSig->m_apiData.m_pipelineLayout; // global root sig.
 
+				GraphicsAPI::PipelineCache* cache = pws->m_shaderFactory->GetPipelineCache();
+				VkPipelineCache pipelineCache = cache != nullptr ? cache->m_apiData.m_pipelineCache : VK_NULL_HANDLE;
+
 				// Create a deferred operation (compiling in parallel)
-				if (GraphicsAPI::VK::vkCreateRayTracingPipelinesKHR(pws->m_device.m_apiData.m_device, VK_NULL_HANDLE, VK_NULL_HANDLE, 1, &rayPipelineInfo, nullptr, &rtPSO->m_apiData.m_pipeline) != VK_SUCCESS) {
+				if (GraphicsAPI::VK::vkCreateRayTracingPipelinesKHR(pws->m_device.m_apiData.m_device, VK_NULL_HANDLE, pipelineCache, 1, &rayPipelineInfo, nullptr, &rtPSO->m_apiData.m_pipeline) != VK_SUCCESS) {
 					Log::Fatal(L"Faild to create shader module.");
 					return std::unique_ptr<ShaderTableRT>();
 				}
@@ -24,11 +24,134 @@
 #include <PersistentWorkingSet.h>
 
 #include <SharedBuffer.h>
+#include <RangeMerge.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
 
 namespace KickstartRT_NativeLayer
 {
 	using ClassifiedBufferEntry = ClassifiedDeviceObject<SharedBuffer::BufferEntry>;
 
+	// An entry placed in a BufferEntryPool. It goes back to the pool when it is deleted via a pointer to any base class.
+	struct PooledBufferEntry : public ClassifiedBufferEntry {
+		using ClassifiedBufferEntry::ClassifiedDeviceObject;
+
+		static void* operator new(size_t sizeInBytes, SharedBuffer::BufferEntryPool* pool)
+		{
+			return pool->Allocate(sizeInBytes);
+		}
+		static void operator delete(void* ptr, SharedBuffer::BufferEntryPool* /*pool*/)
+		{
+			SharedBuffer::BufferEntryPool::Release(ptr);
+		}
+		static void operator delete(void* ptr)
+		{
+			SharedBuffer::BufferEntryPool::Release(ptr);
+		}
+	};
+
+	void* SharedBuffer::BufferEntryPool::Allocate(size_t sizeInBytes)
+	{
+		if (m_slotSizeInBytes == 0)
+			m_slotSizeInBytes = m_headerSizeInBytes + GraphicsAPI::ALIGN(m_headerSizeInBytes, sizeInBytes);
+		assert(m_headerSizeInBytes + sizeInBytes <= m_slotSizeInBytes);
+
+		if (m_freeSlots.empty()) {
+			m_chunks.push_back(std::make_unique<uint8_t[]>(m_slotSizeInBytes * m_slotsPerChunk));
+			uint8_t* chunk = m_chunks.back().get();
+			for (size_t i = m_slotsPerChunk; i > 0; --i)
+				m_freeSlots.push_back(chunk + m_slotSizeInBytes * (i - 1));
+		}
+
+		uint8_t* slot = reinterpret_cast<uint8_t*>(m_freeSlots.back());
+		m_freeSlots.pop_back();
+		*reinterpret_cast<BufferEntryPool**>(slot) = this;
+
+		return slot + m_headerSizeInBytes;
+	}
+
+	void SharedBuffer::BufferEntryPool::Release(void* ptr)
+	{
+		uint8_t* slot = reinterpret_cast<uint8_t*>(ptr) - m_headerSizeInBytes;
+		BufferEntryPool* pool = *reinterpret_cast<BufferEntryPool**>(slot);
+		pool->m_freeSlots.push_back(slot);
+	}
+
+	bool SharedBuffer::AllocationTraceRecorder::Open(const std::wstring& filePath, uint64_t blockSizeInBytes, uint64_t alignmentSizeInBytes)
+	{
+		m_file.open(std::filesystem::path(filePath), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!m_file.is_open())
+			return false;
+
+		AllocationTrace::TraceHeader header = {};
+		memcpy(header.signature, AllocationTrace::kTraceSignature, AllocationTrace::kTraceSignatureSize);
+		header.version = AllocationTrace::kTraceVersion;
+		header.blockSizeInBytes = blockSizeInBytes;
+		header.alignmentSizeInBytes = alignmentSizeInBytes;
+		m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		return m_file.good();
+	}
+
+	void SharedBuffer::AllocationTraceRecorder::Write(AllocationTrace::EventType type, uint64_t id, uint64_t value)
+	{
+		AllocationTrace::TraceEvent ev = { (uint32_t)type, m_frameIndex, id, value };
+		m_file.write(reinterpret_cast<const char*>(&ev), sizeof(ev));
+	}
+
+	void SharedBuffer::AllocationTraceRecorder::RecordAlloc(const void* entry, uint64_t requestedSizeInBytes)
+	{
+		uint64_t id = m_nextID++;
+		m_entryIDs[entry] = id;
+		Write(AllocationTrace::EventType::Alloc, id, requestedSizeInBytes);
+	}
+
+	void SharedBuffer::AllocationTraceRecorder::RecordFree(const void* entry)
+	{
+		auto itr = m_entryIDs.find(entry);
+		if (itr == m_entryIDs.end())
+			return; // allocated before starting the trace.
+
+		Write(AllocationTrace::EventType::Free, itr->second, 0);
+		m_entryIDs.erase(itr);
+	}
+
+	void SharedBuffer::AllocationTraceRecorder::RecordCheckUnusedBlocks(uint64_t framesToRemove)
+	{
+		Write(AllocationTrace::EventType::CheckUnusedBlocks, 0, framesToRemove);
+		++m_frameIndex;
+	}
+
+	void SharedBuffer::AllocationTraceRecorder::RecordDefragment(uint64_t maxBytesToMove)
+	{
+		Write(AllocationTrace::EventType::Defragment, 0, maxBytesToMove);
+	}
+
+	Status SharedBuffer::BeginAllocationTrace(const std::wstring& filePath)
+	{
+		auto trace = std::make_unique<AllocationTraceRecorder>();
+		if (!trace->Open(filePath, m_blockSizeInBytes, m_pageSizeInBytes)) {
+			Log::Error(L"Failed to open an allocation trace file: %s", filePath.c_str());
+			return Status::ERROR_INVALID_PARAM;
+		}
+		m_trace = std::move(trace);
+
+		return Status::OK;
+	}
+
+	Status SharedBuffer::EndAllocationTrace()
+	{
+		if (!m_trace)
+			return Status::ERROR_INVALID_CALL_FOR_THE_CURRENT_PROCESSING_STAGE;
+
+		m_trace->m_file.close();
+		m_trace.reset();
+
+		return Status::OK;
+	}
+
 	Status SharedBuffer::Init(
 		GraphicsAPI::Device* dev,
 		uint64_t allocationAlignmentInBytes, bool useClear, bool useGPUPtr,
@@ -51,6 +174,7 @@ namespace KickstartRT_NativeLayer
 		m_useGPUPtr = useGPUPtr;
 		m_blockSizeInBytes = blockSizeInBytes;
 		m_alignmentSizeInBytes = allocationAlignmentInBytes;
+		m_pageSizeInBytes = allocationAlignmentInBytes;
 		m_formatSizeInByte = GraphicsAPI::Resource::GetFormatBytesPerBlock(m_format);
 
 		// both block and page sizes need to be power of two.
@@ -78,6 +202,13 @@ namespace KickstartRT_NativeLayer
 		return Status::OK;
 	}
 
+	void SharedBuffer::MergeClearRequests(std::deque<std::pair<uint64_t, uint64_t>>& requests, std::vector<std::pair<uint64_t, uint64_t>>& retRanges)
+	{
+		retRanges.assign(requests.begin(), requests.end());
+		requests.clear();
+		RangeMerge::SortAndMerge(retRanges);
+	}
+
 	Status SharedBuffer::DoClear(GraphicsAPI::Device* dev, GraphicsAPI::CommandList* cmdList, GraphicsAPI::IDescriptorHeap* currentGPUDescHeap)
 	{
 		(void)dev; (void)currentGPUDescHeap;
@@ -95,6 +226,9 @@ namespace KickstartRT_NativeLayer
 			if (bb->m_clearRequests.size() == 0)
 				continue;
 
+			// entries registered in a batch are often next to each other, so they are cleared as a few ranges.
+			MergeClearRequests(bb->m_clearRequests, m_mergedClearRanges);
+
 #if defined(GRAPHICS_API_D3D12)
 			// gather clear rects.
 			// not fully verified but seems D3D12 takes the rects as let-top, right-bottom with an exclusive manner.
@@ -102,13 +236,12 @@ namespace KickstartRT_NativeLayer
 			// if you set to clear R32UINT buffer resource with 2,0,3,1, it clears 4 bytes with 8 bytes offset.
 			// if you set to clear RGBA32UINT buffer resource with 2,0,3,1, it clears 16 bytes with 32 bytes offset.
 			// it only uses the first element of the clear value for R32UINT view.
-			std::vector<D3D12_RECT>	clearRect(bb->m_clearRequests.size());
-			for (size_t i = 0; i < bb->m_clearRequests.size(); ++i) {
-				LONG left = (LONG)(bb->m_clearRequests[i].first / m_formatSizeInByte);
-				LONG right = (LONG)((bb->m_clearRequests[i].first + bb->m_clearRequests[i].second) / m_formatSizeInByte);
-				clearRect[i] = { left, 0, right, 1};
+			m_clearRects.resize(m_mergedClearRanges.size());
+			for (size_t i = 0; i < m_mergedClearRanges.size(); ++i) {
+				LONG left = (LONG)(m_mergedClearRanges[i].first / m_formatSizeInByte);
+				LONG right = (LONG)((m_mergedClearRanges[i].first + m_mergedClearRanges[i].second) / m_formatSizeInByte);
+				m_clearRects[i] = { left, 0, right, 1};
 			}
-			bb->m_clearRequests.clear();
 
 			UINT cv[4] = { 0, 0, 0, 0 };
 
@@ -127,8 +260,8 @@ namespace KickstartRT_NativeLayer
 				// NV driver was crashed with more than about 128 rects.
 				// Not sure how many rects can be processed at once in other IHVs.
 				size_t currentOfs = 0;
-				while (currentOfs < clearRect.size()) {
-					size_t numRects = currentOfs + 63 < clearRect.size() ? 63 : clearRect.size() - currentOfs;
+				while (currentOfs < m_clearRects.size()) {
+					size_t numRects = currentOfs + 63 < m_clearRects.size() ? 63 : m_clearRects.size() - currentOfs;
 
 					cmdList->m_apiData.m_commandList->ClearUnorderedAccessViewUint(
 						dt.m_apiData.m_heapAllocationInfo.m_hGPU,
@@ -136,12 +269,12 @@ namespace KickstartRT_NativeLayer
 						bb->m_buffer->m_apiData.m_resource,
 						cv,
 						(UINT)numRects,
-						clearRect.data() + currentOfs);
+						m_clearRects.data() + currentOfs);
 					currentOfs += numRects;
 				}
 			}
 #elif defined(GRAPHICS_API_VK)
-			for (auto&& cr : bb->m_clearRequests) {
+			for (auto&& cr : m_mergedClearRanges) {
 				vkCmdFillBuffer(
 					cmdList->m_apiData.m_commandBuffer,
 					bb->m_buffer->m_apiData.m_buffer,
@@ -149,7 +282,6 @@ namespace KickstartRT_NativeLayer
 					(VkDeviceSize)cr.second, // size in bytes.
 					0); // filldata.
 			}
-			bb->m_clearRequests.clear();
 #endif
 		}
 
@@ -220,6 +352,24 @@ namespace KickstartRT_NativeLayer
 			return Status::ERROR_INTERNAL;
 		}
 
+		if (m_persistentMapping) {
+			// blocks are always mapped. make GPU writes visible, and keep write requests until BatchUnmap() flushes them.
+			if (mapType != GraphicsAPI::Buffer::MapType::Read)
+				return Status::OK;
+
+			for (auto&& bbM : m_bufferBlocks) {
+				auto& bb(bbM.second);
+				if (!bb->m_batchMapRequest)
+					continue;
+
+				bb->m_buffer->InvalidateMappedRange(dev, bb->m_batchMapRangeBegin, bb->m_batchMapRangeEnd);
+				bb->m_batchMapRequest = false;
+				bb->m_batchMapRangeBegin = (uint64_t)-1;
+				bb->m_batchMapRangeEnd = 0;
+			}
+			return Status::OK;
+		}
+
 		for (auto&& bbM : m_bufferBlocks) {
 			auto& bb(bbM.second);
 			if (bb->m_mappedPtr != 0) {
@@ -236,6 +386,8 @@ namespace KickstartRT_NativeLayer
 
 			bb->m_mappedPtr = reinterpret_cast<intptr_t>(bb->m_buffer->Map(dev, mapType, 0, 0, readRangeEnd));
 			bb->m_batchMapRequest = false;
+			bb->m_batchMapRangeBegin = (uint64_t)-1;
+			bb->m_batchMapRangeEnd = 0;
 		}
 
 		return Status::OK;
@@ -246,6 +398,23 @@ namespace KickstartRT_NativeLayer
 		// ------------
 		// be carefull not to touch resources that are about to destruct.
 
+		if (m_persistentMapping) {
+			if (mapType == GraphicsAPI::Buffer::MapType::Read)
+				return Status::OK;
+
+			for (auto&& bbM : m_bufferBlocks) {
+				auto& bb(bbM.second);
+				if (!bb->m_batchMapRequest)
+					continue;
+
+				bb->m_buffer->FlushMappedRange(dev, bb->m_batchMapRangeBegin, bb->m_batchMapRangeEnd);
+				bb->m_batchMapRequest = false;
+				bb->m_batchMapRangeBegin = (uint64_t)-1;
+				bb->m_batchMapRangeEnd = 0;
+			}
+			return Status::OK;
+		}
+
 		for (auto&& bbM : m_bufferBlocks) {
 			auto& bb(bbM.second);
 			if (bb->m_mappedPtr == 0)
@@ -262,6 +431,22 @@ namespace KickstartRT_NativeLayer
 		return Status::OK;
 	}
 
+	Status SharedBuffer::EnablePersistentMapping()
+	{
+		if (m_cpuAccess == GraphicsAPI::Buffer::CpuAccess::None) {
+			Log::Fatal(L"Persistent mapping is only available for CPU accessible shared buffers.");
+			return Status::ERROR_INTERNAL;
+		}
+		if (!m_bufferBlocks.empty()) {
+			Log::Fatal(L"Persistent mapping has to be enabled before any allocation.");
+			return Status::ERROR_INTERNAL;
+		}
+
+		m_persistentMapping = true;
+
+		return Status::OK;
+	}
+
 	decltype(SharedBuffer::m_bufferBlocks)::iterator SharedBuffer::AddBufferBlock(PersistentWorkingSet* pws, size_t allocationSizeInBytes)
 	{
 		size_t elmSize = allocationSizeInBytes;
@@ -269,6 +454,13 @@ namespace KickstartRT_NativeLayer
 			elmSize /= m_formatSizeInByte;
 		}
 
+		if (m_budget != nullptr && m_budget->ExceedsHardLimit(allocationSizeInBytes)) {
+			// keep growing to not break the rendering, but make it visible.
+			++m_numBlocksOverHardLimit;
+			Log::Warning(L"Shared buffer (%s) exceeds the hard memory budget. Committed:%llu, Adding:%llu, Limit:%llu bytes.",
+				m_debugName.c_str(), (uint64_t)m_budget->m_committedBytes, (uint64_t)allocationSizeInBytes, (uint64_t)m_budget->m_hardLimitInBytes);
+		}
+
 		auto buf = pws->CreateBufferResource(elmSize, m_format, m_bindFlags, m_cpuAccess, m_bufferBlockKind);
 		if (!buf) {
 			Log::Fatal(L"Faild to create a new buffer.");
@@ -276,6 +468,15 @@ namespace KickstartRT_NativeLayer
 		}
 		buf->SetName(DebugName(m_debugName));
 
+		intptr_t	mappedPtr = 0;
+		if (m_persistentMapping) {
+			mappedPtr = reinterpret_cast<intptr_t>(buf->MapPersistently(&pws->m_device));
+			if (mappedPtr == 0) {
+				Log::Fatal(L"Faild to map a new buffer persistently.");
+				return m_bufferBlocks.end();
+			}
+		}
+
 		std::unique_ptr<GraphicsAPI::UnorderedAccessView>			uav;
 		std::unique_ptr<SharedCPUDescriptorHeap::SharedTableEntry>	cpuDesc;
 
@@ -303,20 +504,46 @@ namespace KickstartRT_NativeLayer
 		bb->m_uav = std::move(uav);
 		bb->m_cpuDesc = std::move(cpuDesc);
 		bb->m_gpuPtr = gPtr;
+		bb->m_mappedPtr = mappedPtr;
 
 		auto [itr, sts] = m_bufferBlocks.insert({ reinterpret_cast<intptr_t>(bb.get()), std::move(bb) });
 		if (!sts) {
 			Log::Fatal(L"Faild to insert new bufferBlock..");
 		}
+		if (m_budget != nullptr)
+			m_budget->m_committedBytes += itr->second->m_buffer->m_sizeInBytes;
 
 		return itr;
 	}
 
+	void SharedBuffer::EraseBufferBlock(decltype(m_bufferBlocks)::iterator itr)
+	{
+		if (m_budget != nullptr)
+			m_budget->m_committedBytes -= itr->second->m_buffer->m_sizeInBytes;
+		m_bufferBlocks.erase(itr);
+	}
+
+	void SharedBuffer::SetBudget(SharedBufferBudget* budget)
+	{
+		if (m_budget != nullptr) {
+			for (auto&& b : m_bufferBlocks)
+				m_budget->m_committedBytes -= b.second->m_buffer->m_sizeInBytes;
+		}
+		m_budget = budget;
+		if (m_budget != nullptr) {
+			for (auto&& b : m_bufferBlocks)
+				m_budget->m_committedBytes += b.second->m_buffer->m_sizeInBytes;
+		}
+	}
+
 	// call dtor of corresponded BufferBlock.
 	void SharedBuffer_Impl<void>::ReleaseAllocation(BufferEntry* ent)
 	{
 		ent->m_uav.reset();
 
+		if (m_trace)
+			m_trace->RecordFree(ent);
+
 		if (!ent->m_isAllocatedExclusively) {
 			// this should always be true in this configuration.
 			Log::Fatal(L"Failed to release shared buffer allocation..");
@@ -326,7 +553,7 @@ namespace KickstartRT_NativeLayer
 			if (itr == m_bufferBlocks.end()) {
 				Log::Fatal(L"Failed to release shared buffer allocation.");
 			}
-			m_bufferBlocks.erase(itr);
+			EraseBufferBlock(itr);
 		}
 	}
 
@@ -367,35 +594,289 @@ namespace KickstartRT_NativeLayer
 		ent->m_offset = 0;
 		ent->m_size = allocationSize;
 
+		if (m_trace)
+			m_trace->RecordAlloc(static_cast<BufferEntry*>(ent.get()), requestedSizeInBytes);
+
 		return std::move(ent);
 	};
 
+	void SharedBuffer_Impl<void>::GetUtilization(KickstartRT::ResourceAllocations::SharedPoolUtilization* retUtilization) const
+	{
+		// every block is used by an allocation.
+		*retUtilization = {};
+		for (auto&& b : m_bufferBlocks)
+			retUtilization->m_committedBlockBytes += b.second->m_buffer->m_sizeInBytes;
+		retUtilization->m_allocatedBytes = retUtilization->m_committedBlockBytes;
+		retUtilization->m_numBlocksOverHardLimit = m_numBlocksOverHardLimit;
+	}
+
+	Status SharedBuffer_Impl<void>::EnableSlabAllocation(size_t /*maxSlotSizeInBytes*/, uint32_t /*slotsPerSlab*/)
+	{
+		// every allocation has its own buffer in this implementation.
+		return Status::OK;
+	}
+
+	Status SharedBuffer_Impl<void>::ConfigureAllocator(uint64_t /*pageSizeInBytes*/, uint32_t /*smallPageThreshold*/)
+	{
+		// there is no allocator in this implementation.
+		return Status::OK;
+	}
+
+	Status SharedBuffer_Impl<void>::EnableAutoGrowBlockSize(uint64_t /*maxBlockSizeInBytes*/, float /*exclusiveAllocationRatio*/, uint32_t /*blockCountThreshold*/)
+	{
+		// there is no shared buffer block in this implementation.
+		return Status::OK;
+	}
+
 	Status SharedBuffer_Impl<void>::CheckUnusedBufferBlocks(uint64_t /*framesToRemove*/)
 	{
 		// there is no shared buffer block in this implementation.
 		return Status::OK;
 	}
 
+	Status SharedBuffer_Impl<void>::ReclaimFinishedAllocations(uint64_t /*finishedTaskIndex*/)
+	{
+		// entries are released with their own buffers.
+		return Status::OK;
+	}
+
+	Status SharedBuffer_Impl<void>::Defragment(PersistentWorkingSet* /*pws*/, GraphicsAPI::CommandList* /*cmdList*/, size_t /*maxBytesToMove*/, bool& relocated)
+	{
+		// there is no shared buffer block in this implementation.
+		relocated = false;
+		return Status::OK;
+	}
+
 	// Tell releasing allocation of a part of BufferBlock. Buffer block remain unchanged with shared blocks.
 	template<typename Allocator>
 	void SharedBuffer_VirtualAllocatorImpl<Allocator>::ReleaseAllocation(BufferEntry* ent)
 	{
 		ent->m_uav.reset();
 
+		if (m_trace)
+			m_trace->RecordFree(ent);
+
 		if (ent->m_isAllocatedExclusively) {
 			// It was a unique buffer allocation.
 			auto itr = m_bufferBlocks.find(reinterpret_cast<intptr_t>(ent->m_block));
 			if (itr == m_bufferBlocks.end()) {
 				Log::Fatal(L"Failed to release shared buffer allocation.");
 			}
-			m_bufferBlocks.erase(itr);
+			EraseBufferBlock(itr);
+		}
+		else if (ent->m_slabIndex != BufferEntry::m_invalidSlabIndex) {
+			// It was a slot of a slab.
+			ReleaseSlot(ent);
 		}
 		else {
 			// It belonged to a shared block
+			UnlinkFromBlock(ent);
 			m_allocator.Free(ent->m_globalOffset);
 		}
 	}
 
+	template<typename Allocator>
+	void SharedBuffer_VirtualAllocatorImpl<Allocator>::LinkToBlock(BufferEntry* ent)
+	{
+		ent->m_prevInBlock = nullptr;
+		ent->m_nextInBlock = ent->m_block->m_sharedEntries;
+		if (ent->m_nextInBlock != nullptr)
+			ent->m_nextInBlock->m_prevInBlock = ent;
+		ent->m_block->m_sharedEntries = ent;
+	}
+
+	// Entries which have never been linked, like placeholders of relocated ranges, are left untouched.
+	template<typename Allocator>
+	void SharedBuffer_VirtualAllocatorImpl<Allocator>::UnlinkFromBlock(BufferEntry* ent)
+	{
+		if (ent->m_prevInBlock != nullptr)
+			ent->m_prevInBlock->m_nextInBlock = ent->m_nextInBlock;
+		else if (ent->m_block->m_sharedEntries == ent)
+			ent->m_block->m_sharedEntries = ent->m_nextInBlock;
+		else
+			return;
+
+		if (ent->m_nextInBlock != nullptr)
+			ent->m_nextInBlock->m_prevInBlock = ent->m_prevInBlock;
+		ent->m_prevInBlock = nullptr;
+		ent->m_nextInBlock = nullptr;
+	}
+
+	// Find the shared block of the global offset, or create its buffer if the allocator has just added the block.
+	template<typename Allocator>
+	SharedBuffer::BufferBlock* SharedBuffer_VirtualAllocatorImpl<Allocator>::SharedBlock(PersistentWorkingSet* pws, size_t globalOffset, size_t* retLocalOffset)
+	{
+		// globalOffset consists of blockID and localOffset.
+		size_t blockID = globalOffset / m_blockSizeInBytes;
+		*retLocalOffset = globalOffset - (blockID * m_blockSizeInBytes);
+
+		auto itr = m_sharedBlocks.find((uint32_t)blockID);
+		if (itr != m_sharedBlocks.end())
+			return itr->second;
+
+		// (re)allocate a new buffer for shared block.
+		auto bItr = AddBufferBlock(pws, m_blockSizeInBytes);
+		if (bItr == m_bufferBlocks.end())
+			return nullptr;
+		m_sharedBlocks.insert({ (uint32_t)blockID, bItr->second.get() });
+
+		return bItr->second.get();
+	}
+
+	// Pop a free slot from the top available slab of the size class. A new slab is allocated when there is no available one.
+	template<typename Allocator>
+	bool SharedBuffer_VirtualAllocatorImpl<Allocator>::AllocateSlot(PersistentWorkingSet* pws, size_t allocationSize, uint32_t* retSlabIndex, size_t* retGlobalOffset)
+	{
+		uint32_t classIndex = 0;
+		while (m_slabClasses[classIndex].m_slotSizeInBytes < allocationSize)
+			++classIndex;
+		SlabClass& sc(m_slabClasses[classIndex]);
+
+		if (sc.m_availableSlabs.empty()) {
+			size_t slabOffset;
+			if (!m_allocator.Alloc(sc.m_slotSizeInBytes * m_slotsPerSlab, &slabOffset))
+				return false;
+
+			uint32_t slabIndex;
+			if (m_releasedSlabs.size() > 0) {
+				slabIndex = m_releasedSlabs.back();
+				m_releasedSlabs.pop_back();
+			}
+			else {
+				m_slabs.push_back(Slab());
+				slabIndex = (uint32_t)(m_slabs.size() - 1);
+			}
+
+			Slab& slab(m_slabs[slabIndex]);
+			slab.m_globalOffset = slabOffset;
+			slab.m_block = SharedBlock(pws, slabOffset, &slab.m_localOffset);
+			slab.m_classIndex = classIndex;
+			slab.m_freeSlots.resize(m_slotsPerSlab);
+			for (uint32_t i = 0; i < m_slotsPerSlab; ++i)
+				slab.m_freeSlots[i] = m_slotsPerSlab - 1 - i;
+			if (slab.m_block == nullptr) {
+				m_allocator.Free(slabOffset);
+				slab = Slab();
+				m_releasedSlabs.push_back(slabIndex);
+				return false;
+			}
+
+			sc.m_availableSlabs.push_back(slabIndex);
+			++m_numEmptySlabs;
+		}
+
+		uint32_t slabIndex = sc.m_availableSlabs.back();
+		Slab& slab(m_slabs[slabIndex]);
+		if (slab.m_freeSlots.size() == m_slotsPerSlab)
+			--m_numEmptySlabs;
+
+		uint32_t slot = slab.m_freeSlots.back();
+		slab.m_freeSlots.pop_back();
+		if (slab.m_freeSlots.empty())
+			sc.m_availableSlabs.pop_back();
+
+		*retSlabIndex = slabIndex;
+		*retGlobalOffset = slab.m_globalOffset + sc.m_slotSizeInBytes * slot;
+
+		return true;
+	}
+
+	template<typename Allocator>
+	void SharedBuffer_VirtualAllocatorImpl<Allocator>::ReleaseSlot(BufferEntry* ent)
+	{
+		Slab& slab(m_slabs[ent->m_slabIndex]);
+		SlabClass& sc(m_slabClasses[slab.m_classIndex]);
+
+		// a full slab gets available again.
+		if (slab.m_freeSlots.empty())
+			sc.m_availableSlabs.push_back(ent->m_slabIndex);
+
+		slab.m_freeSlots.push_back((uint32_t)((ent->m_globalOffset - slab.m_globalOffset) / sc.m_slotSizeInBytes));
+		if (slab.m_freeSlots.size() == m_slotsPerSlab)
+			++m_numEmptySlabs;
+	}
+
+	// Give empty slabs back to the allocator, so that their blocks can be removed.
+	template<typename Allocator>
+	void SharedBuffer_VirtualAllocatorImpl<Allocator>::ReleaseEmptySlabs()
+	{
+		if (m_numEmptySlabs == 0)
+			return;
+
+		for (auto&& sc : m_slabClasses) {
+			size_t dst = 0;
+			for (size_t i = 0; i < sc.m_availableSlabs.size(); ++i) {
+				uint32_t slabIndex = sc.m_availableSlabs[i];
+				Slab& slab(m_slabs[slabIndex]);
+				if (slab.m_freeSlots.size() < m_slotsPerSlab) {
+					sc.m_availableSlabs[dst++] = slabIndex;
+					continue;
+				}
+				m_allocator.Free(slab.m_globalOffset);
+				slab = Slab();
+				m_releasedSlabs.push_back(slabIndex);
+			}
+			sc.m_availableSlabs.resize(dst);
+		}
+		m_numEmptySlabs = 0;
+	}
+
+	template<typename Allocator>
+	void SharedBuffer_VirtualAllocatorImpl<Allocator>::GetUtilization(KickstartRT::ResourceAllocations::SharedPoolUtilization* retUtilization) const
+	{
+		using RA = KickstartRT::ResourceAllocations;
+
+		*retUtilization = {};
+		for (auto&& b : m_bufferBlocks)
+			retUtilization->m_committedBlockBytes += b.second->m_buffer->m_sizeInBytes;
+
+		// exclusive blocks are entirely used by their entries, and free slots in slabs are not available for others.
+		size_t exclusiveBytes = retUtilization->m_committedBlockBytes - m_sharedBlocks.size() * m_blockSizeInBytes;
+		size_t freeSlotBytes = 0;
+		for (auto&& slab : m_slabs) {
+			if (slab.m_block == nullptr)
+				continue; // released.
+			freeSlotBytes += slab.m_freeSlots.size() * m_slabClasses[slab.m_classIndex].m_slotSizeInBytes;
+		}
+		retUtilization->m_allocatedBytes = m_allocator.AllocatedSizeInBytes() + exclusiveBytes - freeSlotBytes;
+		retUtilization->m_numBlocksOverHardLimit = m_numBlocksOverHardLimit;
+
+		m_allocator.VisitFreeChunks([retUtilization](size_t sizeInBytes) {
+			retUtilization->m_freeBytes += sizeInBytes;
+			retUtilization->m_largestFreeRunBytes = std::max(retUtilization->m_largestFreeRunBytes, sizeInBytes);
+
+			size_t bin = 0;
+			while (bin < RA::kNumFreeRunHistogramBins - 1 && sizeInBytes >= ((size_t)4096 << (2 * bin)))
+				++bin;
+			++retUtilization->m_freeRunHistogram[bin];
+			});
+	}
+
+	template<typename Allocator>
+	Status SharedBuffer_VirtualAllocatorImpl<Allocator>::EnableSlabAllocation(size_t maxSlotSizeInBytes, uint32_t slotsPerSlab)
+	{
+		if (m_slabs.size() > 0 || slotsPerSlab == 0 || maxSlotSizeInBytes < m_alignmentSizeInBytes) {
+			Log::Fatal(L"Invalid slab allocation settings (%s).", m_debugName.c_str());
+			return Status::ERROR_INVALID_PARAM;
+		}
+
+		m_slotsPerSlab = slotsPerSlab;
+		m_slabClasses.clear();
+		for (size_t slotSize = m_alignmentSizeInBytes; slotSize <= maxSlotSizeInBytes; slotSize *= 2) {
+			if (slotSize * slotsPerSlab > m_blockSizeInBytes / 2)
+				break;
+			SlabClass sc;
+			sc.m_slotSizeInBytes = slotSize;
+			m_slabClasses.push_back(sc);
+		}
+		if (m_slabClasses.empty()) {
+			Log::Fatal(L"A slab is larger than the half of the block size (%s).", m_debugName.c_str());
+			return Status::ERROR_INVALID_PARAM;
+		}
+
+		return Status::OK;
+	}
+
 	template<typename Allocator>
 	Status SharedBuffer_VirtualAllocatorImpl<Allocator>::Init(
 		GraphicsAPI::Device* dev,
@@ -413,16 +894,111 @@ namespace KickstartRT_NativeLayer
 		if (sts!= Status::OK)
 			return sts;
 
+		if (!InitAllocator()) {
+			Log::Fatal(L"Failed to initialize allocator.");
+			return Status::ERROR_INTERNAL;
+		}
+
+		return sts;
+	}
+
+	template<typename Allocator>
+	bool SharedBuffer_VirtualAllocatorImpl<Allocator>::InitAllocator()
+	{
+		// allocators can be initialized again while they have no block.
+		assert(m_allocator.NumberOfBlocks() == 0);
 		if (!m_allocator.Init(
 			true,					// allowMultipleBlocks,
 			m_blockSizeInBytes,		// blockSizeInBytes,
-			m_alignmentSizeInBytes)	// allocationPageSizeInBytes
+			m_pageSizeInBytes)		// allocationPageSizeInBytes
 			) {
+			return false;
+		}
+
+		if constexpr (std::is_same_v<Allocator, VirtualAllocator::FixedPageAllocator>) {
+			if (m_smallPageThreshold > 0)
+				m_allocator.SetSmallPageThreshold(m_smallPageThreshold);
+		}
+
+		return true;
+	}
+
+	template<typename Allocator>
+	Status SharedBuffer_VirtualAllocatorImpl<Allocator>::ConfigureAllocator(uint64_t pageSizeInBytes, uint32_t smallPageThreshold)
+	{
+		if (m_allocator.NumberOfBlocks() > 0 || m_slabs.size() > 0) {
+			Log::Fatal(L"Allocator needs to be configured before any allocation (%s).", m_debugName.c_str());
+			return Status::ERROR_INTERNAL;
+		}
+		if (pageSizeInBytes == 0)
+			pageSizeInBytes = m_pageSizeInBytes;
+		if (std::bitset<64>(pageSizeInBytes).count() != 1 || pageSizeInBytes < m_alignmentSizeInBytes || pageSizeInBytes > m_blockSizeInBytes) {
+			Log::Fatal(L"Page size needs to be power of 2 between the allocation alignment and the block size (%s).", m_debugName.c_str());
+			return Status::ERROR_INVALID_PARAM;
+		}
+
+		m_pageSizeInBytes = pageSizeInBytes;
+		m_smallPageThreshold = smallPageThreshold;
+		if (!InitAllocator()) {
 			Log::Fatal(L"Failed to initialize allocator.");
 			return Status::ERROR_INTERNAL;
 		}
 
-		return sts;
+		return Status::OK;
+	}
+
+	template<typename Allocator>
+	Status SharedBuffer_VirtualAllocatorImpl<Allocator>::EnableAutoGrowBlockSize(uint64_t maxBlockSizeInBytes, float exclusiveAllocationRatio, uint32_t blockCountThreshold)
+	{
+		if (std::bitset<64>(maxBlockSizeInBytes).count() != 1 || maxBlockSizeInBytes < m_blockSizeInBytes || exclusiveAllocationRatio < 0.f) {
+			Log::Fatal(L"Invalid auto grow settings (%s).", m_debugName.c_str());
+			return Status::ERROR_INVALID_PARAM;
+		}
+
+		m_autoGrow = AutoGrowStatus();
+		m_autoGrow.m_enabled = true;
+		m_autoGrow.m_maxBlockSizeInBytes = maxBlockSizeInBytes;
+		m_autoGrow.m_exclusiveAllocationRatio = exclusiveAllocationRatio;
+		m_autoGrow.m_blockCountThreshold = blockCountThreshold;
+
+		return Status::OK;
+	}
+
+	template<typename Allocator>
+	void SharedBuffer_VirtualAllocatorImpl<Allocator>::UpdateAutoGrowBlockSize()
+	{
+		if (!m_autoGrow.m_enabled)
+			return;
+
+		if (m_autoGrow.m_pendingBlockSizeInBytes > 0) {
+			// the allocator can be re-initialized with the new size only when no shared block is alive. blocks are not changed while recording a trace.
+			if (m_allocator.NumberOfBlocks() > 0 || m_trace)
+				return;
+
+			m_blockSizeInBytes = m_autoGrow.m_pendingBlockSizeInBytes;
+			m_autoGrow.m_pendingBlockSizeInBytes = 0;
+			m_autoGrow.m_numAllocations = 0;
+			m_autoGrow.m_numExclusiveAllocations = 0;
+			if (!InitAllocator()) {
+				Log::Fatal(L"Failed to initialize allocator.");
+				return;
+			}
+			Log::Info(L"Block size of a shared resource (%s) has been changed to %.02fMB.",
+				m_debugName.c_str(), (double)m_blockSizeInBytes / (1024.0 * 1024.0));
+			return;
+		}
+		if (m_blockSizeInBytes >= m_autoGrow.m_maxBlockSizeInBytes)
+			return;
+
+		bool grow = m_autoGrow.m_blockCountThreshold > 0 && m_allocator.NumberOfBlocks() >= m_autoGrow.m_blockCountThreshold;
+		if (m_autoGrow.m_numAllocations >= AutoGrowStatus::m_allocationsToEvaluate) {
+			if ((float)m_autoGrow.m_numExclusiveAllocations > m_autoGrow.m_exclusiveAllocationRatio * (float)m_autoGrow.m_numAllocations)
+				grow = true;
+			m_autoGrow.m_numAllocations = 0;
+			m_autoGrow.m_numExclusiveAllocations = 0;
+		}
+		if (grow)
+			m_autoGrow.m_pendingBlockSizeInBytes = std::min(m_blockSizeInBytes * 2, m_autoGrow.m_maxBlockSizeInBytes);
 	}
 
 	// Allocate a part of shared buffer if possible.
@@ -437,13 +1013,24 @@ namespace KickstartRT_NativeLayer
 		}
 
 		size_t allocationSize = GraphicsAPI::ALIGN(m_alignmentSizeInBytes, requestedSizeInBytes);
+		++m_autoGrow.m_numAllocations;
 
 		BufferBlock* foundBlock = nullptr;
 		size_t localOffset = 0;
 		size_t globalOffset = (size_t)-1;
+		uint32_t slabIndex = BufferEntry::m_invalidSlabIndex;
 		bool isAllocatedExclusively = false;
 
-		if (allocationSize > m_blockSizeInBytes / 2) {
+		if (m_slabClasses.size() > 0 && allocationSize <= m_slabClasses.back().m_slotSizeInBytes) {
+			// take a slot of a slab.
+			if (!AllocateSlot(pws, allocationSize, &slabIndex, &globalOffset)) {
+				Log::Fatal(L"Faild to allocate a slab.");
+				return std::move(ret_ent);
+			}
+			foundBlock = m_slabs[slabIndex].m_block;
+			localOffset = globalOffset - (globalOffset / m_blockSizeInBytes) * m_blockSizeInBytes;
+		}
+		else if (allocationSize > m_blockSizeInBytes / 2) {
 			// Allocation size is bigger than the half of shaerd block size.
 			auto itr = AddBufferBlock(pws, allocationSize);
 			if (itr == m_bufferBlocks.end()) {
@@ -452,31 +1039,25 @@ namespace KickstartRT_NativeLayer
 			}
 			foundBlock = itr->second.get();
 			isAllocatedExclusively = true;
+			++m_autoGrow.m_numExclusiveAllocations;
 			Log::Info(L"A large allocation (%fMB)MB in a shared resource (%s) occurred. Please consider using more larger memory block (currently %.02fMB).",
 				(double)allocationSize / (1024.0 * 1024.0),
 				m_debugName.c_str(),
 				(double)m_blockSizeInBytes / (1024.0 * 1024.0));
 		}
 		else {
+			// ring allocator tags allocations to reclaim them after the task is finished.
+			if constexpr (std::is_same_v<Allocator, VirtualAllocator::RingAllocator>) {
+				m_allocator.SetCurrentTag(pws->GetCurrentTaskIndex());
+			}
+
 			// search sutable allocation.
 			if (!m_allocator.Alloc(allocationSize, &globalOffset)) {
 				Log::Fatal(L"Faild to allocate shared memory chunk.");
 				return std::move(ret_ent);
 			}
 			else {
-				// globalOffset consists of blockID and localOffset.
-				size_t blockID = globalOffset / m_blockSizeInBytes;
-				localOffset = globalOffset - (blockID * m_blockSizeInBytes);
-
-				auto itr = m_sharedBlocks.find((uint32_t)blockID);
-				if (itr == m_sharedBlocks.end()) {
-					// (re)allocate a new buffer for shared block.
-					foundBlock = AddBufferBlock(pws, m_blockSizeInBytes)->second.get();
-					m_sharedBlocks.insert({(uint32_t)blockID, foundBlock});
-				}
-				else {
-					foundBlock = itr->second;
-				}
+				foundBlock = SharedBlock(pws, globalOffset, &localOffset);
 			}
 		}
 		if (foundBlock == nullptr) {
@@ -484,10 +1065,14 @@ namespace KickstartRT_NativeLayer
 			return std::move(ret_ent);
 		}
 
-		ret_ent = std::make_unique<ClassifiedBufferEntry>(&pws->m_resourceLogger, m_bufferEntryKind, requestedSizeInBytes);
+		if (slabIndex != BufferEntry::m_invalidSlabIndex)
+			ret_ent.reset(new (&m_entryPool) PooledBufferEntry(&pws->m_resourceLogger, m_bufferEntryKind, requestedSizeInBytes));
+		else
+			ret_ent = std::make_unique<ClassifiedBufferEntry>(&pws->m_resourceLogger, m_bufferEntryKind, requestedSizeInBytes);
 		ret_ent->m_manager = this;
 		ret_ent->m_block = foundBlock;
 		ret_ent->m_isAllocatedExclusively = isAllocatedExclusively;
+		ret_ent->m_slabIndex = slabIndex;
 		if (useUAV) {
 			ret_ent->m_uav = std::make_unique<GraphicsAPI::UnorderedAccessView>();
 			{
@@ -504,12 +1089,24 @@ namespace KickstartRT_NativeLayer
 		ret_ent->m_offset = localOffset;
 		ret_ent->m_size = allocationSize;
 
+		if (!isAllocatedExclusively && slabIndex == BufferEntry::m_invalidSlabIndex)
+			LinkToBlock(ret_ent.get());
+
+		if (m_trace)
+			m_trace->RecordAlloc(ret_ent.get(), requestedSizeInBytes);
+
 		return std::move(ret_ent);
 	};
 
 	template<typename Allocator>
 	Status SharedBuffer_VirtualAllocatorImpl<Allocator>::CheckUnusedBufferBlocks(uint64_t framesToRemove)
 	{
+		if (m_trace)
+			m_trace->RecordCheckUnusedBlocks(framesToRemove);
+
+		ReleaseEmptySlabs();
+		UpdateAutoGrowBlockSize();
+
 		size_t nbBlocks = m_allocator.NumberOfBlocks();
 		if (nbBlocks == 0) {
 			// there is no shared block.
@@ -521,6 +1118,34 @@ namespace KickstartRT_NativeLayer
 		std::vector<uint32_t>	currentOccupancy(nbBlocks);
 		m_allocator.BlockStatus(currentIDs.data(), currentOccupancy.data());
 
+		// blocks of the current size are no longer reused after the block size is changed.
+		bool drainBlocks = m_autoGrow.m_pendingBlockSizeInBytes > 0;
+		if (drainBlocks || (m_budget != nullptr && m_budget->IsOverSoftLimit())) {
+			// over the soft limit. Release empty blocks immediately until it gets under the limit.
+			std::vector<uint32_t>	aIDsToRemove;
+			for (size_t idx = nbBlocks; idx > 0 && (drainBlocks || (m_budget != nullptr && m_budget->IsOverSoftLimit())); --idx) {
+				if (currentOccupancy[idx - 1] == 1)
+					continue;
+
+				uint32_t aID = currentIDs[idx - 1];
+				auto itr = m_sharedBlocks.find(aID);
+				assert(itr != m_sharedBlocks.end());
+
+				aIDsToRemove.push_back(aID);
+				EraseBufferBlock(m_bufferBlocks.find(reinterpret_cast<intptr_t>(itr->second)));
+				m_sharedBlocks.erase(itr);
+			}
+
+			if (aIDsToRemove.size() > 0) {
+				m_allocator.RemoveUnusedBlocks(aIDsToRemove);
+
+				// block IDs have been changed. counters are reset in the next call.
+				m_usingBlockStatus.m_freeFrames.clear();
+				m_usingBlockStatus.m_blockIDs.clear();
+			}
+			return Status::OK;
+		}
+
 		if (m_usingBlockStatus.m_freeFrames.size() != nbBlocks) {
 			// number of blocks has been changed. Reset all counter.
 			m_usingBlockStatus.m_freeFrames.resize(nbBlocks);
@@ -550,7 +1175,14 @@ namespace KickstartRT_NativeLayer
 			size_t idxToRemove = m_usingBlockStatus.m_freeFrames.size();
 			size_t numberToRemove = 10;
 
-			while (idxToRemove > 0) {
+			if (m_budget != nullptr) {
+				// under the soft limit. keep warm spare blocks to avoid re-creating them for the next allocations.
+				size_t numEmptyBlocks = (size_t)std::count(currentOccupancy.begin(), currentOccupancy.end(), 0u);
+				size_t numSpareBlocks = m_budget->m_numWarmSpareBlocks;
+				numberToRemove = std::min(numberToRemove, numEmptyBlocks > numSpareBlocks ? numEmptyBlocks - numSpareBlocks : (size_t)0);
+			}
+
+			while (idxToRemove > 0 && numberToRemove > 0) {
 				if (m_usingBlockStatus.m_freeFrames[--idxToRemove] < framesToRemove)
 					continue;
 
@@ -566,10 +1198,9 @@ namespace KickstartRT_NativeLayer
 				aIDsToRemove.push_back(aID); // store allocator ID.
 
 				// Immediately delete the buffer block, since all Entries that used the corresponded block should already be freed with DeferredRelease.
-				m_bufferBlocks.erase(reinterpret_cast<intptr_t>(b));
+				EraseBufferBlock(m_bufferBlocks.find(reinterpret_cast<intptr_t>(b)));
 				m_sharedBlocks.erase(aID);
-				if (--numberToRemove == 0)
-					break;
+				--numberToRemove;
 			};
 		}
 
@@ -584,9 +1215,191 @@ namespace KickstartRT_NativeLayer
 		return Status::OK;
 	}
 
+	template<typename Allocator>
+	Status SharedBuffer_VirtualAllocatorImpl<Allocator>::ReclaimFinishedAllocations(uint64_t finishedTaskIndex)
+	{
+		if constexpr (std::is_same_v<Allocator, VirtualAllocator::RingAllocator>) {
+			m_allocator.Reclaim(finishedTaskIndex);
+		}
+		return Status::OK;
+	}
+
+	// Move entries in the least occupied shared block into the other blocks, so that the block gets empty and released by CheckUnusedBufferBlocks().
+	// Copies are recorded into the command list, so any following command in the task sees the relocated entries.
+	template<typename Allocator>
+	Status SharedBuffer_VirtualAllocatorImpl<Allocator>::Defragment(PersistentWorkingSet* pws, GraphicsAPI::CommandList* cmdList, size_t maxBytesToMove, bool& relocated)
+	{
+		relocated = false;
+
+		if (m_trace)
+			m_trace->RecordDefragment(maxBytesToMove);
+
+		// slabs hold many entries in a chunk, which can't be relocated as a single allocation.
+		for (auto&& slab : m_slabs) {
+			if (slab.m_block != nullptr && slab.m_freeSlots.size() < m_slotsPerSlab)
+				return Status::OK;
+		}
+
+		// the allocator has allocated the destinations and kept the sources allocated when it returns moves.
+		if (!m_allocator.PlanCompaction(maxBytesToMove, &m_moves))
+			return Status::OK;
+
+		// build the lookup of the entries only for the source blocks.
+		std::unordered_map<size_t, BufferEntry*>	srcEntries;
+		std::set<uint32_t>							srcBlockIDs;
+		for (auto&& m : m_moves) {
+			uint32_t blockID = (uint32_t)(m.m_srcOffset / m_blockSizeInBytes);
+			auto bItr = m_sharedBlocks.find(blockID);
+			if (bItr == m_sharedBlocks.end() || !srcBlockIDs.insert(blockID).second)
+				continue;
+			for (BufferEntry* e = bItr->second->m_sharedEntries; e != nullptr; e = e->m_nextInBlock)
+				srcEntries.insert({ e->m_globalOffset, e });
+		}
+
+		// The source range of a relocation is kept by a placeholder entry, which is deferred released with the old view.
+		// The placeholder isn't a ClassifiedBufferEntry since the moved entry keeps its registration in the resource logger.
+		struct Relocation {
+			BufferEntry*					m_entry = nullptr;
+			std::unique_ptr<BufferEntry>	m_src;
+		};
+		std::vector<Relocation>		relocations;
+		std::set<BufferBlock*>		srcBlocks;
+		std::set<BufferBlock*>		dstBlocks;
+		relocations.reserve(m_moves.size());
+
+		// patch entries with the new offsets.
+		for (auto&& m : m_moves) {
+			auto eItr = srcEntries.find(m.m_srcOffset);
+			if (eItr == srcEntries.end()) {
+				// the source is a range which is still waiting for its deferred release, or an empty slab. leave it there.
+				m_allocator.Free(m.m_dstOffset);
+				continue;
+			}
+			BufferEntry* ent = eItr->second;
+
+			size_t dstBlockID = m.m_dstOffset / m_blockSizeInBytes;
+			auto bItr = m_sharedBlocks.find((uint32_t)dstBlockID);
+			if (bItr == m_sharedBlocks.end()) {
+				Log::Fatal(L"Failed to find a shared block to relocate an entry.");
+				return Status::ERROR_INTERNAL;
+			}
+
+			relocations.push_back({});
+			auto& r(relocations.back());
+			r.m_entry = ent;
+			r.m_src = std::make_unique<BufferEntry>();
+			r.m_src->m_manager = this;
+			r.m_src->m_block = ent->m_block;
+			r.m_src->m_globalOffset = ent->m_globalOffset;
+			r.m_src->m_offset = ent->m_offset;
+			r.m_src->m_size = ent->m_size;
+			r.m_src->m_uav = std::move(ent->m_uav);
+			srcBlocks.insert(ent->m_block);
+			dstBlocks.insert(bItr->second);
+
+			UnlinkFromBlock(ent);
+			ent->m_block = bItr->second;
+			ent->m_globalOffset = m.m_dstOffset;
+			ent->m_offset = m.m_dstOffset - dstBlockID * m_blockSizeInBytes;
+			LinkToBlock(ent);
+
+			if (r.m_src->m_uav) {
+				ent->m_uav = std::make_unique<GraphicsAPI::UnorderedAccessView>();
+				{
+					size_t elmOfs = ent->m_offset;
+					size_t elmSize = ent->m_size;
+					if (m_formatSizeInByte > 0) {
+						elmOfs /= m_formatSizeInByte;
+						elmSize /= m_formatSizeInByte;
+					}
+					if (!ent->m_uav->Init(&pws->m_device, ent->m_block->m_buffer.get(), (uint32_t)elmOfs, (uint32_t)elmSize)) {
+						Log::Fatal(L"Failed to create a uav for a relocated entry.");
+						return Status::ERROR_INTERNAL;
+					}
+				}
+			}
+		}
+
+		if (relocations.empty())
+			return Status::OK;
+
+		if (is_set(m_bindFlags, GraphicsAPI::Resource::BindFlags::AccelerationStructure)) {
+			// Acceleration structures cannot be copied as plain buffers. Clone them instead.
+			for (auto&& b : srcBlocks)
+				b->m_barrierRequest = true;
+			RETURN_IF_STATUS_FAILED(UAVBarrier(cmdList));
+
+			for (auto&& r : relocations) {
+#if defined(GRAPHICS_API_D3D12)
+				D3D12_GPU_VIRTUAL_ADDRESS src = { r.m_src->GetGpuPtr() };
+				D3D12_GPU_VIRTUAL_ADDRESS dst = { r.m_entry->GetGpuPtr() };
+
+				cmdList->m_apiData.m_commandList->CopyRaytracingAccelerationStructure(dst, src, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE_CLONE);
+#elif defined(GRAPHICS_API_VK)
+				if (!r.m_src->m_uav) {
+					Log::Fatal(L"Acceleration structure entry without uav cannot be relocated.");
+					return Status::ERROR_INTERNAL;
+				}
+				VkCopyAccelerationStructureInfoKHR copyInfo = {};
+				copyInfo.sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR;
+				copyInfo.src = r.m_src->m_uav->m_apiData.m_accelerationStructure;
+				copyInfo.dst = r.m_entry->m_uav->m_apiData.m_accelerationStructure;
+				copyInfo.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_CLONE_KHR;
+
+				GraphicsAPI::VK::vkCmdCopyAccelerationStructureKHR(cmdList->m_apiData.m_commandBuffer, &copyInfo);
+#endif
+			}
+
+			for (auto&& b : dstBlocks)
+				b->m_barrierRequest = true;
+			RETURN_IF_STATUS_FAILED(UAVBarrier(cmdList));
+		}
+		else {
+			std::vector<GraphicsAPI::Resource*>				resArr;
+			std::vector<GraphicsAPI::ResourceState::State>	stateArr;
+			std::vector<GraphicsAPI::ResourceState::State>	restoreStateArr;
+
+			auto AddBlock = [&](BufferBlock* b, GraphicsAPI::ResourceState::State state) {
+				auto currentState = b->m_buffer->GetGlobalState();
+				resArr.push_back(b->m_buffer.get());
+				stateArr.push_back(state);
+				restoreStateArr.push_back(currentState == GraphicsAPI::ResourceState::State::Undefined ? GraphicsAPI::ResourceState::State::Common : currentState);
+			};
+			for (auto&& b : srcBlocks)
+				AddBlock(b, GraphicsAPI::ResourceState::State::CopySource);
+			for (auto&& b : dstBlocks)
+				AddBlock(b, GraphicsAPI::ResourceState::State::CopyDest);
+
+			if (!cmdList->ResourceTransitionBarrier(resArr.data(), resArr.size(), stateArr.data())) {
+				Log::Fatal(L"Faild to set resource state transition.");
+				return Status::ERROR_INTERNAL;
+			}
+
+			for (auto&& r : relocations)
+				cmdList->CopyBufferRegion(r.m_entry->m_block->m_buffer.get(), r.m_entry->m_offset, r.m_src->m_block->m_buffer.get(), r.m_src->m_offset, r.m_entry->m_size);
+
+			if (!cmdList->ResourceTransitionBarrier(resArr.data(), resArr.size(), restoreStateArr.data())) {
+				Log::Fatal(L"Faild to set resource state transition.");
+				return Status::ERROR_INTERNAL;
+			}
+		}
+
+		// old ranges and views can still be referenced by in-flight tasks. they are freed when the tasks have finished.
+		for (auto&& r : relocations)
+			pws->DeferredRelease(std::move(r.m_src));
+
+		relocated = true;
+
+		return Status::OK;
+	}
+
 	template class SharedBuffer_VirtualAllocatorImpl<VirtualAllocator::BuddyAllocator>;
 	template class SharedBuffer_VirtualAllocatorImpl<VirtualAllocator::FixedPageAllocator>;
+	template class SharedBuffer_VirtualAllocatorImpl<VirtualAllocator::TLSFAllocator>;
+	template class SharedBuffer_VirtualAllocatorImpl<VirtualAllocator::RingAllocator>;
 	template class SharedBuffer_Impl<VirtualAllocator::BuddyAllocator>;
 	template class SharedBuffer_Impl<VirtualAllocator::FixedPageAllocator>;
+	template class SharedBuffer_Impl<VirtualAllocator::TLSFAllocator>;
+	template class SharedBuffer_Impl<VirtualAllocator::RingAllocator>;
 
 };
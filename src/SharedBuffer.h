@@ -26,18 +26,44 @@
 #include <VirtualAllocator.h>
 #include <SharedCPUDescriptorHeap.h>
 #include <ResourceLogger.h>
+#include <common/AllocationTrace.h>
 
+#include <cstddef>
+#include <algorithm>
 #include <string>
+#include <vector>
 #include <map>
+#include <unordered_map>
 #include <deque>
+#include <fstream>
 
 namespace KickstartRT_NativeLayer
 {
     class PersistentWorkingSet;
 
+    // Limits of a memory budget category, which are shared by the pools in the category. Committed bytes are summed over the pools.
+    struct SharedBufferBudget {
+        size_t      m_softLimitInBytes = 0;
+        size_t      m_hardLimitInBytes = 0;
+        uint32_t    m_numWarmSpareBlocks = 0;
+        size_t      m_committedBytes = 0;
+
+        bool IsOverSoftLimit() const
+        {
+            return m_softLimitInBytes > 0 && m_committedBytes > m_softLimitInBytes;
+        };
+
+        bool ExceedsHardLimit(size_t additionalBytes) const
+        {
+            return m_hardLimitInBytes > 0 && m_committedBytes + additionalBytes > m_hardLimitInBytes;
+        };
+    };
+
     // base implementation with no allocator
     class SharedBuffer {
     public:
+        struct BufferEntry;
+
         struct BufferBlock {
             std::unique_ptr<GraphicsAPI::Buffer>                m_buffer;
             std::unique_ptr<GraphicsAPI::UnorderedAccessView>   m_uav;
@@ -48,6 +74,10 @@ namespace KickstartRT_NativeLayer
             std::deque<std::pair<uint64_t, uint64_t>>           m_clearRequests;
             bool            m_barrierRequest = false;
             bool            m_batchMapRequest = false;
+            uint64_t        m_batchMapRangeBegin = (uint64_t)-1; // union of the registered entries. used to invalidate or flush persistently mapped blocks.
+            uint64_t        m_batchMapRangeEnd = 0;
+
+            BufferEntry*    m_sharedEntries = nullptr; // head of the entries sub-allocated from this block. used to find entries to relocate.
 
             ~BufferBlock()
             {
@@ -63,10 +93,12 @@ namespace KickstartRT_NativeLayer
         bool    m_useGPUPtr = false;
         size_t  m_blockSizeInBytes = 0;
         size_t  m_alignmentSizeInBytes = 0;
+        size_t  m_pageSizeInBytes = 0; // allocation granularity of the allocator. same as the alignment unless configured.
         size_t  m_formatSizeInByte = 0;
         GraphicsAPI::Resource::Format m_format = GraphicsAPI::Resource::Format::Unknown;
         GraphicsAPI::Resource::BindFlags m_bindFlags = GraphicsAPI::Resource::BindFlags::None;
         GraphicsAPI::Buffer::CpuAccess m_cpuAccess = GraphicsAPI::Buffer::CpuAccess::None;
+        bool    m_persistentMapping = false;
 
         GraphicsAPI::DescriptorTableLayout	m_oneUAVLayout;
 
@@ -76,6 +108,35 @@ namespace KickstartRT_NativeLayer
 
         std::map<intptr_t, std::unique_ptr<BufferBlock>>    m_bufferBlocks;
 
+        SharedBufferBudget*                 m_budget = nullptr; // not owned. nullptr if the pool is not in a budget category.
+        size_t                              m_numBlocksOverHardLimit = 0;
+
+        // Writes allocation events into a binary file. Entries allocated before starting the trace are ignored.
+        struct AllocationTraceRecorder {
+            std::ofstream   m_file;
+            uint64_t        m_nextID = 0;
+            uint32_t        m_frameIndex = 0;
+            std::unordered_map<const void*, uint64_t>   m_entryIDs;
+
+            bool Open(const std::wstring& filePath, uint64_t blockSizeInBytes, uint64_t alignmentSizeInBytes);
+            void RecordAlloc(const void* entry, uint64_t requestedSizeInBytes);
+            void RecordFree(const void* entry);
+            void RecordCheckUnusedBlocks(uint64_t framesToRemove);
+            void RecordDefragment(uint64_t maxBytesToMove);
+
+        protected:
+            void Write(AllocationTrace::EventType type, uint64_t id, uint64_t value);
+        };
+        std::unique_ptr<AllocationTraceRecorder>    m_trace; // only valid while recording.
+
+        std::vector<std::pair<uint64_t, uint64_t>>  m_mergedClearRanges; // reused by DoClear().
+#if defined(GRAPHICS_API_D3D12)
+        std::vector<D3D12_RECT>                     m_clearRects; // reused by DoClear().
+#endif
+
+        // Sort clear requests by offset and merge adjacent or overlapping ones. requests are consumed.
+        static void MergeClearRequests(std::deque<std::pair<uint64_t, uint64_t>>& requests, std::vector<std::pair<uint64_t, uint64_t>>& retRanges);
+
     public:
         struct BufferEntry : public GraphicsAPI::DeviceObject {
             SharedBuffer* m_manager = nullptr;
@@ -86,6 +147,12 @@ namespace KickstartRT_NativeLayer
             size_t          m_globalOffset = (size_t)-1;
             size_t          m_offset = (size_t)-1;
             size_t          m_size = (size_t)-1;
+            static constexpr uint32_t m_invalidSlabIndex = 0xFFFF'FFFF;
+
+            uint32_t        m_slabIndex = m_invalidSlabIndex; // valid if the entry is a slot of a slab.
+
+            BufferEntry*    m_prevInBlock = nullptr; // links of BufferBlock::m_sharedEntries.
+            BufferEntry*    m_nextInBlock = nullptr;
 
             virtual ~BufferEntry()
             {
@@ -115,9 +182,25 @@ namespace KickstartRT_NativeLayer
             void RegisterBatchMap()
             {
                 m_block->m_batchMapRequest = true;
+                m_block->m_batchMapRangeBegin = std::min(m_block->m_batchMapRangeBegin, (uint64_t)m_offset);
+                m_block->m_batchMapRangeEnd = std::max(m_block->m_batchMapRangeEnd, (uint64_t)(m_offset + m_size));
             };
         };
 
+        // Fixed sized memory pool for entries to avoid a heap allocation per entry. The pool pointer is stored in front of each entry.
+        class BufferEntryPool {
+            static constexpr size_t     m_headerSizeInBytes = alignof(std::max_align_t);
+            static constexpr size_t     m_slotsPerChunk = 256;
+
+            size_t                                  m_slotSizeInBytes = 0;
+            std::vector<std::unique_ptr<uint8_t[]>> m_chunks;
+            std::vector<void*>                      m_freeSlots;
+
+        public:
+            void* Allocate(size_t sizeInBytes);
+            static void Release(void* ptr);
+        };
+
     protected:
         virtual void ReleaseAllocation(BufferEntry* ent) = 0;
 
@@ -135,15 +218,45 @@ namespace KickstartRT_NativeLayer
         Status TransitionBarrier(GraphicsAPI::CommandList* cmdList, GraphicsAPI::ResourceState::State state);
         Status UAVBarrier(GraphicsAPI::CommandList* cmdList);
 
+        // With persistent mapping, BatchMap() and BatchUnmap() only invalidate or flush the registered ranges instead of mapping blocks.
         Status BatchMap(GraphicsAPI::Device* dev, GraphicsAPI::Buffer::MapType mapType);
         Status BatchUnmap(GraphicsAPI::Device* dev, GraphicsAPI::Buffer::MapType mapType);
 
+        // Map each block once when it is created and keep it mapped until it is released. Only allowed for CPU accessible pools before any allocation.
+        Status EnablePersistentMapping();
+
         virtual std::unique_ptr<BufferEntry> Allocate(PersistentWorkingSet* pws, size_t requestedSizeInBytes, bool useUAV) = 0;
 
+        // Serve allocations up to maxSlotSizeInBytes from slabs of fixed sized slots. Entries in slabs are never relocated by Defragment().
+        virtual Status EnableSlabAllocation(size_t maxSlotSizeInBytes, uint32_t slotsPerSlab) = 0;
+
+        // Change the allocation granularity of the allocator before any allocation. Zero page size keeps the current one. smallPageThreshold is only used by the fixed page allocator, and zero keeps its default.
+        virtual Status ConfigureAllocator(uint64_t pageSizeInBytes, uint32_t smallPageThreshold) = 0;
+
+        // Double the block size when the ratio of exclusive allocations or the number of shared blocks exceeds the thresholds. A new size takes effect once all shared blocks have been released.
+        virtual Status EnableAutoGrowBlockSize(uint64_t maxBlockSizeInBytes, float exclusiveAllocationRatio, uint32_t blockCountThreshold) = 0;
+
+        // Release blocks that have been unused for framesToRemove calls. With a budget, empty blocks are released immediately while over the soft limit, and warm spare blocks are kept while under it.
         virtual Status CheckUnusedBufferBlocks(uint64_t framesToRemove) = 0;
 
+        void SetBudget(SharedBufferBudget* budget);
+
+        // Committed, allocated and free bytes of the blocks, and the distribution of free runs.
+        virtual void GetUtilization(KickstartRT::ResourceAllocations::SharedPoolUtilization* retUtilization) const = 0;
+
+        // Make released entries that were allocated until finishedTaskIndex reusable. Only the ring allocator defers the reuse.
+        virtual Status ReclaimFinishedAllocations(uint64_t finishedTaskIndex) = 0;
+
+        // Relocate entries in a bounded size to drain a partially used shared block. relocated is set when offsets, UAVs and GPU pointers of any entry have been changed.
+        virtual Status Defragment(PersistentWorkingSet* pws, GraphicsAPI::CommandList* cmdList, size_t maxBytesToMove, bool& relocated) = 0;
+
+        // Record Allocate, release, CheckUnusedBufferBlocks and Defragment calls to replay them offline with the AllocatorReplay tool.
+        Status BeginAllocationTrace(const std::wstring& filePath);
+        Status EndAllocationTrace();
+
     protected:
         decltype(m_bufferBlocks)::iterator AddBufferBlock(PersistentWorkingSet* pws, size_t requestedSizeInBytes);
+        void EraseBufferBlock(decltype(m_bufferBlocks)::iterator itr);
     };
 
     template<typename Allocator>
@@ -158,7 +271,19 @@ namespace KickstartRT_NativeLayer
     public:
         std::unique_ptr<BufferEntry> Allocate(PersistentWorkingSet* pws, size_t requestedSizeInBytes, bool useUAV) override;
 
+        Status EnableSlabAllocation(size_t maxSlotSizeInBytes, uint32_t slotsPerSlab) override;
+
+        Status ConfigureAllocator(uint64_t pageSizeInBytes, uint32_t smallPageThreshold) override;
+
+        Status EnableAutoGrowBlockSize(uint64_t maxBlockSizeInBytes, float exclusiveAllocationRatio, uint32_t blockCountThreshold) override;
+
         Status CheckUnusedBufferBlocks(uint64_t framesToRemove) override;
+
+        void GetUtilization(KickstartRT::ResourceAllocations::SharedPoolUtilization* retUtilization) const override;
+
+        Status ReclaimFinishedAllocations(uint64_t finishedTaskIndex) override;
+
+        Status Defragment(PersistentWorkingSet* pws, GraphicsAPI::CommandList* cmdList, size_t maxBytesToMove, bool& relocated) override;
     };
 
     // using VirtualAllocator::* 
@@ -167,6 +292,7 @@ namespace KickstartRT_NativeLayer
     protected:
         std::map<uint32_t, BufferBlock*>    m_sharedBlocks;
         Allocator                           m_allocator;
+        std::vector<VirtualAllocator::Move> m_moves;
 
         struct UsingBlockStatus {
             std::vector<uint32_t>    m_blockIDs;
@@ -174,9 +300,54 @@ namespace KickstartRT_NativeLayer
         };
         UsingBlockStatus             m_usingBlockStatus;
 
+        // A slab is a chunk allocated by m_allocator and divided into slots of its class size.
+        struct Slab {
+            size_t                  m_globalOffset = (size_t)-1;
+            BufferBlock*            m_block = nullptr;
+            size_t                  m_localOffset = (size_t)-1;
+            uint32_t                m_classIndex = 0;
+            std::vector<uint32_t>   m_freeSlots; // free-index stack.
+        };
+        struct SlabClass {
+            size_t                  m_slotSizeInBytes = 0;
+            std::vector<uint32_t>   m_availableSlabs; // slabs that have free slots. Allocation always takes the top one.
+        };
+        uint32_t                    m_slotsPerSlab = 0;
+        std::vector<SlabClass>      m_slabClasses; // slot sizes are power of two multiples of the alignment size.
+        std::vector<Slab>           m_slabs;
+        std::vector<uint32_t>       m_releasedSlabs;
+        size_t                      m_numEmptySlabs = 0;
+        BufferEntryPool             m_entryPool;
+
+        uint32_t                    m_smallPageThreshold = 0; // zero keeps the default of the fixed page allocator.
+
+        // Statistics since the last evaluation and the next block size of the auto grow mode.
+        struct AutoGrowStatus {
+            static constexpr size_t m_allocationsToEvaluate = 256;
+
+            bool        m_enabled = false;
+            size_t      m_maxBlockSizeInBytes = 0;
+            float       m_exclusiveAllocationRatio = 0.f;
+            uint32_t    m_blockCountThreshold = 0;
+
+            size_t      m_numAllocations = 0;
+            size_t      m_numExclusiveAllocations = 0;
+            size_t      m_pendingBlockSizeInBytes = 0; // zero if the block size is not going to be changed.
+        };
+        AutoGrowStatus              m_autoGrow;
+
     protected:
         void ReleaseAllocation(BufferEntry* ent) override;
 
+        BufferBlock* SharedBlock(PersistentWorkingSet* pws, size_t globalOffset, size_t* retLocalOffset);
+        bool AllocateSlot(PersistentWorkingSet* pws, size_t allocationSize, uint32_t* retSlabIndex, size_t* retGlobalOffset);
+        void ReleaseSlot(BufferEntry* ent);
+        void ReleaseEmptySlabs();
+        static void LinkToBlock(BufferEntry* ent);
+        static void UnlinkFromBlock(BufferEntry* ent);
+        bool InitAllocator();
+        void UpdateAutoGrowBlockSize();
+
     public:
         Status Init(
             GraphicsAPI::Device* dev,
@@ -188,8 +359,20 @@ namespace KickstartRT_NativeLayer
 
         std::unique_ptr<BufferEntry> Allocate(PersistentWorkingSet* pws, size_t requestedSizeInBytes, bool useUAV) override;
 
+        Status EnableSlabAllocation(size_t maxSlotSizeInBytes, uint32_t slotsPerSlab) override;
+
+        Status ConfigureAllocator(uint64_t pageSizeInBytes, uint32_t smallPageThreshold) override;
+
+        Status EnableAutoGrowBlockSize(uint64_t maxBlockSizeInBytes, float exclusiveAllocationRatio, uint32_t blockCountThreshold) override;
+
         Status CheckUnusedBufferBlocks(uint64_t framesToRemove) override;
 
+        void GetUtilization(KickstartRT::ResourceAllocations::SharedPoolUtilization* retUtilization) const override;
+
+        Status ReclaimFinishedAllocations(uint64_t finishedTaskIndex) override;
+
+        Status Defragment(PersistentWorkingSet* pws, GraphicsAPI::CommandList* cmdList, size_t maxBytesToMove, bool& relocated) override;
+
         std::string DumpAllocator(bool dumpEntry, bool dumpFreed, bool dumpVis) const
         {
             return m_allocator.Dump(dumpEntry, dumpFreed, dumpVis);
@@ -200,4 +383,8 @@ namespace KickstartRT_NativeLayer
     class SharedBuffer_Impl<VirtualAllocator::BuddyAllocator> : public SharedBuffer_VirtualAllocatorImpl<VirtualAllocator::BuddyAllocator> {};
     template<>
     class SharedBuffer_Impl<VirtualAllocator::FixedPageAllocator> : public SharedBuffer_VirtualAllocatorImpl<VirtualAllocator::FixedPageAllocator> {};
+    template<>
+    class SharedBuffer_Impl<VirtualAllocator::TLSFAllocator> : public SharedBuffer_VirtualAllocatorImpl<VirtualAllocator::TLSFAllocator> {};
+    template<>
+    class SharedBuffer_Impl<VirtualAllocator::RingAllocator> : public SharedBuffer_VirtualAllocatorImpl<VirtualAllocator::RingAllocator> {};
 };
\ No newline at end of file
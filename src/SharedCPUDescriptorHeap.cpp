@@ -44,7 +44,7 @@ namespace KickstartRT_NativeLayer
 
 		// try to find a entry form exisitng pools
 		for (auto&& h : m_heapBlocks) {
-			if (h->m_availableTables.size() == 0 && h->m_totalCreated >= m_totalNumberOfDescTableInHeapBlock)
+			if (!h->HasAvailableTable())
 				continue;
 			availableH = h.get();
 			break;
@@ -64,30 +64,35 @@ namespace KickstartRT_NativeLayer
 			}
 			newH->m_heap.SetName(DebugName(L"Shared CPU Descriptor."));
 
+			// allocate all bookkeeping up front so that allocations and releases don't touch the heap memory.
+			newH->m_numTables = (uint32_t)(m_totalNumberOfDescTableInHeapBlock / m_fixedAllocationSize);
+			newH->m_tables = std::make_unique<GraphicsAPI::DescriptorTable[]>(newH->m_numTables);
+			newH->m_isUsing.resize(newH->m_numTables, false);
+			newH->m_freeIndices.reserve(newH->m_numTables);
+
 			availableH = newH.get();
 			m_heapBlocks.push_back(std::move(newH));
 		}
 
-		GraphicsAPI::DescriptorTable* retTable = nullptr;
+		uint32_t retIndex = 0;
 
-		if (availableH->m_availableTables.size() > 0) {
-			// reuse an available entry.
-			retTable = availableH->m_availableTables.front();
-			availableH->m_availableTables.pop_front();
+		if (availableH->m_freeIndices.size() > 0) {
+			// reuse the most recently released entry.
+			retIndex = availableH->m_freeIndices.back();
+			availableH->m_freeIndices.pop_back();
 		}
 		else
 		{
 			// create new entry.
-			auto dt = std::make_unique<GraphicsAPI::DescriptorTable>();
-			if (!dt->Allocate(&availableH->m_heap, &m_fixedLayout, 0)) {
+			retIndex = availableH->m_numCreated;
+			if (!availableH->m_tables[retIndex].Allocate(&availableH->m_heap, &m_fixedLayout, 0)) {
 				Log::Fatal(L"Failed to allocate descriptor table from a pool.");
 				return std::unique_ptr<SharedCPUDescriptorHeap::SharedTableEntry>();
 			}
-			retTable = dt.release();
-			availableH->m_totalCreated += m_fixedAllocationSize;
+			availableH->m_numCreated++;
 		}
-		availableH->m_usingTables.insert(retTable);
+		availableH->m_isUsing[retIndex] = true;
 
-		return std::make_unique<SharedCPUDescriptorHeap::SharedTableEntry>(this, availableH, retTable);
+		return std::make_unique<SharedCPUDescriptorHeap::SharedTableEntry>(this, availableH, retIndex);
 	}
 };
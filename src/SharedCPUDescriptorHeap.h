@@ -24,8 +24,8 @@
 #include <GraphicsAPI/GraphicsAPI.h>
 
 #include <deque>
-#include <list>
-#include <set>
+#include <vector>
+#include <memory>
 
 namespace KickstartRT_NativeLayer
 {
@@ -39,10 +39,28 @@ namespace KickstartRT_NativeLayer
 
         struct SharedHeapBlock
         {
-            GraphicsAPI::DescriptorHeap				    m_heap;
-            size_t	                                    m_totalCreated = 0;
-            std::list<GraphicsAPI::DescriptorTable*>	m_availableTables;
-            std::set<GraphicsAPI::DescriptorTable*>     m_usingTables;
+            GraphicsAPI::DescriptorHeap				            m_heap;
+            std::unique_ptr<GraphicsAPI::DescriptorTable[]>     m_tables; // all tables in the heap. a table is allocated from the heap on its first use.
+            std::vector<uint8_t>                                m_isUsing;
+            std::vector<uint32_t>                               m_freeIndices; // stack of released table indices. reserved for all tables.
+            uint32_t                                            m_numTables = 0;
+            uint32_t                                            m_numCreated = 0;
+
+            bool HasAvailableTable() const
+            {
+                return m_freeIndices.size() > 0 || m_numCreated < m_numTables;
+            };
+
+            void Release(uint32_t index)
+            {
+                // invalid desctable
+                if (index >= m_numCreated || !m_isUsing[index]) {
+                    Log::Fatal(L"Failed to release a descriptor heap entry");
+                    return;
+                }
+                m_isUsing[index] = false;
+                m_freeIndices.push_back(index);
+            };
         };
         std::deque<std::unique_ptr<SharedHeapBlock>>    m_heapBlocks;
 
@@ -52,30 +70,22 @@ namespace KickstartRT_NativeLayer
         protected:
             SharedCPUDescriptorHeap* const m_manager;
             SharedHeapBlock* const         m_heapBlock;
+            const uint32_t                 m_index;
 
         public:
             GraphicsAPI::DescriptorTable* const m_table;
 
         public:
-            SharedTableEntry(SharedCPUDescriptorHeap* manager, SharedHeapBlock* heapBlock, GraphicsAPI::DescriptorTable* table) :
+            SharedTableEntry(SharedCPUDescriptorHeap* manager, SharedHeapBlock* heapBlock, uint32_t index) :
                 m_manager(manager),
                 m_heapBlock(heapBlock),
-                m_table(table)
+                m_index(index),
+                m_table(&heapBlock->m_tables[index])
             {};
 
             ~SharedTableEntry()
             {
-                auto itr = m_heapBlock->m_usingTables.find(m_table);
-
-                // invalid desctable
-                if (itr == m_heapBlock->m_usingTables.end()) {
-                    Log::Fatal(L"Failed to release a descriptor heap entry");
-                }
-                else {
-                    // remove from used entry and put it to the tail of available list.
-                    m_heapBlock->m_usingTables.erase(itr);
-                    m_heapBlock->m_availableTables.push_back(m_table);
-                }
+                m_heapBlock->Release(m_index);
             };
         };
 
@@ -0,0 +1,162 @@
+/*
+* Copyright (c) 2022 NVIDIA CORPORATION. All rights reserved
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <atomic>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace KickstartRT_NativeLayer
+{
+	// Generation indexed slot map which owns the records and issues handles for them.
+	// A handle is [generation:32][slot index:32]. The generation of a slot is odd while it is alive and incremented on both allocation and free,
+	// so a stale handle is rejected by comparing generations without touching the freed record.
+	// Records are placed in fixed size chunks which are never moved, so pointers to them stay valid until they are freed.
+	// Allocate() and Free() are serialized with a mutex, and ToPtr() doesn't take it.
+	template<typename T, typename HType>
+	class SlotMap {
+	public:
+		static constexpr uint32_t	kChunkSizeLog2 = 12;
+		static constexpr uint32_t	kChunkSize = 1u << kChunkSizeLog2;
+		static constexpr uint32_t	kMaxChunks = 4096; // 16M slots.
+
+	protected:
+		struct Slot {
+			std::atomic<uint32_t>	m_generation = 0;
+			alignas(T) uint8_t		m_storage[sizeof(T)];
+		};
+
+		std::array<std::atomic<Slot*>, kMaxChunks>	m_chunks = {};
+		std::atomic<uint32_t>						m_numSlots = 0;
+		std::vector<uint32_t>						m_freeIndices;
+		std::mutex									m_mutex;
+
+		Slot* GetSlot(uint32_t index) const
+		{
+			Slot* chunk = m_chunks[index >> kChunkSizeLog2].load(std::memory_order_acquire);
+			return &chunk[index & (kChunkSize - 1)];
+		}
+
+		static T* GetRecord(Slot* slot)
+		{
+			return std::launder(reinterpret_cast<T*>(slot->m_storage));
+		}
+
+	public:
+		SlotMap() = default;
+		SlotMap(const SlotMap&) = delete;
+		SlotMap& operator=(const SlotMap&) = delete;
+
+		~SlotMap()
+		{
+			// Records still alive at this point are leaked by the application, only the storage is released.
+			for (auto&& c : m_chunks)
+				delete[] c.load();
+		}
+
+		static uint64_t MakeHandle(uint32_t index, uint32_t generation)
+		{
+			return ((uint64_t)generation << 32) | (uint64_t)index;
+		}
+
+		// The record is constructed with its handle value as the first argument. Returns nullptr when all slots are in use.
+		template<typename ... Args>
+		T* Allocate(Args&& ... args)
+		{
+			std::scoped_lock mtx(m_mutex);
+
+			uint32_t index;
+			bool isNewSlot = false;
+			if (m_freeIndices.size() > 0) {
+				index = m_freeIndices.back();
+				m_freeIndices.pop_back();
+			}
+			else {
+				index = m_numSlots.load(std::memory_order_relaxed);
+				if ((index >> kChunkSizeLog2) >= kMaxChunks)
+					return nullptr;
+				if ((index & (kChunkSize - 1)) == 0)
+					m_chunks[index >> kChunkSizeLog2].store(new Slot[kChunkSize], std::memory_order_release);
+				isNewSlot = true;
+			}
+
+			Slot* slot = GetSlot(index);
+			const uint32_t generation = slot->m_generation.load(std::memory_order_relaxed) + 1;
+			assert((generation & 1) == 1);
+
+			T* p = new (slot->m_storage) T(MakeHandle(index, generation), std::forward<Args>(args)...);
+			slot->m_generation.store(generation, std::memory_order_release);
+			if (isNewSlot)
+				m_numSlots.store(index + 1, std::memory_order_release);
+
+			return p;
+		}
+
+		void Free(T* p)
+		{
+			if (p == nullptr)
+				return;
+
+			const uint32_t index = (uint32_t)((uint64_t)p->m_id & 0xFFFF'FFFFull);
+
+			std::scoped_lock mtx(m_mutex);
+
+			// Invalidate handles first, then destruct the record.
+			Slot* slot = GetSlot(index);
+			slot->m_generation.fetch_add(1, std::memory_order_acq_rel);
+			p->~T();
+
+			m_freeIndices.push_back(index);
+		}
+
+		// Returns nullptr for a null, stale or foreign handle.
+		T* ToPtr(HType handle) const
+		{
+			const uint64_t h = static_cast<uint64_t>(handle);
+			const uint32_t index = (uint32_t)(h & 0xFFFF'FFFFull);
+			const uint32_t generation = (uint32_t)(h >> 32);
+
+			if ((generation & 1) == 0 || index >= m_numSlots.load(std::memory_order_acquire))
+				return nullptr;
+
+			Slot* slot = GetSlot(index);
+			if (slot->m_generation.load(std::memory_order_acquire) != generation)
+				return nullptr;
+
+			return GetRecord(slot);
+		}
+	};
+
+	// Deleter to return a record to the slot map of its type, so that std::unique_ptr can own records.
+	template<typename T>
+	struct SlotMapDeleter {
+		void operator()(T* p) const
+		{
+			T::GetSlotMap().Free(p);
+		}
+	};
+};
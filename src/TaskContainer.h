@@ -203,6 +203,7 @@ namespace KickstartRT_NativeLayer
 
 		uint32_t					m_maxBLASbuildCount = 0u;
 		bool						m_buildTLAS = false;
+		uint32_t					m_maxTLASRefitCount = 0u;
 
 	public:
 		Status RegisterGeometry(GeometryHandle gHandle, const BVHTask::GeometryInput* input);
@@ -114,6 +114,34 @@ namespace KickstartRT_NativeLayer
 		return true;
 	}
 
+	Status TaskTracker::GetDescriptorTableCacheStatistics(DescriptorTableCacheStatistics* retStatistics)
+	{
+		std::scoped_lock mtx(m_mutex);
+
+		if (retStatistics == nullptr)
+			return Status::ERROR_INVALID_PARAM;
+
+		*retStatistics = {};
+		for (auto&& tws : m_taskWorkingSets)
+			tws->m_descTableCache.AddStatistics(retStatistics);
+
+		return Status::OK;
+	}
+
+	Status TaskTracker::GetVolatileConstantBufferStatistics(VolatileConstantBufferStatistics* retStatistics)
+	{
+		std::scoped_lock mtx(m_mutex);
+
+		if (retStatistics == nullptr)
+			return Status::ERROR_INVALID_PARAM;
+
+		*retStatistics = {};
+		for (auto&& tws : m_taskWorkingSets)
+			tws->m_volatileConstantBuffer.AddStatistics(retStatistics);
+
+		return Status::OK;
+	}
+
 	Status TaskTracker::AllocateTaskWorkingSet(TaskWorkingSet **ret_tws, uint64_t *ret_taskIndex)
 	{
 		std::scoped_lock mtx(m_mutex);
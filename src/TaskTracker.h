@@ -57,6 +57,8 @@ namespace KickstartRT_NativeLayer
 		bool TaskWorkingSetIsAvailable();
 		Status UpdateFinishedTaskIndex(uint64_t finishedTaskIndex);
 		Status AllocateTaskWorkingSet(TaskWorkingSet** ret_tws, uint64_t *ret_taskIndex);
+		Status GetDescriptorTableCacheStatistics(DescriptorTableCacheStatistics* retStatistics);
+		Status GetVolatileConstantBufferStatistics(VolatileConstantBufferStatistics* retStatistics);
 	};
 };
 
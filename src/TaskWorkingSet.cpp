@@ -25,36 +25,82 @@
 #include <Log.h>
 
 #include <string>
+#include <algorithm>
 
 namespace KickstartRT_NativeLayer
 {
-	Status TaskWorkingSet::VolatileConstantBuffer::BeginMapping(GraphicsAPI::Device* dev)
+	Status TaskWorkingSet::VolatileConstantBuffer::InsertPage(GraphicsAPI::Device* dev, size_t pos, uint64_t sizeInBytes)
 	{
-		m_currentOffsetInBytes = 0;
+		std::unique_ptr<Page> page = std::make_unique<Page>();
+
+		if (!page->m_cb.Create(dev, sizeInBytes, GraphicsAPI::Resource::Format::Unknown,
+			GraphicsAPI::Resource::BindFlags::Constant, GraphicsAPI::Buffer::CpuAccess::Write)) {
+			Log::Fatal(L"Failed to allocate volatile constant buffer");
+			return Status::ERROR_INTERNAL;
+		}
+		page->m_cb.SetName(DebugName(L"TaskWorkingSet - VolatileConstantBuffer[%d]", (uint32_t)m_pages.size()));
 
-		if (m_cpuPtr != 0) {
-			Log::Fatal(L"Failed to Begin Mapping since m_cpuPtr != 0");
+		if (page->m_cb.MapPersistently(dev) == nullptr) {
+			Log::Fatal(L"Failed to map volatile constant buffer");
 			return Status::ERROR_INTERNAL;
 		}
 
-		m_cpuPtr = (intptr_t)m_cb.Map(dev, GraphicsAPI::Buffer::MapType::WriteDiscard, 0, 0, m_cb.m_sizeInBytes);
-		if (m_cpuPtr == 0) {
-			Log::Fatal(L"Failed to map volatile constant buffer, device removal state is suspected.");
+		m_allocatedSizeInBytes += sizeInBytes;
+		++m_numPages;
+		m_pages.insert(m_pages.begin() + pos, std::move(page));
+
+		return Status::OK;
+	}
+
+	Status TaskWorkingSet::VolatileConstantBuffer::Init(GraphicsAPI::Device* dev, uint64_t pageSizeInBytes)
+	{
+		m_pageSizeInBytes = pageSizeInBytes;
+
+		return InsertPage(dev, 0, m_pageSizeInBytes);
+	}
+
+	Status TaskWorkingSet::VolatileConstantBuffer::BeginMapping(GraphicsAPI::Device* dev, uint64_t taskIndex)
+	{
+		if (m_device != nullptr) {
+			Log::Fatal(L"Failed to Begin Mapping since the volatile constant buffer is already mapped.");
 			return Status::ERROR_INTERNAL;
 		}
 
+		// release chained pages that have not been used for a while. the first page is always kept.
+		constexpr uint64_t tasksToRemovePages = 30;
+		while (m_pages.size() > 1 && m_pages.back()->m_lastUsedTaskIndex + tasksToRemovePages < taskIndex) {
+			m_allocatedSizeInBytes -= m_pages.back()->m_cb.m_sizeInBytes;
+			--m_numPages;
+			m_pages.pop_back();
+		}
+
+		// pages are mapped once when created. the task working set is not reused until its previous task has finished on the GPU.
+		for (auto&& page : m_pages)
+			page->m_usedSizeInBytes = 0;
+		m_currentPage = 0;
+		m_currentOffsetInBytes = 0;
+		m_usedSizeInBytes = 0;
+		m_taskIndex = taskIndex;
+		m_device = dev;
+
 		return Status::OK;
 	}
 
 	void TaskWorkingSet::VolatileConstantBuffer::EndMapping(GraphicsAPI::Device* dev)
 	{
-		m_cb.Unmap(dev, 0, 0, m_cb.m_sizeInBytes);
-		m_cpuPtr = 0;
+		if (m_device != nullptr) {
+			for (size_t i = 0; i <= m_currentPage && i < m_pages.size(); ++i)
+				m_pages[i]->m_cb.FlushMappedRange(dev, 0, m_pages[i]->m_usedSizeInBytes);
+
+			if (m_highWaterMarkInBytes < m_usedSizeInBytes)
+				m_highWaterMarkInBytes = m_usedSizeInBytes;
+		}
+		m_device = nullptr;
 	}
 
 	Status TaskWorkingSet::VolatileConstantBuffer::Allocate(uint32_t allocationSizeInByte,	GraphicsAPI::ConstantBufferView *cbv, void** ptrForWrite)
 	{
-		if (m_cpuPtr == 0) {
+		if (m_device == nullptr) {
 			Log::Fatal(L"Failed to Allocate because the volatile constant buffer is unmapped.");
 			return Status::ERROR_INTERNAL;
 		}
@@ -62,79 +108,97 @@ namespace KickstartRT_NativeLayer
 		allocationSizeInByte = GraphicsAPI::Buffer::ConstantBufferPlacementAlignment(allocationSizeInByte);
 		*ptrForWrite = nullptr;
 
-		if (m_cb.m_sizeInBytes < m_currentOffsetInBytes + (uint64_t)allocationSizeInByte) {
-			Log::Fatal(L"Failed to allocate volatile constant buffer. BufferSize:%d CurrentOffset:%d TriedToAllocate:%d", m_cb.m_sizeInBytes, m_currentOffsetInBytes, allocationSizeInByte);
-			return Status::ERROR_INTERNAL;
+		if (m_pages[m_currentPage]->m_cb.m_sizeInBytes < m_currentOffsetInBytes + (uint64_t)allocationSizeInByte) {
+			// move on to the next page, a larger page is inserted for an allocation that doesn't fit in a page.
+			++m_currentPage;
+			m_currentOffsetInBytes = 0;
+			if (m_currentPage == m_pages.size() || m_pages[m_currentPage]->m_cb.m_sizeInBytes < (uint64_t)allocationSizeInByte) {
+				uint64_t pageSizeInBytes = GraphicsAPI::Resource::DefaultResourcePlacementAlignment(std::max(m_pageSizeInBytes, (uint64_t)allocationSizeInByte));
+				RETURN_IF_STATUS_FAILED(InsertPage(m_device, m_currentPage, pageSizeInBytes));
+			}
 		}
-		if (!cbv->Init(&m_cb, (uint32_t)m_currentOffsetInBytes, allocationSizeInByte)) {
+
+		Page* page = m_pages[m_currentPage].get();
+		if (!cbv->Init(&page->m_cb, (uint32_t)m_currentOffsetInBytes, allocationSizeInByte)) {
 			Log::Fatal(L"Failed to init CBV");
 			return Status::ERROR_INTERNAL;
 		}
-		*ptrForWrite = reinterpret_cast<void*>(m_cpuPtr + m_currentOffsetInBytes);
+		*ptrForWrite = reinterpret_cast<void*>((intptr_t)page->m_cb.m_persistentMappedPtr + m_currentOffsetInBytes);
 		m_currentOffsetInBytes += allocationSizeInByte;
 
+		page->m_usedSizeInBytes = m_currentOffsetInBytes;
+		page->m_lastUsedTaskIndex = m_taskIndex;
+		m_usedSizeInBytes += allocationSizeInByte;
+
 		return Status::OK;
 	}
 
+	void TaskWorkingSet::VolatileConstantBuffer::AddStatistics(KickstartRT::VolatileConstantBufferStatistics* retStatistics) const
+	{
+		retStatistics->m_highWaterMarkInBytes = std::max(retStatistics->m_highWaterMarkInBytes, m_highWaterMarkInBytes.load());
+		retStatistics->m_allocatedSizeInBytes += m_allocatedSizeInBytes;
+		retStatistics->m_numPages += m_numPages;
+	}
+
+	GraphicsAPI::DescriptorHeap::Desc TaskWorkingSet::VolatileDescHeapDesc(uint32_t numRenderTasks) const
+	{
+		// VK needs a distinct desc heap budget.
+		// SDK should able to do any render task with 2 samplers, 10 tex SRVs, 5 tex UAVs, 3 CBVs and 2 ASs (static and dynamic TLAS).
+		constexpr uint32_t descHeapBudgetForARenderTask[7] = { 2, 10, 5, 0, 0, 3, 2 };
+		// Budget for at least 20 render tasks is kept for geometry tasks.
+		constexpr uint32_t minRenderTaskNum = 20;
+		const uint32_t renderTaskNum = std::max(numRenderTasks, minRenderTaskNum);
+
+		// Buffer SRVs are used for adding geometry
+		// Buffer UAVs are used for adding geometry and direct lighting cache array.
+		using dh = GraphicsAPI::DescriptorHeap;
+		dh::Desc	desc = {};
+		desc.setDescCount(dh::Type::Sampler, descHeapBudgetForARenderTask[0] * renderTaskNum);
+		desc.setDescCount(dh::Type::TextureSrv, descHeapBudgetForARenderTask[1] * renderTaskNum);
+		desc.setDescCount(dh::Type::TextureUav, descHeapBudgetForARenderTask[2] * renderTaskNum);
+		desc.setDescCount(dh::Type::TypedBufferSrv, descHeapBudgetForARenderTask[3] * renderTaskNum + m_descHeapSize / 4);
+		desc.setDescCount(dh::Type::TypedBufferUav, descHeapBudgetForARenderTask[4] * renderTaskNum + m_descHeapSize / 4 * 3);
+		desc.setDescCount(dh::Type::Cbv, descHeapBudgetForARenderTask[5] * renderTaskNum);
+		desc.setDescCount(dh::Type::AccelerationStructureSrv, descHeapBudgetForARenderTask[6] * renderTaskNum);
+
+		return desc;
+	}
+
 	Status TaskWorkingSet::Init(const ExecuteContext_InitSettings * const settings)
 	{
 		// CBV/SRV/UAV descriptor heap
 		{
-			// VK needs a distinct desc heap budget.
-			// SDK should able to do any render task with 2 samplers, 10 tex SRVs, 5 tex UAVs, 3 CBVs and 1 AS.
-			constexpr uint32_t descHeapBudgetForARenderTask[7] = { 2, 10, 5, 0, 0, 3, 1 };
-			constexpr uint32_t supportedRenderTaskNum = 20;
-
-			// Buffer SRVs are used for adding geometry
-			// Buffer UAVs are used for adding geometry and direct lighting cache array.
 			using dh = GraphicsAPI::DescriptorHeap;
-			dh::Desc	desc = {};
-			uint32_t totalDescs = 0;
-			desc.m_descCount[dh::value(dh::Type::Sampler)] = descHeapBudgetForARenderTask[0] * supportedRenderTaskNum;
-			totalDescs += desc.m_descCount[dh::value(dh::Type::Sampler)];
-			desc.m_descCount[dh::value(dh::Type::TextureSrv)] = descHeapBudgetForARenderTask[1] * supportedRenderTaskNum;
-			totalDescs += desc.m_descCount[dh::value(dh::Type::TextureSrv)];
-			desc.m_descCount[dh::value(dh::Type::TextureUav)] = descHeapBudgetForARenderTask[2] * supportedRenderTaskNum;
-			totalDescs += desc.m_descCount[dh::value(dh::Type::TextureUav)];
-			desc.m_descCount[dh::value(dh::Type::TypedBufferSrv)] = descHeapBudgetForARenderTask[3] * supportedRenderTaskNum + settings->descHeapSize / 4;
-			totalDescs += desc.m_descCount[dh::value(dh::Type::TypedBufferSrv)];
-			desc.m_descCount[dh::value(dh::Type::TypedBufferUav)] = descHeapBudgetForARenderTask[4] * supportedRenderTaskNum + settings->descHeapSize / 4 * 3;
-			totalDescs += desc.m_descCount[dh::value(dh::Type::TypedBufferUav)];
-			desc.m_descCount[dh::value(dh::Type::Cbv)] = descHeapBudgetForARenderTask[5] * supportedRenderTaskNum;
-			totalDescs += desc.m_descCount[dh::value(dh::Type::Cbv)];
-			desc.m_descCount[dh::value(dh::Type::AccelerationStructureSrv)] = descHeapBudgetForARenderTask[6] * supportedRenderTaskNum;
-			totalDescs += desc.m_descCount[dh::value(dh::Type::AccelerationStructureSrv)];
-			desc.m_totalDescCount = totalDescs;
-
-#if defined(GRAPHICS_API_D3D12)
-			if (m_persistentWorkingSet->m_descHeaps.size() == 0) {
-				// Allocate a desc heap whic is going to be shared with all task working set.
-				dh::Desc	descForAll = desc;
-				for (auto&& ent : descForAll.m_descCount) {
-					ent *= settings->supportedWorkingsets;
-				}
-				descForAll.m_totalDescCount *= settings->supportedWorkingsets;
 
-				std::unique_ptr<GraphicsAPI::DescriptorHeap>	heap = std::make_unique<GraphicsAPI::DescriptorHeap>();
-				if (!heap->Create(&m_persistentWorkingSet->m_device, descForAll, true)) {
-					Log::Fatal(L"Failed to create descriptor heap");
-					return Status::ERROR_FAILED_TO_INIT_TASK_WORKING_SET;
-				}
-				heap->SetName(DebugName(L"TaskWorkingSet"));
+			m_descHeapSize = settings->descHeapSize;
+			dh::Desc	desc = VolatileDescHeapDesc(0);
 
-				m_persistentWorkingSet->m_descHeaps.push_back(std::move(heap));
+#if defined(GRAPHICS_API_D3D12)
+			// Persistent region of the descriptor table cache. Samplers are only used by a few tables.
+			if (settings->descTableCacheSize > 0) {
+				constexpr uint32_t descTableCacheSamplerCount = 64;
+				m_descTableCacheDesc.setDescCount(dh::Type::TextureSrv, settings->descTableCacheSize);
+				m_descTableCacheDesc.setDescCount(dh::Type::Sampler, descTableCacheSamplerCount);
 			}
-			{
-				std::unique_ptr<GraphicsAPI::DescriptorSubHeap>	h = std::make_unique<GraphicsAPI::DescriptorSubHeap>();
-				// Suballocate desc heap for each task working set.
 
-				if (!h->Init(m_persistentWorkingSet->m_descHeaps[0].get(), desc)) {
-					Log::Fatal(L"Failed to suballocate descriptor heap");
-					return Status::ERROR_FAILED_TO_INIT_TASK_WORKING_SET;
+			if (! m_persistentWorkingSet->m_descRingHeap) {
+				// Allocate a ring desc heap which is going to be shared with all task working sets.
+				// Cache regions of all task working sets are placed before the ring.
+				dh::Desc	reservedDesc = {};
+				dh::Desc	ringDesc = {};
+				for (uint32_t i = 0; i < dh::value(dh::Type::Count); ++i) {
+					reservedDesc.setDescCount((dh::Type)i, m_descTableCacheDesc.m_descCount[i] * settings->supportedWorkingsets);
+					ringDesc.setDescCount((dh::Type)i, desc.m_descCount[i] * settings->supportedWorkingsets);
 				}
 
-				m_CBVSRVUAVHeap = std::move(h);
+				std::unique_ptr<DescriptorRingHeap>	ringHeap = std::make_unique<DescriptorRingHeap>();
+				RETURN_IF_STATUS_FAILED(ringHeap->Init(m_persistentWorkingSet, reservedDesc, ringDesc));
+
+				m_persistentWorkingSet->m_descRingHeap = std::move(ringHeap);
 			}
+
+			// A segment of the ring is assigned at the beginning of each task.
+			m_CBVSRVUAVHeap = std::make_unique<GraphicsAPI::DescriptorSubHeap>();
 #elif  defined(GRAPHICS_API_VK)
 			{
 				std::unique_ptr<GraphicsAPI::DescriptorHeap>	h = std::make_unique<GraphicsAPI::DescriptorHeap>();
@@ -153,16 +217,11 @@ namespace KickstartRT_NativeLayer
 		{
 			uint64_t volatileConstantBufferSizeInBytes = GraphicsAPI::Resource::DefaultResourcePlacementAlignment((uint64_t)settings->uploadHeapSizeForVolatileConstantBuffers);
 
-			if (!m_volatileConstantBuffer.m_cb.Create(&m_persistentWorkingSet->m_device,
-				volatileConstantBufferSizeInBytes, GraphicsAPI::Resource::Format::Unknown,
-				GraphicsAPI::Resource::BindFlags::Constant, GraphicsAPI::Buffer::CpuAccess::Write)) {
-				Log::Fatal(L"Failed to allocate volatile constant buffer");
-				return (Status::ERROR_INTERNAL);
-			}
-			m_volatileConstantBuffer.m_cb.SetName(DebugName(L"TaskWorkingSet - VolatileConstantBuffer"));
+			RETURN_IF_STATUS_FAILED(m_volatileConstantBuffer.Init(&m_persistentWorkingSet->m_device, volatileConstantBufferSizeInBytes));
 		}
 
-		m_TLASUploadBuffer = std::make_unique<GraphicsAPI::Buffer>();
+		for (auto&& b : m_TLASUploadBuffers)
+			b = std::make_unique<GraphicsAPI::Buffer>();
 #if KICKSTARTRT_ENABLE_DIRECT_LIGHTING_CACHE_INDIRECTION_TABLE
 		m_directLightingCacheIndirectionTableUploadBuffer = std::make_unique<GraphicsAPI::Buffer>();
 #endif
@@ -170,13 +229,45 @@ namespace KickstartRT_NativeLayer
 		return Status::OK;
 	};
 
-	Status TaskWorkingSet::Begin()
+	Status TaskWorkingSet::Begin(uint32_t numRenderTasks)
 	{
+		using dh = GraphicsAPI::DescriptorHeap;
+
+		dh::Desc	desc = VolatileDescHeapDesc(numRenderTasks);
+
+#if defined(GRAPHICS_API_D3D12)
+		// assign a segment of the ring, which also resets desc heap allocation.
+		DescriptorRingHeap* ringHeap = m_persistentWorkingSet->m_descRingHeap.get();
+		RETURN_IF_STATUS_FAILED(ringHeap->AllocateTaskSegment(m_persistentWorkingSet, m_persistentWorkingSet->GetCurrentTaskIndex(), desc,
+			static_cast<GraphicsAPI::DescriptorSubHeap*>(m_CBVSRVUAVHeap.get())));
+
+		// cached tables are dropped when the heap has been reallocated.
+		if (m_descTableCacheGeneration != ringHeap->GetGeneration()) {
+			RETURN_IF_STATUS_FAILED(m_descTableCache.Init(ringHeap->GetHeap(), m_descTableCacheDesc));
+			m_descTableCacheGeneration = ringHeap->GetGeneration();
+		}
+#elif defined(GRAPHICS_API_VK)
+		// the previous task of this working set has been finished, so the pool can be recreated with a larger size.
+		dh* heap = static_cast<dh*>(m_CBVSRVUAVHeap.get());
+		if (heap->m_desc.m_totalDescCount < desc.m_totalDescCount) {
+			std::unique_ptr<dh>	h = std::make_unique<dh>();
+			if (!h->Create(&m_persistentWorkingSet->m_device, desc, true)) {
+				Log::Fatal(L"Failed to create descriptor heap");
+				return Status::ERROR_INTERNAL;
+			}
+			h->SetName(DebugName(L"TaskWorkingSet"));
+
+			m_persistentWorkingSet->DeferredRelease(std::move(m_CBVSRVUAVHeap));
+			m_CBVSRVUAVHeap = std::move(h);
+		}
+
 		// reset desc heap allocation.
 		m_CBVSRVUAVHeap->ResetAllocation();
+#endif
+		m_descTableCache.BeginTask();
 
 		// reset upload heap for volatile constant buffer.
-		m_volatileConstantBuffer.BeginMapping(&m_persistentWorkingSet->m_device);
+		RETURN_IF_STATUS_FAILED(m_volatileConstantBuffer.BeginMapping(&m_persistentWorkingSet->m_device, m_persistentWorkingSet->GetCurrentTaskIndex()));
 
 		return Status::OK;
 	}
@@ -24,10 +24,12 @@
 #include <GraphicsAPI/GraphicsAPI.h>
 #include <Utils.h>
 #include <PersistentWorkingSet.h>
+#include <DescriptorTableCache.h>
 
 #include <vector>
 #include <list>
 #include <memory>
+#include <atomic>
 
 namespace KickstartRT_NativeLayer
 {
@@ -36,30 +38,59 @@ namespace KickstartRT_NativeLayer
 	class TaskWorkingSet
 	{
 	public:
+		// Persistently mapped upload pages, which are chained when a task runs out of them.
+		// Pages are reused by the next task of the working set, which begins after the GPU has finished the previous one.
 		struct VolatileConstantBuffer
 		{
-			GraphicsAPI::Buffer					m_cb;
-			uint64_t							m_currentOffsetInBytes;
-			intptr_t							m_cpuPtr;
-
-			VolatileConstantBuffer()
+			struct Page
 			{
-				m_currentOffsetInBytes = 0;
-				m_cpuPtr = 0;
+				GraphicsAPI::Buffer				m_cb;
+				uint64_t						m_usedSizeInBytes = 0;
+				uint64_t						m_lastUsedTaskIndex = 0;
 			};
-			Status BeginMapping(GraphicsAPI::Device* dev);
+
+			std::vector<std::unique_ptr<Page>>	m_pages;
+			uint64_t							m_pageSizeInBytes = 0;
+			size_t								m_currentPage = 0;
+			uint64_t							m_currentOffsetInBytes = 0;
+			uint64_t							m_usedSizeInBytes = 0; // in the current task.
+			uint64_t							m_taskIndex = 0;
+			GraphicsAPI::Device*				m_device = nullptr; // valid while mapping.
+
+			// read from the other threads.
+			std::atomic<uint64_t>				m_highWaterMarkInBytes = 0;
+			std::atomic<uint64_t>				m_allocatedSizeInBytes = 0;
+			std::atomic<uint32_t>				m_numPages = 0;
+
+			Status InsertPage(GraphicsAPI::Device* dev, size_t pos, uint64_t sizeInBytes);
+
+			Status Init(GraphicsAPI::Device* dev, uint64_t pageSizeInBytes);
+			Status BeginMapping(GraphicsAPI::Device* dev, uint64_t taskIndex);
 			void EndMapping(GraphicsAPI::Device* dev);
 
 			Status Allocate(uint32_t allocationSizeInByte, GraphicsAPI::ConstantBufferView* cbv, void** ptrForWrite);
+
+			void AddStatistics(KickstartRT::VolatileConstantBufferStatistics* retStatistics) const;
 		};
 
 		PersistentWorkingSet* const			m_persistentWorkingSet;
 
 		std::unique_ptr<GraphicsAPI::IDescriptorHeap>		m_CBVSRVUAVHeap;
+		DescriptorTableCache				m_descTableCache;
 		VolatileConstantBuffer				m_volatileConstantBuffer;
 
+	protected:
+		uint32_t							m_descHeapSize = 0;
+#if defined(GRAPHICS_API_D3D12)
+		GraphicsAPI::DescriptorHeap::Desc	m_descTableCacheDesc = {};
+		uint64_t							m_descTableCacheGeneration = 0; // generation of the ring heap that the cache is placed in.
+#endif
+
+		// Descriptors of the volatile heap for a task.
+		GraphicsAPI::DescriptorHeap::Desc VolatileDescHeapDesc(uint32_t numRenderTasks) const;
+
 	public:
-		std::unique_ptr<GraphicsAPI::Buffer>		m_TLASUploadBuffer;
+		std::unique_ptr<GraphicsAPI::Buffer>		m_TLASUploadBuffers[(size_t)TLASBuildStatistics::Partition::e_Num_Partitions];
 #if KICKSTARTRT_ENABLE_DIRECT_LIGHTING_CACHE_INDIRECTION_TABLE
 		std::unique_ptr<GraphicsAPI::Buffer>		m_directLightingCacheIndirectionTableUploadBuffer;
 #endif
@@ -70,7 +101,7 @@ namespace KickstartRT_NativeLayer
 		};
 
 		Status Init(const KickstartRT_NativeLayer::ExecuteContext_InitSettings* const settings);
-		Status Begin();
+		Status Begin(uint32_t numRenderTasks);
 		Status End();
 	};
 
@@ -80,10 +111,10 @@ namespace KickstartRT_NativeLayer
 		TaskWorkingSet*				m_set;
 		GraphicsAPI::CommandList*	m_commandList = nullptr;
 
-		TaskWorkingSetCommandList(TaskWorkingSet* set, GraphicsAPI::CommandList *userPorvidedCmdList) :
+		TaskWorkingSetCommandList(TaskWorkingSet* set, GraphicsAPI::CommandList *userPorvidedCmdList, uint32_t numRenderTasks) :
 			m_set(set)
 		{
-			m_sts = m_set->Begin();
+			m_sts = m_set->Begin(numRenderTasks);
 			if (m_sts != Status::OK) {
 				Log::Fatal(L"TaskWorkignSet::Begin() failed.");
 				return;
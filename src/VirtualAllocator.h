@@ -29,6 +29,12 @@
 #include <map>
 #include <set>
 #include <bitset>
+#include <algorithm>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 #define VIRTUAL_ALLOCATOR_ENALBLE_STRING_DUMP
 #if defined(VIRTUAL_ALLOCATOR_ENALBLE_STRING_DUMP)
@@ -51,13 +57,124 @@ namespace VirtualAllocator {
 
 	enum class Type {
 		FixedPage,
-		Buddy
+		Buddy,
+		TLSF,
+		Ring
 	};
 
 	template<Type type>
 	class Allocator {
 	};
 
+	// A relocation of an allocation planned by PlanCompaction(). Offsets are global ones including block sized offsets.
+	struct Move {
+		size_t	m_srcOffset = 0;
+		size_t	m_dstOffset = 0;
+		size_t	m_size = 0; // requested size of the allocation.
+	};
+
+	namespace BitOps {
+		// index of the least significant set bit. v must not be zero.
+		static inline uint32_t FindLSB(uint32_t v)
+		{
+			assert(v != 0);
+#if defined(_MSC_VER)
+			unsigned long idx;
+			_BitScanForward(&idx, v);
+			return (uint32_t)idx;
+#else
+			return (uint32_t)__builtin_ctz(v);
+#endif
+		}
+
+		// index of the most significant set bit. v must not be zero.
+		static inline uint32_t FindMSB(uint32_t v)
+		{
+			assert(v != 0);
+#if defined(_MSC_VER)
+			unsigned long idx;
+			_BitScanReverse(&idx, v);
+			return (uint32_t)idx;
+#else
+			return (uint32_t)(31 - __builtin_clz(v));
+#endif
+		}
+	};
+
+	// A segment tree that holds the max value of each range of elements.
+	// It is used to find the first block which has a large enough free chunk in O(log N).
+	class MaxSegmentTree {
+		size_t					m_size = 0;
+		size_t					m_leafCount = 0; // always power of two.
+		std::vector<uint32_t>	m_nodes; // node[1] is the root, leaves start from node[m_leafCount].
+
+		void BuildInnerNodes()
+		{
+			for (size_t n = m_leafCount - 1; n > 0; --n)
+				m_nodes[n] = std::max(m_nodes[n * 2], m_nodes[n * 2 + 1]);
+		}
+
+	public:
+		static constexpr size_t npos = (size_t)-1;
+
+		size_t Size() const
+		{
+			return m_size;
+		}
+
+		void Build(const std::vector<uint32_t>& values)
+		{
+			m_size = values.size();
+			m_leafCount = 1;
+			while (m_leafCount < m_size)
+				m_leafCount *= 2;
+
+			m_nodes.assign(m_leafCount * 2, 0);
+			std::copy(values.begin(), values.end(), m_nodes.begin() + m_leafCount);
+			BuildInnerNodes();
+		}
+
+		void PushBack(uint32_t value)
+		{
+			if (m_size == m_leafCount) {
+				// double the leaves and rebuild.
+				std::vector<uint32_t> values(m_nodes.begin() + m_leafCount, m_nodes.begin() + m_leafCount + m_size);
+				values.push_back(value);
+				Build(values);
+				return;
+			}
+			Set(m_size++, value);
+		}
+
+		void Set(size_t idx, uint32_t value)
+		{
+			assert(idx < m_size);
+
+			size_t n = m_leafCount + idx;
+			m_nodes[n] = value;
+			for (n /= 2; n > 0; n /= 2) {
+				uint32_t v = std::max(m_nodes[n * 2], m_nodes[n * 2 + 1]);
+				if (m_nodes[n] == v)
+					break; // ancestors are unchanged.
+				m_nodes[n] = v;
+			}
+		}
+
+		// Returns the smallest index which has a value equal or larger than minValue, or npos.
+		size_t FindFirst(uint32_t minValue) const
+		{
+			if (m_size == 0 || m_nodes[1] < minValue)
+				return npos;
+
+			size_t n = 1;
+			while (n < m_leafCount)
+				n = m_nodes[n * 2] >= minValue ? n * 2 : n * 2 + 1;
+
+			size_t idx = n - m_leafCount;
+			return idx < m_size ? idx : npos;
+		}
+	};
+
 	// This allocator doesn't manage actual memory, just provides an offset for a requested allocation size.
 	// It manages virtual memory space in a pretty simple way, by fixed page size. (e.g. manage 256MB with 64KB entry size, Maximum number of pages is 4096)
 	// It returns offset and allocation handle which can be used to free the allocation in faster way.
@@ -87,6 +204,12 @@ namespace VirtualAllocator {
 			size_t								m_totalAllocatedEntry = 0;
 
 		public:
+			~EntryBank()
+			{
+				for (auto&& a : m_entryBank)
+					delete a;
+			}
+
 			Entry* Alloc()
 			{
 				++m_totalAllocatedEntry;
@@ -134,6 +257,7 @@ namespace VirtualAllocator {
 
 		struct Block {
 			uint32_t	m_id = (uint32_t)-1;
+			uint32_t	m_index = (uint32_t)-1; // position in BlockContainer::m_blockVec.
 			Entry*		m_entries = {};
 			uint32_t	m_allocatedInPages = 0;
 			uint32_t	m_largestFreeInPages = 0;
@@ -146,6 +270,13 @@ namespace VirtualAllocator {
 			uint32_t					m_nextID = 0;
 			std::vector<Block*>			m_blockVec; // it's for traversing all blocks.
 			std::map<uint32_t, Block*>	m_blockMap;	// it's for retrieving a block by its ID.
+			MaxSegmentTree				m_largestFreeTree; // m_largestFreeInPages of each block in the same order with m_blockVec.
+
+			~BlockContainer()
+			{
+				for (auto&& b : m_blockVec)
+					delete b;
+			}
 
 			Block* Find(uint32_t blockID) const
 			{
@@ -157,12 +288,29 @@ namespace VirtualAllocator {
 				return itr->second;
 			}
 
+			// Returns the first block that has a free chunk equal or larger than the requested pages.
+			Block* FindFirstFit(uint32_t nbPages) const
+			{
+				size_t idx = m_largestFreeTree.FindFirst(nbPages);
+				if (idx == MaxSegmentTree::npos)
+					return nullptr;
+				return m_blockVec[idx];
+			}
+
+			// Need to be called when m_largestFreeInPages of a block has been changed.
+			void Update(const Block* b)
+			{
+				m_largestFreeTree.Set(b->m_index, b->m_largestFreeInPages);
+			}
+
 			Block *AddNew()
 			{
 				Block* newBlock = new Block();
 				newBlock->m_id = m_nextID++;
+				newBlock->m_index = (uint32_t)m_blockVec.size();
 				m_blockVec.push_back(newBlock);
 				m_blockMap.insert({ newBlock->m_id, newBlock });
+				m_largestFreeTree.PushBack(newBlock->m_largestFreeInPages);
 
 				if (m_nextID == 0 || m_needToSearchUniqueID) {
 					// ID have reached to 0xFFFF'FFFF so need to search unique ID with existed blocks.
@@ -180,46 +328,40 @@ namespace VirtualAllocator {
 
 			bool Remove(uint32_t blockIDToRemove)
 			{
-				std::vector<Block*> newVec;
-				newVec.reserve(m_blockVec.size()-1);
-
-				bool removed = false;
-				for (auto itr = m_blockMap.begin(); itr != m_blockMap.end();) {
-					if (itr->first == blockIDToRemove) {
-						itr = m_blockMap.erase(itr);
-						removed = true;
-						continue;
-					}
-					newVec.push_back(itr->second);
-					++itr;
-				}
-				std::swap(m_blockVec, newVec);
-
-				return removed;
+				return Remove(std::vector<uint32_t>{ blockIDToRemove });
 			}
 
 			bool Remove(const std::vector<uint32_t>& blockIDsToRemove)
 			{
-				std::vector<Block*> newVec;
-				newVec.reserve(m_blockVec.size());
-
-				uint32_t removedCnt = 0;
-				for (auto itr = m_blockMap.begin(); itr != m_blockMap.end();) {
-					bool removed = false;
-					for (auto&& bID : blockIDsToRemove) {
-						if (itr->first == bID) {
-							itr = m_blockMap.erase(itr);
-							removed = true;
-							++removedCnt;
-							break;
-						}
-					}
-					if (!removed) {
-						newVec.push_back(itr->second);
-						++itr;
+				// mark blocks to remove by its index, then compact the vector in a single pass.
+				std::vector<bool> removeFlags(m_blockVec.size(), false);
+
+				size_t removedCnt = 0;
+				for (auto&& bID : blockIDsToRemove) {
+					auto itr = m_blockMap.find(bID);
+					if (itr == m_blockMap.end())
+						continue;
+					removeFlags[itr->second->m_index] = true;
+					m_blockMap.erase(itr);
+					++removedCnt;
+				}
+
+				std::vector<uint32_t> largestFree;
+				largestFree.reserve(m_blockVec.size() - removedCnt);
+
+				size_t dst = 0;
+				for (size_t i = 0; i < m_blockVec.size(); ++i) {
+					Block* b = m_blockVec[i];
+					if (removeFlags[i]) {
+						delete b;
+						continue;
 					}
+					b->m_index = (uint32_t)dst;
+					largestFree.push_back(b->m_largestFreeInPages);
+					m_blockVec[dst++] = b;
 				}
-				std::swap(m_blockVec, newVec);
+				m_blockVec.resize(dst);
+				m_largestFreeTree.Build(largestFree);
 
 				return removedCnt == blockIDsToRemove.size();
 			}
@@ -286,13 +428,7 @@ namespace VirtualAllocator {
 
 			uint32_t nbPages = (uint32_t)((siz + m_pageSizeInBytes - 1) / m_pageSizeInBytes);
 
-			Block* foundBlock = nullptr;
-			for (auto&& b : m_blockContainer.m_blockVec) {
-				if (b->m_largestFreeInPages < nbPages)
-					continue;
-				foundBlock = b;
-				break;
-			}
+			Block* foundBlock = m_blockContainer.FindFirstFit(nbPages);
 
 			// Failed to find a block to accomodate the requested size.
 			if (foundBlock == nullptr) {
@@ -314,6 +450,7 @@ namespace VirtualAllocator {
 
 					newBlock->m_entries = ent;
 					newBlock->m_largestFreeInPages = ent->m_nbPages;
+					m_blockContainer.Update(newBlock);
 
 					foundBlock = newBlock;
 				}
@@ -346,6 +483,7 @@ namespace VirtualAllocator {
 						foundBlock->m_largestFreeInPages = foundBlock->m_freePages.rbegin()->first;
 					else
 						foundBlock->m_largestFreeInPages = 0;
+					m_blockContainer.Update(foundBlock);
 				}
 
 				m_totalAllocatedSizeInBytes += siz;
@@ -376,6 +514,7 @@ namespace VirtualAllocator {
 				foundBlock->m_allocatedInPages += newEnt->m_nbPages;
 				if (foundBlock->m_largestFreeInPages == originalPages) {
 					foundBlock->m_largestFreeInPages = foundBlock->m_freePages.rbegin()->first;
+					m_blockContainer.Update(foundBlock);
 				}
 
 				m_totalAllocatedSizeInBytes += siz;
@@ -450,7 +589,10 @@ namespace VirtualAllocator {
 
 			// register (update) free entry;
 			foundEnt->m_freeItr = freePages.insert({ foundEnt->m_nbPages, foundEnt });
-			foundBlock->m_largestFreeInPages = std::max(foundBlock->m_largestFreeInPages, foundEnt->m_nbPages);
+			if (foundBlock->m_largestFreeInPages < foundEnt->m_nbPages) {
+				foundBlock->m_largestFreeInPages = foundEnt->m_nbPages;
+				m_blockContainer.Update(foundBlock);
+			}
 
 			return true;
 		}
@@ -501,6 +643,12 @@ namespace VirtualAllocator {
 			return m_blockContainer.m_blockVec.size();
 		}
 
+		// total size of live allocations as requested to Alloc().
+		size_t AllocatedSizeInBytes() const
+		{
+			return m_totalAllocatedSizeInBytes;
+		}
+
 		void BlockStatus(uint32_t *retIDs, uint32_t* retOccupancy) const
 		{
 			for (size_t i = 0; i < m_blockContainer.m_blockVec.size(); ++i) {
@@ -513,6 +661,75 @@ namespace VirtualAllocator {
 			}
 		}
 
+		// Call func(sizeInBytes) for each free chunk in all blocks.
+		template<typename Func>
+		void VisitFreeChunks(Func func) const
+		{
+			for (auto&& b : m_blockContainer.m_blockVec) {
+				for (auto&& itr : b->m_freePages)
+					func((size_t)itr.first * m_pageSizeInBytes);
+			}
+		}
+
+		// Plan relocations to drain the least occupied block into the other used blocks. It never adds a new block.
+		// Moved allocations are allocated at the destinations and the sources are kept allocated. The caller frees the sources once no in-flight work references them.
+		// Planning stops when the moved size would exceed maxBytesToMove (at least one allocation is moved) or when a destination is not found.
+		bool PlanCompaction(size_t maxBytesToMove, std::vector<Move>* retMoves)
+		{
+			retMoves->clear();
+			if (!m_allowMultipleBlocks || m_blockContainer.m_blockVec.size() < 2)
+				return false;
+
+			// pick the least occupied block as the source.
+			Block* srcBlock = nullptr;
+			uint64_t freePagesInUsedBlocks = 0;
+			for (auto&& b : m_blockContainer.m_blockVec) {
+				if (b->m_allocatedInPages == 0)
+					continue;
+				freePagesInUsedBlocks += m_pagesInBlock - b->m_allocatedInPages;
+				if (srcBlock == nullptr || b->m_allocatedInPages < srcBlock->m_allocatedInPages)
+					srcBlock = b;
+			}
+			if (srcBlock == nullptr)
+				return false;
+
+			// the other used blocks need to have enough free pages for all allocations in the source block.
+			if (freePagesInUsedBlocks - (m_pagesInBlock - srcBlock->m_allocatedInPages) < srcBlock->m_allocatedInPages)
+				return false;
+
+			// hide the source and empty blocks from the search, and don't add a new block while planning.
+			std::vector<Block*> hiddenBlocks;
+			for (auto&& b : m_blockContainer.m_blockVec) {
+				if (b == srcBlock || b->m_allocatedInPages == 0) {
+					m_blockContainer.m_largestFreeTree.Set(b->m_index, 0);
+					hiddenBlocks.push_back(b);
+				}
+			}
+			bool allowMultipleBlocks = m_allowMultipleBlocks;
+			m_allowMultipleBlocks = false;
+
+			size_t movedBytes = 0;
+			for (Entry* ent = srcBlock->m_entries; ent != nullptr; ent = ent->m_next) {
+				if (ent->m_realUsed == 0)
+					continue;
+				if (retMoves->size() > 0 && movedBytes + ent->m_realUsed > maxBytesToMove)
+					break;
+
+				size_t dstOffset;
+				if (!Alloc(ent->m_realUsed, &dstOffset))
+					break;
+
+				retMoves->push_back({ (size_t)ent->m_offset * m_pageSizeInBytes, dstOffset, ent->m_realUsed });
+				movedBytes += ent->m_realUsed;
+			}
+
+			m_allowMultipleBlocks = allowMultipleBlocks;
+			for (auto&& b : hiddenBlocks)
+				m_blockContainer.Update(b);
+
+			return retMoves->size() > 0;
+		}
+
 #if defined(VIRTUAL_ALLOCATOR_ENALBLE_STRING_DUMP)
 		std::string Dump(bool dumpEntry, bool dumpFreed, bool dumpVis) const
 		{
@@ -607,6 +824,11 @@ namespace VirtualAllocator {
 #endif
 	};
 
+	// Buddy allocator on a flat, implicit binary tree.
+	// Each block has an array of nodes in a heap layout (node[1] is the entire block, node[n*2] and node[n*2+1] are the halves of node[n]).
+	// Each node holds the largest free order + 1 in its subtree (zero means there is no free chunk in the subtree).
+	// Alloc descends the tree to find a free node of the requested order, and Free climbs from the page up to the allocated node and merges buddies on the way back to the root.
+	// Both are O(log N) and there is no heap allocation except when adding a new block.
 	template<>
 	class Allocator<Type::Buddy> final
 	{
@@ -617,17 +839,25 @@ namespace VirtualAllocator {
 		size_t	m_totalAllocatedSizeInBytes = 0;
 
 		struct Block {
-			uint32_t										m_id = (uint32_t)-1;
-			std::vector<std::set<size_t>>					m_freeList;
-			std::map<size_t, std::tuple<size_t, size_t>>	m_usedMap;
-			size_t											m_largestOrderP1 = 0; // zero means no free chunck.
-			size_t											m_totalAllocatedPagesInBytes = 0;
+			uint32_t				m_id = (uint32_t)-1;
+			uint32_t				m_index = (uint32_t)-1; // position in BlockContainer::m_blockVec.
+			std::vector<uint8_t>	m_tree; // the largest free order + 1 in each subtree.
+			std::vector<uint32_t>	m_requestedSizes; // requested size of an allocation, indexed by its first page.
+			size_t					m_largestOrderP1 = 0; // zero means no free chunck. Same as m_tree[1].
+			size_t					m_totalAllocatedPagesInBytes = 0;
 		};
 
 		struct BlockContainer {
 			uint32_t					m_nextID = 0;
 			std::vector<Block*>			m_blockVec; // it's for traversing all blocks.
 			std::map<uint32_t, Block*>	m_blockMap;	// it's for retrieving a block by its ID.
+			MaxSegmentTree				m_largestOrderTree; // m_largestOrderP1 of each block in the same order with m_blockVec.
+
+			~BlockContainer()
+			{
+				for (auto&& b : m_blockVec)
+					delete b;
+			}
 
 			Block* Find(uint32_t blockID) const
 			{
@@ -639,58 +869,69 @@ namespace VirtualAllocator {
 				return itr->second;
 			}
 
+			// Returns the first block that has a free chunk with the order equal or larger than the requested one.
+			Block* FindFirstFit(size_t orderP1) const
+			{
+				size_t idx = m_largestOrderTree.FindFirst((uint32_t)orderP1);
+				if (idx == MaxSegmentTree::npos)
+					return nullptr;
+				return m_blockVec[idx];
+			}
+
+			// Need to be called when m_largestOrderP1 of a block has been changed.
+			void Update(const Block* b)
+			{
+				m_largestOrderTree.Set(b->m_index, (uint32_t)b->m_largestOrderP1);
+			}
+
 			Block* AddNew()
 			{
 				Block* newBlock = new Block();
 				newBlock->m_id = m_nextID++;
+				newBlock->m_index = (uint32_t)m_blockVec.size();
 				m_blockVec.push_back(newBlock);
 				m_blockMap.insert({ newBlock->m_id, newBlock });
+				m_largestOrderTree.PushBack((uint32_t)newBlock->m_largestOrderP1);
 
 				return newBlock;
 			}
 
 			bool Remove(uint32_t blockIDToRemove)
 			{
-				std::vector<Block*> newVec;
-				newVec.reserve(m_blockVec.size() - 1);
-
-				bool removed = false;
-				for (auto itr = m_blockMap.begin(); itr != m_blockMap.end();) {
-					if (itr->first == blockIDToRemove) {
-						itr = m_blockMap.erase(itr);
-						removed = true;
-						continue;
-					}
-					newVec.push_back(itr->second);
-					++itr;
-				}
-				std::swap(m_blockVec, newVec);
-
-				return removed;
+				return Remove(std::vector<uint32_t>{ blockIDToRemove });
 			}
 
 			bool Remove(const std::vector<uint32_t>& blockIDsToRemove)
 			{
-				std::vector<Block*> newVec;
-				newVec.reserve(m_blockVec.size());
-
-				uint32_t removedCnt = 0;
-				for (auto itr = m_blockMap.begin(); itr != m_blockMap.end();) {
-					bool removed = false;
-					for (auto&& bID : blockIDsToRemove) {
-						if (itr->first == bID) {
-							itr = m_blockMap.erase(itr);
-							removed = true;
-							++removedCnt;
-							break;
-						}
-					}
-					if (!removed) {
-						newVec.push_back(itr->second);
-						++itr;
+				// mark blocks to remove by its index, then compact the vector in a single pass.
+				std::vector<bool> removeFlags(m_blockVec.size(), false);
+
+				size_t removedCnt = 0;
+				for (auto&& bID : blockIDsToRemove) {
+					auto itr = m_blockMap.find(bID);
+					if (itr == m_blockMap.end())
+						continue;
+					removeFlags[itr->second->m_index] = true;
+					m_blockMap.erase(itr);
+					++removedCnt;
+				}
+
+				std::vector<uint32_t> largestOrder;
+				largestOrder.reserve(m_blockVec.size() - removedCnt);
+
+				size_t dst = 0;
+				for (size_t i = 0; i < m_blockVec.size(); ++i) {
+					Block* b = m_blockVec[i];
+					if (removeFlags[i]) {
+						delete b;
+						continue;
 					}
+					b->m_index = (uint32_t)dst;
+					largestOrder.push_back((uint32_t)b->m_largestOrderP1);
+					m_blockVec[dst++] = b;
 				}
-				std::swap(m_blockVec, newVec);
+				m_blockVec.resize(dst);
+				m_largestOrderTree.Build(largestOrder);
 
 				return removedCnt == blockIDsToRemove.size();
 			}
@@ -698,6 +939,7 @@ namespace VirtualAllocator {
 
 		BlockContainer								m_blockContainer;
 		std::vector<size_t>							m_orderList;
+		size_t										m_pagesInBlock = 0; // number of nodes in the lowest level.
 
 		size_t Order(size_t requestedSize) const
 		{
@@ -709,6 +951,77 @@ namespace VirtualAllocator {
 			return m_orderList.size();
 		}
 
+		// Order of a node. Nodes in [2^L, 2^(L+1)) are in the level L and the level 0 is the top order.
+		size_t NodeOrder(size_t node) const
+		{
+			size_t level = BitOps::FindMSB((uint32_t)node);
+			return m_orderList.size() - 1 - level;
+		}
+
+		// Offset in bytes of a node from the top of the block.
+		size_t NodeOffset(size_t node) const
+		{
+			size_t levelTop = (size_t)1 << BitOps::FindMSB((uint32_t)node);
+			return (node - levelTop) * m_orderList[NodeOrder(node)];
+		}
+
+		// Update the ancestors of the node after it has been changed.
+		// Two free buddies are merged into the parent.
+		static void UpdateAncestors(Block* b, size_t node, size_t order)
+		{
+			auto& tree(b->m_tree);
+			while (node > 1) {
+				node /= 2;
+				++order;
+
+				uint8_t l = tree[node * 2];
+				uint8_t r = tree[node * 2 + 1];
+				uint8_t v;
+				if (l == order && r == order)
+					v = (uint8_t)(order + 1); // both halves are entirely free.
+				else
+					v = std::max(l, r);
+
+				if (tree[node] == v)
+					break; // ancestors are unchanged.
+				tree[node] = v;
+			}
+		}
+
+		// A node is an allocated one if it is zero and either it is a leaf or it has a free child (which is left as it was when the node was allocated.)
+		// Otherwise a zero node means that both children are fully occupied.
+		bool IsAllocatedNode(const Block* b, size_t node) const
+		{
+			if (b->m_tree[node] != 0)
+				return false;
+			if (node >= m_pagesInBlock)
+				return true;
+			return b->m_tree[node * 2] != 0 || b->m_tree[node * 2 + 1] != 0;
+		}
+
+		// Traverse allocated nodes in an offset order.
+		template<typename Func>
+		void ForEachAllocatedNode(const Block* b, Func func) const
+		{
+			std::vector<size_t> stack = { 1 };
+			while (stack.size() > 0) {
+				size_t node = stack.back();
+				stack.pop_back();
+
+				if (IsAllocatedNode(b, node)) {
+					func(node);
+					continue;
+				}
+				if (node >= m_pagesInBlock)
+					continue;
+				// children of a free node are free as well.
+				if (b->m_tree[node] == NodeOrder(node) + 1)
+					continue;
+				stack.push_back(node * 2 + 1);
+				stack.push_back(node * 2);
+			}
+		}
+
 	public:
 		bool Init(bool allowMultipleBlocks, size_t blockSizeInBytes, size_t allocationPageSizeInBytes)
 		{
@@ -735,6 +1048,10 @@ namespace VirtualAllocator {
 
 			assert(order > 0);
 
+			// node index is handled in 32bit and order + 1 is stored in 8bit.
+			if (order > 31)
+				return false;
+
 			// initialize order list.
 			m_orderList.resize(order);
 			{
@@ -746,6 +1063,7 @@ namespace VirtualAllocator {
 						break;
 				}
 			}
+			m_pagesInBlock = (size_t)1 << (order - 1);
 
 			return true;
 		}
@@ -761,13 +1079,7 @@ namespace VirtualAllocator {
 			if (o >= m_orderList.size())
 				return false;
 
-			Block* foundBlock = nullptr;
-			for (auto&& b : m_blockContainer.m_blockVec) {
-				if (b->m_largestOrderP1 < o+1)
-					continue;
-				foundBlock = b;
-				break;
-			}
+			Block* foundBlock = m_blockContainer.FindFirstFit(o + 1);
 
 			if (foundBlock == nullptr) {
 				if (!m_allowMultipleBlocks && m_blockContainer.m_blockVec.size() > 0) {
@@ -775,84 +1087,55 @@ namespace VirtualAllocator {
 					return false;
 				}
 
-				// add new block.
+				// add new block. Every node is set to be free.
 				Block* newBlock = m_blockContainer.AddNew();
-				size_t topOrder = m_orderList.size() - 1;
-				newBlock->m_freeList.resize(m_orderList.size());
-				newBlock->m_freeList[topOrder].insert(m_blockSizeInBytes * newBlock->m_id); // insert top block.
-				newBlock->m_largestOrderP1 = topOrder+1;
+				newBlock->m_tree.resize(m_pagesInBlock * 2);
+				newBlock->m_tree[0] = 0; // unused.
+				for (size_t node = 1; node < newBlock->m_tree.size(); ++node)
+					newBlock->m_tree[node] = (uint8_t)(NodeOrder(node) + 1);
+				newBlock->m_requestedSizes.assign(m_pagesInBlock, 0);
+				newBlock->m_largestOrderP1 = newBlock->m_tree[1];
+				m_blockContainer.Update(newBlock);
 
 				foundBlock = newBlock;
 			}
 
-			auto CheckTheLargestOrderP1 = [](Block* b) {
-				size_t i = b->m_freeList.size();
-				while (i > 0) {
-					if (b->m_freeList[--i].size() > 0) {
-						b->m_largestOrderP1 = i+1;
-						return;
-					}
+			// descend the tree to the requested order. Prefer the half which has the smaller free chunk to keep larger chunks.
+			auto& tree(foundBlock->m_tree);
+			size_t node = 1;
+			for (size_t nodeOrder = m_orderList.size() - 1; nodeOrder > o; --nodeOrder) {
+				uint8_t l = tree[node * 2];
+				uint8_t r = tree[node * 2 + 1];
+				if (l >= o + 1 && (r < o + 1 || l <= r))
+					node = node * 2;
+				else if (r >= o + 1)
+					node = node * 2 + 1;
+				else {
+					// There is no block to split. Shouldn't be here.
+					assert(false);
+					return false;
 				}
-				b->m_largestOrderP1 = 0;
-			};
-
-			if (foundBlock->m_freeList[o].size() > 0)
-			{
-				// free list for the order is available. simply assign it.
-				*offset = *foundBlock->m_freeList[o].begin();
-				foundBlock->m_freeList[o].erase(foundBlock->m_freeList[o].begin());
-
-				// Insert map with the start address (offset) key.
-				foundBlock->m_usedMap.insert(std::make_pair(*offset, std::make_tuple(m_orderList[o], siz)));
-				m_totalAllocatedSizeInBytes += siz;
-				foundBlock->m_totalAllocatedPagesInBytes += m_orderList[o];
-
-				CheckTheLargestOrderP1(foundBlock);
-
-				return true;;
-			}
-
-			// Thre is no free block for the requested order, so split a larger block.
-			size_t targetOrder;
-			for (targetOrder = o + 1; targetOrder < m_orderList.size(); ++targetOrder) {
-				if (foundBlock->m_freeList[targetOrder].size() > 0)
-					break;
 			}
-			if (targetOrder == m_orderList.size()) {
-				// There is no block to split. Shouldn't be here.
+			if (tree[node] != o + 1) {
 				assert(false);
 				return false;
 			}
-			bool needToCheckTheLargest = targetOrder + 1 == foundBlock->m_largestOrderP1 ? true : false;
-
-			size_t temp = *foundBlock->m_freeList[targetOrder].begin();
-			foundBlock->m_freeList[targetOrder].erase(foundBlock->m_freeList[targetOrder].begin());
-
-			// split until the requested order.
-			for (size_t i = targetOrder - 1; i >= o; --i) {
-				size_t ofs1 = temp;
-				size_t ofs2 = temp + m_orderList[i];
-
-				// keep the first part  in the free list.
-				foundBlock->m_freeList[i].insert(ofs1);
 
-				// slipt the latter part in the next loop;
-				temp = ofs2;
+			tree[node] = 0;
+			UpdateAncestors(foundBlock, node, o);
 
-				if (i == 0)
-					break;
-			}
-
-			// temp should hold the requested order.
-			foundBlock->m_usedMap.insert(std::make_pair(temp, std::make_tuple(m_orderList[o], siz)));
+			size_t localOffset = NodeOffset(node);
+			foundBlock->m_requestedSizes[localOffset / m_pageSizeInBytes] = (uint32_t)siz;
 			m_totalAllocatedSizeInBytes += siz;
 			foundBlock->m_totalAllocatedPagesInBytes += m_orderList[o];
 
-			if (needToCheckTheLargest)
-				CheckTheLargestOrderP1(foundBlock);
+			if (foundBlock->m_largestOrderP1 != tree[1]) {
+				foundBlock->m_largestOrderP1 = tree[1];
+				m_blockContainer.Update(foundBlock);
+			}
 
-			*offset = temp;
-			return true;;
+			*offset = m_blockSizeInBytes * foundBlock->m_id + localOffset;
+			return true;
 		};
 
 		bool Free(size_t offset)
@@ -864,56 +1147,39 @@ namespace VirtualAllocator {
 				return false;
 			}
 
-			auto itr = b->m_usedMap.find(offset);
-			assert(itr != b->m_usedMap.end());
-
-			size_t allocatedOffset = itr->first;
-			size_t allocatedSize, requestedSize;
-			std::tie(allocatedSize, requestedSize) = itr->second;
-			b->m_usedMap.erase(itr);
-			b->m_totalAllocatedPagesInBytes -= allocatedSize;
-			m_totalAllocatedSizeInBytes -= requestedSize;
-
-			size_t startOrder = Order(allocatedSize);
-
-			// merge free list until the top.
-			size_t o = startOrder;
-			for (; o < m_orderList.size(); ++o) {
-				bool found = false;
-
-				if (o < m_orderList.size() - 1) {
-					size_t buddyOffset, topOffset;
-					if (allocatedOffset / allocatedSize % 2 == 0) {
-						// even block. Try checking odd block.
-						buddyOffset = allocatedOffset + allocatedSize;
-						topOffset = allocatedOffset;
-					}
-					else {
-						// odd block. Try checking even block.
-						buddyOffset = allocatedOffset - allocatedSize;
-						topOffset = buddyOffset;
-					}
+			size_t localOffset = offset - m_blockSizeInBytes * blockID;
+			if (localOffset % m_pageSizeInBytes != 0) {
+				assert(false);
+				return false;
+			}
+			size_t pageIdx = localOffset / m_pageSizeInBytes;
+
+			// climb from the page to the allocated node.
+			auto& tree(b->m_tree);
+			size_t node = m_pagesInBlock + pageIdx;
+			size_t o = 0;
+			while (node > 0 && tree[node] != 0) {
+				node /= 2;
+				++o;
+			}
+			if (node == 0 || !IsAllocatedNode(b, node) || NodeOffset(node) != localOffset) {
+				// unknown entry detected.
+				assert(false);
+				return false;
+			}
 
-					// Search in free list to find it's buddy
-					auto freeItr  = b->m_freeList[o].find(buddyOffset);
-					if (freeItr != b->m_freeList[o].end()) {
-						// found free buddy in the list.
-						b->m_freeList[o].erase(freeItr);
+			b->m_totalAllocatedPagesInBytes -= m_orderList[o];
+			m_totalAllocatedSizeInBytes -= b->m_requestedSizes[pageIdx];
+			b->m_requestedSizes[pageIdx] = 0;
 
-						found = true;
-						allocatedOffset = topOffset;
-						allocatedSize *= 2;;
-					}
-				}
+			// merge free buddies until the top.
+			tree[node] = (uint8_t)(o + 1);
+			UpdateAncestors(b, node, o);
 
-				if (!found) {
-					// add to the free list and exit.
-					b->m_freeList[o].insert(allocatedOffset);
-					break;
-				}
+			if (b->m_largestOrderP1 != tree[1]) {
+				b->m_largestOrderP1 = tree[1];
+				m_blockContainer.Update(b);
 			}
-			assert(o < m_orderList.size());
-			b->m_largestOrderP1 = std::max(o+1, b->m_largestOrderP1);
 
 			return true;
 		}
@@ -928,14 +1194,9 @@ namespace VirtualAllocator {
 					return false;
 				}
 
+				// the top node should be entirely free.
 				Block* b = itr->second;
-				if (b->m_largestOrderP1 < m_orderList.size()) {
-					assert(false);
-					return false;
-				}
-
-				// there should be a free block in the top order.
-				if (b->m_freeList[m_orderList.size() - 1].size() != 1) {
+				if (b->m_largestOrderP1 < m_orderList.size() || b->m_totalAllocatedPagesInBytes > 0) {
 					assert(false);
 					return false;
 				}
@@ -949,6 +1210,12 @@ namespace VirtualAllocator {
 			return m_blockContainer.m_blockVec.size();
 		}
 
+		// total size of live allocations as requested to Alloc().
+		size_t AllocatedSizeInBytes() const
+		{
+			return m_totalAllocatedSizeInBytes;
+		}
+
 		void BlockStatus(uint32_t* retIDs, uint32_t* retOccupancy) const
 		{
 			for (size_t i = 0; i < m_blockContainer.m_blockVec.size(); ++i) {
@@ -961,6 +1228,93 @@ namespace VirtualAllocator {
 			}
 		}
 
+		// Call func(sizeInBytes) for each free chunk in all blocks.
+		template<typename Func>
+		void VisitFreeChunks(Func func) const
+		{
+			std::vector<size_t> stack;
+			for (auto&& b : m_blockContainer.m_blockVec) {
+				stack.assign(1, 1);
+				while (stack.size() > 0) {
+					size_t node = stack.back();
+					stack.pop_back();
+
+					size_t o = NodeOrder(node);
+					if (b->m_tree[node] == o + 1) {
+						// entire subtree is free.
+						func(m_orderList[o]);
+						continue;
+					}
+					if (node >= m_pagesInBlock || IsAllocatedNode(b, node))
+						continue;
+					stack.push_back(node * 2 + 1);
+					stack.push_back(node * 2);
+				}
+			}
+		}
+
+		// Plan relocations to drain the least occupied block into the other used blocks. It never adds a new block.
+		// Moved allocations are allocated at the destinations and the sources are kept allocated. The caller frees the sources once no in-flight work references them.
+		// Planning stops when the moved size would exceed maxBytesToMove (at least one allocation is moved) or when a destination is not found.
+		bool PlanCompaction(size_t maxBytesToMove, std::vector<Move>* retMoves)
+		{
+			retMoves->clear();
+			if (!m_allowMultipleBlocks || m_blockContainer.m_blockVec.size() < 2)
+				return false;
+
+			// pick the least occupied block as the source.
+			Block* srcBlock = nullptr;
+			size_t freeBytesInUsedBlocks = 0;
+			for (auto&& b : m_blockContainer.m_blockVec) {
+				if (b->m_totalAllocatedPagesInBytes == 0)
+					continue;
+				freeBytesInUsedBlocks += m_blockSizeInBytes - b->m_totalAllocatedPagesInBytes;
+				if (srcBlock == nullptr || b->m_totalAllocatedPagesInBytes < srcBlock->m_totalAllocatedPagesInBytes)
+					srcBlock = b;
+			}
+			if (srcBlock == nullptr)
+				return false;
+
+			// the other used blocks need to have enough free space for all allocations in the source block.
+			if (freeBytesInUsedBlocks - (m_blockSizeInBytes - srcBlock->m_totalAllocatedPagesInBytes) < srcBlock->m_totalAllocatedPagesInBytes)
+				return false;
+
+			std::vector<size_t> srcNodes;
+			ForEachAllocatedNode(srcBlock, [&](size_t node) { srcNodes.push_back(node); });
+
+			// hide the source and empty blocks from the search, and don't add a new block while planning.
+			std::vector<Block*> hiddenBlocks;
+			for (auto&& b : m_blockContainer.m_blockVec) {
+				if (b == srcBlock || b->m_totalAllocatedPagesInBytes == 0) {
+					m_blockContainer.m_largestOrderTree.Set(b->m_index, 0);
+					hiddenBlocks.push_back(b);
+				}
+			}
+			bool allowMultipleBlocks = m_allowMultipleBlocks;
+			m_allowMultipleBlocks = false;
+
+			size_t movedBytes = 0;
+			for (auto&& node : srcNodes) {
+				size_t localOffset = NodeOffset(node);
+				size_t requestedSize = srcBlock->m_requestedSizes[localOffset / m_pageSizeInBytes];
+				if (retMoves->size() > 0 && movedBytes + requestedSize > maxBytesToMove)
+					break;
+
+				size_t dstOffset;
+				if (!Alloc(requestedSize, &dstOffset))
+					break;
+
+				retMoves->push_back({ m_blockSizeInBytes * srcBlock->m_id + localOffset, dstOffset, requestedSize });
+				movedBytes += requestedSize;
+			}
+
+			m_allowMultipleBlocks = allowMultipleBlocks;
+			for (auto&& b : hiddenBlocks)
+				m_blockContainer.Update(b);
+
+			return retMoves->size() > 0;
+		}
+
 #if defined(VIRTUAL_ALLOCATOR_ENALBLE_STRING_DUMP)
 		std::string Dump(bool dumpEntry, bool dumpFreed, bool dumpVis) const
 		{
@@ -971,54 +1325,61 @@ namespace VirtualAllocator {
 
 				if (dumpEntry || dumpVis || dumpFreed)
 					ss << "Block:" << b->m_id << std::endl;
-				size_t blockBegin = m_blockSizeInBytes * blockIdx;
+				size_t blockBegin = m_blockSizeInBytes * b->m_id;
 
 				if (dumpEntry) {
 					ss << "Used Map" << std::endl;
-					for (const auto& itr : b->m_usedMap) {
-						ss << " O: " << itr.first << " S:" << std::get<0>(itr.second) << std::endl;
-					}
+					ForEachAllocatedNode(b, [&](size_t node) {
+						ss << " O: " << blockBegin + NodeOffset(node) << " S:" << m_orderList[NodeOrder(node)] << std::endl;
+						});
 				}
 
 				if (dumpVis) {
 					ss << "Visualized Dump" << std::endl;
 
-					size_t nbPages = m_blockSizeInBytes / m_pageSizeInBytes;
-
 					std::array<char, 2> chArr = { '*', '+' };
 					size_t chIdx = 0;
 					size_t chCnt = 0;
-					for (size_t i = 0; i < nbPages; i++) {
-						size_t curOfs = blockBegin + i * m_pageSizeInBytes;
-						auto itr = b->m_usedMap.find(curOfs);
-						if (itr != b->m_usedMap.end()) {
-							size_t usedPages = std::get<0>(itr->second) / m_pageSizeInBytes;
-							i += usedPages - 1;
-							while (usedPages > 0) {
-								ss << chArr[chIdx % chArr.size()];
-								if (++chCnt % 64 == 0)
-									ss << std::endl;
-								--usedPages;
-							}
-							++chIdx;
-							continue;
+					size_t curPage = 0;
+					auto PutCh = [&](char ch, size_t nbPages) {
+						while (nbPages-- > 0) {
+							ss << ch;
+							if (++chCnt % 64 == 0)
+								ss << std::endl;
 						}
-						ss << " ";
-						if (++chCnt % 64 == 0)
-							ss << std::endl;
-					}
+					};
+					ForEachAllocatedNode(b, [&](size_t node) {
+						size_t page = NodeOffset(node) / m_pageSizeInBytes;
+						size_t usedPages = m_orderList[NodeOrder(node)] / m_pageSizeInBytes;
+						PutCh(' ', page - curPage);
+						PutCh(chArr[chIdx++ % chArr.size()], usedPages);
+						curPage = page + usedPages;
+						});
+					PutCh(' ', m_pagesInBlock - curPage);
 					ss << std::endl;
 				}
 
 				if (dumpFreed) {
 					ss << "Freed Map" << std::endl;
-					size_t i = 0;
-					for (const auto& freeSet : b->m_freeList) {
+					for (size_t i = 0; i < m_orderList.size(); ++i) {
 						ss << "Order: " << i << "  Size: " << m_orderList[i] << std::endl;
-						for (const auto& itr : freeSet) {
-							ss << "Ofs: " << itr << std::endl;
+						// a free chunk is a node which holds its own order and the parent is not entirely free.
+						size_t level = m_orderList.size() - 1 - i;
+						for (size_t node = (size_t)1 << level; node < (size_t)2 << level; ++node) {
+							if (b->m_tree[node] != i + 1)
+								continue;
+							if (node > 1 && b->m_tree[node / 2] == i + 2)
+								continue;
+							bool underAllocated = false;
+							for (size_t n = node / 2; n > 0; n /= 2) {
+								if (IsAllocatedNode(b, n)) {
+									underAllocated = true;
+									break;
+								}
+							}
+							if (!underAllocated)
+								ss << "Ofs: " << blockBegin + NodeOffset(node) << std::endl;
 						}
-						++i;
 					}
 					ss << "LargestFreeOrder + 1:" << b->m_largestOrderP1 << std::endl;
 				}
@@ -1043,7 +1404,989 @@ namespace VirtualAllocator {
 #endif
 	};
 
+	// Two-level segregated fit (TLSF) allocator.
+	// Same as FixedPage, it manages virtual memory space by fixed page size and returns offsets with block sized offsets when multiple blocks are allowed.
+	// Free chunks are kept in segregated free lists. The first level index is log2 of the chunk size and the second level index linearly subdivides it into m_slCount ranges.
+	// Free lists are looked up with a bitmap of each level, so Alloc and Free are done in O(1) without any tree operation.
+	// Entries are stored in a flat array and referenced by index, and each block has a page table to find an allocated entry from its offset,
+	// so there is no per-allocation heap allocation once the arrays have grown enough.
+	// A found chunk is always split and the remaining part goes back to the free list. Physically adjacent free chunks are merged in Free.
+	template<>
+	class Allocator<Type::TLSF> final
+	{
+		static constexpr uint32_t	m_invalidIndex = 0xFFFF'FFFF;
+		static constexpr uint32_t	m_slCountLog2 = 4;
+		static constexpr uint32_t	m_slCount = 1u << m_slCountLog2;
+		static constexpr uint32_t	m_flCount = 32 - m_slCountLog2 + 1;
+
+		struct Entry {
+			uint32_t	m_blockID = m_invalidIndex;
+			uint32_t	m_offset = m_invalidIndex; // in pages, local in the block.
+			uint32_t	m_nbPages = 0;
+			bool		m_isFree = false;
+			size_t		m_realUsed = 0;
+
+			// physically adjacent entries in the same block.
+			uint32_t	m_prevPhys = m_invalidIndex;
+			uint32_t	m_nextPhys = m_invalidIndex;
+
+			// links in a segregated free list. m_nextFree is also used to chain released entries.
+			uint32_t	m_prevFree = m_invalidIndex;
+			uint32_t	m_nextFree = m_invalidIndex;
+		};
+
+		struct Block {
+			bool					m_isActive = false;
+			uint32_t				m_topEntry = m_invalidIndex; // entry at the top of the block. It is never merged into others.
+			uint32_t				m_allocatedInPages = 0;
+			std::vector<uint32_t>	m_pageTable; // entry index of an allocated entry at its top page.
+		};
+
+		bool		m_allowMultipleBlocks = false;
+		size_t		m_pageSizeInBytes = 0;
+		size_t		m_blockSizeInBytes = 0;
+		uint32_t	m_pagesInBlock = 0;
+
+		size_t		m_totalAllocatedSizeInBytes = 0;
+
+		std::vector<Entry>		m_entries;
+		uint32_t				m_releasedEntries = m_invalidIndex;
+		size_t					m_numUsingEntries = 0;
+
+		std::vector<Block>		m_blocks; // indexed by block ID.
+		std::vector<uint32_t>	m_releasedBlockIDs;
+		size_t					m_numActiveBlocks = 0;
+
+		uint32_t									m_flBitmap = 0;
+		std::array<uint32_t, m_flCount>				m_slBitmaps = {};
+		std::array<std::array<uint32_t, m_slCount>, m_flCount>	m_freeHeads;
+
+		static inline void Mapping(uint32_t nbPages, uint32_t* fl, uint32_t* sl)
+		{
+			if (nbPages < m_slCount) {
+				*fl = 0;
+				*sl = nbPages;
+				return;
+			}
+			uint32_t msb = BitOps::FindMSB(nbPages);
+			*fl = msb - m_slCountLog2 + 1;
+			*sl = (nbPages >> (msb - m_slCountLog2)) ^ m_slCount;
+		}
+
+		// Round up the requested size to the next list boundary, so that any entry in the found list can accomodate it.
+		static inline uint64_t RoundUpForSearch(uint32_t nbPages)
+		{
+			if (nbPages < m_slCount)
+				return nbPages;
+			uint32_t msb = BitOps::FindMSB(nbPages);
+			return (uint64_t)nbPages + (1ull << (msb - m_slCountLog2)) - 1;
+		}
+
+		uint32_t AllocEntry()
+		{
+			++m_numUsingEntries;
+
+			if (m_releasedEntries != m_invalidIndex) {
+				uint32_t idx = m_releasedEntries;
+				m_releasedEntries = m_entries[idx].m_nextFree;
+				m_entries[idx] = Entry();
+				return idx;
+			}
+			m_entries.push_back(Entry());
+			return (uint32_t)(m_entries.size() - 1);
+		}
+
+		void ReleaseEntry(uint32_t idx)
+		{
+			--m_numUsingEntries;
+
+			m_entries[idx].m_blockID = m_invalidIndex;
+			m_entries[idx].m_nextFree = m_releasedEntries;
+			m_releasedEntries = idx;
+		}
+
+		void InsertFree(uint32_t idx)
+		{
+			Entry& e(m_entries[idx]);
+			uint32_t fl, sl;
+			Mapping(e.m_nbPages, &fl, &sl);
+
+			uint32_t head = m_freeHeads[fl][sl];
+			e.m_isFree = true;
+			e.m_prevFree = m_invalidIndex;
+			e.m_nextFree = head;
+			if (head != m_invalidIndex)
+				m_entries[head].m_prevFree = idx;
+			m_freeHeads[fl][sl] = idx;
+
+			m_flBitmap |= 1u << fl;
+			m_slBitmaps[fl] |= 1u << sl;
+		}
+
+		void RemoveFree(uint32_t idx)
+		{
+			Entry& e(m_entries[idx]);
+			uint32_t fl, sl;
+			Mapping(e.m_nbPages, &fl, &sl);
+
+			if (e.m_prevFree != m_invalidIndex)
+				m_entries[e.m_prevFree].m_nextFree = e.m_nextFree;
+			else
+				m_freeHeads[fl][sl] = e.m_nextFree;
+			if (e.m_nextFree != m_invalidIndex)
+				m_entries[e.m_nextFree].m_prevFree = e.m_prevFree;
+
+			if (m_freeHeads[fl][sl] == m_invalidIndex) {
+				m_slBitmaps[fl] &= ~(1u << sl);
+				if (m_slBitmaps[fl] == 0)
+					m_flBitmap &= ~(1u << fl);
+			}
+
+			e.m_isFree = false;
+			e.m_prevFree = m_invalidIndex;
+			e.m_nextFree = m_invalidIndex;
+		}
+
+		// Returns a free entry that can accomodate nbPages, or m_invalidIndex.
+		// The size is rounded up to the next list, and the list is found with the bitmaps in O(1). A fitting entry in the list of the requested size can be missed, then a new block is used.
+		// Only when the rounded size exceeds the block size (e.g. a full block allocation), no list can be searched, so the head of the list of the requested size is checked instead.
+		// It finds an empty block, but can miss a fitting entry behind the head. No list is walked.
+		uint32_t FindFree(uint32_t nbPages) const
+		{
+			uint64_t searchPages = RoundUpForSearch(nbPages);
+			if (searchPages > m_pagesInBlock) {
+				uint32_t fl, sl;
+				Mapping(nbPages, &fl, &sl);
+				uint32_t head = m_freeHeads[fl][sl];
+				return (head != m_invalidIndex && m_entries[head].m_nbPages >= nbPages) ? head : m_invalidIndex;
+			}
+
+			uint32_t fl, sl;
+			Mapping((uint32_t)searchPages, &fl, &sl);
+
+			uint32_t slMap = m_slBitmaps[fl] & (~0u << sl);
+			if (slMap == 0) {
+				uint32_t flMap = fl + 1 < 32 ? m_flBitmap & (~0u << (fl + 1)) : 0;
+				if (flMap == 0)
+					return m_invalidIndex;
+				fl = BitOps::FindLSB(flMap);
+				slMap = m_slBitmaps[fl];
+			}
+
+			return m_freeHeads[fl][BitOps::FindLSB(slMap)];
+		}
+
+		uint32_t AddNewBlock()
+		{
+			uint32_t blockID;
+			if (m_releasedBlockIDs.size() > 0) {
+				blockID = m_releasedBlockIDs.back();
+				m_releasedBlockIDs.pop_back();
+			}
+			else {
+				m_blocks.push_back(Block());
+				blockID = (uint32_t)(m_blocks.size() - 1);
+			}
+
+			uint32_t topIdx = AllocEntry();
+			{
+				Entry& e(m_entries[topIdx]);
+				e.m_blockID = blockID;
+				e.m_offset = 0;
+				e.m_nbPages = m_pagesInBlock;
+			}
+
+			Block& b(m_blocks[blockID]);
+			b.m_isActive = true;
+			b.m_topEntry = topIdx;
+			b.m_allocatedInPages = 0;
+			b.m_pageTable.assign(m_pagesInBlock, m_invalidIndex);
+			++m_numActiveBlocks;
+
+			InsertFree(topIdx);
+
+			return topIdx;
+		}
+
+	public:
+		Allocator()
+		{
+			for (auto&& fl : m_freeHeads)
+				fl.fill(m_invalidIndex);
+		}
+
+		bool Init(bool allowMultipleBlocks, size_t blockSizeInBytes, size_t allocationPageSizeInBytes)
+		{
+			m_allowMultipleBlocks = allowMultipleBlocks;
+			m_blockSizeInBytes = blockSizeInBytes;
+			m_pageSizeInBytes = allocationPageSizeInBytes;
+
+			if (allocationPageSizeInBytes == 0 || blockSizeInBytes / allocationPageSizeInBytes >= (1ull << 31))
+				return false;
+
+			m_pagesInBlock = (uint32_t)(blockSizeInBytes / allocationPageSizeInBytes);
+			if (m_pagesInBlock == 0)
+				return false;
+
+			return true;
+		}
+
+		bool Alloc(size_t siz, size_t* offset)
+		{
+			if (siz > m_blockSizeInBytes) {
+				assert(siz <= m_blockSizeInBytes);
+				return false;
+			}
+
+			uint32_t nbPages = std::max((uint32_t)((siz + m_pageSizeInBytes - 1) / m_pageSizeInBytes), 1u);
+
+			uint32_t foundIdx = FindFree(nbPages);
+			if (foundIdx == m_invalidIndex) {
+				if (!m_allowMultipleBlocks && m_numActiveBlocks > 0) {
+					return false;
+				}
+				// allocate new block. Its top entry covers the entire block.
+				foundIdx = AddNewBlock();
+			}
+
+			RemoveFree(foundIdx);
+
+			// Split the entry and give the former part.
+			if (m_entries[foundIdx].m_nbPages > nbPages) {
+				uint32_t remIdx = AllocEntry(); // m_entries can be reallocated here.
+				Entry& foundEnt(m_entries[foundIdx]);
+				Entry& remEnt(m_entries[remIdx]);
+
+				remEnt.m_blockID = foundEnt.m_blockID;
+				remEnt.m_offset = foundEnt.m_offset + nbPages;
+				remEnt.m_nbPages = foundEnt.m_nbPages - nbPages;
+				remEnt.m_prevPhys = foundIdx;
+				remEnt.m_nextPhys = foundEnt.m_nextPhys;
+				if (foundEnt.m_nextPhys != m_invalidIndex)
+					m_entries[foundEnt.m_nextPhys].m_prevPhys = remIdx;
+				foundEnt.m_nextPhys = remIdx;
+				foundEnt.m_nbPages = nbPages;
+
+				InsertFree(remIdx);
+			}
+
+			Entry& foundEnt(m_entries[foundIdx]);
+			Block& b(m_blocks[foundEnt.m_blockID]);
+			foundEnt.m_realUsed = siz;
+			b.m_pageTable[foundEnt.m_offset] = foundIdx;
+			b.m_allocatedInPages += nbPages;
+
+			m_totalAllocatedSizeInBytes += siz;
+
+			*offset = (size_t)foundEnt.m_blockID * m_blockSizeInBytes + (size_t)foundEnt.m_offset * m_pageSizeInBytes;
+
+			return true;
+		}
+
+		bool Free(size_t offset)
+		{
+			size_t blockID = offset / m_blockSizeInBytes;
+			size_t localOffset = offset - blockID * m_blockSizeInBytes;
+			uint32_t key = (uint32_t)(localOffset / m_pageSizeInBytes);
+
+			// make sure the page size alignment.
+			if (key * m_pageSizeInBytes != localOffset) {
+				assert(false);
+				return false;
+			}
+
+			if (blockID >= m_blocks.size() || !m_blocks[blockID].m_isActive) {
+				// invalid block ID detected.
+				assert(false);
+				return false;
+			}
+			Block& b(m_blocks[blockID]);
+
+			uint32_t idx = b.m_pageTable[key];
+			if (idx == m_invalidIndex) {
+				// unknown entry detected.
+				assert(false);
+				return false;
+			}
+			b.m_pageTable[key] = m_invalidIndex;
+
+			b.m_allocatedInPages -= m_entries[idx].m_nbPages;
+			m_totalAllocatedSizeInBytes -= m_entries[idx].m_realUsed;
+			m_entries[idx].m_realUsed = 0;
+
+			// merge with the previous entry if it's free. Keep the previous one.
+			{
+				uint32_t prevIdx = m_entries[idx].m_prevPhys;
+				if (prevIdx != m_invalidIndex && m_entries[prevIdx].m_isFree) {
+					RemoveFree(prevIdx);
+
+					Entry& prev(m_entries[prevIdx]);
+					Entry& cur(m_entries[idx]);
+					prev.m_nbPages += cur.m_nbPages;
+					prev.m_nextPhys = cur.m_nextPhys;
+					if (cur.m_nextPhys != m_invalidIndex)
+						m_entries[cur.m_nextPhys].m_prevPhys = prevIdx;
+					ReleaseEntry(idx);
+
+					idx = prevIdx;
+				}
+			}
+			// merge with the next entry if it's free. Remove the next one.
+			{
+				uint32_t nextIdx = m_entries[idx].m_nextPhys;
+				if (nextIdx != m_invalidIndex && m_entries[nextIdx].m_isFree) {
+					RemoveFree(nextIdx);
+
+					Entry& cur(m_entries[idx]);
+					Entry& next(m_entries[nextIdx]);
+					cur.m_nbPages += next.m_nbPages;
+					cur.m_nextPhys = next.m_nextPhys;
+					if (next.m_nextPhys != m_invalidIndex)
+						m_entries[next.m_nextPhys].m_prevPhys = idx;
+					ReleaseEntry(nextIdx);
+				}
+			}
+
+			InsertFree(idx);
+
+			return true;
+		}
+
+		bool RemoveUnusedBlocks(const std::vector<uint32_t>& blockIDsToRemove)
+		{
+			for (auto&& id : blockIDsToRemove) {
+				if (id >= m_blocks.size() || !m_blocks[id].m_isActive) {
+					// invalid block ID detected.
+					assert(false);
+					return false;
+				}
+
+				Block& b(m_blocks[id]);
+				if (b.m_allocatedInPages > 0) {
+					// This block is still active.
+					assert(false);
+					return false;
+				}
+
+				// top entry must be free and hold entire block.
+				const Entry& topE(m_entries[b.m_topEntry]);
+				if (!topE.m_isFree ||
+					topE.m_nbPages != m_pagesInBlock ||
+					topE.m_nextPhys != m_invalidIndex ||
+					topE.m_prevPhys != m_invalidIndex) {
+					assert(false);
+					return false;
+				}
+
+				RemoveFree(b.m_topEntry);
+				ReleaseEntry(b.m_topEntry);
+
+				b.m_isActive = false;
+				b.m_topEntry = m_invalidIndex;
+				std::vector<uint32_t>().swap(b.m_pageTable);
+				--m_numActiveBlocks;
+
+				m_releasedBlockIDs.push_back(id);
+			}
+
+			return true;
+		}
+
+		size_t NumberOfBlocks() const
+		{
+			return m_numActiveBlocks;
+		}
+
+		// total size of live allocations as requested to Alloc().
+		size_t AllocatedSizeInBytes() const
+		{
+			return m_totalAllocatedSizeInBytes;
+		}
+
+		void BlockStatus(uint32_t* retIDs, uint32_t* retOccupancy) const
+		{
+			size_t i = 0;
+			for (uint32_t id = 0; id < (uint32_t)m_blocks.size(); ++id) {
+				const Block& b(m_blocks[id]);
+				if (!b.m_isActive)
+					continue;
+
+				retIDs[i] = id;
+				if (b.m_allocatedInPages > 0)
+					retOccupancy[i] = 1; // used block
+				else
+					retOccupancy[i] = 0;
+				++i;
+			}
+		}
+
+		// Call func(sizeInBytes) for each free chunk in all blocks.
+		template<typename Func>
+		void VisitFreeChunks(Func func) const
+		{
+			for (auto&& b : m_blocks) {
+				if (!b.m_isActive)
+					continue;
+				for (uint32_t idx = b.m_topEntry; idx != m_invalidIndex; idx = m_entries[idx].m_nextPhys) {
+					if (m_entries[idx].m_isFree)
+						func((size_t)m_entries[idx].m_nbPages * m_pageSizeInBytes);
+				}
+			}
+		}
+
+		// Plan relocations to drain the least occupied block into the other used blocks. It never adds a new block.
+		// Moved allocations are allocated at the destinations and the sources are kept allocated. The caller frees the sources once no in-flight work references them.
+		// Planning stops when the moved size would exceed maxBytesToMove (at least one allocation is moved) or when a destination is not found.
+		bool PlanCompaction(size_t maxBytesToMove, std::vector<Move>* retMoves)
+		{
+			retMoves->clear();
+			if (!m_allowMultipleBlocks || m_numActiveBlocks < 2)
+				return false;
+
+			// pick the least occupied block as the source.
+			uint32_t srcBlockID = m_invalidIndex;
+			uint64_t freePagesInUsedBlocks = 0;
+			for (uint32_t id = 0; id < (uint32_t)m_blocks.size(); ++id) {
+				const Block& b(m_blocks[id]);
+				if (!b.m_isActive || b.m_allocatedInPages == 0)
+					continue;
+				freePagesInUsedBlocks += m_pagesInBlock - b.m_allocatedInPages;
+				if (srcBlockID == m_invalidIndex || b.m_allocatedInPages < m_blocks[srcBlockID].m_allocatedInPages)
+					srcBlockID = id;
+			}
+			if (srcBlockID == m_invalidIndex)
+				return false;
+
+			// the other used blocks need to have enough free pages for all allocations in the source block.
+			uint32_t srcAllocatedInPages = m_blocks[srcBlockID].m_allocatedInPages;
+			if (freePagesInUsedBlocks - (m_pagesInBlock - srcAllocatedInPages) < srcAllocatedInPages)
+				return false;
+
+			// hide free entries of the source and empty blocks from the free lists, and gather allocations in the source block.
+			std::vector<uint32_t> hiddenEntries;
+			std::vector<std::pair<size_t, size_t>> srcAllocations; // local offset in pages, requested size.
+			for (uint32_t id = 0; id < (uint32_t)m_blocks.size(); ++id) {
+				const Block& b(m_blocks[id]);
+				if (!b.m_isActive || (id != srcBlockID && b.m_allocatedInPages > 0))
+					continue;
+
+				for (uint32_t idx = b.m_topEntry; idx != m_invalidIndex; idx = m_entries[idx].m_nextPhys) {
+					Entry& e(m_entries[idx]);
+					if (e.m_isFree) {
+						RemoveFree(idx);
+						hiddenEntries.push_back(idx);
+					}
+					else if (b.m_pageTable[e.m_offset] == idx) {
+						srcAllocations.push_back({ e.m_offset, e.m_realUsed });
+					}
+				}
+			}
+			bool allowMultipleBlocks = m_allowMultipleBlocks;
+			m_allowMultipleBlocks = false;
+
+			size_t movedBytes = 0;
+			for (auto&& a : srcAllocations) {
+				if (retMoves->size() > 0 && movedBytes + a.second > maxBytesToMove)
+					break;
+
+				size_t dstOffset;
+				if (!Alloc(a.second, &dstOffset))
+					break;
+
+				retMoves->push_back({ (size_t)srcBlockID * m_blockSizeInBytes + a.first * m_pageSizeInBytes, dstOffset, a.second });
+				movedBytes += a.second;
+			}
+
+			m_allowMultipleBlocks = allowMultipleBlocks;
+			for (auto&& idx : hiddenEntries)
+				InsertFree(idx);
+
+			return retMoves->size() > 0;
+		}
+
+#if defined(VIRTUAL_ALLOCATOR_ENALBLE_STRING_DUMP)
+		std::string Dump(bool dumpEntry, bool dumpFreed, bool dumpVis) const
+		{
+			std::stringstream ss;
+
+			size_t totalAllocatedPages = 0;
+			for (uint32_t id = 0; id < (uint32_t)m_blocks.size(); ++id) {
+				const Block& b(m_blocks[id]);
+				if (!b.m_isActive)
+					continue;
+				totalAllocatedPages += b.m_allocatedInPages;
+
+				if (dumpEntry || dumpVis || dumpFreed)
+					ss << "BlockID:" << id << std::endl;
+
+				if (dumpEntry) {
+					ss << "Entry Dump" << std::endl;
+					for (uint32_t idx = b.m_topEntry; idx != m_invalidIndex; idx = m_entries[idx].m_nextPhys) {
+						const Entry& ent(m_entries[idx]);
+						ss << "U: " << ent.m_realUsed << " O: " << ent.m_offset << " S:" << ent.m_nbPages << (ent.m_isFree ? " Free" : "") << std::endl;
+					}
+				}
+
+				if (dumpVis) {
+					ss << "Visualized Dump" << std::endl;
+					std::array<char, 2> chArr = { '*', '+' };
+					size_t chIdx = 0;
+					size_t chCnt = 0;
+					for (uint32_t idx = b.m_topEntry; idx != m_invalidIndex; idx = m_entries[idx].m_nextPhys) {
+						const Entry& ent(m_entries[idx]);
+						char ch = ent.m_isFree ? ' ' : chArr[chIdx++ % chArr.size()];
+						for (size_t i = 0; i < ent.m_nbPages; i++) {
+							ss << ch;
+							if (++chCnt % 64 == 0)
+								ss << std::endl;
+						}
+					}
+					ss << std::endl;
+				}
+
+				ss << "AllocatedInPages: " << b.m_allocatedInPages << std::endl;
+			}
+
+			if (dumpFreed) {
+				ss << "Free Lists" << std::endl;
+				for (uint32_t fl = 0; fl < m_flCount; ++fl) {
+					for (uint32_t sl = 0; sl < m_slCount; ++sl) {
+						if (m_freeHeads[fl][sl] == m_invalidIndex)
+							continue;
+						ss << "FL: " << fl << " SL: " << sl << std::endl;
+						for (uint32_t idx = m_freeHeads[fl][sl]; idx != m_invalidIndex; idx = m_entries[idx].m_nextFree) {
+							const Entry& ent(m_entries[idx]);
+							ss << "B: " << ent.m_blockID << " O: " << ent.m_offset << " S:" << ent.m_nbPages << std::endl;
+						}
+					}
+				}
+			}
+
+			if (dumpEntry && dumpFreed && dumpVis) {
+				// in case of full dump, entry array is also get dumped.
+				ss << "Entries" << std::endl;
+				ss << "ArraySize:" << m_entries.size() << " TotalUsing:" << m_numUsingEntries << std::endl;
+			}
+
+			if (m_numActiveBlocks > 0) {
+				size_t totalAllocatedBlocksInByte = m_blockSizeInBytes * m_numActiveBlocks;
+				size_t totalAllocatedBlocksInPages = (size_t)m_pagesInBlock * m_numActiveBlocks;
+
+				ss << "TotalAllocatedInBytes: " << m_totalAllocatedSizeInBytes << " : " << (double)m_totalAllocatedSizeInBytes * 100. / totalAllocatedBlocksInByte << "%" << std::endl;
+				ss << "TotalAllocatedInPages: " << totalAllocatedPages << " : " << (double)totalAllocatedPages * 100. / totalAllocatedBlocksInPages << "%" << std::endl;
+			}
+			else {
+				ss << "TotalAllocatedInBytes: " << m_totalAllocatedSizeInBytes << std::endl;
+			}
+
+			return ss.str();
+		}
+#endif
+	};
+
+	// Linear allocator for short lived allocations. Each block is used as a ring buffer, and allocations are tagged with the current tag (task index).
+	// Freed allocations are reclaimed in allocation order by Reclaim() after their tags are finished, so the ring never wraps into in-flight allocations.
+	// Allocations only go to the head block in O(1). When it has no contiguous space at its head, an emptied block or a new block becomes the head
+	// and the previous one drains.
+	template<>
+	class Allocator<Type::Ring> final
+	{
+		static constexpr uint64_t	m_invalidSeq = 0xFFFF'FFFF'FFFF'FFFFull;
+
+		struct Entry {
+			uint32_t	m_offset = 0; // in pages, local in the block.
+			uint32_t	m_nbPages = 0;
+			uint32_t	m_skippedPages = 0; // unused pages at the end of the block when the ring wrapped at this entry.
+			bool		m_isFreed = false;
+			uint64_t	m_tag = 0;
+			size_t		m_realUsed = 0;
+		};
+
+		struct Block {
+			bool					m_isActive = false;
+			bool					m_isInEmptyList = false;
+			uint32_t				m_head = 0; // next page to allocate.
+			uint32_t				m_tail = 0; // the oldest page in use.
+			uint32_t				m_usedPages = 0; // pages between the tail and the head including skipped pages.
+			uint64_t				m_frontSeq = 0; // sequence number of m_entries.front().
+			std::deque<Entry>		m_entries; // in allocation order.
+			std::vector<uint64_t>	m_pageTable; // sequence number of an allocated entry at its top page.
+		};
+
+		bool		m_allowMultipleBlocks = false;
+		size_t		m_pageSizeInBytes = 0;
+		size_t		m_blockSizeInBytes = 0;
+		uint32_t	m_pagesInBlock = 0;
+		uint64_t	m_currentTag = 0;
+
+		size_t		m_totalAllocatedSizeInBytes = 0;
+
+		std::vector<Block>		m_blocks; // indexed by block ID.
+		std::vector<uint32_t>	m_releasedBlockIDs;
+		std::vector<uint32_t>	m_emptyBlockIDs; // drained blocks other than the head. Entries can be stale after RemoveUnusedBlocks().
+		uint32_t				m_headBlockID = 0xFFFF'FFFFu;
+		size_t					m_numActiveBlocks = 0;
+
+		// Try to allocate nbPages at the head of the ring. Returns false if it would overwrap the tail.
+		bool AllocInBlock(Block& b, uint32_t nbPages, uint32_t* retOffset, uint32_t* retSkippedPages) const
+		{
+			if (b.m_usedPages == 0) {
+				*retOffset = 0;
+				*retSkippedPages = 0;
+				return true;
+			}
+			if (b.m_head > b.m_tail) {
+				// free space at the end and at the beginning of the block.
+				if (m_pagesInBlock - b.m_head >= nbPages) {
+					*retOffset = b.m_head;
+					*retSkippedPages = 0;
+					return true;
+				}
+				if (b.m_tail >= nbPages) {
+					*retOffset = 0;
+					*retSkippedPages = m_pagesInBlock - b.m_head;
+					return true;
+				}
+				return false;
+			}
+			if (b.m_head < b.m_tail && b.m_tail - b.m_head >= nbPages) {
+				*retOffset = b.m_head;
+				*retSkippedPages = 0;
+				return true;
+			}
+			// the head reached the tail.
+			return false;
+		}
+
+		uint32_t AddNewBlock()
+		{
+			uint32_t blockID;
+			if (m_releasedBlockIDs.size() > 0) {
+				blockID = m_releasedBlockIDs.back();
+				m_releasedBlockIDs.pop_back();
+			}
+			else {
+				m_blocks.push_back(Block());
+				blockID = (uint32_t)(m_blocks.size() - 1);
+			}
+
+			Block& b(m_blocks[blockID]);
+			b.m_isActive = true;
+			b.m_head = 0;
+			b.m_tail = 0;
+			b.m_usedPages = 0;
+			b.m_pageTable.assign(m_pagesInBlock, m_invalidSeq);
+			++m_numActiveBlocks;
+
+			return blockID;
+		}
+
+	public:
+		bool Init(bool allowMultipleBlocks, size_t blockSizeInBytes, size_t allocationPageSizeInBytes)
+		{
+			m_allowMultipleBlocks = allowMultipleBlocks;
+			m_blockSizeInBytes = blockSizeInBytes;
+			m_pageSizeInBytes = allocationPageSizeInBytes;
+
+			if (allocationPageSizeInBytes == 0 || blockSizeInBytes / allocationPageSizeInBytes >= (1ull << 31))
+				return false;
+
+			m_pagesInBlock = (uint32_t)(blockSizeInBytes / allocationPageSizeInBytes);
+			if (m_pagesInBlock == 0)
+				return false;
+
+			return true;
+		}
+
+		// Following allocations are tagged with it. It should be increased monotonically.
+		void SetCurrentTag(uint64_t tag)
+		{
+			assert(tag >= m_currentTag);
+			m_currentTag = tag;
+		}
+
+		bool Alloc(size_t siz, size_t* offset)
+		{
+			if (siz > m_blockSizeInBytes) {
+				assert(siz <= m_blockSizeInBytes);
+				return false;
+			}
+
+			uint32_t nbPages = std::max((uint32_t)((siz + m_pageSizeInBytes - 1) / m_pageSizeInBytes), 1u);
+
+			uint32_t blockID = m_headBlockID;
+			uint32_t localOffset = 0;
+			uint32_t skippedPages = 0;
+			if (blockID == 0xFFFF'FFFFu || !AllocInBlock(m_blocks[blockID], nbPages, &localOffset, &skippedPages)) {
+				if (!m_allowMultipleBlocks && m_numActiveBlocks > 0) {
+					return false;
+				}
+
+				// switch the head to a drained block, or to a new one.
+				blockID = 0xFFFF'FFFFu;
+				while (m_emptyBlockIDs.size() > 0) {
+					uint32_t id = m_emptyBlockIDs.back();
+					m_emptyBlockIDs.pop_back();
+					if (m_blocks[id].m_isInEmptyList) {
+						m_blocks[id].m_isInEmptyList = false;
+						blockID = id;
+						break;
+					}
+				}
+				if (blockID == 0xFFFF'FFFFu)
+					blockID = AddNewBlock();
+				m_headBlockID = blockID;
+				localOffset = 0;
+				skippedPages = 0;
+			}
+
+			Block& b(m_blocks[blockID]);
+			if (b.m_usedPages == 0) {
+				b.m_head = 0;
+				b.m_tail = 0;
+			}
+
+			Entry e;
+			e.m_offset = localOffset;
+			e.m_nbPages = nbPages;
+			e.m_skippedPages = skippedPages;
+			e.m_tag = m_currentTag;
+			e.m_realUsed = siz;
+
+			b.m_pageTable[localOffset] = b.m_frontSeq + b.m_entries.size();
+			b.m_entries.push_back(e);
+			b.m_usedPages += skippedPages + nbPages;
+			b.m_head = localOffset + nbPages;
+			if (b.m_head == m_pagesInBlock)
+				b.m_head = 0;
+
+			m_totalAllocatedSizeInBytes += siz;
+
+			*offset = (size_t)blockID * m_blockSizeInBytes + (size_t)localOffset * m_pageSizeInBytes;
+
+			return true;
+		}
+
+		// Mark the allocation as freed. The range is reused after Reclaim() is called with a finished tag.
+		bool Free(size_t offset)
+		{
+			size_t blockID = offset / m_blockSizeInBytes;
+			size_t localOffset = offset - blockID * m_blockSizeInBytes;
+			uint32_t key = (uint32_t)(localOffset / m_pageSizeInBytes);
+
+			// make sure the page size alignment.
+			if (key * m_pageSizeInBytes != localOffset) {
+				assert(false);
+				return false;
+			}
+
+			if (blockID >= m_blocks.size() || !m_blocks[blockID].m_isActive) {
+				// invalid block ID detected.
+				assert(false);
+				return false;
+			}
+			Block& b(m_blocks[blockID]);
+
+			uint64_t seq = b.m_pageTable[key];
+			if (seq == m_invalidSeq) {
+				// unknown entry detected.
+				assert(false);
+				return false;
+			}
+			b.m_pageTable[key] = m_invalidSeq;
+
+			Entry& e(b.m_entries[seq - b.m_frontSeq]);
+			e.m_isFreed = true;
+			m_totalAllocatedSizeInBytes -= e.m_realUsed;
+			e.m_realUsed = 0;
+
+			return true;
+		}
+
+		// Advance the tails over freed allocations whose tags are less than or equal to finishedTag.
+		void Reclaim(uint64_t finishedTag)
+		{
+			for (uint32_t id = 0; id < (uint32_t)m_blocks.size(); ++id) {
+				Block& b(m_blocks[id]);
+				if (!b.m_isActive)
+					continue;
+
+				while (b.m_entries.size() > 0) {
+					const Entry& e(b.m_entries.front());
+					if (!e.m_isFreed || e.m_tag > finishedTag)
+						break;
+
+					b.m_usedPages -= e.m_skippedPages + e.m_nbPages;
+					b.m_tail = e.m_offset + e.m_nbPages;
+					if (b.m_tail == m_pagesInBlock)
+						b.m_tail = 0;
+
+					b.m_entries.pop_front();
+					++b.m_frontSeq;
+				}
+				if (b.m_usedPages == 0) {
+					b.m_head = 0;
+					b.m_tail = 0;
+					if (id != m_headBlockID && !b.m_isInEmptyList) {
+						b.m_isInEmptyList = true;
+						m_emptyBlockIDs.push_back(id);
+					}
+				}
+			}
+		}
+
+		bool RemoveUnusedBlocks(const std::vector<uint32_t>& blockIDsToRemove)
+		{
+			for (auto&& id : blockIDsToRemove) {
+				if (id >= m_blocks.size() || !m_blocks[id].m_isActive) {
+					// invalid block ID detected.
+					assert(false);
+					return false;
+				}
+
+				Block& b(m_blocks[id]);
+				if (b.m_entries.size() > 0) {
+					// This block is still active.
+					assert(false);
+					return false;
+				}
+
+				b.m_isActive = false;
+				b.m_isInEmptyList = false;
+				b.m_frontSeq = 0;
+				if (id == m_headBlockID)
+					m_headBlockID = 0xFFFF'FFFFu;
+				std::vector<uint64_t>().swap(b.m_pageTable);
+				--m_numActiveBlocks;
+
+				m_releasedBlockIDs.push_back(id);
+			}
+
+			return true;
+		}
+
+		size_t NumberOfBlocks() const
+		{
+			return m_numActiveBlocks;
+		}
+
+		// total size of live allocations as requested to Alloc().
+		size_t AllocatedSizeInBytes() const
+		{
+			return m_totalAllocatedSizeInBytes;
+		}
+
+		void BlockStatus(uint32_t* retIDs, uint32_t* retOccupancy) const
+		{
+			size_t i = 0;
+			for (uint32_t id = 0; id < (uint32_t)m_blocks.size(); ++id) {
+				const Block& b(m_blocks[id]);
+				if (!b.m_isActive)
+					continue;
+
+				retIDs[i] = id;
+				// freed but not reclaimed entries keep the block in use.
+				if (b.m_entries.size() > 0)
+					retOccupancy[i] = 1; // used block
+				else
+					retOccupancy[i] = 0;
+				++i;
+			}
+		}
+
+		// Call func(sizeInBytes) for each free chunk in all blocks. Freed but not reclaimed ranges are not free chunks.
+		template<typename Func>
+		void VisitFreeChunks(Func func) const
+		{
+			for (auto&& b : m_blocks) {
+				if (!b.m_isActive)
+					continue;
+				if (b.m_usedPages == 0) {
+					func((size_t)m_pagesInBlock * m_pageSizeInBytes);
+				}
+				else if (b.m_head > b.m_tail) {
+					if (b.m_head < m_pagesInBlock)
+						func((size_t)(m_pagesInBlock - b.m_head) * m_pageSizeInBytes);
+					if (b.m_tail > 0)
+						func((size_t)b.m_tail * m_pageSizeInBytes);
+				}
+				else if (b.m_head < b.m_tail) {
+					func((size_t)(b.m_tail - b.m_head) * m_pageSizeInBytes);
+				}
+			}
+		}
+
+		// Allocations in a ring are short lived and get reclaimed in order, so they are never relocated.
+		bool PlanCompaction(size_t /*maxBytesToMove*/, std::vector<Move>* retMoves)
+		{
+			retMoves->clear();
+			return false;
+		}
+
+#if defined(VIRTUAL_ALLOCATOR_ENALBLE_STRING_DUMP)
+		std::string Dump(bool dumpEntry, bool dumpFreed, bool dumpVis) const
+		{
+			std::stringstream ss;
+
+			size_t totalUsedPages = 0;
+			for (uint32_t id = 0; id < (uint32_t)m_blocks.size(); ++id) {
+				const Block& b(m_blocks[id]);
+				if (!b.m_isActive)
+					continue;
+				totalUsedPages += b.m_usedPages;
+
+				if (dumpEntry || dumpVis || dumpFreed)
+					ss << "BlockID:" << id << " Head: " << b.m_head << " Tail: " << b.m_tail << std::endl;
+
+				if (dumpEntry || dumpFreed) {
+					ss << "Entry Dump" << std::endl;
+					for (auto&& ent : b.m_entries) {
+						if (!dumpFreed && ent.m_isFreed)
+							continue;
+						ss << "U: " << ent.m_realUsed << " O: " << ent.m_offset << " S:" << ent.m_nbPages << " T:" << ent.m_tag << (ent.m_isFreed ? " Freed" : "") << std::endl;
+					}
+				}
+
+				if (dumpVis) {
+					ss << "Visualized Dump" << std::endl;
+					std::vector<char> vis(m_pagesInBlock, ' ');
+					std::array<char, 2> chArr = { '*', '+' };
+					size_t chIdx = 0;
+					for (auto&& ent : b.m_entries) {
+						char ch = ent.m_isFreed ? '-' : chArr[chIdx++ % chArr.size()];
+						for (uint32_t i = 0; i < ent.m_nbPages; i++)
+							vis[ent.m_offset + i] = ch;
+					}
+					for (size_t i = 0; i < vis.size(); i++) {
+						ss << vis[i];
+						if ((i + 1) % 64 == 0)
+							ss << std::endl;
+					}
+					ss << std::endl;
+				}
+
+				ss << "UsedPages: " << b.m_usedPages << " Entries: " << b.m_entries.size() << std::endl;
+			}
+
+			if (m_numActiveBlocks > 0) {
+				size_t totalAllocatedBlocksInByte = m_blockSizeInBytes * m_numActiveBlocks;
+				size_t totalAllocatedBlocksInPages = (size_t)m_pagesInBlock * m_numActiveBlocks;
+
+				ss << "TotalAllocatedInBytes: " << m_totalAllocatedSizeInBytes << " : " << (double)m_totalAllocatedSizeInBytes * 100. / totalAllocatedBlocksInByte << "%" << std::endl;
+				ss << "TotalUsedInPages: " << totalUsedPages << " : " << (double)totalUsedPages * 100. / totalAllocatedBlocksInPages << "%" << std::endl;
+			}
+			else {
+				ss << "TotalAllocatedInBytes: " << m_totalAllocatedSizeInBytes << std::endl;
+			}
+
+			return ss.str();
+		}
+#endif
+	};
+
 	using FixedPageAllocator = Allocator<Type::FixedPage>;
 	using BuddyAllocator = Allocator<Type::Buddy>;
+	using TLSFAllocator = Allocator<Type::TLSF>;
+	using RingAllocator = Allocator<Type::Ring>;
 
 };
@@ -0,0 +1,55 @@
+/*
+* Copyright (c) 2022 NVIDIA CORPORATION. All rights reserved
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Binary format of allocation traces recorded by shared buffers. It is also read by the AllocatorReplay tool.
+// A trace file consists of a TraceHeader followed by fixed sized TraceEvents.
+namespace KickstartRT::AllocationTrace {
+
+	struct TraceHeader {
+		char		signature[4];
+		uint32_t	version;
+		uint64_t	blockSizeInBytes;
+		uint64_t	alignmentSizeInBytes;
+	};
+
+	enum class EventType : uint32_t {
+		Alloc = 0,				// id: a new allocation ID, value: requested size in bytes.
+		Free = 1,				// id: the allocation ID to free.
+		CheckUnusedBlocks = 2,	// value: framesToRemove. It is called once per task, so the frame index is incremented after it.
+		Defragment = 3,			// value: maxBytesToMove.
+	};
+
+	struct TraceEvent
+	{
+		uint32_t type;
+		uint32_t frameIndex;
+		uint64_t id;
+		uint64_t value;
+	};
+
+	static constexpr const char* kTraceSignature = "KSAT";
+	static constexpr const size_t kTraceSignatureSize = 4;
+	static constexpr const uint32_t kTraceVersion = 1;
+};
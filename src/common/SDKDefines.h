@@ -27,6 +27,16 @@
 #define KICKSTARTRT_ENABLE_SHARED_BUFFERS_FOR_TEMPORAL_DEVICE_RESOURCES 1
 #define KICKSTARTRT_ENABLE_SHARED_BUFFERS_FOR_READBACK_AND_COUNTER_RESOURCES 1
 
+// Use TLSF (O(1) alloc and free) allocator instead of FixedPage allocator for shared buffers of persistent device resources.
+#define KICKSTARTRT_USE_TLSF_ALLOCATOR_FOR_PERSISTENT_DEVICE_RESOURCES 1
+
+// Use ring allocator, which reclaims allocations in bulk after their tasks are finished, instead of FixedPage allocator for shared buffers of temporal device resources released at the end of their tasks (BLAS scratch and DLC temp).
+// Temporal vertex and BLAS buffers can be kept for many frames, so they always use FixedPage allocator.
+#define KICKSTARTRT_USE_RING_ALLOCATOR_FOR_TEMPORAL_DEVICE_RESOURCES 1
+
+// Record allocation traces of shared buffers while logging resource allocations. Traces are written next to the log file and can be replayed with the AllocatorReplay tool.
+#define KICKSTARTRT_ENABLE_ALLOCATION_TRACE 0
+
 // This enables indirection table to refer Direct Lighting Cache in shaders, and it will reduce the number of descriptor table entry while ray tracing.
 // This required to enable shared buffers.
 // that this is also referred in shader codes, so you need to recompile them after changing the sate.
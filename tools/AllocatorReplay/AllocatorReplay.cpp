@@ -0,0 +1,524 @@
+/*
+* Copyright (c) 2022 NVIDIA CORPORATION. All rights reserved
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <VirtualAllocator.h>
+#include <common/AllocationTrace.h>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+
+#include "Options.h"
+
+using namespace KickstartRT;
+
+// Replays a trace recorded by SharedBuffer_VirtualAllocatorImpl. Entries that don't fit in the half of a block are allocated exclusively
+// in SharedBuffer, so they don't hit the allocator and are only counted in the footprint.
+
+static CommandLineOptions g_Options;
+
+struct FrameSample
+{
+	uint32_t	frameIndex = 0;
+	size_t		numberOfBlocks = 0;
+	size_t		footprintInBytes = 0;
+	size_t		liveInBytes = 0;
+	size_t		freeInBytes = 0;
+	size_t		largestFreeInBytes = 0;
+
+	double ExternalFragmentation() const
+	{
+		if (freeInBytes == 0)
+			return 0.0;
+		return 1.0 - (double)largestFreeInBytes / (double)freeInBytes;
+	}
+};
+
+struct ReplayResult
+{
+	bool		succeeded = false;
+	size_t		numberOfOperations = 0;
+	double		elapsedSeconds = 0.0;
+	size_t		peakFootprintInBytes = 0;
+	size_t		peakLiveInBytes = 0;
+	size_t		peakNumberOfBlocks = 0;
+	size_t		numberOfMoves = 0;
+	size_t		movedBytes = 0;
+	std::vector<FrameSample>	frames;
+};
+
+template<typename AllocatorType>
+class Replayer
+{
+	struct Allocation {
+		size_t	m_offset = 0;
+		size_t	m_size = 0;
+		bool	m_isExclusive = false;
+	};
+
+	AllocatorType								m_allocator;
+	size_t										m_blockSizeInBytes = 0;
+	size_t										m_pageSizeInBytes = 0;
+	std::unordered_map<uint64_t, Allocation>	m_allocations;
+	std::unordered_map<size_t, uint64_t>		m_idsByOffset;
+	std::vector<uint32_t>						m_blockIDs;
+	std::vector<uint32_t>						m_freeFrames;
+	std::vector<VirtualAllocator::Move>			m_moves;
+	std::vector<size_t>							m_pendingSrcOffsets; // sources of moves, released at the end of the frame like deferred releases.
+	size_t										m_exclusiveInBytes = 0;
+	size_t										m_liveInBytes = 0;
+
+	size_t Footprint() const
+	{
+		return m_allocator.NumberOfBlocks() * m_blockSizeInBytes + m_exclusiveInBytes;
+	}
+
+	// Same as SharedBuffer_VirtualAllocatorImpl::CheckUnusedBufferBlocks().
+	bool CheckUnusedBlocks(uint64_t framesToRemove)
+	{
+		size_t nbBlocks = m_allocator.NumberOfBlocks();
+		if (nbBlocks == 0) {
+			m_freeFrames.clear();
+			return true;
+		}
+
+		std::vector<uint32_t>	currentIDs(nbBlocks);
+		std::vector<uint32_t>	currentOccupancy(nbBlocks);
+		m_allocator.BlockStatus(currentIDs.data(), currentOccupancy.data());
+
+		if (m_freeFrames.size() != nbBlocks || !std::equal(m_blockIDs.begin(), m_blockIDs.end(), currentIDs.begin())) {
+			m_freeFrames.assign(nbBlocks, 0);
+			std::swap(m_blockIDs, currentIDs);
+			return true;
+		}
+
+		for (size_t i = 0; i < currentOccupancy.size(); ++i) {
+			if (currentOccupancy[i] == 1) {
+				m_freeFrames[i] = 0;
+				continue;
+			}
+			++m_freeFrames[i];
+		}
+
+		std::vector<uint32_t>	aIDsToRemove;
+		size_t idxToRemove = m_freeFrames.size();
+		size_t numberToRemove = 10;
+		while (idxToRemove > 0) {
+			if (m_freeFrames[--idxToRemove] < framesToRemove)
+				continue;
+			aIDsToRemove.push_back(m_blockIDs[idxToRemove]);
+			if (--numberToRemove == 0)
+				break;
+		}
+		if (aIDsToRemove.size() > 0)
+			return m_allocator.RemoveUnusedBlocks(aIDsToRemove);
+
+		return true;
+	}
+
+	void Sample(uint32_t frameIndex, ReplayResult& res) const
+	{
+		FrameSample s;
+		s.frameIndex = frameIndex;
+		s.numberOfBlocks = m_allocator.NumberOfBlocks();
+		s.footprintInBytes = Footprint();
+		s.liveInBytes = m_liveInBytes;
+		m_allocator.VisitFreeChunks([&s](size_t sizeInBytes) {
+			s.freeInBytes += sizeInBytes;
+			s.largestFreeInBytes = std::max(s.largestFreeInBytes, sizeInBytes);
+			});
+		res.frames.push_back(s);
+	}
+
+public:
+	bool Init(size_t blockSizeInBytes, size_t pageSizeInBytes, uint32_t smallPageThreshold)
+	{
+		m_blockSizeInBytes = blockSizeInBytes;
+		m_pageSizeInBytes = pageSizeInBytes;
+		if (!m_allocator.Init(true, blockSizeInBytes, pageSizeInBytes))
+			return false;
+		if constexpr (std::is_same_v<AllocatorType, VirtualAllocator::FixedPageAllocator>) {
+			if (smallPageThreshold > 0)
+				m_allocator.SetSmallPageThreshold(smallPageThreshold);
+		}
+		return true;
+	}
+
+	// Frame samples and peaks are collected only if collectStats is true, so that they don't disturb the throughput measurement.
+	bool Run(const std::vector<AllocationTrace::TraceEvent>& events, bool collectStats, ReplayResult& res)
+	{
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		for (auto&& ev : events) {
+			switch ((AllocationTrace::EventType)ev.type) {
+			case AllocationTrace::EventType::Alloc:
+			{
+				Allocation a;
+				a.m_size = (ev.value + m_pageSizeInBytes - 1) / m_pageSizeInBytes * m_pageSizeInBytes;
+				if (a.m_size > m_blockSizeInBytes / 2) {
+					a.m_isExclusive = true;
+					m_exclusiveInBytes += a.m_size;
+				}
+				else {
+					if constexpr (std::is_same_v<AllocatorType, VirtualAllocator::RingAllocator>) {
+						m_allocator.SetCurrentTag(ev.frameIndex);
+					}
+					if (!m_allocator.Alloc(a.m_size, &a.m_offset)) {
+						std::cerr << "Failed to allocate " << a.m_size << " bytes. (ID:" << ev.id << ")" << std::endl;
+						return false;
+					}
+					m_idsByOffset[a.m_offset] = ev.id;
+				}
+				m_liveInBytes += a.m_size;
+				m_allocations[ev.id] = a;
+
+				if (collectStats) {
+					res.peakFootprintInBytes = std::max(res.peakFootprintInBytes, Footprint());
+					res.peakLiveInBytes = std::max(res.peakLiveInBytes, m_liveInBytes);
+					res.peakNumberOfBlocks = std::max(res.peakNumberOfBlocks, m_allocator.NumberOfBlocks());
+				}
+				break;
+			}
+			case AllocationTrace::EventType::Free:
+			{
+				auto itr = m_allocations.find(ev.id);
+				if (itr == m_allocations.end()) {
+					std::cerr << "Unknown allocation ID is freed. (ID:" << ev.id << ")" << std::endl;
+					return false;
+				}
+				const Allocation& a = itr->second;
+				if (a.m_isExclusive) {
+					m_exclusiveInBytes -= a.m_size;
+				}
+				else {
+					if (!m_allocator.Free(a.m_offset)) {
+						std::cerr << "Failed to free an allocation. (ID:" << ev.id << ")" << std::endl;
+						return false;
+					}
+					m_idsByOffset.erase(a.m_offset);
+				}
+				m_liveInBytes -= a.m_size;
+				m_allocations.erase(itr);
+				break;
+			}
+			case AllocationTrace::EventType::CheckUnusedBlocks:
+				// frees in a trace are recorded after their tasks are finished.
+				if constexpr (std::is_same_v<AllocatorType, VirtualAllocator::RingAllocator>) {
+					m_allocator.Reclaim(ev.frameIndex);
+				}
+				for (auto&& ofs : m_pendingSrcOffsets)
+					m_allocator.Free(ofs);
+				m_pendingSrcOffsets.clear();
+				if (!CheckUnusedBlocks(ev.value)) {
+					std::cerr << "Failed to remove unused blocks." << std::endl;
+					return false;
+				}
+				if (collectStats)
+					Sample(ev.frameIndex, res);
+				break;
+			case AllocationTrace::EventType::Defragment:
+				if (!m_allocator.PlanCompaction((size_t)ev.value, &m_moves))
+					break;
+				for (auto&& m : m_moves) {
+					auto itr = m_idsByOffset.find(m.m_srcOffset);
+					if (itr == m_idsByOffset.end()) {
+						// a source of a previous move which is not released yet. SharedBuffer leaves it in place.
+						m_allocator.Free(m.m_dstOffset);
+						continue;
+					}
+					uint64_t id = itr->second;
+					m_idsByOffset.erase(itr);
+					m_idsByOffset[m.m_dstOffset] = id;
+					m_allocations[id].m_offset = m.m_dstOffset;
+					m_pendingSrcOffsets.push_back(m.m_srcOffset);
+					res.movedBytes += m.m_size;
+					res.numberOfMoves++;
+				}
+				break;
+			default:
+				std::cerr << "Unknown event type: " << ev.type << std::endl;
+				return false;
+			}
+		}
+
+		res.elapsedSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+		res.numberOfOperations += events.size();
+
+		return true;
+	}
+};
+
+static bool LoadTrace(const std::string& filePath, AllocationTrace::TraceHeader& header, std::vector<AllocationTrace::TraceEvent>& events)
+{
+	std::ifstream ifs(std::filesystem::path(filePath), std::ios::in | std::ios::binary);
+	if (!ifs.is_open()) {
+		std::cerr << "Failed to open the trace file: " << filePath << std::endl;
+		return false;
+	}
+
+	ifs.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!ifs.good() || memcmp(header.signature, AllocationTrace::kTraceSignature, AllocationTrace::kTraceSignatureSize) != 0) {
+		std::cerr << "Invalid trace file: " << filePath << std::endl;
+		return false;
+	}
+	if (header.version != AllocationTrace::kTraceVersion) {
+		std::cerr << "Unsupported trace version: " << header.version << std::endl;
+		return false;
+	}
+
+	AllocationTrace::TraceEvent ev;
+	while (ifs.read(reinterpret_cast<char*>(&ev), sizeof(ev)))
+		events.push_back(ev);
+
+	return true;
+}
+
+static bool WriteCSV(const std::string& filePath, const ReplayResult& res)
+{
+	std::ofstream ofs(std::filesystem::path(filePath), std::ios::out | std::ios::trunc);
+	if (!ofs.is_open()) {
+		std::cerr << "Failed to open a CSV file: " << filePath << std::endl;
+		return false;
+	}
+
+	ofs << "FrameIndex,NumberOfBlocks,FootprintInBytes,LiveInBytes,FreeInBytes,LargestFreeInBytes,ExternalFragmentation" << std::endl;
+	for (auto&& s : res.frames) {
+		ofs << s.frameIndex << "," << s.numberOfBlocks << "," << s.footprintInBytes << "," << s.liveInBytes << ","
+			<< s.freeInBytes << "," << s.largestFreeInBytes << "," << s.ExternalFragmentation() << std::endl;
+	}
+
+	return true;
+}
+
+static void PrintResult(const char* name, const ReplayResult& res)
+{
+	const double MB = 1024.0 * 1024.0;
+
+	size_t minBlocks = size_t(-1), maxBlocks = 0;
+	double avgBlocks = 0.0, avgFragmentation = 0.0, maxFragmentation = 0.0;
+	for (auto&& s : res.frames) {
+		minBlocks = std::min(minBlocks, s.numberOfBlocks);
+		maxBlocks = std::max(maxBlocks, s.numberOfBlocks);
+		avgBlocks += (double)s.numberOfBlocks;
+		avgFragmentation += s.ExternalFragmentation();
+		maxFragmentation = std::max(maxFragmentation, s.ExternalFragmentation());
+	}
+	if (res.frames.size() > 0) {
+		avgBlocks /= (double)res.frames.size();
+		avgFragmentation /= (double)res.frames.size();
+	}
+	else {
+		minBlocks = 0;
+	}
+
+	std::cout << "[" << name << "]" << std::endl;
+	std::cout << "  Throughput             : " << (double)res.numberOfOperations / res.elapsedSeconds / 1.0e6 << " Mops/s ("
+		<< res.numberOfOperations << " ops in " << res.elapsedSeconds * 1000.0 << " ms)" << std::endl;
+	std::cout << "  Peak footprint         : " << (double)res.peakFootprintInBytes / MB << " MB (peak live: " << (double)res.peakLiveInBytes / MB << " MB)" << std::endl;
+	std::cout << "  Blocks per frame       : min " << minBlocks << ", avg " << avgBlocks << ", max " << maxBlocks << " (peak: " << res.peakNumberOfBlocks << ")" << std::endl;
+	std::cout << "  External fragmentation : avg " << avgFragmentation << ", max " << maxFragmentation << " (1 - largest free chunk / total free)" << std::endl;
+	if (res.numberOfMoves > 0)
+		std::cout << "  Compaction             : " << res.numberOfMoves << " moves, " << (double)res.movedBytes / MB << " MB" << std::endl;
+}
+
+template<typename AllocatorType>
+static bool Replay(const char* name, const AllocationTrace::TraceHeader& header, const std::vector<AllocationTrace::TraceEvent>& events)
+{
+	size_t blockSize = g_Options.blockSizeInBytes > 0 ? (size_t)g_Options.blockSizeInBytes : (size_t)header.blockSizeInBytes;
+	size_t pageSize = g_Options.pageSizeInBytes > 0 ? (size_t)g_Options.pageSizeInBytes : (size_t)header.alignmentSizeInBytes;
+
+	ReplayResult res;
+
+	// timed replays without sampling.
+	for (uint32_t i = 0; i < g_Options.iterations; ++i) {
+		Replayer<AllocatorType> r;
+		if (!r.Init(blockSize, pageSize, g_Options.smallPageThreshold)) {
+			std::cerr << "[" << name << "] Failed to initialize the allocator. Block size:" << blockSize << " Page size:" << pageSize << std::endl;
+			return false;
+		}
+		if (!r.Run(events, false, res)) {
+			std::cerr << "[" << name << "] Failed to replay the trace." << std::endl;
+			return false;
+		}
+	}
+
+	// replay again to collect statistics.
+	{
+		ReplayResult statRes;
+		Replayer<AllocatorType> r;
+		r.Init(blockSize, pageSize, g_Options.smallPageThreshold);
+		if (!r.Run(events, true, statRes))
+			return false;
+
+		res.peakFootprintInBytes = statRes.peakFootprintInBytes;
+		res.peakLiveInBytes = statRes.peakLiveInBytes;
+		res.peakNumberOfBlocks = statRes.peakNumberOfBlocks;
+		res.numberOfMoves = statRes.numberOfMoves;
+		res.movedBytes = statRes.movedBytes;
+		res.frames = std::move(statRes.frames);
+	}
+
+	PrintResult(name, res);
+
+	if (!g_Options.csvFile.empty()) {
+		std::filesystem::path p(g_Options.csvFile);
+		std::filesystem::path csvPath = p.parent_path() / (p.stem().string() + "_" + name + ".csv");
+		if (!WriteCSV(csvPath.string(), res))
+			return false;
+	}
+
+	return true;
+}
+
+// Synthetic churn: the live set is filled up to liveCount allocations, then each step frees a random live allocation and allocates a new one.
+// The time per operation should stay flat over live set sizes for an allocator with O(1) alloc and free.
+template<typename AllocatorType>
+static bool RunSynthetic(const char* name, size_t blockSize, size_t pageSize, uint32_t liveCount)
+{
+	AllocatorType allocator;
+	if (!allocator.Init(true, blockSize, pageSize)) {
+		std::cerr << "[" << name << "] Failed to initialize the allocator. Block size:" << blockSize << " Page size:" << pageSize << std::endl;
+		return false;
+	}
+
+	std::mt19937 rng(1);
+	std::uniform_int_distribution<uint32_t> pageDist(1, g_Options.maxAllocationPages);
+
+	// sizes are generated up front so that the random number generation isn't timed.
+	std::vector<size_t> sizes((size_t)liveCount + g_Options.operations);
+	for (auto&& s : sizes)
+		s = (size_t)pageDist(rng) * pageSize;
+	std::vector<uint32_t> victims(g_Options.operations);
+	for (auto&& v : victims)
+		v = rng() % liveCount;
+
+	std::vector<size_t> offsets(liveCount);
+	size_t sizeIdx = 0;
+
+	auto fillStart = std::chrono::high_resolution_clock::now();
+	for (auto&& ofs : offsets) {
+		if (!allocator.Alloc(sizes[sizeIdx++], &ofs)) {
+			std::cerr << "[" << name << "] Failed to allocate while filling the live set." << std::endl;
+			return false;
+		}
+	}
+	double fillSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - fillStart).count();
+
+	double churnSeconds = 0.0;
+	for (uint32_t it = 0; it < g_Options.iterations; ++it) {
+		auto churnStart = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < g_Options.operations; ++i) {
+			size_t& ofs(offsets[victims[i]]);
+			if (!allocator.Free(ofs)) {
+				std::cerr << "[" << name << "] Failed to free an allocation." << std::endl;
+				return false;
+			}
+			if (!allocator.Alloc(sizes[liveCount + i], &ofs)) {
+				std::cerr << "[" << name << "] Failed to allocate " << sizes[liveCount + i] << " bytes." << std::endl;
+				return false;
+			}
+		}
+		churnSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - churnStart).count();
+	}
+
+	const double nbChurnOps = 2.0 * (double)g_Options.operations * (double)g_Options.iterations;
+	std::cout << "  " << name << " live " << liveCount << ": fill " << fillSeconds * 1.0e9 / (double)liveCount << " ns/alloc, churn "
+		<< churnSeconds * 1.0e9 / nbChurnOps << " ns/op, " << allocator.NumberOfBlocks() << " blocks" << std::endl;
+
+	return true;
+}
+
+static int RunSyntheticBenchmarks()
+{
+	size_t blockSize = g_Options.blockSizeInBytes > 0 ? (size_t)g_Options.blockSizeInBytes : 16 * 1024 * 1024;
+	size_t pageSize = g_Options.pageSizeInBytes > 0 ? (size_t)g_Options.pageSizeInBytes : 256;
+
+	std::cout << "Synthetic churn: block size: " << blockSize << ", page size: " << pageSize << ", allocation size: 1-" << g_Options.maxAllocationPages
+		<< " pages, " << g_Options.operations << " free/alloc pairs x " << g_Options.iterations << std::endl;
+
+	bool succeeded = true;
+	for (uint32_t liveCount : g_Options.liveCounts) {
+		if (liveCount == 0)
+			continue;
+		for (auto kind : g_Options.allocators) {
+			switch (kind) {
+			case AllocatorKind::FixedPage:
+				succeeded &= RunSynthetic<VirtualAllocator::FixedPageAllocator>("FixedPage", blockSize, pageSize, liveCount);
+				break;
+			case AllocatorKind::Buddy:
+				succeeded &= RunSynthetic<VirtualAllocator::BuddyAllocator>("Buddy", blockSize, pageSize, liveCount);
+				break;
+			case AllocatorKind::TLSF:
+				succeeded &= RunSynthetic<VirtualAllocator::TLSFAllocator>("TLSF", blockSize, pageSize, liveCount);
+				break;
+			case AllocatorKind::Ring:
+				// Ring reuses memory only in allocation order, random frees don't model it.
+				break;
+			}
+		}
+	}
+
+	return succeeded ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+	if (!g_Options.parse(argc, argv))
+	{
+		std::cout << g_Options.errorMessage << std::endl;
+		return 1;
+	}
+
+	if (g_Options.synthetic)
+		return RunSyntheticBenchmarks();
+
+	AllocationTrace::TraceHeader header;
+	std::vector<AllocationTrace::TraceEvent> events;
+	if (!LoadTrace(g_Options.inputFile, header, events))
+		return 1;
+
+	std::cout << "Trace: " << g_Options.inputFile << " (" << events.size() << " events, block size: " << header.blockSizeInBytes
+		<< ", alignment: " << header.alignmentSizeInBytes << ")" << std::endl;
+
+	bool succeeded = true;
+	for (auto kind : g_Options.allocators) {
+		switch (kind) {
+		case AllocatorKind::FixedPage:
+			succeeded &= Replay<VirtualAllocator::FixedPageAllocator>("FixedPage", header, events);
+			break;
+		case AllocatorKind::Buddy:
+			succeeded &= Replay<VirtualAllocator::BuddyAllocator>("Buddy", header, events);
+			break;
+		case AllocatorKind::TLSF:
+			succeeded &= Replay<VirtualAllocator::TLSFAllocator>("TLSF", header, events);
+			break;
+		case AllocatorKind::Ring:
+			succeeded &= Replay<VirtualAllocator::RingAllocator>("Ring", header, events);
+			break;
+		}
+	}
+
+	return succeeded ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+/*
+* Copyright (c) 2022 NVIDIA CORPORATION. All rights reserved
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <cxxopts.hpp>
+#include <filesystem>
+
+#include "Options.h"
+
+using namespace std;
+using namespace cxxopts;
+
+bool CommandLineOptions::parse(int argc, char** argv)
+{
+	Options options("allocatorReplay", "Replays a shared buffer allocation trace, or runs a synthetic alloc/free churn, against VirtualAllocator types");
+
+	string allocatorName = "all";
+
+	options.add_options()
+		("i,infile", "Allocation trace file (.kstrace)", value(inputFile))
+		("a,allocator", "Allocator type, one of: fixed, buddy, tlsf, ring, all", value(allocatorName))
+		("b,block", "Block size in bytes (default: the value in the trace)", value(blockSizeInBytes))
+		("p,page", "Page size in bytes (default: the value in the trace)", value(pageSizeInBytes))
+		("s,smallPageThreshold", "Small page threshold in pages for the FixedPage allocator", value(smallPageThreshold))
+		("n,iterations", "Number of timed replays to measure throughput", value(iterations))
+		("c,csv", "Write per frame statistics to CSV files (<stem>_<allocator>.csv)", value(csvFile))
+		("synthetic", "Run a synthetic alloc/free churn instead of replaying a trace", value(synthetic))
+		("live", "Live allocation counts of the synthetic churn, comma separated (default: 1000,10000,100000)", value(liveCounts))
+		("ops", "Number of free/alloc pairs per synthetic run", value(operations))
+		("maxPages", "Maximum allocation size in pages of the synthetic churn", value(maxAllocationPages))
+		("h,help", "Print the help message", value(help));
+
+	try
+	{
+		options.parse(argc, argv);
+
+		if (help)
+		{
+			errorMessage = options.help();
+			return false;
+		}
+
+		if (synthetic) {
+			if (liveCounts.empty())
+				liveCounts = { 1000, 10000, 100000 };
+			if (operations == 0 || maxAllocationPages == 0)
+				throw OptionException("Number of operations and maximum allocation pages must be greater than zero");
+		}
+		else {
+			if (inputFile.empty())
+				throw OptionException("Input file not specified");
+
+			if (!filesystem::exists(inputFile))
+				throw OptionException("Specified input file (" + inputFile + ") does not exist");
+		}
+
+		if (iterations == 0)
+			throw OptionException("Number of iterations must be greater than zero");
+
+		for (char& c : allocatorName)
+			c = (char)tolower(c);
+		if (allocatorName == "fixed" || allocatorName == "fixedpage")
+			allocators = { AllocatorKind::FixedPage };
+		else if (allocatorName == "buddy")
+			allocators = { AllocatorKind::Buddy };
+		else if (allocatorName == "tlsf")
+			allocators = { AllocatorKind::TLSF };
+		else if (allocatorName == "ring")
+			allocators = { AllocatorKind::Ring };
+		else if (allocatorName == "all")
+			allocators = { AllocatorKind::FixedPage, AllocatorKind::Buddy, AllocatorKind::TLSF, AllocatorKind::Ring };
+		else
+			throw OptionException("Unrecognized allocator: " + allocatorName);
+
+		return true;
+	}
+	catch (const OptionException& e)
+	{
+		errorMessage = e.what();
+		return false;
+	}
+}
@@ -0,0 +1,53 @@
+/*
+* Copyright (c) 2022 NVIDIA CORPORATION. All rights reserved
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class AllocatorKind
+{
+	FixedPage,
+	Buddy,
+	TLSF,
+	Ring
+};
+
+struct CommandLineOptions
+{
+	std::string inputFile;
+	std::string csvFile;
+	std::vector<AllocatorKind> allocators;
+	uint64_t blockSizeInBytes = 0;		// zero means the value in the trace header.
+	uint64_t pageSizeInBytes = 0;		// zero means the value in the trace header.
+	uint32_t smallPageThreshold = 0;	// zero means the allocator's default. FixedPage only.
+	uint32_t iterations = 1;
+	bool synthetic = false;				// run a synthetic alloc/free churn instead of replaying a trace.
+	std::vector<uint32_t> liveCounts;	// live allocation counts of the synthetic churn.
+	uint32_t operations = 1000000;		// alloc/free pairs per synthetic run.
+	uint32_t maxAllocationPages = 64;	// allocation sizes of the synthetic churn are uniform in [1, maxAllocationPages] pages.
+	bool help = false;
+
+	std::string errorMessage;
+
+	bool parse(int argc, char** argv);
+};
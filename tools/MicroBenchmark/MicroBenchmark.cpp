@@ -0,0 +1,456 @@
+/*
+* Copyright (c) 2022 NVIDIA CORPORATION. All rights reserved
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <RangeMerge.h>
+#include <DescriptorBatchedWrites.h>
+#include <SlotMap.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "Options.h"
+
+using namespace KickstartRT_NativeLayer;
+
+static CommandLineOptions g_Options;
+
+/***************************************************************
+ * Common setup of the benchmarks.
+ ***************************************************************/
+using Clock = std::chrono::high_resolution_clock;
+
+// Results of measured work are added to it, so that the compiler doesn't drop the work.
+static uint64_t g_sink = 0;
+
+// Problem sizes given with --counts, or the defaults of a benchmark. Zero is skipped.
+static std::vector<uint32_t> Counts(const std::vector<uint32_t>& defaults)
+{
+	std::vector<uint32_t> counts;
+	for (uint32_t c : g_Options.counts.empty() ? defaults : g_Options.counts) {
+		if (c > 0)
+			counts.push_back(c);
+	}
+	return counts;
+}
+
+// Accumulates the time of measured sections.
+struct Timer {
+	double	m_seconds = 0.0;
+
+	template<typename F>
+	void Measure(F&& f)
+	{
+		auto start = Clock::now();
+		f();
+		m_seconds += std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	double NanosecondsPer(double nbOps) const
+	{
+		return m_seconds * 1.0e9 / nbOps;
+	}
+};
+
+/***************************************************************
+ * SharedBuffer clear request merging.
+ ***************************************************************/
+// Same as SharedBuffer::MergeClearRequests().
+static void MergeClearRequests(std::deque<std::pair<uint64_t, uint64_t>>& requests, std::vector<std::pair<uint64_t, uint64_t>>& retRanges)
+{
+	retRanges.assign(requests.begin(), requests.end());
+	requests.clear();
+	RangeMerge::SortAndMerge(retRanges);
+}
+
+// Clear requests of entries packed in a block. Some entries are separated by free space, so they are merged into runs.
+// Requests come either in the address order, which is typical for entries allocated in a batch, or shuffled.
+static bool RunClear()
+{
+	const uint64_t alignment = 256;
+
+	std::cout << "Clear request merge: " << g_Options.iterations << " iterations" << std::endl;
+
+	for (uint32_t count : Counts({ 64, 1024, 16384 })) {
+		std::mt19937 rng(1);
+		std::uniform_int_distribution<uint32_t> pageDist(1, 16);
+		std::vector<std::pair<uint64_t, uint64_t>> inOrder(count);
+		uint64_t offset = 0;
+		for (auto&& r : inOrder) {
+			if (rng() % 4 == 0)
+				offset += pageDist(rng) * alignment; // free space between entries.
+			r = { offset, pageDist(rng) * alignment };
+			offset += r.second;
+		}
+		std::vector<std::pair<uint64_t, uint64_t>> shuffled(inOrder);
+		std::shuffle(shuffled.begin(), shuffled.end(), rng);
+
+		auto Measure = [&](const char* name, const std::vector<std::pair<uint64_t, uint64_t>>& src) {
+			std::deque<std::pair<uint64_t, uint64_t>> requests;
+			std::vector<std::pair<uint64_t, uint64_t>> merged;
+			Timer timer;
+			for (uint32_t it = 0; it < g_Options.iterations; ++it) {
+				// requests are registered by Allocate(), which isn't part of the merge.
+				requests.assign(src.begin(), src.end());
+				timer.Measure([&]() { MergeClearRequests(requests, merged); });
+			}
+			std::cout << "  " << count << " requests " << name << ": " << timer.NanosecondsPer((double)count * g_Options.iterations) << " ns/request, "
+				<< merged.size() << " ranges" << std::endl;
+		};
+		Measure("in order", inOrder);
+		Measure("shuffled", shuffled);
+	}
+
+	return true;
+}
+
+/***************************************************************
+ * Batched VK descriptor writes.
+ ***************************************************************/
+// Stand-ins of the VK structs with the same sizes, since the tool is built without a graphics API.
+struct DescriptorImageInfo {
+	uint64_t	sampler;
+	uint64_t	imageView;
+	uint32_t	imageLayout;
+};
+struct DescriptorBufferInfo {
+	uint64_t	buffer;
+	uint64_t	offset;
+	uint64_t	range;
+};
+struct WriteDescriptorSetAccelerationStructure {
+	uint32_t		sType;
+	const void*		pNext;
+	uint32_t		accelerationStructureCount;
+	const uint64_t*	pAccelerationStructures;
+};
+struct WriteDescriptorSet {
+	uint32_t					sType;
+	const void*					pNext;
+	uint64_t					dstSet;
+	uint32_t					dstBinding;
+	uint32_t					dstArrayElement;
+	uint32_t					descriptorCount;
+	uint32_t					descriptorType;
+	const DescriptorImageInfo*	pImageInfo;
+	const DescriptorBufferInfo*	pBufferInfo;
+	const uint64_t*				pTexelBufferView;
+};
+
+// GraphicsAPI::DescriptorBatchedWrites with the stand-ins.
+using BatchedWrites = DescriptorBatchedWrites<WriteDescriptorSet, DescriptorImageInfo, DescriptorBufferInfo, uint64_t, WriteDescriptorSetAccelerationStructure, uint64_t>;
+
+// Stand-in of vkUpdateDescriptorSets(). It only reads the writes, so the driver cost of each call isn't included.
+static uint64_t g_numUpdateCalls = 0;
+#if defined(_MSC_VER)
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+static void UpdateDescriptorSets(const WriteDescriptorSet* writes, uint32_t count)
+{
+	++g_numUpdateCalls;
+	for (uint32_t i = 0; i < count; ++i) {
+		const auto& w(writes[i]);
+		g_sink += w.dstSet + w.dstBinding;
+		if (w.pImageInfo != nullptr)
+			g_sink += w.pImageInfo->imageView;
+		if (w.pBufferInfo != nullptr)
+			g_sink += w.pBufferInfo->offset;
+	}
+}
+
+// CPU cost of writing descriptors of tables as DescriptorTable does, with an update call per view, or batched into a call per table
+// with a scratch per table or a scratch shared by the tables of a heap. Three quarters of descriptors are textures and the rest are buffers.
+static bool RunTable()
+{
+	const uint32_t nbTables = 1000;
+
+	std::cout << "Descriptor table writes: " << nbTables << " tables x " << g_Options.iterations << " iterations" << std::endl;
+
+	for (uint32_t count : Counts({ 4, 16, 64 })) {
+		// write is either applied immediately or recorded to the batch. same as DescriptorTable::WriteDescriptor().
+		auto FillTable = [&](BatchedWrites* b, uint32_t tableIndex) {
+			for (uint32_t i = 0; i < count; ++i) {
+				WriteDescriptorSet write = {};
+				DescriptorImageInfo imageInfo = { 0, (uint64_t)tableIndex * count + i, 5 };
+				DescriptorBufferInfo bufferInfo = { (uint64_t)tableIndex, (uint64_t)i * 256, 256 };
+				write.dstSet = tableIndex;
+				write.dstBinding = i;
+				write.descriptorCount = 1;
+				if (i % 4 != 3)
+					write.pImageInfo = &imageInfo;
+				else
+					write.pBufferInfo = &bufferInfo;
+
+				if (b == nullptr)
+					UpdateDescriptorSets(&write, 1);
+				else
+					b->Record(write);
+			}
+			if (b != nullptr)
+				b->Flush(UpdateDescriptorSets);
+		};
+
+		Timer timers[3];
+		uint64_t calls[3] = {};
+		auto Measure = [&](uint32_t i, auto&& fillTables) {
+			uint64_t startCalls = g_numUpdateCalls;
+			timers[i].Measure(fillTables);
+			calls[i] += g_numUpdateCalls - startCalls;
+		};
+		for (uint32_t it = 0; it < g_Options.iterations; ++it) {
+			Measure(0, [&]() {
+				for (uint32_t t = 0; t < nbTables; ++t)
+					FillTable(nullptr, t);
+				});
+			Measure(1, [&]() {
+				for (uint32_t t = 0; t < nbTables; ++t) {
+					BatchedWrites b;
+					FillTable(&b, t);
+				}
+				});
+			Measure(2, [&]() {
+				BatchedWrites b;
+				for (uint32_t t = 0; t < nbTables; ++t)
+					FillTable(&b, t);
+				});
+		}
+
+		const double nbFills = (double)nbTables * g_Options.iterations;
+		const char* names[3] = { "per view", "batched, scratch per table", "batched, shared scratch" };
+		std::cout << "  " << count << " descriptors:" << std::endl;
+		for (uint32_t i = 0; i < 3; ++i)
+			std::cout << "    " << names[i] << ": " << timers[i].NanosecondsPer(nbFills) << " ns/table, " << (double)calls[i] / nbFills << " update calls/table" << std::endl;
+		if (calls[0] > calls[2]) {
+			// the extra recording cost of batching is paid back by the update calls saved.
+			std::cout << "    batching with a shared scratch pays off if an update call costs more than "
+				<< std::max((timers[2].m_seconds - timers[0].m_seconds) * 1.0e9 / (double)(calls[0] - calls[2]), 0.0) << " ns in the driver" << std::endl;
+		}
+	}
+
+	return true;
+}
+
+/***************************************************************
+ * Dirty TLAS instance desc upload.
+ ***************************************************************/
+// Same size as a TLAS instance desc.
+struct InstanceDesc {
+	float		transform[12];
+	uint32_t	instanceIDAndMask;
+	uint32_t	offsetAndFlags;
+	uint64_t	accelerationStructure;
+};
+static_assert(sizeof(InstanceDesc) == 64);
+
+// CPU cost of Scene::BuildTLASPartitionCommands() to gather dirty instance descs into upload ranges and pack them for the upload, with the same RangeMerge calls,
+// for several numbers of instances and changed instances. Changed instances are picked at random every frame. Marking them dirty is done by instance updates and isn't measured.
+// The desc written for a dirty instance is a stand-in since it refers the BLAS of a geometry.
+static bool RunTLAS()
+{
+	const std::vector<uint32_t> nbInstancesList = { 10'000, 100'000, 1'000'000 };
+	const uint32_t mergeGap = 16; // Scene::m_TLASInstanceDescMergeGap
+
+	std::cout << "TLAS dirty desc gather and pack: " << g_Options.iterations << " frames" << std::endl;
+
+	for (uint32_t nbInstances : nbInstancesList) {
+		std::vector<InstanceDesc> descs(nbInstances);
+		std::vector<uint8_t> dirtyFlags(nbInstances, 0);
+		std::vector<uint32_t> dirtyIndices;
+		std::vector<std::pair<uint32_t, uint32_t>> uploadRanges;
+		std::vector<InstanceDesc> uploadBuffer;
+
+		for (uint32_t count : Counts({ 16, 256, 4096 })) {
+			if (count > nbInstances)
+				continue;
+
+			std::mt19937 rng(1);
+			std::uniform_int_distribution<uint32_t> indexDist(0, nbInstances - 1);
+			Timer timer;
+			size_t nbRanges = 0;
+			size_t nbUploaded = 0;
+			for (uint32_t it = 0; it < g_Options.iterations; ++it) {
+				for (uint32_t i = 0; i < count; ++i) {
+					uint32_t index = indexDist(rng);
+					if (!dirtyFlags[index]) {
+						dirtyFlags[index] = 1;
+						dirtyIndices.push_back(index);
+					}
+				}
+				uploadRanges.clear();
+
+				timer.Measure([&]() {
+					RangeMerge::GatherDirtyRanges(dirtyIndices, dirtyFlags, nbInstances, mergeGap, uploadRanges, [&](uint32_t index) {
+						InstanceDesc& d(descs[index]);
+						d = {};
+						d.transform[0] = d.transform[5] = d.transform[10] = 1.f;
+						d.instanceIDAndMask = index | (0xFFu << 24);
+						d.accelerationStructure = (uint64_t)index << 8;
+						});
+					dirtyIndices.clear();
+
+					// the upload buffer is persistently mapped and grows rarely.
+					size_t length = RangeMerge::TotalLength(uploadRanges);
+					if (uploadBuffer.size() < length)
+						uploadBuffer.resize(length);
+					RangeMerge::PackRanges(uploadRanges, descs.data(), uploadBuffer.data());
+					nbUploaded += length;
+					});
+				nbRanges += uploadRanges.size();
+			}
+			if (!uploadBuffer.empty())
+				g_sink += uploadBuffer[0].accelerationStructure;
+
+			std::cout << "  " << nbInstances << " instances, " << count << " changed: " << timer.m_seconds * 1.0e6 / g_Options.iterations << " us/frame, "
+				<< timer.NanosecondsPer((double)count * g_Options.iterations) << " ns/changed instance, " << nbRanges / g_Options.iterations << " ranges, "
+				<< nbUploaded / g_Options.iterations << " descs uploaded" << std::endl;
+		}
+	}
+
+	return true;
+}
+
+/***************************************************************
+ * Geometry and instance handles.
+ ***************************************************************/
+// Stand-in of a geometry or an instance record. The slot map constructs it with its handle.
+enum class RecordHandle : uint64_t { Null = 0 };
+struct Record {
+	uint64_t	m_id;
+	uint32_t	m_payload[14];
+
+	Record(uint64_t id, uint32_t value) : m_id(id)
+	{
+		m_payload[0] = value;
+	}
+};
+
+// CPU cost of SlotMap against the hash map of owned records that scene containers used before, with count live handles.
+// Churn destroys a random live record and creates a new one, and the stale handle is looked up afterwards.
+static bool RunSlotMap()
+{
+	const uint32_t iterations = std::max(g_Options.iterations / 10, 1u); // each iteration touches every handle a few times.
+
+	std::cout << "Handle churn: " << iterations << " iterations" << std::endl;
+
+	for (uint32_t count : Counts({ 1'000'000 })) {
+		// same sequence of live slots to churn for both containers.
+		std::mt19937 rng(1);
+		std::uniform_int_distribution<uint32_t> slotDist(0, count - 1);
+		std::vector<uint32_t> churnSlots(count);
+		for (auto&& s : churnSlots)
+			s = slotDist(rng);
+		std::vector<uint32_t> lookupOrder(count);
+		for (uint32_t i = 0; i < count; ++i)
+			lookupOrder[i] = i;
+		std::shuffle(lookupOrder.begin(), lookupOrder.end(), rng);
+
+		std::vector<uint64_t> handles(count);
+		std::vector<uint64_t> staleHandles(count);
+
+		// create, lookup, churn (destroy + create), stale lookup.
+		auto Measure = [&](const char* name, auto&& create, auto&& lookup, auto&& destroy, auto&& reset) {
+			Timer timers[4];
+			for (uint32_t it = 0; it < iterations; ++it) {
+				reset();
+
+				timers[0].Measure([&]() {
+					for (uint32_t i = 0; i < count; ++i)
+						handles[i] = create(i);
+					});
+				timers[1].Measure([&]() {
+					for (uint32_t i : lookupOrder)
+						g_sink += lookup(handles[i])->m_payload[0];
+					});
+				timers[2].Measure([&]() {
+					for (uint32_t i = 0; i < count; ++i) {
+						uint64_t& h(handles[churnSlots[i]]);
+						staleHandles[i] = h;
+						destroy(h);
+						h = create(i);
+					}
+					});
+				timers[3].Measure([&]() {
+					for (uint32_t i : lookupOrder)
+						g_sink += lookup(staleHandles[i]) == nullptr ? 0 : 1;
+					});
+			}
+
+			const double nbOps = (double)count * iterations;
+			std::cout << "  " << count << " handles " << name << ": create " << timers[0].NanosecondsPer(nbOps) << " ns, lookup " << timers[1].NanosecondsPer(nbOps)
+				<< " ns, destroy + create " << timers[2].NanosecondsPer(nbOps) << " ns, stale lookup " << timers[3].NanosecondsPer(nbOps) << " ns" << std::endl;
+		};
+
+		{
+			std::unique_ptr<SlotMap<Record, RecordHandle>> slotMap;
+			Measure("slot map",
+				[&](uint32_t v) { return slotMap->Allocate(v)->m_id; },
+				[&](uint64_t h) { return slotMap->ToPtr(static_cast<RecordHandle>(h)); },
+				[&](uint64_t h) { slotMap->Free(slotMap->ToPtr(static_cast<RecordHandle>(h))); },
+				[&]() { slotMap = std::make_unique<SlotMap<Record, RecordHandle>>(); });
+		}
+		{
+			std::unordered_map<uint64_t, std::unique_ptr<Record>> hashMap;
+			uint64_t nextID = 1;
+			Measure("hash map",
+				[&](uint32_t v) { uint64_t id = nextID++; hashMap.emplace(id, std::make_unique<Record>(id, v)); return id; },
+				[&](uint64_t h) { auto itr = hashMap.find(h); return itr != hashMap.end() ? itr->second.get() : nullptr; },
+				[&](uint64_t h) { hashMap.erase(h); },
+				[&]() { hashMap.clear(); nextID = 1; });
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (!g_Options.parse(argc, argv))
+	{
+		std::cout << g_Options.errorMessage << std::endl;
+		return 1;
+	}
+
+	// benchmarks in the order they run, with the options selecting them.
+	const std::pair<bool CommandLineOptions::*, bool (*)()> benchmarks[] = {
+		{ &CommandLineOptions::clear, RunClear },
+		{ &CommandLineOptions::table, RunTable },
+		{ &CommandLineOptions::tlas, RunTLAS },
+		{ &CommandLineOptions::slotMap, RunSlotMap },
+	};
+
+	bool succeeded = true;
+	for (auto&& b : benchmarks) {
+		if (g_Options.*b.first)
+			succeeded &= b.second();
+	}
+
+	if (g_sink == 0)
+		std::cout << std::endl;
+
+	return succeeded ? 0 : 1;
+}
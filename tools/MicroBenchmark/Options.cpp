@@ -0,0 +1,66 @@
+/*
+* Copyright (c) 2022 NVIDIA CORPORATION. All rights reserved
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <cxxopts.hpp>
+
+#include "Options.h"
+
+using namespace std;
+using namespace cxxopts;
+
+bool CommandLineOptions::parse(int argc, char** argv)
+{
+	Options options("microBenchmark", "Measures CPU cost of SDK internals which can be built without a graphics API. All benchmarks run if none is selected");
+
+	options.add_options()
+		("clear", "Merge clear requests of a shared buffer block", value(clear))
+		("table", "Record batched descriptor writes of tables", value(table))
+		("tlas", "Gather dirty TLAS instance descs into upload ranges", value(tlas))
+		("slotmap", "Create, destroy and look up geometry/instance handles", value(slotMap))
+		("counts", "Problem sizes, comma separated (default: depends on the benchmark)", value(counts))
+		("n,iterations", "Number of timed repetitions", value(iterations))
+		("h,help", "Print the help message", value(help));
+
+	try
+	{
+		options.parse(argc, argv);
+
+		if (help)
+		{
+			errorMessage = options.help();
+			return false;
+		}
+
+		if (iterations == 0)
+			throw OptionException("Number of iterations must be greater than zero");
+
+		// run all benchmarks if none is selected.
+		if (!clear && !table && !tlas && !slotMap)
+			clear = table = tlas = slotMap = true;
+
+		return true;
+	}
+	catch (const OptionException& e)
+	{
+		errorMessage = e.what();
+		return false;
+	}
+}
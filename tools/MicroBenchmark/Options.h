@@ -0,0 +1,40 @@
+/*
+* Copyright (c) 2022 NVIDIA CORPORATION. All rights reserved
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct CommandLineOptions
+{
+	bool clear = false;					// SharedBuffer clear request merging.
+	bool table = false;					// recording of batched VK descriptor writes.
+	bool tlas = false;					// gathering dirty TLAS instance descs.
+	bool slotMap = false;				// handle create/destroy/lookup churn of SlotMap.
+	std::vector<uint32_t> counts;		// problem sizes of each benchmark. the meaning depends on the benchmark.
+	uint32_t iterations = 100;
+	bool help = false;
+
+	std::string errorMessage;
+
+	bool parse(int argc, char** argv);
+};